@@ -0,0 +1,249 @@
+//------------------------------------------
+//    shmem event ring
+//------------------------------------------
+//
+// Variable length events in a ring of 32-bit words, written by the
+// readout list and read by any number of online monitors.
+//
+// The producer never waits for the consumers: new events overwrite the
+// oldest ones.  Each consumer has its own read cursor; a consumer that
+// falls more than a ring behind loses the events that were overwritten,
+// jumps to the newest event and counts them in ndropped.  Events are
+// only written while a consumer is attached.
+//
+// Positions are 64-bit word counts that only go up; the ring index is
+// pos & (EVRING_WORDS-1).  A record is
+//     word 0:  length of the record in words, header included
+//     word 1:  record sequence number (counts all records written)
+//     word 2:  event number given by the producer
+//     payload
+// A record never wraps: the space left at the end of the ring is skipped
+// with a one word EVRING_PAD record.
+//
+// Producer (rocTrigger):
+//     if (evring_wanted(ring)) evring_put(ring, data, nwords, evnum);
+// Several producers may write to one ring; records are committed in the
+// order the space was claimed.
+//
+// Consumer:
+//     id = evring_attach(ring);
+//     n = evring_next(ring, id, buf, maxwords, &evnum);  -- 0: no new event
+//     evring_detach(ring, id);
+// A consumer copies a record and then checks that no producer has started
+// to overwrite it; if one has, the copy is dropped.
+//
+
+#ifndef EVRING_H
+#define EVRING_H
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <sched.h>
+#include <unistd.h>
+
+#define EVRING_LINE       64
+#define EVRING_WORDS      (1<<21)            //-- 8 MB, power of 2
+#define EVRING_HDR        3
+#define EVRING_MAX_EVENT  (EVRING_WORDS/8)   //-- longest record, words
+#define EVRING_PAD        0x80000000
+#define EVRING_CONSUMERS  16
+
+typedef struct {
+  uint64_t cursor;       //-- next record to read
+  uint64_t next_seq;     //-- sequence number expected at cursor
+  uint64_t nread;        //-- events read
+  uint64_t ndropped;     //-- events overwritten before they were read
+  uint64_t nlapped;      //-- times the consumer was overrun
+  int32_t  pid;          //-- owner, 0 if free
+  uint32_t pad[5];
+} __attribute__((__packed__)) EvRingConsumer;
+
+typedef struct {
+  //-- written by the producers
+  uint64_t reserve __attribute__((aligned(EVRING_LINE)));  //-- end of the claimed space
+  uint64_t head;         //-- end of the committed records
+  uint64_t nput;         //-- records committed, next sequence number
+  uint64_t nskip;        //-- events too long for the ring
+  uint32_t pcount;       //-- prescale counter
+  uint32_t pad0[7];
+  //-- written by the consumers, rarely
+  int32_t  nconsumers __attribute__((aligned(EVRING_LINE)));
+  int32_t  prescale;     //-- write one event in prescale, 0 or 1: all
+  uint32_t pad1[14];
+  EvRingConsumer consumer[EVRING_CONSUMERS] __attribute__((aligned(EVRING_LINE)));
+  uint32_t words[EVRING_WORDS] __attribute__((aligned(EVRING_LINE)));
+} __attribute__((__packed__)) EventRing;
+
+//------------------------------------------
+//    producer
+//------------------------------------------
+
+//-- 1 if the next event should be written: a consumer is attached and
+//-- the prescale counter is due
+static inline int evring_wanted(EventRing *r)
+{
+  int32_t ps;
+  if (__atomic_load_n(&r->nconsumers, __ATOMIC_RELAXED) <= 0)
+    return 0;
+  ps = __atomic_load_n(&r->prescale, __ATOMIC_RELAXED);
+  if (ps <= 1)
+    return 1;
+  return __atomic_fetch_add(&r->pcount, 1, __ATOMIC_RELAXED) % ps == 0;
+}
+
+//-- write one event of nwords words; never blocks on the consumers
+//-- returns 0, -1 if the event is empty or too long
+static inline int evring_put(EventRing *r, const uint32_t *data, uint32_t nwords,
+                             uint32_t evnum)
+{
+  const uint64_t mask = EVRING_WORDS - 1;
+  uint64_t start, pos, end, seq;
+  uint32_t len = nwords + EVRING_HDR;
+  uint32_t idx, pad;
+
+  if (nwords == 0 || len > EVRING_MAX_EVENT) {
+    __atomic_fetch_add(&r->nskip, 1, __ATOMIC_RELAXED);
+    return -1;
+  }
+
+  //-- claim the space, with the pad up to the end of the ring if needed
+  start = __atomic_load_n(&r->reserve, __ATOMIC_RELAXED);
+  do {
+    idx = start & mask;
+    pad = (idx + len > EVRING_WORDS) ? EVRING_WORDS - idx : 0;
+    end = start + pad + len;
+  } while (!__atomic_compare_exchange_n(&r->reserve, &start, end, 1,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+  //-- the new reserve is seen before any word it overwrites
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  pos = start;
+  if (pad) {
+    r->words[idx] = EVRING_PAD | pad;
+    pos += pad;
+  }
+  idx = pos & mask;
+  r->words[idx] = len;
+  r->words[idx+2] = evnum;
+  memcpy(&r->words[idx+EVRING_HDR], data, nwords * sizeof(uint32_t));
+
+  //-- commit in claim order; a single producer never waits here
+  while (__atomic_load_n(&r->head, __ATOMIC_ACQUIRE) != start)
+    sched_yield();
+  seq = __atomic_load_n(&r->nput, __ATOMIC_RELAXED);
+  r->words[idx+1] = (uint32_t) seq;
+  __atomic_store_n(&r->nput, seq + 1, __ATOMIC_RELAXED);
+  __atomic_store_n(&r->head, end, __ATOMIC_RELEASE);
+  return 0;
+}
+
+//------------------------------------------
+//    consumer
+//------------------------------------------
+
+//-- take a consumer slot, reading from the next event written
+//-- slots of dead processes are taken over
+//-- returns the consumer id, -1 if all slots are in use
+static inline int evring_attach(EventRing *r)
+{
+  int32_t me = getpid(), pid;
+  int i;
+
+  for (i = 0; i < EVRING_CONSUMERS; i++) {
+    EvRingConsumer *c = &r->consumer[i];
+    int reclaim = 0;
+    pid = __atomic_load_n(&c->pid, __ATOMIC_RELAXED);
+    if (pid != 0) {
+      if (kill(pid, 0) == 0 || errno != ESRCH)
+        continue;
+      reclaim = 1;
+    }
+    if (!__atomic_compare_exchange_n(&c->pid, &pid, me, 0,
+                                     __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+      continue;
+    c->cursor = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+    c->next_seq = __atomic_load_n(&r->nput, __ATOMIC_RELAXED);
+    c->nread = c->ndropped = c->nlapped = 0;
+    if (!reclaim)
+      __atomic_fetch_add(&r->nconsumers, 1, __ATOMIC_RELAXED);
+    return i;
+  }
+  return -1;
+}
+
+static inline void evring_detach(EventRing *r, int id)
+{
+  if (id < 0 || id >= EVRING_CONSUMERS)
+    return;
+  __atomic_store_n(&r->consumer[id].pid, 0, __ATOMIC_RELEASE);
+  __atomic_fetch_sub(&r->nconsumers, 1, __ATOMIC_RELAXED);
+}
+
+//-- copy the next event of consumer id into buf, at most maxwords words
+//-- returns the event length in words (more than maxwords if truncated),
+//-- 0 if there is no new event
+static inline int evring_next(EventRing *r, int id, uint32_t *buf, int maxwords,
+                              uint32_t *evnum)
+{
+  const uint64_t mask = EVRING_WORDS - 1;
+  EvRingConsumer *c = &r->consumer[id];
+  volatile uint32_t *w = r->words;
+  uint64_t p, h, seq;
+  uint32_t hdr, len, idx, ev = 0;
+  int32_t d;
+  int n = 0;
+
+  for (;;) {
+    p = c->cursor;
+    h = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+    if (p == h)
+      return 0;
+    if (h - p > EVRING_WORDS)
+      goto lapped;
+
+    idx = p & mask;
+    hdr = w[idx];
+    len = hdr & ~EVRING_PAD;
+    seq = 0;
+    if (!(hdr & EVRING_PAD)) {
+      if (len <= EVRING_HDR || len > EVRING_MAX_EVENT)
+        goto lapped;
+      seq = w[idx+1];
+      ev = w[idx+2];
+      n = len - EVRING_HDR;
+      memcpy(buf, (const void *) &w[idx+EVRING_HDR],
+             (n < maxwords ? n : maxwords) * sizeof(uint32_t));
+    } else if (len == 0 || idx + len != EVRING_WORDS) {
+      goto lapped;
+    }
+
+    //-- nothing read may have been overwritten since
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&r->reserve, __ATOMIC_RELAXED) - p > EVRING_WORDS)
+      goto lapped;
+
+    c->cursor = p + len;
+    if (hdr & EVRING_PAD)
+      continue;
+
+    //-- the header holds the low 32 bits of the sequence number
+    d = (int32_t)((uint32_t) seq - (uint32_t) c->next_seq);
+    if (d > 0)
+      c->ndropped += d;
+    c->next_seq += d + 1;
+    c->nread++;
+    if (evnum)
+      *evnum = ev;
+    return n;
+
+  lapped:
+    //-- overrun: skip to the newest event, the drops are counted from the
+    //-- sequence number of the next event read
+    c->nlapped++;
+    c->cursor = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+  }
+}
+
+#endif
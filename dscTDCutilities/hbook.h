@@ -2,6 +2,13 @@
 //    shmem hist 
 //------------------------------------------    
 
+#ifndef HBOOK_H
+#define HBOOK_H
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
 #define shm_hist_NB 512
 #define shm_hist_LT 256
 typedef struct  {  
@@ -30,3 +37,156 @@ float hstati(int sw, SHM_HIST  *hp, int id);
 void hf1(SHM_HIST *hp, int id, unsigned int ich);
 int hnoent(SHM_HIST  *hp,  int id);
 //---------------------------------------------------
+
+//------------------------------------------
+//    local fill, merged into SHM_HIST
+//------------------------------------------
+//-- each filling thread keeps its own SHM_HFILL per histogram and adds it
+//-- to the shared histogram with atomic adds (hfill_merge), e.g. every
+//-- 100 ms with hfill_merge_due, given the time read once per event:
+//--     hfill_init(&hl, &shm->H_rol1[id], 0);     -- after hbook1
+//--     hfill_i(&hl, event_words);                 -- per event
+//--     hfill_merge_due(&hl, hfill_now_ms(), 100);
+//-- every bin of the shared histogram is always a complete count; the
+//-- totals (entries, over, ...) may lag the bins by one merge.
+//-- binning uses the reciprocal bin width, and a shift for hfill_i when
+//-- xmin is an integer and the bin width a power of 2.
+
+typedef struct {
+  SHM_HIST    *hp;        //-- shared histogram
+  float        xmin, rwidth;
+  int32_t      imin;
+  int32_t      shift;     //-- -1: no integer binning
+  unsigned int nbin;
+  unsigned int over, under, entries;
+  unsigned int nfill;     //-- fills since the last merge
+  int64_t      merged;    //-- time of the last merge, ms
+  unsigned int hist[shm_hist_NB];
+} SHM_HFILL;
+
+static inline int64_t hfill_now_ms(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+  return (int64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+//-- bind hl to the booked histogram hp (or to xmin, xmax, nbin if nbin > 0)
+static inline void hfill_init(SHM_HFILL *hl, SHM_HIST *hp, unsigned int nbin)
+{
+  float xmin = hp->xmin, xmax = hp->xmax, w;
+  unsigned int iw;
+
+  memset(hl, 0, sizeof(*hl));
+  hl->hp = hp;
+  hl->nbin = nbin ? nbin : hp->nbin;
+  if (hl->nbin > shm_hist_NB) hl->nbin = shm_hist_NB;
+  hl->xmin = xmin;
+  hl->rwidth = (xmax > xmin && hl->nbin) ? hl->nbin / (xmax - xmin) : 0;
+  hl->shift = -1;
+  w = hl->nbin ? (xmax - xmin) / hl->nbin : 0;
+  iw = (unsigned int) w;
+  if (w >= 1 && (float) iw == w && !(iw & (iw - 1)) && (float)(int32_t) xmin == xmin) {
+    hl->imin = (int32_t) xmin;
+    for (hl->shift = 0; (1u << hl->shift) < iw; hl->shift++)
+      ;
+  }
+  hl->merged = hfill_now_ms();
+}
+
+static inline void hfill(SHM_HFILL *hl, float x)
+{
+  unsigned int bin;
+  float f;
+  hl->nfill++;
+  if (!(x >= hl->xmin)) {  //-- also NaN
+    hl->under++;
+    return;
+  }
+  //-- range checked as a float: the conversion of an out of range value
+  //-- (or +inf) is undefined
+  f = (x - hl->xmin) * hl->rwidth;
+  if (!(f < (float) hl->nbin) || hl->rwidth == 0) {
+    hl->over++;
+    return;
+  }
+  bin = (unsigned int) f;
+  hl->hist[bin]++;
+  hl->entries++;
+}
+
+static inline void hfill_i(SHM_HFILL *hl, int32_t v)
+{
+  unsigned int bin;
+  if (hl->shift < 0) {
+    hfill(hl, (float) v);
+    return;
+  }
+  hl->nfill++;
+  if (v < hl->imin) {
+    hl->under++;
+    return;
+  }
+  bin = ((uint32_t) v - (uint32_t) hl->imin) >> hl->shift;
+  if (bin >= hl->nbin) {
+    hl->over++;
+    return;
+  }
+  hl->hist[bin]++;
+  hl->entries++;
+}
+
+//-- bulk fills
+static inline void hfilln(SHM_HFILL *hl, const float *x, int n)
+{
+  int i;
+  for (i = 0; i < n; i++)
+    hfill(hl, x[i]);
+}
+
+static inline void hfilln_i(SHM_HFILL *hl, const int32_t *v, int n)
+{
+  int i;
+  if (hl->shift < 0) {
+    for (i = 0; i < n; i++)
+      hfill(hl, (float) v[i]);
+    return;
+  }
+  for (i = 0; i < n; i++)
+    hfill_i(hl, v[i]);
+}
+
+//-- add the local counts to the shared histogram and clear them
+static inline void hfill_merge(SHM_HFILL *hl)
+{
+  SHM_HIST *hp = hl->hp;
+  unsigned int i;
+
+  if (hl->nfill) {
+    for (i = 0; i < hl->nbin; i++) {
+      if (hl->hist[i]) {
+        __atomic_fetch_add(&hp->hist[i], hl->hist[i], __ATOMIC_RELAXED);
+        hl->hist[i] = 0;
+      }
+    }
+    if (hl->under) __atomic_fetch_add(&hp->under, hl->under, __ATOMIC_RELAXED);
+    if (hl->over) __atomic_fetch_add(&hp->over, hl->over, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&hp->integral, hl->entries, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&hp->entries, hl->nfill, __ATOMIC_RELAXED);
+    hl->under = hl->over = hl->entries = hl->nfill = 0;
+  }
+  hl->merged = hfill_now_ms();
+}
+
+//-- merge if period_ms have passed since the last merge, now_ms from
+//-- hfill_now_ms().  returns 1 if merged
+static inline int hfill_merge_due(SHM_HFILL *hl, int64_t now_ms, int period_ms)
+{
+  if (now_ms - hl->merged < period_ms)
+    return 0;
+  hfill_merge(hl);
+  hl->merged = now_ms;
+  return 1;
+}
+
+#endif
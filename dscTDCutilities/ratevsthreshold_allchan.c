@@ -1,86 +1,141 @@
 //
 //  Mark Dalton  April 2015
 //
-//  This program writes the scaler rates as a function of threshold to a file for each channel.
+//  This program writes the scaler rates as a function of threshold for all
+//  discriminator channels in the crate to a single columnar text file.
 //
-//  The scaler rates are read from the shared memory buffer and writes them to a text 
+//  The thresholds are set and the scalers latched and read directly with
+//  the vmeDSC library: at each threshold step the TDC scalers of every
+//  module are latched, the program waits for the dwell time, and latches
+//  them again.  The rate is the difference of the two reads divided by
+//  the difference of the reference (125 MHz) scalers.
 //
+//  Output file (default DSC_ratevthresh_<host>_<date>.txt):
+//     # comment lines, the last one naming the columns
+//     threshold  rate_s<slot>c<chan> ...   one line per threshold step
 //
-//  Compile and run with the following:
+//  Warning: DO NOT execute while a CODA run is ongoing, as it will
+//           interfere with the shmem_srv process that is running in
+//           the background and latching the scalers.
 //
-//  gcc ratevsthreshold_allchan.c -I ../rcm/monitor/  -o ratevsthreshold_allchan.exe
-// ./ratevsthreshold_allchan.exe
+//  Compile and run with the following:
 //
-//  The executable needs access to programs that will change the threshold in the current directory.
-//  Run the following commands.
-//  
-//  ln -s /gluonfs1/home/dalton/work/DAQ/new/daq_dev_vers/daq/vme/src/vmefa/test/faSetThresholds
-//  ln -s /gluonfs1/home/dalton/work/DAQ/new/daq_dev_vers/daq/vme/src/vmeDSC/test/vmeDSCSetThresholds
+//  make ratevsthreshold_allchan
+// ./ratevsthreshold_allchan  thresh_min  thresh_max  thresh_step  [dwell_ms]  [outfile]
 //
-#include <sys/prctl.h>
 #include <unistd.h>
-#include <signal.h>
 #include <stdlib.h>
-#include <pthread.h>
 #include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include "jvme.h"
+#include "vmeDSClib.h"
 
 int min(int a, int b) { return (a < b)? a : b; }
 int max(int a, int b) { return (a > b)? a : b; }
 
-//--------------------------------------------
-#include "shmem_roc.h"
-static void shmem_get();
-static int  semid,shmid;
-static roc_shmem *shmem_ptr;
-void get_rates (int, int, int);
-//--------------------------------------------
+#define DWELL_MS_DEFAULT 1000   // time to count at each threshold
+#define SETTLE_US       10000   // threshold DAC settling time
+#define MAXWORDS          100   // words read per module per latch
 
-// Structure for general system command
-char SystemCallString[2000];           // global array of strings to store system calls
-void *SystemCall( void *argptr);       // program to preform a system call (run in a thread)
+DMA_MEM_ID vmeIN,vmeOUT;
+extern int Ndsc;
+
+int read_scalers(volatile unsigned int *buf, unsigned int counts[][17], int *valid);
+void get_rates (int, int, int, int, char *);
 //--------------------------------------------
 
 
 
 int main(int argc, char *argv[], char *envp[]) {
    if (argc<4) {
-      printf("\nUseage:\n\n\tratevsthreshold_allchan  thresh_min  thresh_max  thresh_step\n\n\n");
+      printf("\nUseage:\n\n\tratevsthreshold_allchan  thresh_min  thresh_max  thresh_step  [dwell_ms]  [outfile]\n\n\n");
 
    } else {
-      shmem_get();
-      
       int thresh_min = atof(argv[1]);
       int thresh_max = atof(argv[2]);
       int thresh_step = atof(argv[3]);
-      printf("Stepping through thresholds from %i to %i in steps of %i\n", thresh_min, thresh_max, thresh_step);
-      get_rates( thresh_min, thresh_max, thresh_step);
-      pthread_exit(NULL);
+      int dwell_ms = (argc>4)? atoi(argv[4]) : DWELL_MS_DEFAULT;
+      char *outname = (argc>5)? argv[5] : NULL;
+      if (thresh_step<=0 || dwell_ms<=0) {
+         printf("thresh_step and dwell_ms must be positive\n");
+         return 1;
+      }
 
+      vmeSetQuietFlag(1);
+      if (vmeOpenDefaultWindows() != OK) {
+         printf(" Failed to access VME bridge\n");
+         return 1;
+      }
+      vmeDmaConfig(2,5,1);
+      dmaPFreeAll();
+      vmeIN  = dmaPCreate("vmeIN",MAXWORDS*4,1,0);
+      vmeOUT = dmaPCreate("vmeOUT",0,0,0);
+      dmaPReInitAll();
+
+      int iFlag = (1<<16); // Do not attempt to initialize the module(s)
+      printf(" Locating DSC in the crate...\n");
+      if (vmeDSCInit((2<<19),(1<<19),20,iFlag) == ERROR || Ndsc==0) {
+         printf(" No discriminators found\n");
+         vmeCloseDefaultWindows();
+         return 1;
+      }
+
+      printf("Stepping through thresholds from %i to %i in steps of %i, %i ms per step\n",
+             thresh_min, thresh_max, thresh_step, dwell_ms);
+      get_rates( thresh_min, thresh_max, thresh_step, dwell_ms, outname);
 
+      dmaPFreeAll();
+      vmeCloseDefaultWindows();
    }
    return 0;
 }
 
 //-----------------------------------------------------------------------------------
-//          get rates
+//          read scalers
 //-----------------------------------------------------------------------------------
-void get_rates(int thresh_min, int thresh_max, int thresh_step) {
-   int slot,ichan;
-   unsigned int update_f_old=0, update_d_old=0;
-   pthread_t thread;
-
-   //printf("Stepping through thresholds from %i to %i in steps of %i\n", thresh_min, thresh_max, thresh_step);
-
-   int doADC=0;  // Variable to record if we have ADCs
-   int doDSC=1;  // Variable to record if we have Discriminators
-   FILE *outfile[21][16];      // have a potential file handle for each channel
-   int fileisopen[21][16];     // record if file handle is open for each channel
-   int i,j;
-   for (i=0; i<21; i++) {
-      for (j=0; j<16; j++) {
-         fileisopen[i][j]=0;
+// Latch and read the TDC scalers and the reference scaler of every module.
+// counts[idsc][0-15] are the channels, counts[idsc][16] the reference.
+// The scalers are full 32-bit counts, so the data words are not told
+// apart by bit 31: they are the 17 words that follow the scaler header.
+// valid[idsc] is 0, and counts[idsc] zeroed, for a module whose read
+// came back short.  Returns the number of modules read.
+int read_scalers(volatile unsigned int *buf, unsigned int counts[][17], int *valid) {
+   int idsc, i, n, nw, nread=0;
+   for (idsc=0; idsc<Ndsc; idsc++) {
+      nw = vmeDSCReadScalers(vmeDSCSlot(idsc), buf, MAXWORDS,
+                             DSC_READOUT_TDC_GRP1 | DSC_READOUT_REF_GRP1 |
+                             DSC_READOUT_LATCH_GRP1, 1);
+      // skip the block and event headers up to the scaler header
+      for (i=0; i<nw; i++) {
+         unsigned int word = (unsigned int)LSWAP(buf[i]);
+         if ((word & DSC_DATA_TYPE_DEFINING_WORD) &&
+             ((word>>27) & 0xF) == DSC_DATA_TYPE_SCALERHEADER)
+            break;
+      }
+      // then the data words
+      for (i++, n=0; i<nw && n<17; i++, n++)
+         counts[idsc][n] = (unsigned int)LSWAP(buf[i]);
+      valid[idsc] = (n==17);
+      if (valid[idsc]) {
+         nread++;
+      } else {
+         memset(counts[idsc], 0, sizeof(counts[idsc]));
+         printf("read_scalers: slot %d returned %d of 17 scalers\n", vmeDSCSlot(idsc), n);
       }
    }
+   return nread;
+}
+
+//-----------------------------------------------------------------------------------
+//          get rates
+//-----------------------------------------------------------------------------------
+void get_rates(int thresh_min, int thresh_max, int thresh_step, int dwell_ms, char *outname) {
+   int idsc,ichan;
+   unsigned int counts1[DSC_MAX_BOARDS][17];
+   unsigned int counts2[DSC_MAX_BOARDS][17];
+   int valid1[DSC_MAX_BOARDS], valid2[DSC_MAX_BOARDS];
+   DMANODE *buffer;
 
    char *host;
    host = getenv("HOSTNAME");
@@ -88,7 +143,7 @@ void get_rates(int thresh_min, int thresh_max, int thresh_step) {
 
 
    // Make a date time label
-   time_t result = time(NULL); 
+   time_t result = time(NULL);
    char *timestring = ctime(&result);
    char datetimelabel[255];
    int count=0;
@@ -109,185 +164,66 @@ void get_rates(int thresh_min, int thresh_max, int thresh_step) {
    }
    printf("datetimelabel '%s'\n",datetimelabel);
 
+   // open the output file and name the columns
+   char filename[600];
+   if (outname)
+      snprintf(filename,sizeof(filename),"%s",outname);
+   else
+      snprintf(filename,sizeof(filename),"DSC_ratevthresh_%s_%s.txt",host,datetimelabel);
+   FILE *outfile = fopen(filename, "w");
+   if (outfile == NULL) {
+      printf("Cannot open %s for writing\n",filename);
+      return;
+   }
+   printf("Writing to %s\n",filename);
+   fprintf(outfile,"# ratevsthreshold_allchan on %s, %s",host,ctime(&result));
+   fprintf(outfile,"# TDC scaler rates (Hz), %i ms per threshold step\n",dwell_ms);
+   fprintf(outfile,"# thresh");
+   for (idsc=0; idsc<Ndsc; idsc++)
+      for (ichan=0; ichan<16; ichan++)
+         fprintf(outfile,"     s%02ic%02i",vmeDSCSlot(idsc),ichan);
+   fprintf(outfile,"\n");
+
+   buffer = dmaPGetItem(vmeIN);
+   if (buffer == NULL) {
+      printf("No DMA buffer available\n");
+      fclose(outfile);
+      return;
+   }
+
    // step through the thresholds
    int threshold;
    int loopmax, loopmin;
    loopmax = max(thresh_min,thresh_max);
    loopmin = min(thresh_min,thresh_max);
 
-   for (threshold=thresh_min; threshold<=thresh_max; threshold+=thresh_step) {
+   for (threshold=loopmin; threshold<=loopmax; threshold+=thresh_step) {
 
-      // set the tresholds on the crate and wait.
+      // set the thresholds on the crate, count for the dwell time
       printf("Setting a threshold of %i\n",threshold);
-      if (doADC==1) {
-         sprintf(SystemCallString,"echo faSetThresholds %i",threshold);
-         system(SystemCallString);
-      }
-      if (doDSC==1) {
-         sprintf(SystemCallString,"./vmeDSCSetThresholds %i",threshold);
-         system(SystemCallString);
-      }
-      // read the current update number
-      if (doADC==1) {
-         unsigned int update_f_atchange=shmem_ptr->f250_scalers.update;
-         // wait for 2 updates to make sure that there is no stale data
-         printf("Waiting for scaler update (%u) clear stale data\n",update_f_atchange);
-         while(1) {
-            unsigned int update_f=shmem_ptr->f250_scalers.update;
-            if (update_f == update_f_atchange)
-               usleep(100000);
-            else {
-               update_f_atchange = update_f;
-               break;
-            }
-            //printf("%i\n",update_f);
-         }
-         printf("Waiting for scaler update (%u) get new rates\n",update_f_atchange);
-         while(1) {
-            unsigned int update_f=shmem_ptr->f250_scalers.update;
-            if (update_f == update_f_atchange) usleep(100000);
-            else {
-               update_f_atchange = update_f;
-               break;
-            }
-            //printf("%i\n",update_f);
-         }
-      }
-      if (doDSC==1) {
-         unsigned int update_f_atchange=shmem_ptr->discr_scalers.update;
-         // wait for 2 updates to make sure that there is no stale data
-         printf("Waiting for scaler update (%u) clear stale data\n",update_f_atchange);
-         while(1) {
-            unsigned int update_f=shmem_ptr->discr_scalers.update;
-            if (update_f == update_f_atchange)
-               usleep(100000);
-            else {
-               update_f_atchange = update_f;
-               break;
-            }
-            //printf("%i\n",update_f);
-         }
-         printf("Waiting for scaler update (%u) get new rates\n",update_f_atchange);
-         while(1) {
-            unsigned int update_f=shmem_ptr->discr_scalers.update;
-            if (update_f == update_f_atchange) usleep(100000);
-            else {
-               update_f_atchange = update_f;
-               break;
-            }
-            //printf("%i\n",update_f);
+      vmeDSCSetBipolarThresholdAll((INT16) threshold, (INT16) threshold);
+      usleep(SETTLE_US);
+      read_scalers(buffer->data, counts1, valid1);
+      usleep(dwell_ms*1000);
+      read_scalers(buffer->data, counts2, valid2);
+
+      // Write data to file, rates 0 for a module that was not read
+      fprintf(outfile,"%8i",threshold);
+      for (idsc=0; idsc<Ndsc; idsc++) {
+         double time = (valid1[idsc] && valid2[idsc])?
+            (counts2[idsc][16] - counts1[idsc][16]) / DSC_REFERENCE_RATE : 0;
+         for (ichan=0; ichan<16; ichan++) {
+            double rate = (time > 0)? (counts2[idsc][ichan] - counts1[idsc][ichan]) / time : 0;
+            fprintf(outfile," %10.3f",rate);
          }
       }
-
-      // Write data to file
-      char filename[255];
-      //---------------------------------------------------------------------------
-      //            FA250 rates
-      //---------------------------------------------------------------------------
-      if (doADC==1) {
-         int numADCchan=0;
-         for(slot=0; slot<21; slot++) {
-            if (shmem_ptr->f250_scalers.counters[slot][16]==0) continue;
-            //printf("  Fill slot=%d \n",slot);
-            for(ichan=0; ichan<16; ichan++) {
-               //printf("  chan=%d \n",ichan);
-               if (shmem_ptr->f250_scalers.counters[slot][ichan] > 0) {
-                  numADCchan++;
-                  if (fileisopen[slot][ichan]==0) {
-                     sprintf(filename,"ADC_ratevthresh_%s_%s_s%02ic%02i.txt",host,datetimelabel,slot,ichan);
-                     //printf("opening file: %s\n",filename);
-                     outfile[slot][ichan] = fopen(filename, "a");
-                  fileisopen[slot][ichan]=1;
-                  }
-                  fprintf(outfile[slot][ichan],"%4i %10.3f\n",threshold,shmem_ptr->f250_scalers.rates[slot][ichan]);
-               }
-            }               
-         }
-         if (numADCchan==0) {
-            doADC=0;
-            printf("Ignoring ADCs in future.\n");
-         }
-         printf("Wrote %i ADC channels\n",numADCchan);
-      }
-      //---------------------------------------------------------------------------------------------------
-      //             DISCR rates 
-      //---------------------------------------------------------------------------------------------------
-      if (doDSC==1) {
-         int numDSCchan=0;
-         for(slot=0; slot<21; slot++) {
-            if (shmem_ptr->discr_scalers.counters[slot][16]==0) continue;
-            //printf("  Fill slot=%d \n",slot);
-            for(ichan=0; ichan<16; ichan++) {
-               //if (shmem_ptr->discr_scalers.counters[slot][ichan] > 0) {
-                  numDSCchan++;
-                  if (fileisopen[slot][ichan]==0) {
-                     sprintf(filename,"DSC_ratevthresh_%s_%s_s%02ic%02i.txt",host,datetimelabel,slot,ichan);
-                     outfile[slot][ichan] = fopen(filename, "a");
-                     fileisopen[slot][ichan]=1;
-                  }
-                  fprintf(outfile[slot][ichan],"%4i %10.3f\n",
-                        threshold,shmem_ptr->discr_scalers.rates[slot][ichan]);
-                  //}
-            }               
-         }
-         if (numDSCchan==0) {
-            //doDSC=0;
-            printf("Ignoring discriminators in future.\n");
-         }
-         printf("Wrote %i Discriminator channels\n",numDSCchan);
-      }
+      fprintf(outfile,"\n");
+      fflush(outfile);
    }
 
-   printf("Closing the text files\n");
-   for (i=0; i<21; i++) {
-      for (j=0; j<15; j++) {
-         if (fileisopen[i][j]==1) {
-            fclose(outfile[i][j]);
-         }
-      }
-   }
-}
-//-----------------------------------------------------------------------------------
-//                   Shared memory         
-//-----------------------------------------------------------------------------------
-static void shmem_get() {
-
-   if ( (semid=semget( SEM_ID1, 1, 0) ) < 0 ) {
-      printf("shmem: can not get semaphore \n"); 
-      fflush(stdout);
-   }
-   if ( (shmid=shmget(SHM_ID1,sizeof(roc_shmem), 0))<0) {
-      printf("==> shmem: shared memory 0x%x, size=%d get error=%d\n",SHM_ID1,sizeof(roc_shmem),shmid);
-      fflush(stdout);
-      exit(1);
-   }
-   if ( (shmem_ptr=(roc_shmem *) shmat (shmid, 0, 0))<0 ) {
-      printf("==> shmem: shared memory attach error\n");
-      fflush(stdout);
-   }
-   printf("==> shmem: shared memory attached OK ptr=%p\n",shmem_ptr); 
-   fflush(stdout);
-    
-   //printf("===== wait semaphore  ======  \n"); 
-   //fflush(stdout); 
-   //-- access to shmem --
-   //sem_wait(semid);    
-   // if (shmem_ptr) shmem_ptr->rol2_hist=1;
-   //sem_post(semid);
-
-}
-//-----------------------------------------------------------------------------------
-
-//-----------------------------------------------------------------------------------
-//                   General system command        
-//-----------------------------------------------------------------------------------
-void *SystemCall( void *argptr) {
-   char *mySystemCallStringArray;
-   mySystemCallStringArray = (char *) argptr;
-   char command[2000];
-   sprintf(command,"%s",mySystemCallStringArray);
-   printf("   %s\n",command);
-   //system(command);
-   pthread_exit(NULL);
+   dmaPFreeItem(buffer);
+   printf("Wrote %i Discriminator channels at %i thresholds\n",
+          16*Ndsc, (loopmax-loopmin)/thresh_step+1);
+   fclose(outfile);
 }
 //-----------------------------------------------------------------------------------
@@ -1,6 +1,6 @@
 #!/bin/env python
 #
-# ratevsthreshold_collect.py - script to collect the many output files
+# ratevsthreshold_collect.py - script to collect the output files
 #                              produced by ratevsthreshold_allchan into
 #                              a single output stream written to stdout.
 #
@@ -10,31 +10,34 @@
 import sys
 
 def usage():
-   print "Usage: ./ratevsthreshold_collect <suffix> [<suffix2> ... ]"
-   print "   where <suffix> is the 5-character string that is found"
-   print "   in the output filenames from ratevsthreshold_allchan,"
-   print "   as in 'DSC_ratevthresh_roctagm2_<suffix>_s05c09.txt'"
+   print "Usage: ./ratevsthreshold_collect <file> [<file2> ... ]"
+   print "   where <file> is an output file from ratevsthreshold_allchan,"
+   print "   as in 'DSC_ratevthresh_roctagm2_<date>.txt', with one line"
+   print "   per threshold and one column per slot and channel"
    sys.exit(1)
 
 if len(sys.argv) < 2:
    usage()
-else:
-   prefix = "DSC_ratevthresh_roctagm2_"
 
 rates = {}
-for suffix in sys.argv[1:]:
-   for slot in range(4,12):
-     for chan in range(0,16):
-        ext = "_s" + str(slot).zfill(2) + "c" + str(chan).zfill(2) + ".txt"
-        for line in open("DSC_ratevthresh_roctagm2_" + suffix + ext):
-           fields = line.split()
-           thresh = int(fields[0])
-           count = float(fields[1])
-           if not thresh in rates:
-              rates[thresh] = {}
-           if not slot in rates[thresh]:
-              rates[thresh][slot] = {}
-           rates[thresh][slot][chan] = count
+for fname in sys.argv[1:]:
+   columns = []
+   for line in open(fname):
+      fields = line.split()
+      if len(fields) == 0:
+         continue
+      if fields[0] == "#":
+         # the last comment line names the columns: thresh s<slot>c<chan> ...
+         if len(fields) > 1 and fields[1] == "thresh":
+            columns = [(int(col[1:3]), int(col[4:6])) for col in fields[2:]]
+         continue
+      thresh = int(fields[0])
+      if not thresh in rates:
+         rates[thresh] = {}
+      for (slot, chan), count in zip(columns, fields[1:]):
+         if not slot in rates[thresh]:
+            rates[thresh][slot] = {}
+         rates[thresh][slot][chan] = float(count)
   
 for thresh in sorted(rates.iterkeys()):
    print "threshold", thresh
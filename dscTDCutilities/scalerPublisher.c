@@ -0,0 +1,314 @@
+/*
+ * File:
+ *    scalerPublisher.c
+ *
+ * Description:
+ *    Scaler publisher.  Latches the scalers of all fADC250 and vmeDSC
+ *    modules in the crate together at a fixed cadence, computes the
+ *    rates and publishes counters and rates to the roc_shmem
+ *    f250_scalers and discr_scalers sections.  This is the only process
+ *    that should latch the scalers: the monitor tools read the rates
+ *    from shared memory while it runs (scalers_live() in shmem_roc.h).
+ *
+ *    The scalers are not cleared: rates are taken from the difference of
+ *    two latches, over the module clock latched with them
+ *       fADC250: time_count, 2048 ns ticks
+ *       vmeDSC:  Grp2 reference scaler, DSC_REFERENCE_RATE
+ *    The vmeDSC Grp2 scalers are used so that the Grp1 latches of the
+ *    readout list are left alone.  A module whose clock interval does
+ *    not match the wall clock (cleared or reset by someone else since the
+ *    last latch) is published with rates 0 and an interval 0 for one
+ *    cadence.
+ *
+ *    Sections are written under their sequence locks, readers take
+ *    consistent copies with f250_scalers_read() / dsc_scalers_read().
+ *    rates[slot][16] is the interval of the rates, in seconds.
+ *
+ *    Usage:
+ *       scalerPublisher [-c cadence_ms] [-t seconds] [-b dsc_slot] [-F] [-D]
+ *
+ */
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <signal.h>
+#include <sys/time.h>
+#include "jvme.h"
+#include "fadcLib.h"
+#include <vmeDSClib.h>
+#include "shmem_roc.h"
+
+#define FA_TICK   2048e-9                    /* s, fADC250 time_count */
+#define DSC_TICK  (1.0/DSC_REFERENCE_RATE)   /* s, vmeDSC reference scaler */
+#define MAX_CADENCE 30000                    /* ms, reference scaler wraps in 34 s */
+#define DSC_FIRST_SLOT 2                     /* DSC scan start, as vmeDSCSetThresholds */
+
+extern int fadcA32Base;
+extern int nfadc;
+extern int Ndsc;
+
+char *progName;
+void Usage();
+static roc_shmem *shmem_get();
+
+static volatile int quit = 0;
+
+static void
+sig_handler(int sig)
+{
+	quit = 1;
+}
+
+static long long
+now_ms()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (long long)tv.tv_sec*1000 + tv.tv_usec/1000;
+}
+
+/* counters of one module, last is the clock */
+typedef struct {
+	uint32_t cnt[MAX_CHAN+1];
+	int valid;
+} ScalerSnap;
+
+static ScalerSnap fa_prev[MAX_SLOT], fa_cur[MAX_SLOT];
+static ScalerSnap tdc_prev[MAX_SLOT+1], tdc_cur[MAX_SLOT+1];
+static ScalerSnap trg_prev[MAX_SLOT+1], trg_cur[MAX_SLOT+1];
+static uint32_t thr_tdc[MAX_SLOT+1][MAX_CHAN+1], thr_trg[MAX_SLOT+1][MAX_CHAN+1];
+
+/*
+ * rates of the 16 channels of cur since prev, rate[MAX_CHAN] = interval in s
+ * returns 0, -1 (rates 0) if the interval is not within a factor 2 of the
+ * wall clock interval wall_s
+ */
+static int
+scaler_rates(const ScalerSnap *prev, const ScalerSnap *cur, double tick,
+	     double wall_s, double *rate)
+{
+	uint32_t dcnt[MAX_CHAN];
+	double dt, rdt;
+	int chan;
+
+	dt = (uint32_t)(cur->cnt[MAX_CHAN] - prev->cnt[MAX_CHAN]) * tick;
+	if (!prev->valid || dt <= 0 || dt > 2*wall_s || 2*dt < wall_s) {
+		memset(rate, 0, (MAX_CHAN+1)*sizeof(double));
+		return -1;
+	}
+	/* one divide per module, the channel loop vectorizes */
+	rdt = 1.0/dt;
+	for (chan=0; chan<MAX_CHAN; chan++)
+		dcnt[chan] = cur->cnt[chan] - prev->cnt[chan];
+	for (chan=0; chan<MAX_CHAN; chan++)
+		rate[chan] = dcnt[chan]*rdt;
+	rate[MAX_CHAN] = dt;
+	return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+	int cadence=1000;   /* ms between latches */
+	int runtime=0;
+	int use_fa=1, use_dsc=1;
+	int dsc_slot=DSC_FIRST_SLOT;
+	int c, ifa, idsc, chan, slot;
+
+	progName = argv[0];
+	while ((c = getopt(argc, argv, "c:t:b:FD")) != -1) {
+		switch (c) {
+		case 'c': cadence = atoi(optarg); break;
+		case 't': runtime = atoi(optarg); break;
+		case 'b': dsc_slot = atoi(optarg); break;
+		case 'F': use_fa = 0; break;
+		case 'D': use_dsc = 0; break;
+		default:
+			Usage();
+			exit(1);
+		}
+	}
+	if (cadence <= 0 || cadence > MAX_CADENCE || (!use_fa && !use_dsc) ||
+	    dsc_slot < 2 || dsc_slot > 21) {
+		Usage();
+		exit(1);
+	}
+
+	roc_shmem *shm = shmem_get();
+	if (shm == NULL)
+		exit(1);
+
+	printf("\nJLAB scaler publisher\n");
+	printf("-------------------------------\n");
+
+	vmeSetQuietFlag(1);
+	if (vmeOpenDefaultWindows() != OK) {
+		printf("Failed to access VME bridge\n");
+		exit(1);
+	}
+
+	vmeBusLock();
+	if (use_fa) {
+		fadcA32Base=0x09000000;
+		int InitFlag = FA_INIT_SKIP; /* Do not attempt to initialize the module(s) */
+		InitFlag |= FA_INIT_SKIP_FIRMWARE_CHECK;
+		InitFlag |= FA_INIT_DISCOVERY_CACHE; /* Skip the empty slots found last time */
+		printf(" Locating fADC250s in the crate...\n");
+		faInit((3<<19),(1<<19),20,InitFlag);
+	}
+	if (use_dsc) {
+		printf(" Locating DSC in the crate...\n");
+		if (vmeDSCInit((dsc_slot<<19),(1<<19),20,(1<<16)) == ERROR)
+			Ndsc = 0;
+	}
+	vmeBusUnlock();
+	if (nfadc == 0 && Ndsc == 0) {
+		printf("No fADC250s or DSCs found\n");
+		vmeCloseDefaultWindows();
+		exit(1);
+	}
+
+	signal(SIGINT, sig_handler);
+	signal(SIGTERM, sig_handler);
+
+	memset(fa_prev, 0, sizeof(fa_prev));
+	memset(tdc_prev, 0, sizeof(tdc_prev));
+	memset(trg_prev, 0, sizeof(trg_prev));
+	printf("Publishing %i fADC250s and %i DSCs every %i ms\n", nfadc, Ndsc, cadence);
+
+	struct timeval tv, tv_prev = {0, 0};
+	static double rate[MAX_CHAN+1];
+	long long start = now_ms();
+	long long next = start;
+	while (!quit && (runtime <= 0 || now_ms() - start < runtime*1000LL)) {
+		/* latch all modules back to back, then read them */
+		vmeBusLock();
+		gettimeofday(&tv, NULL);
+		for (ifa=0; ifa<nfadc; ifa++)
+			faLatchScalers(faSlot(ifa));
+		for (idsc=0; idsc<Ndsc; idsc++)
+			vmeDSCLatchScalers(vmeDSCSlot(idsc), 2);
+		for (ifa=0; ifa<nfadc; ifa++) {
+			slot = faSlot(ifa);
+			fa_cur[slot].valid =
+				(faReadScalers(slot, fa_cur[slot].cnt, 0xffff, 0) == MAX_CHAN+1);
+		}
+		for (idsc=0; idsc<Ndsc; idsc++) {
+			slot = vmeDSCSlot(idsc);
+			trg_cur[slot].valid = tdc_cur[slot].valid =
+				(vmeDSCReadLatchedScalers(slot, 2, tdc_cur[slot].cnt,
+							  trg_cur[slot].cnt,
+							  &tdc_cur[slot].cnt[MAX_CHAN]) == OK);
+			trg_cur[slot].cnt[MAX_CHAN] = tdc_cur[slot].cnt[MAX_CHAN];
+			for (chan=0; chan<MAX_CHAN; chan++) {
+				thr_tdc[slot][chan] = vmeDSCGetThreshold(slot, chan, TDC);
+				thr_trg[slot][chan] = vmeDSCGetThreshold(slot, chan, TRG);
+			}
+		}
+		vmeBusUnlock();
+
+		double wall = (tv.tv_sec - tv_prev.tv_sec) + (tv.tv_usec - tv_prev.tv_usec)*1e-6;
+		tv_prev = tv;
+
+		if (nfadc > 0) {
+			F250_Scalers *f = &shm->f250_scalers;
+			f250_scalers_write_begin(shm);
+			f->Nslots = nfadc;
+			for (ifa=0; ifa<nfadc; ifa++) {
+				slot = faSlot(ifa);
+				f->slots[ifa] = slot;
+				scaler_rates(&fa_prev[slot], &fa_cur[slot], FA_TICK, wall, rate);
+				memcpy(f->counters[slot], fa_cur[slot].cnt, sizeof(f->counters[slot]));
+				memcpy(f->rates[slot], rate, sizeof(f->rates[slot]));
+			}
+			f->tv_sec = tv.tv_sec;
+			f->tv_usec = tv.tv_usec;
+			f->cadence = cadence;
+			f250_scalers_write_end(shm);
+		}
+
+		if (Ndsc > 0) {
+			vmeDSC_Scalers *d = &shm->discr_scalers;
+			dsc_scalers_write_begin(shm);
+			d->Nslots = Ndsc;
+			for (idsc=0; idsc<Ndsc; idsc++) {
+				slot = vmeDSCSlot(idsc);
+				d->slots[idsc] = slot;
+				scaler_rates(&tdc_prev[slot], &tdc_cur[slot], DSC_TICK, wall, rate);
+				memcpy(d->counters[slot], tdc_cur[slot].cnt, sizeof(d->counters[slot]));
+				memcpy(d->rates[slot], rate, sizeof(d->rates[slot]));
+				memcpy(d->thresholds[slot], thr_tdc[slot], sizeof(d->thresholds[slot]));
+				scaler_rates(&trg_prev[slot], &trg_cur[slot], DSC_TICK, wall, rate);
+				memcpy(d->counters2[slot], trg_cur[slot].cnt, sizeof(d->counters2[slot]));
+				memcpy(d->rates2[slot], rate, sizeof(d->rates2[slot]));
+				memcpy(d->thresholds2[slot], thr_trg[slot], sizeof(d->thresholds2[slot]));
+			}
+			d->threshold_flag = 1;
+			d->threshold_flag2 = 1;
+			d->tv_sec = tv.tv_sec;
+			d->tv_usec = tv.tv_usec;
+			d->cadence = cadence;
+			dsc_scalers_write_end(shm);
+		}
+
+		memcpy(fa_prev, fa_cur, sizeof(fa_prev));
+		memcpy(tdc_prev, tdc_cur, sizeof(tdc_prev));
+		memcpy(trg_prev, trg_cur, sizeof(trg_prev));
+
+		/* sleep to the next latch, not for a cadence: no drift */
+		next += cadence;
+		long long t = now_ms();
+		if (next <= t)
+			next = t + cadence;
+		while (!quit && now_ms() < next)
+			usleep((next - now_ms())*1000);
+	}
+
+	/* tell the readers to go back to the modules */
+	if (nfadc > 0) {
+		f250_scalers_write_begin(shm);
+		shm->f250_scalers.cadence = 0;
+		f250_scalers_write_end(shm);
+	}
+	if (Ndsc > 0) {
+		dsc_scalers_write_begin(shm);
+		shm->discr_scalers.cadence = 0;
+		dsc_scalers_write_end(shm);
+	}
+
+	vmeCloseDefaultWindows();
+	exit(0);
+}
+
+static roc_shmem *
+shmem_get()
+{
+	int shmid;
+	roc_shmem *ptr;
+	if ((shmid = shmget(SHM_ID1, sizeof(roc_shmem), IPC_CREAT|PERMS)) < 0) {
+		printf("==> shmem: shared memory 0x%x, size=%d get error=%d\n",
+		       SHM_ID1, (int)sizeof(roc_shmem), shmid);
+		return NULL;
+	}
+	ptr = (roc_shmem *) shmat(shmid, 0, 0);
+	if (ptr == (roc_shmem *) -1) {
+		printf("==> shmem: shared memory attach error\n");
+		return NULL;
+	}
+	return ptr;
+}
+
+void
+Usage()
+{
+	printf("\nUSAGE:\n\n");
+	printf("%s [-c cadence_ms] [-t seconds] [-b dsc_slot] [-F] [-D]\n",progName);
+	printf("\t - Latch all fADC250 and DSC scalers every cadence_ms (default 1000,\n");
+	printf("\t   at most %d) and publish counters and rates to shared memory\n", MAX_CADENCE);
+	printf("\t   -t: stop after seconds\n");
+	printf("\t   -b: first slot searched for DSCs (default %d)\n", DSC_FIRST_SLOT);
+	printf("\t   -F: no fADC250s\n");
+	printf("\t   -D: no DSCs\n\n");
+}
@@ -0,0 +1,164 @@
+//
+// shmLogPrint.c
+//
+// Print the log records of the ROC shared memory log ring (shmlog.h),
+// formatting them here rather than in the process that logged them.
+//
+//    shmLogPrint [-f] [-n nrec]
+//       -f       follow: keep printing new records
+//       -n nrec  start nrec records before the newest (default: all)
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "shmem_roc.h"
+static roc_shmem *shmem_get();
+static void print_record(LogBufferShm *lb, ShmLogRecord *r);
+
+char *progName;
+
+static void Usage()
+{
+  printf("\nUSAGE:\n\n");
+  printf("%s [-f] [-n nrec]\n", progName);
+  printf("\t - Print the log records in shared memory\n");
+  printf("\t   -f: follow, print new records as they come\n");
+  printf("\t   -n: start nrec records before the newest\n\n");
+}
+
+int main(int argc, char *argv[])
+{
+  int follow = 0, c;
+  long nrec = -1;
+  uint64_t rd, wr;
+  int64_t n;
+  ShmLogRecord rec;
+
+  progName = argv[0];
+  while ((c = getopt(argc, argv, "fn:")) != -1) {
+    switch (c) {
+    case 'f': follow = 1; break;
+    case 'n': nrec = atol(optarg); break;
+    default:
+      Usage();
+      exit(1);
+    }
+  }
+
+  roc_shmem *shm = shmem_get();
+  if (shm == NULL)
+    exit(1);
+  LogBufferShm *lb = &shm->LogBuf;
+
+  rd = shmlog_tail(lb);
+  wr = __atomic_load_n(&lb->wr_pos, __ATOMIC_ACQUIRE);
+  if (nrec >= 0 && wr - rd > (uint64_t) nrec)
+    rd = wr - nrec;
+
+  while (1) {
+    n = shmlog_read(lb, &rd, &rec);
+    if (n > 0) {
+      print_record(lb, &rec);
+      continue;
+    }
+    if (n < 0) {
+      printf("... %lld records lost\n", (long long) -n);
+      continue;
+    }
+    if (!follow)
+      break;
+    fflush(stdout);
+    usleep(100000);
+  }
+  exit(0);
+}
+
+//-- format the record as logMsg would have
+static void print_record(LogBufferShm *lb, ShmLogRecord *r)
+{
+  const char *fmt = shmlog_string(lb, r->fmt);
+  char out[1024], spec[32];
+  const char *c, *s;
+  int iarg = 0, len = 0, l;
+  time_t t = r->time_ns / 1000000000;
+  struct tm tm;
+
+  localtime_r(&t, &tm);
+  strftime(out, sizeof(out), "%Y-%m-%d %H:%M:%S", &tm);
+  printf("%s.%06d [%d] ", out, (int)(r->time_ns % 1000000000) / 1000, r->pid);
+  if (fmt == NULL) {
+    printf("<format %u not in the string table>\n", r->fmt);
+    return;
+  }
+
+  out[0] = 0;
+  for (c = fmt; *c && len < (int) sizeof(out) - 1; ) {
+    if (*c != '%' || c[1] == '%' || iarg >= SHMLOG_NARG) {
+      if (*c == '%' && c[1] == '%')
+        c++;
+      out[len++] = *c++;
+      out[len] = 0;
+      continue;
+    }
+    l = 1 + strspn(c + 1, "#0- +'123456789.*hlLqjzt");
+    if (c[l] == 0 || l + 2 > (int) sizeof(spec))
+      break;
+    l++;
+    //-- arguments were logged as 32-bit values: drop the length modifiers
+    //-- (and * widths, not logged)
+    int ls = 0, i;
+    for (i = 0; i < l; i++)
+      if (!strchr("*hlLqjzt", c[i]))
+        spec[ls++] = c[i];
+    spec[ls] = 0;
+    uint32_t a = r->arg[iarg++];
+    switch (c[l-1]) {
+    case 's':
+      s = (a == SHMLOG_NOSTR) ? "(null)" : shmlog_string(lb, a);
+      len += snprintf(out + len, sizeof(out) - len, spec, s ? s : "<?>");
+      break;
+    case 'd': case 'i': case 'c':
+      len += snprintf(out + len, sizeof(out) - len, spec, (int32_t) a);
+      break;
+    case 'e': case 'E': case 'f': case 'F': case 'g': case 'G':
+      len += snprintf(out + len, sizeof(out) - len, spec, (double)(int32_t) a);
+      break;
+    case 'p':
+      len += snprintf(out + len, sizeof(out) - len, "0x%x", a);
+      break;
+    default:
+      len += snprintf(out + len, sizeof(out) - len, spec, a);
+      break;
+    }
+    c += l;
+  }
+  if (len > (int) sizeof(out) - 1)
+    len = sizeof(out) - 1;
+  //-- one record per line
+  while (len > 0 && out[len-1] == '\n')
+    out[--len] = 0;
+  for (s = out; *s == '\n'; s++)
+    ;
+  printf("%s\n", s);
+}
+
+static roc_shmem *shmem_get()
+{
+  int shmid;
+  roc_shmem *ptr;
+  if ((shmid = shmget(SHM_ID1, sizeof(roc_shmem), 0)) < 0) {
+    printf("==> shmem: shared memory 0x%x, size=%d get error=%d\n",
+           SHM_ID1, (int) sizeof(roc_shmem), shmid);
+    return NULL;
+  }
+  ptr = (roc_shmem *) shmat(shmid, 0, 0);
+  if (ptr == (roc_shmem *) -1) {
+    printf("==> shmem: shared memory attach error\n");
+    return NULL;
+  }
+  return ptr;
+}
@@ -3,10 +3,15 @@
 #include <sys/sem.h>
 #include <sys/shm.h>
 #include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <sched.h>
 #include <time.h>
 
 #include "hbook.h" 
 #include "bor_roc.h"
+#include "evring.h"
+#include "shmlog.h"
 
 #define SEM_ID1	0xDF1	
 #define SHM_ID1	0xDF2
@@ -22,16 +27,6 @@ int sem_get(void);
 
 #define LINFO 128
 
-#define LLogBuffer 128000
-
-typedef struct
-{  
-  int32_t wr_ptr;
-  int32_t rd_ptr;
-  int32_t loop_ptr;
-  int32_t level_ptr;
-  char buf[LLogBuffer];
-}  LogBufferShm;
 
 
 //---------- FADC 250 [16] chan / 125 [72] chan. Configuration  --------------
@@ -49,6 +44,9 @@ typedef  struct  {
 } __attribute__((__packed__)) FADC_Config;
 //--------------------- PED monitor  ---------------------
 #define MAX_PED 21*72
+#define PEDMON_INDEX(slot,chan) ((slot)*16+(chan))  //-- f250: 16 channels/slot
+#define PEDMON_VALID 0x1   //-- status: mean/sigma/noent filled
+#define PEDMON_DRIFT 0x2   //-- status: mean moved from its reference
 typedef struct {
   int32_t status;
   int64_t updated;
@@ -62,35 +60,111 @@ typedef struct {
 #define MAX_SLOT  21
 #define MAX_CHAN  16
 
+//-- the sequence word of a section sits alone on the first cache line of the
+//-- section, so polling readers do not share a line with the data being written
+#define SHM_CACHE_LINE 64
+#define SHM_SEQ_WORD(name) \
+  uint32_t name __attribute__((aligned(SHM_CACHE_LINE))); \
+  uint32_t name##_pad[SHM_CACHE_LINE/4-1]
+
 typedef  struct  {
+  SHM_SEQ_WORD(seq);                          //-- sequence lock, see f250_scalers_read()
   uint32_t   counters[MAX_SLOT][MAX_CHAN+1];  //-- last is timer 
-  double     rates[MAX_SLOT][MAX_CHAN+1];     //-- last is timer
+  double     rates[MAX_SLOT][MAX_CHAN+1];     //-- last is the interval, s
   int32_t    Nslots;
   int32_t    slots[MAX_SLOT];        //-- installed --
   uint32_t   update;
+  uint32_t   tv_sec;                 //-- time of the latch
+  uint32_t   tv_usec;
+  uint32_t   cadence;                //-- ms between updates, 0: no publisher
 } __attribute__((__packed__)) F250_Scalers;
 
 //---------- vmeDSC  Scalers --------------
 
 typedef  struct  {
+  SHM_SEQ_WORD(seq);                 //-- sequence lock, see dsc_scalers_read()
   //
   int32_t  threshold_flag2;
   uint32_t thresholds2[MAX_SLOT+1][MAX_CHAN+1];
   uint32_t counters2[MAX_SLOT+1][MAX_CHAN+1];  //-- last is timer 
-  double   rates2[MAX_SLOT+1][MAX_CHAN+1];     //-- last is timer
+  double   rates2[MAX_SLOT+1][MAX_CHAN+1];     //-- last is the interval, s
   //
   int32_t  threshold_flag;
   uint32_t thresholds[MAX_SLOT+1][MAX_CHAN+1];
   uint32_t counters[MAX_SLOT+1][MAX_CHAN+1];  //-- last is timer 
-  double   rates[MAX_SLOT+1][MAX_CHAN+1];     //-- last is timer
+  double   rates[MAX_SLOT+1][MAX_CHAN+1];     //-- last is the interval, s
   //
   int32_t  Nslots;
   int32_t  slots[MAX_SLOT+1];        //-- installed --
   uint32_t tv_sec;
   uint32_t tv_usec;
   uint32_t update;
+  uint32_t cadence;                  //-- ms between updates, 0: no publisher
 } __attribute__((__packed__)) vmeDSC_Scalers;
 
+//---------- sequence lock for sections updated in place --------
+//-- writer (one process):  shm_seq_write_begin(&seq); update; shm_seq_write_end(&seq);
+//-- reader:  do { s=shm_seq_read_begin(&seq); copy; } while (shm_seq_read_retry(&seq,s));
+//--      or  shm_seq_copy(&seq, copy, section, size, tries)
+//-- the count is odd while an update is in progress, and goes up by 2 with
+//-- every update: a reader that has seen s has nothing new while
+//-- shm_seq_peek(&seq) == s
+
+static inline void shm_seq_write_begin(volatile void *seqp)
+{
+  uint32_t *seq = (uint32_t *) seqp;
+  __atomic_store_n(seq, __atomic_load_n(seq, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void shm_seq_write_end(volatile void *seqp)
+{
+  uint32_t *seq = (uint32_t *) seqp;
+  __atomic_store_n(seq, __atomic_load_n(seq, __ATOMIC_RELAXED) + 1, __ATOMIC_RELEASE);
+}
+
+static inline uint32_t shm_seq_read_begin(volatile void *seqp)
+{
+  uint32_t *seq = (uint32_t *) seqp;
+  uint32_t s;
+  while ((s = __atomic_load_n(seq, __ATOMIC_ACQUIRE)) & 1)
+    ;
+  return s;
+}
+
+static inline int shm_seq_read_retry(volatile void *seqp, uint32_t s)
+{
+  uint32_t *seq = (uint32_t *) seqp;
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return __atomic_load_n(seq, __ATOMIC_RELAXED) != s;
+}
+
+static inline uint32_t shm_seq_peek(volatile void *seqp)
+{
+  return __atomic_load_n((uint32_t *) seqp, __ATOMIC_ACQUIRE);
+}
+
+//-- consistent copy of n bytes at src, written under *seqp.  Gives up after
+//-- tries attempts, e.g. when the writer died during an update.
+//-- returns the (even) sequence number of the copy, -1 if none was consistent
+static inline int64_t shm_seq_copy(volatile void *seqp, void *dst,
+                                   const volatile void *src, size_t n, int tries)
+{
+  uint32_t *seq = (uint32_t *) seqp;
+  uint32_t s;
+  while (tries-- > 0) {
+    s = __atomic_load_n(seq, __ATOMIC_ACQUIRE);
+    if (s & 1) {
+      sched_yield();  //-- let a preempted writer finish
+      continue;
+    }
+    memcpy(dst, (const void *) src, n);
+    if (!shm_seq_read_retry(seqp, s))
+      return s;
+  }
+  return -1;
+}
+
 //--------------------------------------------------------------
 //                       SHARED Memory 
 //--------------------------------------------------------------
@@ -117,32 +191,25 @@ typedef struct
 #define LMessage 8192
   char Message[LMessage];
 
-//---------- Log Buffer 65k --------------
-  LogBufferShm LogBuf;
+//---------- Log ring (shmlog.h) --------------
+  LogBufferShm LogBuf __attribute__((aligned(SHM_CACHE_LINE)));
 
 
 
 //-----------------  ROL 1/2  vars  -------------------------
 
 
-//----------  Event Buffer  --------------
-
   int32_t rol2_hist;
 
-#define LEventBuffer 2000000  
-  //  20000 x 100 
-  int32_t EventBufferFLAG;
-  int32_t EventLength;
-  int32_t EventMaxLength;
-  int32_t EventSkipCounter;
-  int32_t EventBuffer[LEventBuffer];
+//----------  Event Ring (evring.h)  --------------
+  EventRing evring __attribute__((aligned(SHM_CACHE_LINE)));
 
 
 //---------- FADC 250 Scalers --------------
-  F250_Scalers f250_scalers;
+  F250_Scalers f250_scalers __attribute__((aligned(SHM_CACHE_LINE)));
   
 //---------- vmeDSC   Scalers --------------
-  vmeDSC_Scalers discr_scalers;
+  vmeDSC_Scalers discr_scalers __attribute__((aligned(SHM_CACHE_LINE)));
 
 //---------- f125/f250 configuratuon  ------
 #define MAX_FADC_CONFIG 5
@@ -150,6 +217,8 @@ typedef struct
   FADC_Config fadc_config[MAX_FADC_CONFIG]; //---  0=F125 , 1=F250
 
 //--------------------- PED monitor  ---------------------
+  SHM_SEQ_WORD(pedmon_seq);  //-- sequence lock, see pedmon_read()
+  uint32_t pedmon_cadence;   //-- publishing interval, ms
   PedMon pedmon[MAX_PED];
 
 
@@ -201,3 +270,62 @@ typedef struct
 } __attribute__((__packed__))
 roc_shmem;
 
+//-- scaler sections.  The publisher brackets each update of a section with
+//-- f250_scalers_write_begin/end (dsc_scalers_write_begin/end), which also
+//-- count update.  Readers take a copy with f250_scalers_read (dsc_scalers_read).
+#define SHM_SEQ_TRIES 100000
+
+static inline void f250_scalers_write_begin(roc_shmem *shm)
+{
+  shm_seq_write_begin(&shm->f250_scalers.seq);
+}
+
+static inline void f250_scalers_write_end(roc_shmem *shm)
+{
+  shm->f250_scalers.update++;
+  shm_seq_write_end(&shm->f250_scalers.seq);
+}
+
+static inline void dsc_scalers_write_begin(roc_shmem *shm)
+{
+  shm_seq_write_begin(&shm->discr_scalers.seq);
+}
+
+static inline void dsc_scalers_write_end(roc_shmem *shm)
+{
+  shm->discr_scalers.update++;
+  shm_seq_write_end(&shm->discr_scalers.seq);
+}
+
+//-- consistent copy of the fADC250 scalers, returns its sequence number, -1 if none
+static inline int64_t f250_scalers_read(roc_shmem *shm, F250_Scalers *copy)
+{
+  return shm_seq_copy(&shm->f250_scalers.seq, copy, &shm->f250_scalers,
+                      sizeof(F250_Scalers), SHM_SEQ_TRIES);
+}
+
+//-- consistent copy of the vmeDSC scalers, returns its sequence number, -1 if none
+static inline int64_t dsc_scalers_read(roc_shmem *shm, vmeDSC_Scalers *copy)
+{
+  return shm_seq_copy(&shm->discr_scalers.seq, copy, &shm->discr_scalers,
+                      sizeof(vmeDSC_Scalers), SHM_SEQ_TRIES);
+}
+
+//-- 1 if a section with this tv_sec and cadence is kept up to date by a
+//-- publisher (scalerPublisher): the readers then take the rates from here
+//-- instead of latching the modules themselves
+static inline int scalers_live(uint32_t tv_sec, uint32_t cadence)
+{
+  if (cadence == 0)
+    return 0;
+  return (uint32_t) time(NULL) - tv_sec <= 3 * cadence / 1000 + 2;
+}
+
+//-- consistent copy of pedmon[first .. first+n-1], returns its sequence
+//-- number, -1 if none (e.g. faPedMon died during an update)
+static inline int64_t pedmon_read(roc_shmem *shm, PedMon *copy, int first, int n)
+{
+  return shm_seq_copy(&shm->pedmon_seq, copy, &shm->pedmon[first],
+                      n*sizeof(PedMon), SHM_SEQ_TRIES);
+}
+
@@ -0,0 +1,226 @@
+//------------------------------------------
+//    shmem log ring
+//------------------------------------------
+//
+// Binary log records in roc_shmem.LogBuf, written without locks by any
+// number of threads and processes and formatted by the reader
+// (shmLogPrint).  A record holds a format id, the time and up to six
+// logMsg arguments.  Format strings, and the strings passed for %s, are
+// copied once into the string table of the buffer and referred to by id.
+//
+// Writer:
+//     shmlog_attach(&shm->LogBuf);
+//     shmlog_logmsg(fmt, a1, a2, a3, a4, a5, a6);   -- as logMsg
+// shmlog_logmsg can be given to faSetLogFunc / vmeDSCSetLogFunc so that
+// the readout paths of the libraries log here instead of to the console.
+//
+// Reader:
+//     uint64_t rd = shmlog_tail(lb);
+//     while ((n = shmlog_read(lb, &rd, &rec)) != 0) -- n < 0: records lost
+//
+// Each record is guarded by its own sequence number: 2*pos+1 while it is
+// written, 2*pos+2 when complete.  The writer of the oldest record never
+// waits for the readers; a reader that is overrun skips ahead.
+//
+
+#ifndef SHMLOG_H
+#define SHMLOG_H
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SHMLOG_NREC   2048        //-- records, power of 2
+#define SHMLOG_NSTR   256         //-- string table entries
+#define SHMLOG_LSTR   120
+#define SHMLOG_NARG   6
+#define SHMLOG_NOSTR  0xffffffff  //-- string not in the table
+
+typedef struct {
+  uint64_t seq;
+  int64_t  time_ns;               //-- CLOCK_REALTIME
+  uint32_t fmt;                   //-- string id of the format
+  int32_t  pid;
+  uint32_t arg[SHMLOG_NARG];      //-- string id for %s
+} __attribute__((__packed__)) ShmLogRecord;
+
+typedef struct {
+  uint32_t ready;                 //-- 1 once s is written
+  uint32_t len;
+  char     s[SHMLOG_LSTR];
+} __attribute__((__packed__)) ShmLogString;
+
+typedef struct
+{
+  uint64_t wr_pos __attribute__((aligned(64)));  //-- records claimed
+  uint32_t pad0[14];
+  uint32_t nstr __attribute__((aligned(64)));    //-- string entries claimed
+  uint32_t pad1[15];
+  ShmLogString str[SHMLOG_NSTR];
+  ShmLogRecord rec[SHMLOG_NREC];
+} __attribute__((__packed__)) LogBufferShm;
+
+//------------------------------------------
+//    writer
+//------------------------------------------
+
+//-- per-process cache: format or string pointer -> string id
+#define SHMLOG_NCACHE 512
+typedef struct {
+  const char *p;
+  uint32_t    id;
+} ShmLogCache;
+
+static LogBufferShm *shmlog_buf;
+static ShmLogCache shmlog_cache[SHMLOG_NCACHE];
+
+static inline void shmlog_attach(LogBufferShm *lb)
+{
+  shmlog_buf = lb;
+  memset(shmlog_cache, 0, sizeof(shmlog_cache));
+}
+
+//-- arguments of fmt converted with %s, as a bit mask
+static inline uint32_t shmlog_smask(const char *fmt)
+{
+  uint32_t mask = 0;
+  int iarg = 0;
+  const char *c;
+
+  for (c = fmt; *c && iarg < SHMLOG_NARG; c++) {
+    if (*c != '%')
+      continue;
+    if (*++c == '%')
+      continue;
+    c += strspn(c, "#0- +'123456789.*hlLqjzt");
+    if (*c == 's')
+      mask |= 1u << iarg;
+    if (*c == 0)
+      break;
+    iarg++;
+  }
+  return mask;
+}
+
+//-- id of the string s in the table, added if not there
+static inline uint32_t shmlog_intern(LogBufferShm *lb, const char *s)
+{
+  ShmLogCache *ce = &shmlog_cache[((uintptr_t) s >> 3) % SHMLOG_NCACHE];
+  uint32_t len = strnlen(s, SHMLOG_LSTR - 1), n, i;
+
+  //-- the same pointer may hold another string since it was cached, and
+  //-- the entry may be updated by another thread: compare the contents
+  if (ce->p == s && (i = ce->id) < SHMLOG_NSTR && lb->str[i].len == len &&
+      memcmp(lb->str[i].s, s, len) == 0)
+    return i;
+
+  n = __atomic_load_n(&lb->nstr, __ATOMIC_ACQUIRE);
+  if (n > SHMLOG_NSTR) n = SHMLOG_NSTR;
+  for (i = 0; i < n; i++) {
+    ShmLogString *e = &lb->str[i];
+    if (__atomic_load_n(&e->ready, __ATOMIC_ACQUIRE) && e->len == len &&
+        memcmp(e->s, s, len) == 0)
+      break;
+  }
+  if (i == n) {
+    i = __atomic_fetch_add(&lb->nstr, 1, __ATOMIC_RELAXED);
+    if (i >= SHMLOG_NSTR)
+      return SHMLOG_NOSTR;
+    memcpy(lb->str[i].s, s, len);
+    lb->str[i].s[len] = 0;
+    lb->str[i].len = len;
+    __atomic_store_n(&lb->str[i].ready, 1, __ATOMIC_RELEASE);
+  }
+  ce->p = s;
+  ce->id = i;
+  return i;
+}
+
+//-- log a message as logMsg would.  returns 0, -1 if not attached
+static inline int shmlog_logmsg(const char *fmt, long a1, long a2, long a3,
+                                long a4, long a5, long a6)
+{
+  LogBufferShm *lb = shmlog_buf;
+  long a[SHMLOG_NARG] = { a1, a2, a3, a4, a5, a6 };
+  uint32_t arg[SHMLOG_NARG], id, smask;
+  struct timespec ts;
+  ShmLogRecord *r;
+  uint64_t pos;
+  int i;
+
+  if (lb == NULL || fmt == NULL)
+    return -1;
+
+  id = shmlog_intern(lb, fmt);
+  smask = shmlog_smask(fmt);
+  for (i = 0; i < SHMLOG_NARG; i++)
+    arg[i] = ((smask >> i) & 1) ? (a[i] ? shmlog_intern(lb, (const char *) a[i])
+                                        : SHMLOG_NOSTR)
+                                : (uint32_t) a[i];
+  clock_gettime(CLOCK_REALTIME, &ts);
+
+  pos = __atomic_fetch_add(&lb->wr_pos, 1, __ATOMIC_RELAXED);
+  r = &lb->rec[pos & (SHMLOG_NREC - 1)];
+  __atomic_store_n(&r->seq, 2*pos + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  r->time_ns = (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+  r->fmt = id;
+  r->pid = getpid();
+  memcpy(r->arg, arg, sizeof(arg));
+  __atomic_store_n(&r->seq, 2*pos + 2, __ATOMIC_RELEASE);
+  return 0;
+}
+
+//------------------------------------------
+//    reader
+//------------------------------------------
+
+//-- position of the oldest record still in the ring
+static inline uint64_t shmlog_tail(LogBufferShm *lb)
+{
+  uint64_t wr = __atomic_load_n(&lb->wr_pos, __ATOMIC_ACQUIRE);
+  return wr > SHMLOG_NREC ? wr - SHMLOG_NREC : 0;
+}
+
+//-- copy the record at *rd and advance *rd
+//-- returns 1, 0 if the record is not written yet, -(records lost) if the
+//-- reader was overrun; *rd then is the oldest record in the ring.
+//-- a record left half written (writer killed) is skipped once SHMLOG_NREC/2
+//-- newer records are complete
+static inline int64_t shmlog_read(LogBufferShm *lb, uint64_t *rd, ShmLogRecord *out)
+{
+  ShmLogRecord *r = &lb->rec[*rd & (SHMLOG_NREC - 1)];
+  uint64_t s, wr;
+
+  s = __atomic_load_n(&r->seq, __ATOMIC_ACQUIRE);
+  if (s == 2 * *rd + 2) {
+    memcpy(out, (const void *) r, sizeof(*out));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&r->seq, __ATOMIC_RELAXED) == s) {
+      (*rd)++;
+      return 1;
+    }
+  }
+  wr = __atomic_load_n(&lb->wr_pos, __ATOMIC_ACQUIRE);
+  if (s > 2 * *rd + 2 || wr > *rd + SHMLOG_NREC) {
+    uint64_t lost = shmlog_tail(lb) + 1 - *rd;
+    *rd += lost;
+    return -(int64_t) lost;
+  }
+  if (s == 2 * *rd + 1 && wr > *rd + SHMLOG_NREC/2) {
+    (*rd)++;
+    return -1;
+  }
+  return 0;
+}
+
+//-- string of id, or NULL
+static inline const char *shmlog_string(LogBufferShm *lb, uint32_t id)
+{
+  if (id >= SHMLOG_NSTR || !__atomic_load_n(&lb->str[id].ready, __ATOMIC_ACQUIRE))
+    return NULL;
+  return lb->str[id].s;
+}
+
+#endif
@@ -15,20 +15,16 @@ if [[ $? = 0 ]]; then
 fi
 
 # do an initial scan to get rid of hysteresis
-../ratevsthreshold_allchan 10 20 10
+../ratevsthreshold_allchan 10 20 10 1000 hysteresis.txt
+rm -f hysteresis.txt
 
 t=0
 dt=1
 while [[ $t -lt 1000 ]]; do
     tend=`expr $t + \( $dt \* 9 \)`
-    ../ratevsthreshold_allchan $t $tend $dt
-    for fn in `ls *_[0-9][0-9]h[0-9][0-9]_s[0-9][0-9]c[0-9][0-9].txt`; do
-        suffix=`echo $fn | awk -F_ '{print $5}'`
-        newname=`echo $fn | sed s/$suffix/tt$t/`
-        mv $fn $newname
-    done
+    ../ratevsthreshold_allchan $t $tend $dt 1000 DSC_ratevthresh_tt$t.txt
     t=`expr $dt \* 10 + $t`
     dt=`expr $dt \* 2`
 done
 
-python ../ratevsthreshold_collect.py `ls *_s04c00.txt | awk -F_ '{print $4"_"$5}'` | tee threshold_scan.log
+python ../ratevsthreshold_collect.py DSC_ratevthresh_tt*.txt | tee threshold_scan.log
@@ -10,6 +10,9 @@
  *          interfere with the shmem_srv process that is running in
  *          the background and updating scaler tables in shared
  *          memory. Use vmeDSCPrintShmemRates instead.
+ *
+ *          While scalerPublisher is running the rates are taken from
+ *          shared memory, and the modules are not touched.
  */
 
 #include <unistd.h>
@@ -18,9 +21,12 @@
 #include <stdio.h>
 #include "jvme.h"
 #include <vmeDSClib.h>
+#include "shmem_roc.h"
 
 char *progName;
 void Usage();
+static roc_shmem *shmem_get();
+static void PrintShmemRates(roc_shmem *shm);
 
 DMA_MEM_ID vmeIN,vmeOUT;
 extern DMANODE *the_event;
@@ -36,6 +42,10 @@ int main(int argc, char *argv[])
 
 	progName = argv[0];
 
+	roc_shmem *shm = shmem_get();
+	if (shm != NULL)
+		PrintShmemRates(shm);
+
 	vmeSetQuietFlag(1);
 	if (vmeOpenDefaultWindows() != OK) {
 		printf(" Failed to access VME bridge\n");
@@ -143,3 +153,52 @@ int main(int argc, char *argv[])
 	vmeCloseDefaultWindows();
 	exit(0);
 }
+
+/*
+ * print the TDC rates published by scalerPublisher, every update
+ * returns when there is no publisher, or it stops
+ */
+static void
+PrintShmemRates(roc_shmem *shm)
+{
+	static vmeDSC_Scalers sc;
+	int64_t seq, last = -1;
+	int i, chan;
+
+	while (1) {
+		seq = dsc_scalers_read(shm, &sc);
+		if (seq < 0 || !scalers_live(sc.tv_sec, sc.cadence)) {
+			if (last >= 0)
+				printf(" scalerPublisher stopped, reading the modules\n");
+			return;
+		}
+		if (seq == last) {
+			usleep(100000);
+			continue;
+		}
+		if (last < 0)
+			printf(" Reading the rates published by scalerPublisher\n");
+		last = seq;
+		for (i=0; i < sc.Nslots && i <= MAX_SLOT; i++) {
+			int slot = sc.slots[i];
+			printf("slot %2i:", slot);
+			for (chan=0; chan < 16; chan++)
+				printf("%10.0f", sc.rates[slot][chan]);
+			printf("\n");
+		}
+		fflush(stdout);
+	}
+}
+
+static roc_shmem *
+shmem_get()
+{
+	int shmid;
+	roc_shmem *ptr;
+	if ((shmid = shmget(SHM_ID1, sizeof(roc_shmem), 0)) < 0)
+		return NULL;
+	ptr = (roc_shmem *) shmat(shmid, 0, 0);
+	if (ptr == (roc_shmem *) -1)
+		return NULL;
+	return ptr;
+}
@@ -31,25 +31,31 @@ int main(int argc, char *argv[])
 
   shmem_get();
   while (1) {
+    static vmeDSC_Scalers sc;
     int idsc;
-    int ndsc = shmem_ptr->discr_scalers.Nslots;
+    if (dsc_scalers_read(shmem_ptr, &sc) < 0) {
+      printf(" Scalers are being updated, no consistent copy\n");
+      usleep(1000000);
+      continue;
+    }
+    int ndsc = sc.Nslots;
     printf(" Scaler type TDC:\n");
     for (idsc=0; idsc < ndsc; idsc++) {
       int chan;
-      int slot = shmem_ptr->discr_scalers.slots[idsc];
+      int slot = sc.slots[idsc];
       printf("slot %d:", slot);
       for (chan=0; chan < 16; chan++) {
-        printf(" %8.0f", shmem_ptr->discr_scalers.rates[slot][chan]);
+        printf(" %8.0f", sc.rates[slot][chan]);
       }
       printf("\n");
     }
     printf(" Scaler type TRG:\n");
     for (idsc=0; idsc < ndsc; idsc++) {
       int chan;
-      int slot = shmem_ptr->discr_scalers.slots[idsc];
+      int slot = sc.slots[idsc];
       printf("slot %d:", slot);
       for (chan=0; chan < 16; chan++) {
-        printf(" %8.0f", shmem_ptr->discr_scalers.rates2[slot][chan]);
+        printf(" %8.0f", sc.rates2[slot][chan]);
       }
       printf("\n");
     }
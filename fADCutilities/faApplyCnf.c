@@ -0,0 +1,119 @@
+/*
+ * File:
+ *    faApplyCnf.c
+ *
+ * Description:
+ *    Load the DAC and threshold settings of fadc250 .cnf files (as
+ *    written by faCalibPedestals, faTweakPedestals and faFitRates) into
+ *    the fADC250s in the crate.  Only the registers that differ from the
+ *    modules are written (faCnfApply), and the changes are reported.
+ *    Later files override earlier ones channel by channel.
+ *
+ *    Usage:
+ *       faApplyCnf [-c crate] [-D] [-T] [-n] [-q] file [file ...]
+ *
+ *       -c  Only use the CRATE sections for this crate (default: all)
+ *       -D  Only the DAC settings
+ *       -T  Only the thresholds
+ *       -n  Report the changes, do not write
+ *       -q  Do not list the changed channels
+ *
+ */
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "jvme.h"
+#include "fadcLib.h"
+
+extern int fadcA32Base;
+extern int nfadc;
+
+char *progName;
+void Usage();
+
+static faCnf cnf;
+
+int
+main(int argc, char *argv[])
+{
+	char *crate=NULL;
+	int aflag = FA_CNF_DAC | FA_CNF_THR | FA_CNF_VERBOSE;
+	int c, i, nset;
+	faCnfDelta delta;
+
+	progName = argv[0];
+	while ((c = getopt(argc, argv, "c:DTnq")) != -1) {
+		switch (c) {
+		case 'c': crate = optarg; break;
+		case 'D': aflag &= ~FA_CNF_THR; break;
+		case 'T': aflag &= ~FA_CNF_DAC; break;
+		case 'n': aflag |= FA_CNF_DRYRUN; break;
+		case 'q': aflag &= ~FA_CNF_VERBOSE; break;
+		default:
+			Usage();
+			exit(1);
+		}
+	}
+	if (optind >= argc || !(aflag & (FA_CNF_DAC | FA_CNF_THR))) {
+		Usage();
+		exit(1);
+	}
+
+	faCnfClear(&cnf);
+	for (i=optind; i<argc; i++) {
+		nset = faCnfRead(argv[i], crate, &cnf);
+		if (nset < 0)
+			exit(1);
+		printf("%s: %i channel settings\n", argv[i], nset);
+	}
+
+	vmeSetQuietFlag(1);
+	if (vmeOpenDefaultWindows() != OK) {
+		printf("Failed to access VME bridge\n");
+		exit(1);
+	}
+
+	fadcA32Base=0x09000000;
+	int InitFlag = FA_INIT_SKIP; /* Do not attempt to initialize the module(s) */
+	InitFlag |= FA_INIT_SKIP_FIRMWARE_CHECK;
+	InitFlag |= FA_INIT_DISCOVERY_CACHE; /* Skip the empty slots found last time */
+	printf(" Locating fADC250s in the crate...\n");
+	faInit((3<<19),(1<<19),20,InitFlag);
+	if (nfadc == 0) {
+		printf("No fADC250s found\n");
+		vmeCloseDefaultWindows();
+		exit(1);
+	}
+
+	vmeBusLock();
+	int nchanged = faCnfApply(&cnf, &delta, aflag);
+	vmeBusUnlock();
+	if (nchanged < 0) {
+		printf("Failed to apply the configuration\n");
+		vmeCloseDefaultWindows();
+		exit(1);
+	}
+
+	printf("%s%i module(s): %i DAC and %i threshold channel(s) changed, %i register write(s)\n",
+	       (aflag & FA_CNF_DRYRUN) ? "Dry run, " : "", delta.nslots,
+	       delta.ndac, delta.nthr, delta.nwrite);
+	if (delta.nmissing > 0)
+		printf("%i slot(s) in the configuration have no module\n", delta.nmissing);
+
+	vmeCloseDefaultWindows();
+	exit(0);
+}
+
+void
+Usage()
+{
+	printf("\nUSAGE:\n\n");
+	printf("%s [-c crate] [-D] [-T] [-n] [-q] file [file ...]\n",progName);
+	printf("\t - Write the DAC and threshold settings of .cnf files that differ from the modules\n");
+	printf("\t   -c: only the CRATE sections for this crate\n");
+	printf("\t   -D, -T: only the DAC values, only the thresholds\n");
+	printf("\t   -n: report the changes, do not write\n");
+	printf("\t   -q: do not list the changed channels\n\n");
+}
@@ -7,6 +7,18 @@
  *    Move the DAC value between 2 limits to find the threshold 
  *    maximum rate of increase in the scalers.
  *
+ *    The DAC range is first swept in coarse steps with all channels
+ *    at the same DAC value.  Each channel is then scanned in single
+ *    DAC steps around its own coarse peak, all channels in the same
+ *    step, and the peak is taken from a gaussian fit to the rates.
+ *
+ *    If every channel has a DAC value for this pedestal in the
+ *    calibration store (faCalibGet), the coarse sweep is skipped and
+ *    the fine scan starts from the stored values; should a peak fall
+ *    on the edge of its fine scan, the full sweep is done after all.
+ *    The results are written back to the store.  With "cold" as the
+ *    second argument the stored values are ignored.
+ *
  */
 
 
@@ -15,6 +27,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <math.h>
 #include "jvme.h"
 #include "fadcLib.h"
 #include "fadcLib_extensions.h"
@@ -25,9 +38,22 @@ extern int fadcA32Base;
 extern int fadcID[FA_MAX_BOARDS];
 extern int nfadc;
 
+#define COARSESTEP      6   /* DAC step of the coarse sweep */
+#define FINEHALFWIDTH   3   /* fine scan covers the coarse peak +- this */
+#define NCOARSEMAX    256   /* points of the coarse sweep */
+#define NFINE         (2*FINEHALFWIDTH+1)
+#define DACMAX        4095
+
 char *progName;
 void Usage();
 void PrintDataArray(int *array[]);
+void MeasureRates(int sleepval, double rate[FA_MAX_BOARDS][FA_MAX_ADC_CHANNELS]);
+double FitPeak(int npts, int *dac, double *rate);
+int FineStart(int peak);
+
+/* rates measured in the coarse and fine scans */
+double coarserate[NCOARSEMAX][FA_MAX_BOARDS][FA_MAX_ADC_CHANNELS];
+double finerate[NFINE][FA_MAX_BOARDS][FA_MAX_ADC_CHANNELS];
 
 int 
 main(int argc, char *argv[]) 
@@ -35,12 +61,23 @@ main(int argc, char *argv[])
 	int thresh=0;
 
 	/* Parse command line arguments */
+	int cold=0;
 	switch(argc) {
 	case 2: /* One threshold to rule them all */
 		{
 			thresh = strtoll(argv[1],NULL,10);
 			break;
 		}
+	case 3:
+		{
+			thresh = strtoll(argv[1],NULL,10);
+			cold = (strcmp(argv[2],"cold")==0);
+			if (!cold) {
+				Usage();
+				goto CLOSE;
+			}
+			break;
+		}
 	default:
 		printf(" Incorrect number of arguments..\n");
 		Usage();
@@ -72,6 +109,12 @@ main(int argc, char *argv[])
 	highsingledac=dacstart;
 	lowsingledac=dacstop;
 
+	if ((dacstop-dacstart)/COARSESTEP + 1 > NCOARSEMAX) {
+		printf("Coarse sweep %i to %i in steps of %i has more than %i points\n",
+		       dacstart,dacstop,COARSESTEP,NCOARSEMAX);
+		exit(1);
+	}
+
 	// initialise array values
 	for (i=0; i<FA_MAX_BOARDS; i++) {
 		for (j=0; j<FA_MAX_ADC_CHANNELS; j++) {
@@ -126,9 +169,32 @@ main(int argc, char *argv[])
 	int ScalerReadFlag;
 	//ScalerReadFlag = (1<<0) && (1<<1);   // latch and clear
 	ScalerReadFlag = (1<<0);             // latch
-	//loop over DAC values
 	int dacval;
-	for (dacval = dacstart; dacval<=dacstop; dacval++) {
+	int icoarse, ncoarse=0, ifine;
+	int scandac[NCOARSEMAX];
+	double scanrate[NCOARSEMAX];
+	int finestart[FA_MAX_BOARDS][FA_MAX_ADC_CHANNELS];
+
+	// warm start from the calibration store, if every channel has a
+	// DAC value for this pedestal
+	int warm = !cold;
+	for(ifa=0; ifa<nfadc && warm; ifa++) {
+		for (chan=0; chan<=15 && warm; chan++) {
+			faCalibChannel cal;
+			if (faCalibGet(faSlot(ifa), chan, &cal) == OK && cal.dac >= 0 &&
+			    fabs(cal.ped - thresh) < 0.5)
+				finestart[ifa][chan] = FineStart(cal.dac);
+			else
+				warm = 0;
+		}
+	}
+	if (warm)
+		printf("Starting from the DAC values in the calibration store\n");
+
+ SWEEP:
+	if (!warm) {
+	// coarse sweep, all channels at the same DAC value
+	for (dacval = dacstart; dacval<=dacstop; dacval+=COARSESTEP) {
 		if (DEBUG>0) printf("Setting DAC value to: %i\n",dacval);
 		else {
 			printf("Setting DAC value to: %i\r",dacval);
@@ -138,41 +204,70 @@ main(int argc, char *argv[])
 		for(ifa=0; ifa<nfadc; ifa++) {
 			faSetDAC(faSlot(ifa), dacval, 0xffff);
 		}
-		// loop over modules to read scalers 
+		// only the location of the peak is needed here
+		MeasureRates(shortsleepval/4, coarserate[ncoarse]);
+		scandac[ncoarse++] = dacval;
+	}
+
+	// start of the fine scan for each channel: gaussian fit to the
+	// coarse points, falling back on the highest coarse point
+	for(ifa=0; ifa<nfadc; ifa++) {
+		for (chan=0; chan<=15; chan++) {
+			for (icoarse=0; icoarse<ncoarse; icoarse++)
+				scanrate[icoarse] = coarserate[icoarse][ifa][chan];
+			dacval = (int)(FitPeak(ncoarse, scandac, scanrate) + 0.5);
+			finestart[ifa][chan] = FineStart(dacval);
+		}
+	}
+	}
+
+	// fine scan, each channel around its own peak
+	for (ifine=0; ifine<NFINE; ifine++) {
+		if (DEBUG>0) printf("Fine scan step %i of %i\n",ifine+1,NFINE);
+		faTransBegin();
 		for(ifa=0; ifa<nfadc; ifa++) {
-			faReadScalers(faSlot(ifa), scalerdata1[ifa], 0xffff, ScalerReadFlag);
-			if (DEBUG>2) { // print the first read
-				printf("Mod %2i   ", faSlot(ifa));
-				for (chan=0; chan<=16; chan++) {
-					if (chan==8) printf("\n         ");
-					printf("%10u ",scalerdata1[ifa][chan]);
-				}
-				printf("\n");
+			for (chan=0; chan<=15; chan++) {
+				faTransSetDAC(faSlot(ifa), finestart[ifa][chan]+ifine, (1<<chan));
 			}
 		}
-		// sleep to accumulate scaler scalerdata
-		usleep(shortsleepval);
-		// loop over modules to read scalers 
-		for(ifa=0; ifa<nfadc; ifa++) {
-			faReadScalers(faSlot(ifa), scalerdata2[ifa], 0xffff, ScalerReadFlag);
-			if (DEBUG>3) { // printf the second read
-				printf("Mod %2i   ", faSlot(ifa));
-				for (chan=0; chan<=16; chan++) {
-					if (chan==8) printf("\n         ");
-					printf("%10u ",scalerdata2[ifa][chan]);
-				}
-				printf("\n");
+		if (faTransCommit() < 0)
+			printf("DAC readback failed at fine scan step %i\n",ifine);
+		MeasureRates(shortsleepval, finerate[ifine]);
+	}
+
+	// peak of the fine scan from a gaussian fit
+	for(ifa=0; ifa<nfadc; ifa++) {
+		for (chan=0; chan<=15; chan++) {
+			for (ifine=0; ifine<NFINE; ifine++) {
+				scandac[ifine] = finestart[ifa][chan]+ifine;
+				scanrate[ifine] = finerate[ifine][ifa][chan];
+				if (scanrate[ifine]>highestrate[ifa][chan])
+					highestrate[ifa][chan]=scanrate[ifine];
 			}
-			// save DAC value if rate is highest
-			double time=scalerdata2[ifa][16]-scalerdata1[ifa][16];
-			for (chan=0; chan<=15; chan++) {
-				double rate = (scalerdata2[ifa][chan]-scalerdata1[ifa][chan])/time;
-				if (rate>highestrate[ifa][chan]) {
-					highestrate[ifa][chan]=rate;
-					highestdacval[ifa][chan]=dacval;
-				}
+			highestdacval[ifa][chan] = (int)(FitPeak(NFINE, scandac, scanrate) + 0.5);
+		}
+	}
+	// a stored value off by more than the fine scan puts the peak on its
+	// edge; channels without a peak (dead or disconnected) do not count
+	if (warm) {
+		float maxrate=0;
+		for(ifa=0; ifa<nfadc; ifa++)
+			for (chan=0; chan<=15; chan++)
+				if (highestrate[ifa][chan]>maxrate) maxrate=highestrate[ifa][chan];
+		for(ifa=0; ifa<nfadc && warm; ifa++) {
+			for (chan=0; chan<=15 && warm; chan++) {
+				if (highestrate[ifa][chan] < 0.1*maxrate)
+					continue;
+				if (highestdacval[ifa][chan] <= finestart[ifa][chan] ||
+				    highestdacval[ifa][chan] >= finestart[ifa][chan]+NFINE-1)
+					warm = 0;
 			}
 		}
+		if (!warm) {
+			printf("Stored DAC values are off, doing the full sweep\n");
+			memset(highestrate, 0, sizeof(highestrate));
+			goto SWEEP;
+		}
 	}
 	// print results
 	printf("\nRESULTS\n\n");
@@ -246,6 +341,16 @@ main(int argc, char *argv[])
 	}
 	fclose(outfile);
 
+	// Record the DAC values in the calibration store
+	for(ifa=0; ifa<nfadc; ifa++) {
+		for (chan=0; chan<=15; chan++) {
+			faCalibChannel cal = {highestdacval[ifa][chan], -1, thresh, -1, 0};
+			faCalibSet(faSlot(ifa), chan, &cal);
+		}
+	}
+	if (faCalibSave(NULL) < 0)
+		printf("Unable to update the calibration store\n");
+
 	// Set the DAC values to the optimum
 	for(ifa=0; ifa<nfadc; ifa++) {
 		for (chan=0; chan<=15; chan++) {
@@ -302,8 +407,9 @@ void
 Usage()
 {
 	printf("\nUSAGE:\n\n");
-	printf("%s PedestalValue\n",progName);
-	printf("\t - Find DAC value to put pedestal at PedestalValue\n\n");
+	printf("%s PedestalValue [cold]\n",progName);
+	printf("\t - Find DAC value to put pedestal at PedestalValue\n");
+	printf("\t   cold: ignore the DAC values in the calibration store\n\n");
 	printf("\n\n");
 }
 
@@ -318,3 +424,67 @@ void PrintDataArray(int *array[]) {
 		printf("\n");
 	}
 }
+
+
+/* Latch the scalers of all modules, wait sleepval us, latch again and
+   return the rate of each channel (counts per scaler time count) */
+void MeasureRates(int sleepval, double rate[FA_MAX_BOARDS][FA_MAX_ADC_CHANNELS]) {
+	unsigned int scalerdata1[FA_MAX_BOARDS][17];
+	unsigned int scalerdata2[FA_MAX_BOARDS][17];
+	int ifa,chan;
+	for(ifa=0; ifa<nfadc; ifa++)
+		faReadScalers(faSlot(ifa), scalerdata1[ifa], 0xffff, 1);
+	usleep(sleepval);
+	for(ifa=0; ifa<nfadc; ifa++) {
+		faReadScalers(faSlot(ifa), scalerdata2[ifa], 0xffff, 1);
+		double time=scalerdata2[ifa][16]-scalerdata1[ifa][16];
+		for (chan=0; chan<=15; chan++) {
+			rate[ifa][chan] = (time>0) ? (scalerdata2[ifa][chan]-scalerdata1[ifa][chan])/time : 0;
+		}
+	}
+}
+
+
+/* DAC value of the peak of the rate curve.  A parabola is fitted to the
+   log of the rate (a gaussian) over the highest point and its neighbours
+   with at least 1% of its rate, weighted by rate.  Returns the DAC value
+   of the highest point when there are fewer than 3 such points or the
+   fit has no maximum inside them. */
+double FitPeak(int npts, int *dac, double *rate) {
+	int i, imax=0, ilo, ihi;
+	double s[5]={0,0,0,0,0}, t[3]={0,0,0};
+	for (i=1; i<npts; i++)
+		if (rate[i]>rate[imax]) imax=i;
+	if (rate[imax]<=0)
+		return dac[imax];
+	for (ilo=imax; ilo>0 && ilo>imax-2 && rate[ilo-1]>0.01*rate[imax]; ilo--);
+	for (ihi=imax; ihi<npts-1 && ihi<imax+2 && rate[ihi+1]>0.01*rate[imax]; ihi++);
+	if (ihi-ilo<2)
+		return dac[imax];
+	for (i=ilo; i<=ihi; i++) {
+		double x = dac[i]-dac[imax], y = log(rate[i]), w = rate[i];
+		s[0] += w;       s[1] += w*x;     s[2] += w*x*x;
+		s[3] += w*x*x*x; s[4] += w*x*x*x*x;
+		t[0] += w*y;     t[1] += w*x*y;   t[2] += w*x*x*y;
+	}
+	// solve the normal equations for y = a + b x + c x^2
+	double det = s[0]*(s[2]*s[4]-s[3]*s[3]) - s[1]*(s[1]*s[4]-s[3]*s[2]) + s[2]*(s[1]*s[3]-s[2]*s[2]);
+	if (det==0)
+		return dac[imax];
+	double b = (s[0]*(t[1]*s[4]-s[3]*t[2]) - t[0]*(s[1]*s[4]-s[3]*s[2]) + s[2]*(s[1]*t[2]-t[1]*s[2]))/det;
+	double c = (s[0]*(s[2]*t[2]-t[1]*s[3]) - s[1]*(s[1]*t[2]-t[1]*s[2]) + t[0]*(s[1]*s[3]-s[2]*s[2]))/det;
+	if (c>=0)
+		return dac[imax];
+	double peak = -b/(2*c);
+	if (peak<dac[ilo]-dac[imax] || peak>dac[ihi]-dac[imax])
+		return dac[imax];
+	return dac[imax]+peak;
+}
+
+// first DAC value of the fine scan around peak, kept inside 0 - DACMAX
+int FineStart(int peak) {
+	int start = peak - FINEHALFWIDTH;
+	if (start < 0) start = 0;
+	if (start > DACMAX-NFINE+1) start = DACMAX-NFINE+1;
+	return start;
+}
@@ -0,0 +1,174 @@
+//
+// faEmulate - run the fadc250 pulse processing emulator (fadc250emu)
+//             either as a throughput benchmark on synthetic raw windows,
+//             or to validate firmware pulse parameters against the raw
+//             windows of a mode 10 readout dump.
+//
+// version: october 16, 2026
+//
+// Usage:
+//        $ ./faEmulate -b [<nwindows>] [<ptw>] [<nthreads>]
+//        $ ./faEmulate -v <dumpfile> [<TET> | <cnffile> [<crate>]]
+//
+// Notes:
+//  1. The dump file holds the buffers returned by faReadBlock, as
+//     written to disk (big-endian words).
+//  2. Processing parameters default to those used by fadc250::acquire;
+//     override them with the environment variables FA_NSB, FA_NSA, FA_NP,
+//     FA_NPED, FA_MAXPED and FA_NSAT.  When validating, NSB and NSA are
+//     taken from the block headers of the dump.
+//  3. The TET of each channel is either one value for all, or the
+//     FADC250_ALLCH_THR settings of a .cnf file (by slot; channels
+//     without a setting keep the default of 20).
+//
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "fadc250emu.hh"
+
+extern "C" {
+    #include "jvme.h"
+    #include "fadcLib.h"
+}
+
+static int envint(const char *name, int defval)
+{
+    const char *val = getenv(name);
+    return (val)? atoi(val) : defval;
+}
+
+void usage()
+{
+    printf("Usage: faEmulate -b [<nwindows>] [<ptw>] [<nthreads>]\n");
+    printf("       faEmulate -v <dumpfile> [<TET> | <cnffile> [<crate>]]\n");
+    exit(1);
+}
+
+// synthetic window: pedestal near 100 with noise and 0-3 pulses
+static void make_window(short *samp, int ptw, unsigned int &seed)
+{
+    for (int i=0; i < ptw; ++i) {
+        seed = seed * 1664525 + 1013904223;
+        samp[i] = 100 + ((seed >> 24) & 0x7);
+    }
+    seed = seed * 1664525 + 1013904223;
+    int npulses = (seed >> 28) & 0x3;
+    for (int p=0; p < npulses; ++p) {
+        seed = seed * 1664525 + 1013904223;
+        int t0 = 10 + (seed >> 8) % (ptw > 30? ptw - 30 : 1);
+        int amp = 50 + ((seed >> 20) & 0x7ff);
+        static const int shape[8] = {10, 45, 100, 80, 55, 35, 20, 10};
+        for (int k=0; k < 8 && t0 + k < ptw; ++k) {
+            int v = (samp[t0 + k] & 0xfff) + amp * shape[k] / 100;
+            samp[t0 + k] = (v > 0xfff)? (0xfff | 0x1000) : v;
+        }
+    }
+}
+
+int benchmark(int nwin, int ptw, int nthreads, const fadc250emu &emu)
+{
+    if (nthreads <= 0)
+        nthreads = std::thread::hardware_concurrency();
+    std::vector<short> samples((long)nwin * ptw);
+    std::vector<fadc250emu_window> win(nwin);
+    unsigned int seed = 12345;
+    for (int i=0; i < nwin; ++i) {
+        make_window(&samples[(long)i * ptw], ptw, seed);
+        fadc250emu_window w = {i % 16, 1, &samples[(long)i * ptw], ptw};
+        win[i] = w;
+    }
+    std::vector<unsigned int> words((long)nwin * emu.max_words());
+    std::vector<int> nwords(nwin);
+
+    auto t0 = std::chrono::steady_clock::now();
+    long hits = emu.emulate_batch(&win[0], nwin, &words[0], &nwords[0], nthreads);
+    auto t1 = std::chrono::steady_clock::now();
+    double dt = std::chrono::duration<double>(t1 - t0).count();
+
+    printf("windows=%d ptw=%d threads=%d pulses=%ld time=%.4f s\n",
+           nwin, ptw, nthreads, hits, dt);
+    printf("%.3e windows/s  %.3e hits/s  %.3e samples/s\n",
+           nwin / dt, hits / dt, (double)nwin * ptw / dt);
+    return 0;
+}
+
+int validate(const char *fname, const fadc250emu &emu,
+             const int (*tet)[16])
+{
+    FILE *fp = fopen(fname, "rb");
+    if (fp == 0) {
+        perror(fname);
+        return 1;
+    }
+    std::vector<unsigned int> data;
+    unsigned int buf[4096];
+    size_t n;
+    while ((n = fread(buf, sizeof(unsigned int), 4096, fp)) > 0)
+        data.insert(data.end(), buf, buf + n);
+    fclose(fp);
+
+    int nwin = 0;
+    int ndiff = emu.validate(&data[0], data.size(), 1, nwin, 1, tet);
+    printf("%d windows compared, %d differ\n", nwin, ndiff);
+    return (ndiff > 0)? 2 : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+        usage();
+
+    fadc250emu_config config;
+    config.NSB = envint("FA_NSB", 3);
+    config.NSA = envint("FA_NSA", 15);
+    config.NP = envint("FA_NP", 4);
+    config.NPED = envint("FA_NPED", 5);
+    config.MAXPED = envint("FA_MAXPED", 600);
+    config.NSAT = envint("FA_NSAT", 2);
+    for (int c=0; c < 16; ++c)
+        config.TET[c] = 20;
+
+    if (strcmp(argv[1], "-b") == 0) {
+        int nwin = (argc > 2)? atoi(argv[2]) : 1000000;
+        int ptw = (argc > 3)? atoi(argv[3]) : 100;
+        int nthreads = (argc > 4)? atoi(argv[4]) : 0;
+        fadc250emu emu(config);
+        return benchmark(nwin, ptw, nthreads, emu);
+    }
+    else if (strcmp(argv[1], "-v") == 0 && argc > 2) {
+        static int tet[22][16];
+        static faCnf cnf;
+        int usecnf = 0;
+        if (argc > 3) {
+            char *end;
+            long val = strtol(argv[3], &end, 10);
+            if (*end == 0) {
+                for (int c=0; c < 16; ++c)
+                    config.TET[c] = val;
+            }
+            else {
+                faCnfClear(&cnf);
+                if (faCnfRead(argv[3], (argc > 4)? argv[4] : 0, &cnf) < 0)
+                    return 1;
+                usecnf = 1;
+            }
+        }
+        for (int s=0; s < 22; ++s) {
+            for (int c=0; c < 16; ++c) {
+                tet[s][c] = config.TET[c];
+                if (usecnf && (cnf.slot[s].thrmask & (1 << c)))
+                    tet[s][c] = cnf.slot[s].thr[c];
+            }
+        }
+        fadc250emu emu(config);
+        return validate(argv[2], emu, tet);
+    }
+    usage();
+    return 1;
+}
@@ -0,0 +1,113 @@
+//
+// faFitRates - fit the rate vs threshold curves written by faMapRates or
+//              ratevsthreshold_allchan (see ratescan.hh) and write the
+//              chosen per-channel thresholds as a FADC250_ALLCH_THR
+//              config file.
+//
+// version: october 16, 2026
+//
+// Usage:
+//        $ ./faFitRates [-r <rule>] [-o <outfile>] [-p] [-d <defthr>]
+//                       [-t <nthreads>] [-q] <scanfile> [<scanfile> ...]
+//
+// Notes:
+//  1. rule is nsigma:N, rate:R (Hz) or spe:F, default nsigma:5.
+//  2. With -p the thresholds are written relative to the fitted pedestal,
+//     as for the TET of the readout; without it they are absolute, as
+//     scanned.  Channels without a fit get <defthr>, default 5.
+//  3. The crate name in the output is taken from HOSTNAME.
+//
+
+#include <iostream>
+#include <chrono>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "ratescan.hh"
+
+void usage()
+{
+    printf("Usage: faFitRates [-r <rule>] [-o <outfile>] [-p] [-d <defthr>]\n");
+    printf("                  [-t <nthreads>] [-q] <scanfile> [<scanfile> ...]\n");
+    printf("   rule: nsigma:N, rate:R or spe:F (default nsigma:5)\n");
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    ratescan_rule rule;
+    rule.type = ratescan_rule::NSIGMA;
+    rule.value = 5;
+    const char *outname = 0;
+    int relative = 0;
+    int defthr = 5;
+    int nthreads = 0;
+    int quiet = 0;
+
+    int c;
+    while ((c = getopt(argc, argv, "r:o:pd:t:q")) != -1) {
+        switch (c) {
+          case 'r':
+            if (!rule.parse(optarg)) {
+                printf("faFitRates: bad rule %s\n", optarg);
+                usage();
+            }
+            break;
+          case 'o':
+            outname = optarg;
+            break;
+          case 'p':
+            relative = 1;
+            break;
+          case 'd':
+            defthr = atoi(optarg);
+            break;
+          case 't':
+            nthreads = atoi(optarg);
+            break;
+          case 'q':
+            quiet = 1;
+            break;
+          default:
+            usage();
+        }
+    }
+    if (optind >= argc)
+        usage();
+
+    ratescan scan;
+    for (int i=optind; i < argc; ++i) {
+        if (scan.read(argv[i]) < 0)
+            printf("faFitRates: cannot read %s, skipped\n", argv[i]);
+    }
+    if (scan.ncurves() == 0) {
+        printf("faFitRates: no rate vs threshold curves found\n");
+        return 1;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    int nok = scan.fit_all(rule, nthreads);
+    auto t1 = std::chrono::steady_clock::now();
+    double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+    if (!quiet)
+        scan.print(stdout);
+    printf("%d curves fitted in %.1f ms, %d with noise edge and plateau\n",
+           scan.ncurves(), ms, nok);
+
+    const char *host = getenv("HOSTNAME");
+    if (host == 0)
+        host = "unknown";
+    char filename[600];
+    if (outname)
+        snprintf(filename, sizeof(filename), "%s", outname);
+    else
+        snprintf(filename, sizeof(filename), "%s_fadc250_thresholds.cnf", host);
+    if (scan.write_config(filename, host, rule, relative, defthr) != 0) {
+        printf("faFitRates: cannot write %s\n", filename);
+        return 1;
+    }
+    printf("Wrote %s\n", filename);
+    return 0;
+}
@@ -6,6 +6,16 @@
  *    Move the trigger path threshold around desired pedestal value.
  *    Output measured rates over range to file.
  *
+ *    With -a the thresholds are chosen adaptively: every module starts
+ *    from a few evenly spaced thresholds, then each new threshold is
+ *    put between the neighbouring measured thresholds where the rate
+ *    changes most, until the rate changes by less than a factor
+ *    exp(RESOLVED) between neighbours.  Modules are scanned
+ *    independently, each at its own threshold in the same dwell.
+ *    With -c the same is done for each channel separately, using the
+ *    channel readout threshold (faSetThreshold), for firmware where the
+ *    scalers count readout threshold crossings.
+ *
  */
 
 
@@ -28,6 +38,7 @@ cd /gluonfs1/home/dalton/svn/daq_dev_vers/daq/vme/src/vmefa/test
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <math.h>
 #include "jvme.h"
 #include "fadcLib.h"
 #include "fadcLib_extensions.h"
@@ -38,17 +49,46 @@ extern int fadcA32Base;
 extern int fadcID[FA_MAX_BOARDS];
 extern int nfadc;
 
+#define MAXPOINTS  64   /* most thresholds measured per module/channel */
+#define NINITIAL    5   /* evenly spaced thresholds measured first */
+#define RESOLVED  0.5   /* largest change of log(rate) between neighbours */
+#define NSIGMA    3.0   /* smallest significant rate change, in std devs */
+
+/* One independently scanned threshold: a whole module (trigger path
+   threshold, chan = -1) or a single channel (readout threshold) */
+typedef struct {
+	int ifa;
+	int chan;
+	int npts;
+	int thr[MAXPOINTS];                          /* sorted */
+	double rate[MAXPOINTS][FA_MAX_ADC_CHANNELS];
+	double time[MAXPOINTS];                      /* dwell in seconds */
+	int next;                                    /* -1 when resolved */
+} ScanUnit;
+
+ScanUnit scanunit[FA_MAX_BOARDS*FA_MAX_ADC_CHANNELS];
+
 char *progName;
 void Usage();
 void PrintDataArray(int *array[]);
+int NextThreshold(ScanUnit *u, int threshstart, int threshstop, int threshstep);
+int MapRatesAdaptive(int threshstart, int threshstop, int threshstep, int perchan,
+		     int sleepval, char *host, char *datetimelabel);
 
 int 
 main(int argc, char *argv[]) 
 {
 	int threshstart=0, threshstop=0, threshstep=1;
+	int adaptive=0, perchan=0;
 
 	/* Parse command line arguments */
 	progName = argv[0];
+	if (argc>1 && (strcmp(argv[1],"-a")==0 || strcmp(argv[1],"-c")==0)) {
+		adaptive = 1;
+		perchan = (argv[1][1]=='c');
+		argc--;
+		argv++;
+	}
 	switch(argc) {
 	case 3:
 		{
@@ -73,6 +113,7 @@ main(int argc, char *argv[])
 		printf("Threshold_min < Threshold_max\n");
 		return -1;
 	}
+	if (threshstep<1) threshstep=1;
 
 	int DEBUG=0;
 
@@ -159,54 +200,60 @@ main(int argc, char *argv[])
 	// ScalerReadFlag = (1<<0) && (1<<1);   // latch and clear
 	ScalerReadFlag = (1<<0);             // latch
 
-	// Loop over threshold values
-	int threshval;
-	for (threshval = threshstart; threshval<=threshstop; threshval+=threshstep) {
-		if (DEBUG>0) printf("Setting threshold value to: %i\n",threshval);
-		else {
-			printf("Setting threshold value to: %i\n",threshval);
-			fflush(stdout);
-		}
-		// loop over modules to set trigger path threshold
-		for(ifa=0; ifa<nfadc; ifa++) 
-			faSetTriggerPathThreshold(faSlot(ifa),threshval);
-		// loop over modules to read scalers 
-		for(ifa=0; ifa<nfadc; ifa++) {
-			faReadScalers(faSlot(ifa), scalerdata1[ifa], 0xffff, ScalerReadFlag);
-			if (DEBUG>2) { // print the first read
-				printf("Mod %2i   ", faSlot(ifa));
-				for (chan=0; chan<FA_MAX_ADC_CHANNELS; chan++) {
-					if (chan==8) printf("\n         ");
-					printf("%10u ",scalerdata1[ifa][chan]);
-				}
-				printf("\n");
+	if (adaptive) {
+		MapRatesAdaptive(threshstart, threshstop, threshstep, perchan,
+				 sleepval, host, datetimelabel);
+	}
+	else {
+		// Loop over threshold values
+		int threshval;
+		for (threshval = threshstart; threshval<=threshstop; threshval+=threshstep) {
+			if (DEBUG>0) printf("Setting threshold value to: %i\n",threshval);
+			else {
+				printf("Setting threshold value to: %i\n",threshval);
+				fflush(stdout);
 			}
-		}
-		// sleep to accumulate scaler scalerdata
-		usleep(sleepval);
-		// loop over modules to read scalers 
-		for(ifa=0; ifa<nfadc; ifa++) {
-			faReadScalers(faSlot(ifa), scalerdata2[ifa], 0xffff, ScalerReadFlag);
-			if (DEBUG>3) { // printf the second read
-				printf("Mod %2i   ", faSlot(ifa));
-				for (chan=0; chan<FA_MAX_ADC_CHANNELS; chan++) {
-					if (chan==8) printf("\n         ");
-					printf("%10u ",scalerdata2[ifa][chan]);
+			// loop over modules to set trigger path threshold
+			for(ifa=0; ifa<nfadc; ifa++) 
+				faSetTriggerPathThreshold(faSlot(ifa),threshval);
+			// loop over modules to read scalers 
+			for(ifa=0; ifa<nfadc; ifa++) {
+				faReadScalers(faSlot(ifa), scalerdata1[ifa], 0xffff, ScalerReadFlag);
+				if (DEBUG>2) { // print the first read
+					printf("Mod %2i   ", faSlot(ifa));
+					for (chan=0; chan<FA_MAX_ADC_CHANNELS; chan++) {
+						if (chan==8) printf("\n         ");
+						printf("%10u ",scalerdata1[ifa][chan]);
+					}
+					printf("\n");
 				}
-				printf("\n");
 			}
-			// Write data to file
-			double clockcycles = scalerdata2[ifa][16]-scalerdata1[ifa][16];
-			double time = clockcycles * 2048e-9;
-			for (chan=0; chan<FA_MAX_ADC_CHANNELS; chan++) {
-				double rate = (scalerdata2[ifa][chan]-scalerdata1[ifa][chan])/time;
-				if (fileisopen[ifa][chan]==0) {
-					sprintf(filename,"ADC_ratevthresh_%s_%s_s%02ic%02i.txt",host,datetimelabel,faSlot(ifa),chan);
-					//printf("opening file: %s\n",filename);
-					outfile[ifa][chan] = fopen(filename, "a");
-					fileisopen[ifa][chan] = 1;
+			// sleep to accumulate scaler scalerdata
+			usleep(sleepval);
+			// loop over modules to read scalers 
+			for(ifa=0; ifa<nfadc; ifa++) {
+				faReadScalers(faSlot(ifa), scalerdata2[ifa], 0xffff, ScalerReadFlag);
+				if (DEBUG>3) { // printf the second read
+					printf("Mod %2i   ", faSlot(ifa));
+					for (chan=0; chan<FA_MAX_ADC_CHANNELS; chan++) {
+						if (chan==8) printf("\n         ");
+						printf("%10u ",scalerdata2[ifa][chan]);
+					}
+					printf("\n");
+				}
+				// Write data to file
+				double clockcycles = scalerdata2[ifa][16]-scalerdata1[ifa][16];
+				double time = clockcycles * 2048e-9;
+				for (chan=0; chan<FA_MAX_ADC_CHANNELS; chan++) {
+					double rate = (scalerdata2[ifa][chan]-scalerdata1[ifa][chan])/time;
+					if (fileisopen[ifa][chan]==0) {
+						sprintf(filename,"ADC_ratevthresh_%s_%s_s%02ic%02i.txt",host,datetimelabel,faSlot(ifa),chan);
+						//printf("opening file: %s\n",filename);
+						outfile[ifa][chan] = fopen(filename, "a");
+						fileisopen[ifa][chan] = 1;
+					}
+					fprintf(outfile[ifa][chan],"%4i %13.3f\n",threshval,rate);
 				}
-				fprintf(outfile[ifa][chan],"%4i %13.3f\n",threshval,rate);
 			}
 		}
 	}
@@ -251,6 +298,10 @@ Usage()
 	printf("\nUSAGE:\n\n");
 	printf("%s Threshold_min Threshold_max Thresold_step\n",progName);
 	printf("\t - Find DAC value to put pedestal at PedestalValue\n\n");
+	printf("%s -a Threshold_min Threshold_max Min_step\n",progName);
+	printf("\t - Adaptive scan, trigger path threshold of each module\n\n");
+	printf("%s -c Threshold_min Threshold_max Min_step\n",progName);
+	printf("\t - Adaptive scan, readout threshold of each channel\n\n");
 	printf("\n\n");
 }
 
@@ -266,3 +317,149 @@ void PrintDataArray(int *array[]) {
 		printf("\n");
 	}
 }
+
+
+/* Threshold to measure next for a module/channel, or -1 once its rate
+   curve is resolved */
+int NextThreshold(ScanUnit *u, int threshstart, int threshstop, int threshstep) {
+	int i, chan, best=-1;
+	double score, bestscore=RESOLVED, r1, r2, var;
+	if (u->npts < NINITIAL)
+		return threshstart + (threshstop-threshstart)*u->npts/(NINITIAL-1);
+	if (u->npts >= MAXPOINTS)
+		return -1;
+	for (i=0; i<u->npts-1; i++) {
+		if (u->thr[i+1]-u->thr[i] < 2*threshstep)
+			continue;
+		for (chan=0; chan<FA_MAX_ADC_CHANNELS; chan++) {
+			if (u->chan>=0 && chan!=u->chan)
+				continue;
+			// changes within the counting statistics do not count
+			r1 = u->rate[i][chan];
+			r2 = u->rate[i+1][chan];
+			var = (r1+1)/u->time[i] + (r2+1)/u->time[i+1];
+			if ((r1-r2)*(r1-r2) < NSIGMA*NSIGMA*var)
+				continue;
+			score = fabs(log(r1+1) - log(r2+1));
+			if (score > bestscore) {
+				bestscore = score;
+				best = i;
+			}
+		}
+	}
+	if (best<0)
+		return -1;
+	return (u->thr[best]+u->thr[best+1])/2;
+}
+
+
+/* Adaptive scan of all modules (perchan=0) or all channels (perchan=1),
+   each dwell measuring every unresolved module/channel at its own next
+   threshold.  Writes the same files as the linear scan.  Returns the
+   number of dwells */
+int MapRatesAdaptive(int threshstart, int threshstop, int threshstep, int perchan,
+		     int sleepval, char *host, char *datetimelabel) {
+	unsigned int scalerdata1[FA_MAX_BOARDS][17];
+	unsigned int scalerdata2[FA_MAX_BOARDS][17];
+	double rate[FA_MAX_BOARDS][FA_MAX_ADC_CHANNELS];
+	double time[FA_MAX_BOARDS];
+	struct fadc_struct st[FA_MAX_BOARDS];
+	int ifa, chan, iu, nunit=0, nactive, ndwell=0, i, j;
+	ScanUnit *u;
+
+	for(ifa=0; ifa<nfadc; ifa++) {
+		if (perchan) {
+			// save the readout thresholds
+			faSnapshot(faSlot(ifa), &st[ifa], FA_SNAPSHOT_THRES);
+			for (chan=0; chan<FA_MAX_ADC_CHANNELS; chan++) {
+				scanunit[nunit].ifa = ifa;
+				scanunit[nunit++].chan = chan;
+			}
+		}
+		else {
+			scanunit[nunit].ifa = ifa;
+			scanunit[nunit++].chan = -1;
+		}
+	}
+	for (iu=0; iu<nunit; iu++)
+		scanunit[iu].npts = 0;
+
+	while (1) {
+		nactive = 0;
+		if (perchan) faTransBegin();
+		for (iu=0; iu<nunit; iu++) {
+			u = &scanunit[iu];
+			u->next = NextThreshold(u, threshstart, threshstop, threshstep);
+			if (u->next<0)
+				continue;
+			nactive++;
+			if (perchan)
+				faTransSetThreshold(faSlot(u->ifa), u->next, (1<<u->chan));
+			else
+				faSetTriggerPathThreshold(faSlot(u->ifa), u->next);
+		}
+		if (perchan) faTransCommit();
+		if (nactive==0)
+			break;
+		printf("Dwell %3i: %3i %s still scanning\n", ndwell+1, nactive,
+		       perchan ? "channels" : "modules");
+		fflush(stdout);
+
+		for(ifa=0; ifa<nfadc; ifa++)
+			faReadScalers(faSlot(ifa), scalerdata1[ifa], 0xffff, 1);
+		usleep(sleepval);
+		for(ifa=0; ifa<nfadc; ifa++) {
+			faReadScalers(faSlot(ifa), scalerdata2[ifa], 0xffff, 1);
+			time[ifa] = (scalerdata2[ifa][16]-scalerdata1[ifa][16]) * 2048e-9;
+			for (chan=0; chan<FA_MAX_ADC_CHANNELS; chan++)
+				rate[ifa][chan] = (time[ifa]>0) ? (scalerdata2[ifa][chan]-scalerdata1[ifa][chan])/time[ifa] : 0;
+		}
+		ndwell++;
+
+		// insert the new point in threshold order
+		for (iu=0; iu<nunit; iu++) {
+			u = &scanunit[iu];
+			if (u->next<0)
+				continue;
+			for (i=u->npts; i>0 && u->thr[i-1]>u->next; i--) {
+				u->thr[i] = u->thr[i-1];
+				memcpy(u->rate[i], u->rate[i-1], sizeof(u->rate[i]));
+				u->time[i] = u->time[i-1];
+			}
+			u->thr[i] = u->next;
+			u->time[i] = time[u->ifa];
+			memcpy(u->rate[i], rate[u->ifa], sizeof(u->rate[i]));
+			u->npts++;
+		}
+	}
+
+	// write one file per channel, as the linear scan does
+	char filename[255];
+	for (iu=0; iu<nunit; iu++) {
+		u = &scanunit[iu];
+		for (chan=0; chan<FA_MAX_ADC_CHANNELS; chan++) {
+			if (u->chan>=0 && chan!=u->chan)
+				continue;
+			sprintf(filename,"ADC_ratevthresh_%s_%s_s%02ic%02i.txt",host,datetimelabel,faSlot(u->ifa),chan);
+			FILE *outfile = fopen(filename, "a");
+			if (outfile==NULL) {
+				printf("Cannot open %s\n",filename);
+				continue;
+			}
+			for (j=0; j<u->npts; j++)
+				fprintf(outfile,"%4i %13.3f\n",u->thr[j],u->rate[j][chan]);
+			fclose(outfile);
+		}
+	}
+
+	// restore the readout thresholds
+	if (perchan) {
+		for(ifa=0; ifa<nfadc; ifa++)
+			for (chan=0; chan<FA_MAX_ADC_CHANNELS; chan++)
+				faSetThreshold(faSlot(ifa), st[ifa].adc_thres[chan], (1<<chan));
+	}
+
+	printf("Adaptive scan done in %i dwells (%i for the linear scan)\n",
+	       ndwell, (threshstop-threshstart)/threshstep+1);
+	return ndwell;
+}
@@ -0,0 +1,216 @@
+/*
+ * File:
+ *    faPedMon.c
+ *
+ * Description:
+ *    Online pedestal monitor.  Samples the baseline of every channel
+ *    with faReadAllChannelSamples while the crate is idle, keeps running
+ *    statistics (faPedMonSample) and publishes mean, sigma and number
+ *    of samples of each channel to the roc_shmem PedMon table at a fixed
+ *    cadence.  A channel whose mean moves more than the drift tolerance
+ *    from its first published mean is flagged PEDMON_DRIFT.
+ *
+ *    The table is written under the pedmon_seq sequence lock, readers
+ *    take a consistent copy with pedmon_read() (shmem_roc.h); -r prints
+ *    the table that way.
+ *
+ *    Do not run while the modules are taking data: the sample readout
+ *    toggles the channel read enable of the processing FPGA.  During a
+ *    run, the readout list can feed the same statistics from mode 10
+ *    pre-trigger samples with faPedMonAddHits.
+ *
+ *    Usage:
+ *       faPedMon [-c cadence_ms] [-n nreads] [-s sleep_us] [-d drift]
+ *                [-m maxvalue] [-t seconds]
+ *       faPedMon -r
+ *
+ */
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <sys/time.h>
+#include "jvme.h"
+#include "fadcLib.h"
+#include "shmem_roc.h"
+
+extern int fadcA32Base;
+extern int nfadc;
+
+char *progName;
+void Usage();
+static roc_shmem *shmem_get();
+static int PrintTable(roc_shmem *shm);
+
+static long long
+now_ms()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (long long)tv.tv_sec*1000 + tv.tv_usec/1000;
+}
+
+static faPedMon pm;
+static double refmean[FA_MAX_BOARDS+1][FA_MAX_ADC_CHANNELS];
+
+int
+main(int argc, char *argv[])
+{
+	int cadence=1000;    /* ms between publications */
+	int nreads=64;       /* reads of each module per pass */
+	int sleepval=10000;  /* us between passes */
+	double drift=1.0;    /* ADC counts */
+	int maxvalue=0;
+	int runtime=0;
+	int readonly=0;
+	int c, ifa, chan;
+
+	progName = argv[0];
+	while ((c = getopt(argc, argv, "c:n:s:d:m:t:r")) != -1) {
+		switch (c) {
+		case 'c': cadence = atoi(optarg); break;
+		case 'n': nreads = atoi(optarg); break;
+		case 's': sleepval = atoi(optarg); break;
+		case 'd': drift = atof(optarg); break;
+		case 'm': maxvalue = atoi(optarg); break;
+		case 't': runtime = atoi(optarg); break;
+		case 'r': readonly = 1; break;
+		default:
+			Usage();
+			exit(1);
+		}
+	}
+	if (cadence <= 0 || nreads <= 0) {
+		Usage();
+		exit(1);
+	}
+
+	roc_shmem *shm = shmem_get();
+	if (shm == NULL)
+		exit(1);
+	if (readonly) {
+		exit(PrintTable(shm));
+	}
+
+	printf("\nJLAB fadc pedestal monitor\n");
+	printf("-------------------------------\n");
+
+	vmeSetQuietFlag(1);
+	if (vmeOpenDefaultWindows() != OK) {
+		printf("Failed to access VME bridge\n");
+		exit(1);
+	}
+
+	fadcA32Base=0x09000000;
+	int InitFlag = FA_INIT_SKIP; /* Do not attempt to initialize the module(s) */
+	InitFlag |= FA_INIT_SKIP_FIRMWARE_CHECK;
+	InitFlag |= FA_INIT_DISCOVERY_CACHE; /* Skip the empty slots found last time */
+	printf(" Locating fADC250s in the crate...\n");
+	faInit((3<<19),(1<<19),20,InitFlag);
+	if (nfadc == 0) {
+		printf("No fADC250s found\n");
+		vmeCloseDefaultWindows();
+		exit(1);
+	}
+
+	faPedMonInit(&pm, maxvalue);
+	memset(refmean, 0, sizeof(refmean));
+	shm->pedmon_cadence = cadence;
+	printf("Publishing every %i ms, %i reads per module per pass\n", cadence, nreads);
+
+	long long start = now_ms();
+	long long next = start + cadence;
+	while (runtime <= 0 || now_ms() - start < runtime*1000LL) {
+		vmeBusLock();
+		for (ifa=0; ifa<nfadc; ifa++)
+			faPedMonSample(&pm, faSlot(ifa), nreads);
+		vmeBusUnlock();
+
+		if (now_ms() >= next) {
+			long long t = now_ms();
+			shm_seq_write_begin(&shm->pedmon_seq);
+			for (ifa=0; ifa<nfadc; ifa++) {
+				int slot = faSlot(ifa);
+				for (chan=0; chan<FA_MAX_ADC_CHANNELS; chan++) {
+					PedMon *p = &shm->pedmon[PEDMON_INDEX(slot,chan)];
+					double mean, var;
+					int n = faPedMonGet(&pm, slot, chan, &mean, &var);
+					if (n <= 0)
+						continue;
+					if (refmean[slot][chan] == 0)
+						refmean[slot][chan] = mean;
+					p->mean = mean;
+					p->sigma = sqrt(var);
+					p->noent = n;
+					p->updated = t;
+					p->status = PEDMON_VALID;
+					if (fabs(mean - refmean[slot][chan]) > drift)
+						p->status |= PEDMON_DRIFT;
+				}
+			}
+			shm_seq_write_end(&shm->pedmon_seq);
+			faPedMonClear(&pm);
+			next += cadence;
+			if (next < t)
+				next = t + cadence;
+		}
+		if (sleepval > 0)
+			usleep(sleepval);
+	}
+
+	vmeCloseDefaultWindows();
+	exit(0);
+}
+
+static int
+PrintTable(roc_shmem *shm)
+{
+	static PedMon copy[MAX_PED];
+	int slot, chan;
+
+	if (pedmon_read(shm, copy, 0, MAX_PED) < 0) {
+		printf("No consistent copy of the pedestal table (writer stopped during an update?)\n");
+		return 1;
+	}
+	printf("slot chan      mean    sigma    noent  status\n");
+	for (slot=0; slot<=FA_MAX_BOARDS; slot++) {
+		for (chan=0; chan<FA_MAX_ADC_CHANNELS; chan++) {
+			PedMon *p = &copy[PEDMON_INDEX(slot,chan)];
+			if (!(p->status & PEDMON_VALID))
+				continue;
+			printf("%4i %4i %9.3f %8.3f %8i  %s\n", slot, chan, p->mean,
+			       p->sigma, p->noent, (p->status & PEDMON_DRIFT)? "DRIFT" : "ok");
+		}
+	}
+	return 0;
+}
+
+static roc_shmem *
+shmem_get()
+{
+	int shmid;
+	roc_shmem *ptr;
+	if ((shmid = shmget(SHM_ID1, sizeof(roc_shmem), 0)) < 0) {
+		printf("==> shmem: shared memory 0x%x, size=%d get error=%d\n",
+		       SHM_ID1, (int)sizeof(roc_shmem), shmid);
+		return NULL;
+	}
+	ptr = (roc_shmem *) shmat(shmid, 0, 0);
+	if (ptr == (roc_shmem *) -1) {
+		printf("==> shmem: shared memory attach error\n");
+		return NULL;
+	}
+	return ptr;
+}
+
+void
+Usage()
+{
+	printf("\nUSAGE:\n\n");
+	printf("%s [-c cadence_ms] [-n nreads] [-s sleep_us] [-d drift] [-m maxvalue] [-t seconds]\n",progName);
+	printf("\t - Publish pedestal mean/sigma of all channels to shared memory\n");
+	printf("%s -r\n",progName);
+	printf("\t - Print the published pedestals\n\n");
+}
@@ -43,6 +43,7 @@ main(int argc, char *argv[])
 
 	iFlag = FA_INIT_SKIP; /* Do not attempt to initialize the module(s) */
 	iFlag |= FA_INIT_SKIP_FIRMWARE_CHECK;
+	iFlag |= FA_INIT_DISCOVERY_CACHE; /* Skip the empty slots found last time */
 	printf(" Locating fADC250s in the crate...\n");
 
 	vmeBusLock();
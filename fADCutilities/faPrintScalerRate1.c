@@ -14,6 +14,9 @@
  *    (or q) before continuing around the loop.
  *
  *  Richard Jones - January 13, 2018
+ *
+ *    While scalerPublisher is running the rates are taken from shared
+ *    memory, and the modules are not touched.
  */
 
 #include <unistd.h>
@@ -22,9 +25,12 @@
 #include <stdio.h>
 #include "jvme.h"
 #include "fadcLib.h"
+#include "shmem_roc.h"
 
 char *progName;
 void Usage();
+static roc_shmem *shmem_get();
+static int PrintShmemRates(roc_shmem *shm);
 
 extern int nfadc;
 
@@ -41,6 +47,11 @@ main(int argc, char *argv[])
 	printf("\nJLAB fADC250 Print Scalers\n");
 	printf("----------------------------\n");
 
+	progName = argv[0];
+	roc_shmem *shm = shmem_get();
+	if (shm != NULL && PrintShmemRates(shm) == OK)
+		exit(0);
+
 	vmeSetQuietFlag(1);
 	if(vmeOpenDefaultWindows()!=OK)
 		{
@@ -54,6 +65,7 @@ main(int argc, char *argv[])
 
 	iFlag = FA_INIT_SKIP; /* Do not attempt to initialize the module(s) */
 	iFlag |= FA_INIT_SKIP_FIRMWARE_CHECK;
+	iFlag |= FA_INIT_DISCOVERY_CACHE; /* Skip the empty slots found last time */
 	printf(" Locating fADC250s in the crate...\n");
 
 	vmeBusLock();
@@ -129,6 +141,61 @@ main(int argc, char *argv[])
 }
 
 
+/*
+ * print the next rates published by scalerPublisher, and wait for the user
+ * returns OK when the user quits, ERROR when there is no publisher or it stops
+ */
+static int
+PrintShmemRates(roc_shmem *shm)
+{
+	static F250_Scalers sc;
+	int64_t seq, last = -1;
+	int i, chan;
+
+	while (1) {
+		seq = f250_scalers_read(shm, &sc);
+		if (seq < 0 || !scalers_live(sc.tv_sec, sc.cadence)) {
+			if (last >= 0)
+				printf(" scalerPublisher stopped, reading the modules\n");
+			return ERROR;
+		}
+		if (seq == last) {
+			usleep(100000);
+			continue;
+		}
+		last = seq;
+		printf("Scaler rates in Hz (from scalerPublisher)\n");
+		for (i=0; i<sc.Nslots && i<MAX_SLOT; i++) {
+			int slot = sc.slots[i];
+			printf("Mod %2i   ", slot);
+			for (chan=0; chan<MAX_CHAN; chan++) {
+				if (chan==8) printf("\n         ");
+				printf("%12.1f ",sc.rates[slot][chan]);
+			}
+			printf(" (%.3f s)\n", sc.rates[slot][MAX_CHAN]);
+		}
+		{
+			char ans[99];
+			printf("press enter to continue, q to quit:");
+			if (fgets(ans, 90, stdin) == NULL || ans[0] == 'q')
+				return OK;
+		}
+	}
+}
+
+static roc_shmem *
+shmem_get()
+{
+	int shmid;
+	roc_shmem *ptr;
+	if ((shmid = shmget(SHM_ID1, sizeof(roc_shmem), 0)) < 0)
+		return NULL;
+	ptr = (roc_shmem *) shmat(shmid, 0, 0);
+	if (ptr == (roc_shmem *) -1)
+		return NULL;
+	return ptr;
+}
+
 void
 Usage()
 {
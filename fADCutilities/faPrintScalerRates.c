@@ -6,6 +6,9 @@
  * Description:
  *    Print scalers from all of the fADC250s in the crate in a loop.
  *
+ *    While scalerPublisher is running the rates are taken from shared
+ *    memory, and the modules are not touched.
+ *
  *  Bryan Moffit - November 2014
  */
 
@@ -15,9 +18,12 @@
 #include <stdio.h>
 #include "jvme.h"
 #include "fadcLib.h"
+#include "shmem_roc.h"
 
 char *progName;
 void Usage();
+static roc_shmem *shmem_get();
+static void PrintShmemRates(roc_shmem *shm);
 
 extern int nfadc;
 
@@ -34,6 +40,11 @@ main(int argc, char *argv[])
 	printf("\nJLAB fADC250 Print Scalers\n");
 	printf("----------------------------\n");
 
+	progName = argv[0];
+	roc_shmem *shm = shmem_get();
+	if (shm != NULL)
+		PrintShmemRates(shm);
+
 	vmeSetQuietFlag(1);
 	if(vmeOpenDefaultWindows()!=OK)
 		{
@@ -47,6 +58,7 @@ main(int argc, char *argv[])
 
 	iFlag = FA_INIT_SKIP; /* Do not attempt to initialize the module(s) */
 	iFlag |= FA_INIT_SKIP_FIRMWARE_CHECK;
+	iFlag |= FA_INIT_DISCOVERY_CACHE; /* Skip the empty slots found last time */
 	printf(" Locating fADC250s in the crate...\n");
 
 	vmeBusLock();
@@ -115,6 +127,58 @@ main(int argc, char *argv[])
 }
 
 
+/*
+ * print the rates published by scalerPublisher, every update
+ * returns when there is no publisher, or it stops
+ */
+static void
+PrintShmemRates(roc_shmem *shm)
+{
+	static F250_Scalers sc;
+	int64_t seq, last = -1;
+	int i, chan;
+
+	while (1) {
+		seq = f250_scalers_read(shm, &sc);
+		if (seq < 0 || !scalers_live(sc.tv_sec, sc.cadence)) {
+			if (last >= 0)
+				printf(" scalerPublisher stopped, reading the modules\n");
+			return;
+		}
+		if (seq == last) {
+			usleep(100000);
+			continue;
+		}
+		if (last < 0)
+			printf(" Reading the rates published by scalerPublisher\n");
+		last = seq;
+		printf("Scaler rates in Hz\n");
+		for (i=0; i<sc.Nslots && i<MAX_SLOT; i++) {
+			int slot = sc.slots[i];
+			printf("Mod %2i   ", slot);
+			for (chan=0; chan<MAX_CHAN; chan++) {
+				if (chan==8) printf("\n         ");
+				printf("%12.1f ",sc.rates[slot][chan]);
+			}
+			printf(" (%.3f s)\n", sc.rates[slot][MAX_CHAN]);
+		}
+		fflush(stdout);
+	}
+}
+
+static roc_shmem *
+shmem_get()
+{
+	int shmid;
+	roc_shmem *ptr;
+	if ((shmid = shmget(SHM_ID1, sizeof(roc_shmem), 0)) < 0)
+		return NULL;
+	ptr = (roc_shmem *) shmat(shmid, 0, 0);
+	if (ptr == (roc_shmem *) -1)
+		return NULL;
+	return ptr;
+}
+
 void
 Usage()
 {
@@ -41,13 +41,15 @@ TH1I *pulse[16] = {0};
 
 TServerSocket *sock = 0;
 
+#define TREE1_MAXSAMP 500   // samples per hit kept in tree1
+
 struct tree1_t {
     int nhit;
     int hcrate[16];
     int hslot[16];
     int hch[16];
     int nsamp[16];
-    int samp[16][500];
+    int samp[16][TREE1_MAXSAMP];
     int invalid[16];
     int overflow[16];
 } trow;
@@ -187,25 +189,33 @@ int decode(int dlen, unsigned int *data)
             trow.hcrate[n] = crate;
             trow.hslot[n] = slot;
             trow.hch[n] = chan;
-            trow.nsamp[n] = nsamples;
+            trow.nsamp[n] = (nsamples > TREE1_MAXSAMP)? TREE1_MAXSAMP : nsamples;
             int istart = i+1;
-            int istop = istart + (nsamples+1)/2;
-            int invalid = 0;
-            int overflow = 0;
-            for (i=istart; i<istop; ++i) {
-                int code = bswap_32(data[i]);
-                int adc0 = ((code & 0xffff0000) >> 16);
-                int adc1 = (code & 0xffff);
-                trow.samp[n][2*(i-istart)] = adc0;
-                trow.samp[n][2*(i-istart)+1] = adc1;
-                invalid += ((adc0 & 0x2000) >> 13);
-                invalid += ((adc1 & 0x2000) >> 13);
-                overflow += ((adc0 & 0x1000) >> 12);
-                overflow += ((adc1 & 0x1000) >> 12);
-                trace[chan]->Fill(8*(i-istart), adc0);
-                trace[chan]->Fill(8*(i-istart)+4, adc1);
+            int nwords = (nsamples+1)/2;
+            if (istart + nwords > dlen)
+                nwords = dlen - istart;
+            unsigned int invalid = 0;
+            unsigned int overflow = 0;
+            // the window width field allows up to 511 samples
+            short samp[512];
+            faUnpackRawSamples(&data[istart], nwords, samp, FA_DECODE_SWAP,
+                               &invalid, &overflow);
+            int nkeep = 2*nwords;
+            static bool warned = false;
+            if (nkeep > TREE1_MAXSAMP) {
+                if (!warned)
+                    printf("slot %d channel %d: raw window of %d samples, "
+                           "only the first %d are kept in tree1\n",
+                           slot, chan, nsamples, TREE1_MAXSAMP);
+                warned = true;
+                nkeep = TREE1_MAXSAMP;
+            }
+            for (int s=0; s < 2*nwords; ++s) {
+                if (s < nkeep)
+                    trow.samp[n][s] = samp[s];
+                trace[chan]->Fill(4*s, samp[s]);
             }
-            --i;
+            i = istart + nwords - 1;
             trow.invalid[n] = invalid;
             trow.overflow[n] = overflow;
             if (trow.nhit == 16) {
@@ -245,10 +255,8 @@ int main(int argc, char *argv[])
     if (argc > 3)
         nevents = std::atoi(argv[3]);
 
-    for (int s=3; s<11; ++s) {
-       factrl.set_dac_levels(s, 400);
-       printf("slot %d initialized\n", s);
-    }
+    factrl.set_dac_levels(400);
+    printf("all slots initialized\n");
     exit(0);
 
     TFile fout("faScope.root", "recreate");
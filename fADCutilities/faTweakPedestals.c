@@ -5,7 +5,10 @@
  * Description:
  *    Sets trigger path threshold to the desired pedestal value.
  *    Move the DAC value from its current position in a small range
- *    to find maximum rate in the scalers.
+ *    to find maximum rate in the scalers.  Channels with a DAC value
+ *    for this pedestal in the calibration store (faCalibGet) are
+ *    scanned around the stored value instead, and the results are
+ *    written back to the store.
  *
  */
 
@@ -28,6 +31,7 @@ cd /gluonfs1/home/dalton/svn/daq_dev_vers/daq/vme/src/vmefa/test
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <math.h>
 #include "jvme.h"
 #include "fadcLib.h"
 #include "fadcLib_extensions.h"
@@ -143,6 +147,22 @@ main(int argc, char *argv[])
 		printf("\n");
 	}
 
+	// Center the scan on the calibration store where it has a DAC
+	// value for this pedestal
+	int nstored=0;
+	for(ifa=0; ifa<nfadc; ifa++) {
+		for (chan=0; chan<FA_MAX_ADC_CHANNELS; chan++) {
+			faCalibChannel cal;
+			if (faCalibGet(faSlot(ifa), chan, &cal) == OK && cal.dac >= 0 &&
+			    fabs(cal.ped - thresh) < 0.5) {
+				OrigDAC[ifa][chan] = cal.dac;
+				nstored++;
+			}
+		}
+	}
+	if (nstored > 0)
+		printf("Scanning %i channel(s) around the DAC values in the calibration store\n",nstored);
+
 	printf("Setting trigger path threshold to %i\n",thresh);
 	faGSetTriggerPathThreshold(thresh);
 
@@ -157,14 +177,17 @@ main(int argc, char *argv[])
 			printf("Setting DAC value to: %i\n",dacval);
 			fflush(stdout);
 		}
-		// loop over modules to set DAC
+		// loop over modules to set DAC, written to the crate in one batch
+		faTransBegin();
 		for(ifa=0; ifa<nfadc; ifa++) {
 			for (chan=0; chan<FA_MAX_ADC_CHANNELS; chan++) {
 				int newdac = (int)OrigDAC[ifa][chan] + dacval;
 				//printf("mod %2i chan %2i   %u  %i  %i\n", faSlot(ifa),chan, OrigDAC[ifa][chan], dacval, newDAC);
-				faSetDAC(faSlot(ifa), newdac, (1<<chan));
+				faTransSetDAC(faSlot(ifa), newdac, (1<<chan));
 			}
 		}
+		if (faTransCommit() < 0)
+			printf("DAC readback failed at DAC offset %i\n",dacval);
 		// loop over modules to read scalers 
 		for(ifa=0; ifa<nfadc; ifa++) {
 			faReadScalers(faSlot(ifa), scalerdata1[ifa], 0xffff, ScalerReadFlag);
@@ -226,16 +249,32 @@ main(int argc, char *argv[])
 	}
 	// Set the DAC values to the optimum
 	printf("Setting DAC values to optimum\n");
+	faTransBegin();
 	for(ifa=0; ifa<nfadc; ifa++) {
 		for (chan=0; chan<FA_MAX_ADC_CHANNELS; chan++) {
 			NewDAC[ifa][chan] = OrigDAC[ifa][chan] + highestdacval[ifa][chan];
 			//printf("mod %2i chan %2i   %u  %i  %i\n", faSlot(ifa),chan, OrigDAC[ifa][chan], highestdacval[ifa][chan], NewDAC[ifa][chan]);
-			faSetDAC(faSlot(ifa), NewDAC[ifa][chan], (1<<chan));
+			faTransSetDAC(faSlot(ifa), NewDAC[ifa][chan], (1<<chan));
 		}
 	}
+	int dacok = (faTransCommit() >= 0);
 	for(ifa=0; ifa<nfadc; ifa++)
 		faPrintDAC(faSlot(ifa));
 
+	// Record the DAC values in the calibration store
+	if (!dacok) {
+		printf("DAC readback failed, the calibration store is not updated\n");
+	} else {
+		for(ifa=0; ifa<nfadc; ifa++) {
+			for (chan=0; chan<FA_MAX_ADC_CHANNELS; chan++) {
+				faCalibChannel cal = {NewDAC[ifa][chan], -1, thresh, -1, 0};
+				faCalibSet(faSlot(ifa), chan, &cal);
+			}
+		}
+		if (faCalibSave(NULL) < 0)
+			printf("Unable to update the calibration store\n");
+	}
+
 	// Write optimimum DAC values to file
 	// Make a date time label
 	time_t result = time(NULL); 
@@ -10,6 +10,7 @@
 #include <stdexcept>
 #include <sstream>
 #include <unistd.h>
+#include <math.h>
 
 #include "fadc250.hh"
 
@@ -45,29 +46,207 @@ fadc250::~fadc250()
 
 int fadc250::set_dac_levels(int slot, int baseline)
 {
-    int step = 1024;
-    short int dac[16];
-    for (int i=0; i<16; i++)
-        dac[i] = 2047;
-    float level[16];
-    while (step > 0) {
-        for (int i=0; i<16; ++i)
-            level[i] = 0;
-        for (int a=0; a<100; a++) {
-            unsigned int data[8];
-            void *dptr = (void*) data;
-            unsigned short *levels = (unsigned short*)dptr;
-            faReadAllChannelSamples(slot, data);
-            for (int i=0; i<16; ++i)
-                level[i] += 0.01 * (levels[i] & 0xfff);
+    return set_dac_levels(1, &slot, baseline);
+}
+
+int fadc250::set_dac_levels(int baseline)
+{
+    return set_dac_levels(fadcCount, fadcSlot, baseline);
+}
+
+// Successive-approximation search for the DAC settings that bring every
+// channel of the listed slots to the given baseline.  All modules are
+// searched at once: sample reads are interleaved across the slots, a
+// channel stops being sampled within a step as soon as its mean is far
+// enough from the baseline (in units of its standard error) to decide
+// the direction of the next step, and the DAC updates of each step are
+// written in one register transaction.  Channels with a DAC value in the
+// calibration store for this baseline start from it with a small step.
+// The pedestal of every channel is measured again at the end: a warm
+// started channel that missed the baseline (its pedestal drifted further
+// than the small step can follow) is searched again from the cold start.
+// Only the channels that reached the baseline go back into the store.
+// Returns 0, or the number of channels that did not converge.
+
+int fadc250::set_dac_levels(int nslots, const int *slots, int baseline)
+{
+    const int max_samples = 100;
+    const int min_samples = 8;
+    const double nsigma = 3.0;
+    const double max_offset = 2.0;  // ADC counts, accepted pedestal offset
+    const int cold_step = 1024;
+    const int warm_step = 8;
+
+    if (nslots < 1 || nslots > 32)
+        return -1;
+
+    int step[32][16];
+    int dac[32][16];
+    double noise[32][16];
+    bool warm[32][16];
+    bool converged[32][16];
+    int stepping = 0;
+    faTransBegin();
+    for (int s=0; s < nslots; ++s) {
+        for (int i=0; i<16; ++i) {
+            faCalibChannel cal;
+            warm[s][i] = (faCalibGet(slots[s], i, &cal) == OK && cal.dac >= 0 &&
+                          fabs(cal.ped - baseline) < 0.5);
+            if (warm[s][i]) {
+                dac[s][i] = cal.dac;
+                step[s][i] = warm_step;
+            }
+            else {
+                dac[s][i] = 2047;
+                step[s][i] = cold_step;
+            }
+            noise[s][i] = -1;
+            faTransSetDAC(slots[s], dac[s][i], (1<<i));
+            ++stepping;
         }
+    }
+    faTransCommit();
+
+    int failed;
+    for (int pass=0; pass < 2; ++pass) {
+        while (stepping > 0) {
+            int nsamp[32][16];
+            double sum[32][16];
+            double sum2[32][16];
+            bool decided[32][16];
+            int undecided[32];
+            int active = 0;
+            for (int s=0; s < nslots; ++s) {
+                undecided[s] = 0;
+                for (int i=0; i<16; ++i) {
+                    nsamp[s][i] = 0;
+                    sum[s][i] = sum2[s][i] = 0;
+                    decided[s][i] = (step[s][i] == 0);
+                    undecided[s] += !decided[s][i];
+                }
+                active += (undecided[s] > 0);
+            }
+            for (int a=0; a < max_samples && active > 0; a++) {
+                for (int s=0; s < nslots; ++s) {
+                    if (undecided[s] == 0)
+                        continue;
+                    unsigned int data[8];
+                    void *dptr = (void*) data;
+                    unsigned short *levels = (unsigned short*)dptr;
+                    faReadAllChannelSamples(slots[s], data);
+                    for (int i=0; i<16; ++i) {
+                        if (decided[s][i])
+                            continue;
+                        double v = levels[i] & 0xfff;
+                        int n = ++nsamp[s][i];
+                        sum[s][i] += v;
+                        sum2[s][i] += v * v;
+                        if (n < min_samples)
+                            continue;
+                        double mean = sum[s][i] / n;
+                        double var = (sum2[s][i] - n * mean * mean) / (n - 1);
+                        noise[s][i] = sqrt(var > 0? var : 0);
+                        double diff = mean - baseline;
+                        if (diff * diff > nsigma * nsigma * var / n) {
+                            decided[s][i] = true;
+                            if (--undecided[s] == 0)
+                                --active;
+                        }
+                    }
+                }
+            }
+            stepping = 0;
+            faTransBegin();
+            for (int s=0; s < nslots; ++s) {
+                for (int i=0; i<16; ++i) {
+                    if (step[s][i] == 0)
+                        continue;
+                    double level = sum[s][i] / nsamp[s][i];
+                    dac[s][i] += (level > baseline)? step[s][i] : -step[s][i];
+                    if (dac[s][i] < 0)
+                        dac[s][i] = 0;
+                    else if (dac[s][i] > 4095)
+                        dac[s][i] = 4095;
+                    faTransSetDAC(slots[s], dac[s][i], (1<<i));
+                    step[s][i] = int(step[s][i] * 0.7);
+                    stepping += (step[s][i] > 0);
+                }
+            }
+            faTransCommit();
+        }
+
+        // measure the pedestals at the final settings
+        int nsamp[32][16];
+        double sum[32][16];
+        double sum2[32][16];
+        for (int s=0; s < nslots; ++s) {
+            for (int i=0; i<16; ++i) {
+                nsamp[s][i] = 0;
+                sum[s][i] = sum2[s][i] = 0;
+            }
+        }
+        for (int a=0; a < max_samples; a++) {
+            for (int s=0; s < nslots; ++s) {
+                unsigned int data[8];
+                void *dptr = (void*) data;
+                unsigned short *levels = (unsigned short*)dptr;
+                faReadAllChannelSamples(slots[s], data);
+                for (int i=0; i<16; ++i) {
+                    double v = levels[i] & 0xfff;
+                    ++nsamp[s][i];
+                    sum[s][i] += v;
+                    sum2[s][i] += v * v;
+                }
+            }
+        }
+
+        // start the warm started channels that missed the baseline again
+        failed = 0;
+        faTransBegin();
+        for (int s=0; s < nslots; ++s) {
+            for (int i=0; i<16; ++i) {
+                int n = nsamp[s][i];
+                double mean = sum[s][i] / n;
+                double var = (sum2[s][i] - n * mean * mean) / (n - 1);
+                noise[s][i] = sqrt(var > 0? var : 0);
+                converged[s][i] = (fabs(mean - baseline) <= max_offset);
+                if (converged[s][i])
+                    continue;
+                if (pass == 0 && warm[s][i]) {
+                    warm[s][i] = false;
+                    dac[s][i] = 2047;
+                    step[s][i] = cold_step;
+                    faTransSetDAC(slots[s], dac[s][i], (1<<i));
+                    ++stepping;
+                }
+                ++failed;
+            }
+        }
+        faTransCommit();
+        if (stepping == 0)
+            break;
+    }
+
+    for (int s=0; s < nslots; ++s) {
         for (int i=0; i<16; ++i) {
-            dac[i] += (level[i] > baseline)? step : -step;
-            faSetDAC(slot, dac[i], (1<<i));
+            if (!converged[s][i]) {
+                std::cerr << "set_dac_levels: slot " << slots[s]
+                          << " channel " << i << " did not reach baseline "
+                          << baseline << " (dac " << dac[s][i]
+                          << "), not saved" << std::endl;
+                continue;
+            }
+            faCalibChannel cal;
+            cal.dac = dac[s][i];
+            cal.thr = -1;
+            cal.ped = baseline;
+            cal.noise = noise[s][i];
+            cal.updated = 0;
+            faCalibSet(slots[s], i, &cal);
         }
-        step = int(step * 0.7);
     }
-    return 0;
+    faCalibSave(NULL);
+    return failed;
 }
 
 int fadc250::acquire(int slot, int events, 
@@ -19,6 +19,8 @@ class fadc250
 
     int acquire(int slot, int events, int bufsize, unsigned int *data, int threshold);
     int set_dac_levels(int id, int baseline);
+    int set_dac_levels(int baseline);
+    int set_dac_levels(int nslots, const int *slots, int baseline);
     void decode(unsigned int data);
     void dumpconfig();
 
@@ -0,0 +1,292 @@
+//
+// fadc250emu - software emulation of the fadc250 pulse processing
+//              firmware (modes 9 and 10), see fadc250emu.hh.
+//
+// version: october 16, 2026
+//
+
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+
+#include "fadc250emu.hh"
+
+extern "C" {
+    #include "jvme.h"
+    #include "fadcLib.h"
+}
+
+fadc250emu::fadc250emu(const fadc250emu_config &config)
+ : fConfig(config)
+{
+    if (fConfig.NPED < 1 || fConfig.NPED > 15)
+        throw std::invalid_argument("fadc250emu: NPED out of range (1-15)");
+    if (fConfig.NP < 1 || fConfig.NP > 4)
+        throw std::invalid_argument("fadc250emu: NP out of range (1-4)");
+    if (fConfig.NSAT < 1 || fConfig.NSAT > 4)
+        throw std::invalid_argument("fadc250emu: NSAT out of range (1-4)");
+    if (fConfig.NSB < 0 || fConfig.NSA < 1)
+        throw std::invalid_argument("fadc250emu: bad NSB/NSA");
+}
+
+fadc250emu::~fadc250emu()
+{
+}
+
+int fadc250emu::emulate(const fadc250emu_window &win,
+                        unsigned int *words) const
+{
+    const short *samp = win.samples;
+    int ns = win.nsamples;
+    int chan = win.chan & 0xf;
+    if (ns <= fConfig.NPED)
+        return 0;
+
+    // pedestal
+    int pedsum = 0;
+    int pedbad = 0;
+    for (int i=0; i < fConfig.NPED; ++i) {
+        int s = samp[i] & 0xfff;
+        pedsum += s;
+        pedbad |= (s > fConfig.MAXPED);
+    }
+    int vmin = pedsum / fConfig.NPED;
+    if (pedsum > 0x3fff)
+        pedsum = 0x3fff;
+    int thr = vmin + fConfig.TET[chan];
+
+    int nw = 1;
+    int i = fConfig.NPED;
+    for (int np=0; np < fConfig.NP && i < ns; ) {
+        // threshold crossing with NSAT samples above threshold
+        if ((samp[i] & 0xfff) <= thr) {
+            ++i;
+            continue;
+        }
+        int nover = 1;
+        while (i + nover < ns && (samp[i + nover] & 0xfff) > thr)
+            ++nover;
+        if (nover < fConfig.NSAT) {
+            i += nover;
+            continue;
+        }
+        int tc = i;
+
+        // integral
+        int first = tc - fConfig.NSB;
+        int last = tc + fConfig.NSA - 1;
+        int late = 0;
+        if (first < 0)
+            first = 0;
+        if (last >= ns) {
+            last = ns - 1;
+            late = 1;
+        }
+        unsigned int sum = 0;
+        int over = 0;
+        int under = 0;
+        for (int k=first; k <= last; ++k) {
+            int s = samp[k];
+            sum += s & 0xfff;
+            over |= (s & 0x1000) != 0;
+            under |= (s & 0xfff) == 0;
+        }
+        if (sum > 0x3ffff)
+            sum = 0x3ffff;
+        if (nover > 0x1ff)
+            nover = 0x1ff;
+
+        // peak and leading edge time
+        int ipeak = tc;
+        while (ipeak + 1 < ns && (samp[ipeak + 1] & 0xfff) >= (samp[ipeak] & 0xfff))
+            ++ipeak;
+        int pbad = (ipeak + 1 == ns);
+        int pout = (ipeak > tc + fConfig.NSA - 1);
+        int vpeak = samp[ipeak] & 0xfff;
+        int vmid = (vmin + vpeak) >> 1;
+        int k = ipeak;
+        while (k > 0 && (samp[k - 1] & 0xfff) > vmid)
+            --k;
+        unsigned int coarse = 0;
+        unsigned int fine = 0;
+        if (k > 0) {
+            int s0 = samp[k - 1] & 0xfff;
+            int s1 = samp[k] & 0xfff;
+            coarse = k - 1;
+            fine = ((vmid - s0) << 6) / (s1 - s0);
+        }
+
+        words[nw++] = (1u << 30) | (sum << 12) | (late << 11) |
+                      (over << 10) | (under << 9) | nover;
+        words[nw++] = ((coarse & 0x1ff) << 21) | ((fine & 0x3f) << 15) |
+                      ((vpeak & 0xfff) << 3) | (pout << 2) |
+                      (pbad << 1) | pedbad;
+        ++np;
+
+        // resume after the integration window, below threshold
+        i = tc + fConfig.NSA;
+        while (i < ns && (samp[i] & 0xfff) > thr)
+            ++i;
+    }
+
+    if (nw == 1)
+        return 0;
+
+    words[0] = FA_DATA_TYPE_DEFINE | (9u << 27) |
+               ((win.evt_of_blk & 0xff) << 19) | (chan << 15) |
+               (pedbad << 14) | pedsum;
+    return nw;
+}
+
+long fadc250emu::emulate_batch(const fadc250emu_window *win, int nwin,
+                               unsigned int *words, int *nwords,
+                               int nthreads) const
+{
+    if (nthreads <= 0)
+        nthreads = std::thread::hardware_concurrency();
+    if (nthreads <= 0)
+        nthreads = 1;
+    if (nthreads > nwin)
+        nthreads = (nwin > 0)? nwin : 1;
+
+    int mw = max_words();
+    std::vector<long> pulses(nthreads, 0);
+    std::vector<std::thread> workers;
+    for (int t=0; t < nthreads; ++t) {
+        int begin = (long)nwin * t / nthreads;
+        int end = (long)nwin * (t + 1) / nthreads;
+        workers.push_back(std::thread([=, &pulses] {
+            long np = 0;
+            for (int i=begin; i < end; ++i) {
+                int n = emulate(win[i], &words[(long)i * mw]);
+                nwords[i] = n;
+                np += (n > 0)? (n - 1) / 2 : 0;
+            }
+            pulses[t] = np;
+        }));
+    }
+    long total = 0;
+    for (int t=0; t < nthreads; ++t) {
+        workers[t].join();
+        total += pulses[t];
+    }
+    return total;
+}
+
+int fadc250emu::validate(const unsigned int *data, int nwrds, int swap,
+                         int &nwin, int verbose,
+                         const int (*tet)[16]) const
+{
+    // settings of the current block
+    fadc250emu_config cfg = fConfig;
+    // per event: raw window and firmware pulse words of each channel
+    int raw_off[16];
+    int raw_ns[16];
+    int evt_of_blk[16];
+    std::vector<unsigned int> fw[16];
+    int event = -1;
+    int evt_in_blk = 0;
+    int type = 15;
+    int pchan = -1;
+    int ndiff = 0;
+    nwin = 0;
+
+    std::vector<short> samples(4096);
+    std::vector<unsigned int> emu(max_words());
+
+    for (int c=0; c < 16; ++c)
+        raw_off[c] = -1;
+
+    for (int iw=0; iw <= nwrds; ++iw) {
+        unsigned int w = 0xffffffff;
+        if (iw < nwrds)
+            w = swap? LSWAP(data[iw]) : data[iw];
+        int newtype = (w & FA_DATA_TYPE_DEFINE) != 0;
+        if (newtype)
+            type = (w & FA_DATA_TYPE_MASK) >> 27;
+
+        // compare at the end of each event
+        if (newtype && (type <= 2 || iw == nwrds) && event >= 0) {
+            fadc250emu blk(cfg);
+            for (int c=0; c < 16; ++c) {
+                if (raw_off[c] < 0)
+                    continue;
+                int nsw = (raw_ns[c] + 1) / 2;
+                if ((int)samples.size() < 2 * nsw)
+                    samples.resize(2 * nsw);
+                faUnpackRawSamples(&data[raw_off[c]], nsw, &samples[0],
+                                   swap? FA_DECODE_SWAP : 0, 0, 0);
+                fadc250emu_window win = {c, evt_of_blk[c], &samples[0], raw_ns[c]};
+                if (fw[c].size() > 0)
+                    win.evt_of_blk = (fw[c][0] & 0x07f80000) >> 19;
+                int n = blk.emulate(win, &emu[0]);
+                int same = (n == (int)fw[c].size());
+                for (int k=0; same && k < n; ++k)
+                    same = (emu[k] == fw[c][k]);
+                ++nwin;
+                if (!same) {
+                    ++ndiff;
+                    if (verbose) {
+                        printf("event %d chan %d: firmware", event, c);
+                        for (unsigned int k=0; k < fw[c].size(); ++k)
+                            printf(" %08x", fw[c][k]);
+                        printf("\n               emulator");
+                        for (int k=0; k < n; ++k)
+                            printf(" %08x", emu[k]);
+                        printf("\n");
+                    }
+                }
+                raw_off[c] = -1;
+                fw[c].clear();
+            }
+            event = -1;
+        }
+        if (iw == nwrds)
+            break;
+
+        if (newtype && type == 0) {
+            evt_in_blk = 0;
+            int slot = (w & 0x7c00000) >> 22;
+            cfg = fConfig;
+            if (tet && slot < 22) {
+                for (int c=0; c < 16; ++c)
+                    cfg.TET[c] = tet[slot][c];
+            }
+        }
+        else if (type == 0) {
+            // block header 2: PL, NSB, NSA
+            int nsb = (w & 0x0003fe00) >> 9;
+            int nsa = (w & 0x000001ff);
+            if (nsa >= 1) {
+                cfg.NSB = nsb;
+                cfg.NSA = nsa;
+            }
+        }
+        else if (newtype && type == 2) {
+            event = w & 0x3fffff;
+            ++evt_in_blk;
+            for (int c=0; c < 16; ++c) {
+                raw_off[c] = -1;
+                fw[c].clear();
+            }
+        }
+        else if (newtype && type == 4) {
+            int c = (w & 0x7800000) >> 23;
+            raw_off[c] = iw + 1;
+            raw_ns[c] = w & 0xfff;
+            evt_of_blk[c] = evt_in_blk;
+            if (raw_off[c] + (raw_ns[c] + 1) / 2 > nwrds)
+                raw_ns[c] = 2 * (nwrds - raw_off[c]);
+            iw += (raw_ns[c] + 1) / 2;
+        }
+        else if (type == 9) {
+            if (newtype)
+                pchan = (w & 0x78000) >> 15;
+            if (pchan >= 0)
+                fw[pchan].push_back(w);
+        }
+    }
+    return ndiff;
+}
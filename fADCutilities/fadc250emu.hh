@@ -0,0 +1,92 @@
+//
+// fadc250emu - software emulation of the fadc250 pulse processing
+//              firmware (modes 9 and 10), producing the same pulse
+//              parameter words (type 9) the module writes to its fifo.
+//
+// version: october 16, 2026
+//
+// Notes:
+//  1. Configuration follows faSetProcMode(id, pmode, PL, PTW, NSB, NSA,
+//     NP, NPED, MAXPED, NSAT) plus the per-channel TET set with
+//     faSetThreshold.  validate() takes NSB and NSA from the second
+//     block header word of the data, and the TET of each module from
+//     an optional table indexed by slot.
+//  2. Samples are the int16 values written by faUnpackRawSamples:
+//     12-bit adc value with the overflow flag in bit 12.
+//  3. The algorithm, per channel window:
+//     - pedestal: sum of the first NPED samples; quality bit set if any
+//       of them is above MAXPED.  Vmin = pedsum / NPED.
+//     - threshold crossing: first sample after the pedestal samples
+//       above Vmin + TET followed by NSAT-1 more samples above it;
+//       searching resumes after the integration window of the previous
+//       pulse, once the samples have dropped back below threshold; up
+//       to NP pulses.  The samples over threshold are the run of
+//       consecutive samples above it starting at the crossing.
+//     - integral: raw sum over [tc-NSB, tc+NSA-1], clipped to the window;
+//       late if the range runs past the end of the window, overflow if
+//       any sample in it overflowed, underflow if any sample is zero.
+//     - time: first local maximum from tc is Vpeak (not found if the
+//       samples rise to the end of the window, outside if it lies past
+//       tc+NSA-1); Vmid = (Vmin + Vpeak)/2 is interpolated between the
+//       samples straddling it on the leading edge, in 1/64 sample units.
+//
+
+#ifndef FADC250EMU_HH
+#define FADC250EMU_HH
+
+#include <vector>
+
+struct fadc250emu_config
+{
+    int NSB;
+    int NSA;
+    int NP;
+    int NPED;
+    int MAXPED;
+    int NSAT;
+    int TET[16];
+};
+
+// one raw window to process
+struct fadc250emu_window
+{
+    int chan;
+    int evt_of_blk;
+    const short *samples;
+    int nsamples;
+};
+
+class fadc250emu
+{
+  public:
+    fadc250emu(const fadc250emu_config &config);
+    ~fadc250emu();
+
+    // largest number of words emulate() can write for one window
+    int max_words() const { return 1 + 2 * fConfig.NP; }
+
+    // emulate one window, returns the number of words written
+    // (0 if no pulse was found)
+    int emulate(const fadc250emu_window &win, unsigned int *words) const;
+
+    // emulate a batch of windows on nthreads threads (0 = all cores);
+    // words for window i start at words[i * max_words()] and
+    // nwords[i] receives the count.  Returns the number of pulses.
+    long emulate_batch(const fadc250emu_window *win, int nwin,
+                       unsigned int *words, int *nwords,
+                       int nthreads=0) const;
+
+    // compare emulated words against firmware words from a mode 10
+    // buffer (host byte order if swap == 0); returns the number of
+    // windows whose words differ, and the number compared in nwin.
+    // NSB and NSA are those of the block header, when present; tet,
+    // if given, holds the TET of each channel by slot (22 entries).
+    int validate(const unsigned int *data, int nwrds, int swap,
+                 int &nwin, int verbose=0,
+                 const int (*tet)[16]=0) const;
+
+  protected:
+    fadc250emu_config fConfig;
+};
+
+#endif
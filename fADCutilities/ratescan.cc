@@ -0,0 +1,472 @@
+//
+// ratescan - analysis of scaler rate vs threshold scans, see ratescan.hh.
+//
+// version: october 16, 2026
+//
+
+#include <algorithm>
+#include <map>
+#include <thread>
+#include <vector>
+#include <string>
+#include <math.h>
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ratescan.hh"
+
+#define EDGE_NSIGMA   4.0   // plateau fit starts this far above the pedestal
+#define EDGE_FLOOR    0.01  // noise edge fit uses rates above this * max
+#define EDGE_KNEE     0.5   // ... and stops where the log drop per step falls
+#define GRID_NEDGE    24    // edge positions tried in the plateau grid search
+#define GRID_NWIDTH   8     // widths tried in the plateau grid search
+#define REFINE_ITER   60    // plateau pattern search iterations
+
+bool ratescan_rule::parse(const char *spec)
+{
+    const char *colon = strchr(spec, ':');
+    if (colon == 0)
+        return false;
+    std::string name(spec, colon - spec);
+    char *end;
+    value = strtod(colon + 1, &end);
+    if (end == colon + 1 || *end != 0)
+        return false;
+    if (name == "nsigma")
+        type = NSIGMA;
+    else if (name == "rate")
+        type = RATE;
+    else if (name == "spe")
+        type = SPE;
+    else
+        return false;
+    return true;
+}
+
+std::string ratescan_rule::str() const
+{
+    char buf[64];
+    static const char *names[] = {"nsigma", "rate", "spe"};
+    snprintf(buf, sizeof(buf), "%s:%g", names[type], value);
+    return buf;
+}
+
+ratescan::ratescan()
+{
+}
+
+ratescan::~ratescan()
+{
+}
+
+ratescan_curve &ratescan::get(int slot, int chan)
+{
+    for (size_t i=0; i < fCurves.size(); ++i)
+        if (fCurves[i].slot == slot && fCurves[i].chan == chan)
+            return fCurves[i];
+    ratescan_curve c;
+    c.slot = slot;
+    c.chan = chan;
+    fCurves.push_back(c);
+    return fCurves.back();
+}
+
+int ratescan::read(const char *fname)
+{
+    FILE *fp = fopen(fname, "r");
+    if (fp == 0)
+        return -1;
+
+    // faMapRates names one file per channel *_s<slot>c<chan>.txt
+    int fslot = -1, fchan = -1;
+    const char *base = strrchr(fname, '/');
+    base = (base)? base + 1 : fname;
+    const char *tag = strrchr(base, '_');
+    if (tag == 0 || sscanf(tag, "_s%2dc%2d.txt", &fslot, &fchan) != 2)
+        fslot = fchan = -1;
+
+    // points go to a (slot, chan) keyed map first, then into the curves
+    std::map<std::pair<int, int>, std::vector<std::pair<double, double> > > pts;
+    std::vector<std::pair<int, int> > columns;
+    double thresh = 0;
+    int have_thresh = 0;
+    int npoints = 0;
+    char line[16384];
+    while (fgets(line, sizeof(line), fp)) {
+        char *tok = strtok(line, " \t\r\n");
+        if (tok == 0)
+            continue;
+        if (tok[0] == '#') {
+            // ratevsthreshold_allchan column names: # thresh s04c00 ...
+            if ((tok = strtok(0, " \t\r\n")) && strcmp(tok, "thresh") == 0) {
+                columns.clear();
+                while ((tok = strtok(0, " \t\r\n"))) {
+                    int s, c;
+                    if (sscanf(tok, "s%2dc%2d", &s, &c) == 2)
+                        columns.push_back(std::make_pair(s, c));
+                }
+            }
+            continue;
+        }
+        if (strcmp(tok, "threshold") == 0) {
+            // ratevsthreshold_collect.py: threshold <t>
+            if ((tok = strtok(0, " \t\r\n"))) {
+                thresh = atof(tok);
+                have_thresh = 1;
+            }
+            continue;
+        }
+        if (strcmp(tok, "slot") == 0) {
+            // ratevsthreshold_collect.py: slot <s>: <r0> ... <r15>
+            if (!have_thresh || (tok = strtok(0, " \t\r\n:")) == 0)
+                continue;
+            int s = atoi(tok);
+            for (int c=0; c < 16 && (tok = strtok(0, " \t\r\n")); ++c) {
+                pts[std::make_pair(s, c)].push_back(
+                    std::make_pair(thresh, atof(tok)));
+                ++npoints;
+            }
+            continue;
+        }
+        double t = atof(tok);
+        if (columns.size() > 0) {
+            for (size_t k=0; k < columns.size() &&
+                             (tok = strtok(0, " \t\r\n")); ++k)
+            {
+                pts[columns[k]].push_back(std::make_pair(t, atof(tok)));
+                ++npoints;
+            }
+        }
+        else if (fslot >= 0 && (tok = strtok(0, " \t\r\n"))) {
+            pts[std::make_pair(fslot, fchan)].push_back(
+                std::make_pair(t, atof(tok)));
+            ++npoints;
+        }
+    }
+    fclose(fp);
+
+    std::map<std::pair<int, int>,
+             std::vector<std::pair<double, double> > >::iterator it;
+    for (it = pts.begin(); it != pts.end(); ++it) {
+        ratescan_curve &c = get(it->first.first, it->first.second);
+        std::vector<std::pair<double, double> > v;
+        for (size_t i=0; i < c.thr.size(); ++i)
+            v.push_back(std::make_pair(c.thr[i], c.rate[i]));
+        v.insert(v.end(), it->second.begin(), it->second.end());
+        std::stable_sort(v.begin(), v.end());
+        c.thr.resize(v.size());
+        c.rate.resize(v.size());
+        for (size_t i=0; i < v.size(); ++i) {
+            c.thr[i] = v[i].first;
+            c.rate[i] = v[i].second;
+        }
+    }
+    return npoints;
+}
+
+// Weighted least squares fit of y = a + b x + c x^2, returns false if
+// the normal equations are singular.
+static bool fit_parabola(const double *x, const double *y, const double *w,
+                         int n, double &a, double &b, double &c)
+{
+    double s0=0, s1=0, s2=0, s3=0, s4=0, t0=0, t1=0, t2=0;
+    for (int i=0; i < n; ++i) {
+        double wx = w[i] * x[i];
+        double wxx = wx * x[i];
+        s0 += w[i];
+        s1 += wx;
+        s2 += wxx;
+        s3 += wxx * x[i];
+        s4 += wxx * x[i] * x[i];
+        t0 += w[i] * y[i];
+        t1 += wx * y[i];
+        t2 += wxx * y[i];
+    }
+    double det = s0 * (s2 * s4 - s3 * s3) - s1 * (s1 * s4 - s3 * s2)
+               + s2 * (s1 * s3 - s2 * s2);
+    if (fabs(det) < 1e-30)
+        return false;
+    a = (t0 * (s2 * s4 - s3 * s3) - s1 * (t1 * s4 - s3 * t2)
+       + s2 * (t1 * s3 - s2 * t2)) / det;
+    b = (s0 * (t1 * s4 - t2 * s3) - t0 * (s1 * s4 - s3 * s2)
+       + s2 * (s1 * t2 - t1 * s2)) / det;
+    c = (s0 * (s2 * t2 - s3 * t1) - s1 * (s1 * t2 - t1 * s2)
+       + t0 * (s1 * s3 - s2 * s2)) / det;
+    return true;
+}
+
+// Plateau chi-square at (mu, s) with the height P profiled out:
+// sum w (r - P f)^2 at its minimum in P, f the logistic edge.
+// The loop is straight-line over contiguous arrays.
+static double plateau_chi2(const double *x, const double *r, const double *w,
+                           double swrr, int n, double mu, double s,
+                           double *height)
+{
+    double swrf = 0, swff = 0;
+    double inv = 1 / s;
+    for (int i=0; i < n; ++i) {
+        double f = 1 / (1 + exp((x[i] - mu) * inv));
+        swrf += w[i] * r[i] * f;
+        swff += w[i] * f * f;
+    }
+    if (swff <= 0) {
+        *height = 0;
+        return swrr;
+    }
+    *height = swrf / swff;
+    return swrr - swrf * swrf / swff;
+}
+
+// Noise edge: Gaussian fit, as a weighted parabola in log(rate), to the
+// points around the rate maximum down to EDGE_FLOOR of it or the knee
+// into the plateau.
+static bool fit_noise_edge(const double *thr, const double *rate, int n,
+                           ratescan_fit &fit)
+{
+    int imax = 0;
+    for (int i=1; i < n; ++i)
+        if (rate[i] > rate[imax])
+            imax = i;
+    double rmax = rate[imax];
+    if (rmax <= 0)
+        return false;
+    // on a Gaussian edge the drop in log(rate) per step grows away from
+    // the maximum, stop where it halves: the plateau has taken over
+    double floor = EDGE_FLOOR * rmax;
+    double drop = 0;
+    int lo = imax, hi = imax;
+    while (lo > 0 && rate[lo - 1] > floor) {
+        double d = log(rate[lo] / rate[lo - 1]);
+        if (d < EDGE_KNEE * drop)
+            break;
+        drop = d;
+        --lo;
+    }
+    drop = 0;
+    while (hi < n - 1 && rate[hi + 1] > floor) {
+        double d = log(rate[hi] / rate[hi + 1]);
+        if (d < EDGE_KNEE * drop)
+            break;
+        drop = d;
+        ++hi;
+    }
+    int ne = hi - lo + 1;
+    if (ne < 3)
+        return false;
+    std::vector<double> x(ne), y(ne), w(ne);
+    for (int i=0; i < ne; ++i) {
+        x[i] = thr[lo + i] - thr[imax];
+        y[i] = log(rate[lo + i]);
+        w[i] = rate[lo + i] / rmax;   // var(log R) ~ 1/R
+    }
+    double a, b, c;
+    if (!fit_parabola(&x[0], &y[0], &w[0], ne, a, b, c) || c >= 0)
+        return false;
+    fit.sigma = sqrt(-0.5 / c);
+    fit.ped = thr[imax] - b / (2 * c);
+    fit.noise_rate = exp(a - b * b / (4 * c));
+    return true;
+}
+
+ratescan_fit ratescan::fit_curve(const ratescan_curve &c,
+                                 const ratescan_rule &rule)
+{
+    ratescan_fit fit;
+    fit.status = ratescan_fit::NO_NOISE_EDGE;
+    fit.ped = fit.sigma = fit.noise_rate = 0;
+    fit.plateau = fit.spe_edge = fit.spe_width = 0;
+    fit.threshold = -1;
+
+    int n = c.thr.size();
+    if (n < 3)
+        return fit;
+
+    if (!fit_noise_edge(&c.thr[0], &c.rate[0], n, fit))
+        return fit;
+    fit.status = ratescan_fit::NO_PLATEAU;
+
+    // plateau: points clear of the noise edge
+    double x0 = fit.ped + EDGE_NSIGMA * fit.sigma;
+    int first = std::lower_bound(c.thr.begin(), c.thr.end(), x0)
+              - c.thr.begin();
+    int np = n - first;
+    if (np >= 4) {
+        const double *px = &c.thr[first];
+        const double *pr = &c.rate[first];
+        std::vector<double> pw(np);
+        double swrr = 0;
+        double dxmin = px[np - 1] - px[0];
+        for (int i=0; i < np; ++i) {
+            pw[i] = 1 / std::max(pr[i], 1.0);   // Poisson, counts ~ rate
+            swrr += pw[i] * pr[i] * pr[i];
+            if (i > 0 && px[i] > px[i - 1])
+                dxmin = std::min(dxmin, px[i] - px[i - 1]);
+        }
+        double range = px[np - 1] - px[0];
+        if (range > 0) {
+            // grid: edges across and one step beyond the scan, geometric widths
+            double best = -1, bmu = 0, bs = 0, height;
+            int nmu = std::min(np, GRID_NEDGE);
+            for (int i=0; i <= nmu; ++i) {
+                double mu = px[0] + range * i / (nmu - 1.0);
+                for (int k=0; k < GRID_NWIDTH; ++k) {
+                    double s = 0.5 * dxmin *
+                        pow(2 * range / dxmin, k / (GRID_NWIDTH - 1.0));
+                    double chi2 = plateau_chi2(px, pr, &pw[0], swrr, np,
+                                               mu, s, &height);
+                    if (best < 0 || chi2 < best) {
+                        best = chi2;
+                        bmu = mu;
+                        bs = s;
+                    }
+                }
+            }
+            // refine with a shrinking pattern search
+            double dmu = range / np;
+            double fs = 1.5;
+            for (int iter=0; iter < REFINE_ITER; ++iter) {
+                double tmu[4] = {bmu - dmu, bmu + dmu, bmu, bmu};
+                double ts[4] = {bs, bs, bs * fs, bs / fs};
+                bool improved = false;
+                for (int k=0; k < 4; ++k) {
+                    if (ts[k] < 1e-3 * dxmin)
+                        continue;
+                    double chi2 = plateau_chi2(px, pr, &pw[0], swrr, np,
+                                               tmu[k], ts[k], &height);
+                    if (chi2 < best) {
+                        best = chi2;
+                        bmu = tmu[k];
+                        bs = ts[k];
+                        improved = true;
+                    }
+                }
+                if (!improved) {
+                    dmu *= 0.5;
+                    fs = sqrt(fs);
+                }
+            }
+            plateau_chi2(px, pr, &pw[0], swrr, np, bmu, bs, &height);
+            fit.plateau = height;
+            fit.spe_edge = bmu;
+            fit.spe_width = bs;
+            if (height > 0)
+                fit.status = ratescan_fit::OK;
+
+            // refit the noise edge with the plateau under it subtracted
+            std::vector<double> sub(n);
+            for (int i=0; i < n; ++i)
+                sub[i] = c.rate[i] - height / (1 + exp((c.thr[i] - bmu) / bs));
+            ratescan_fit edge = fit;
+            if (height > 0 && fit_noise_edge(&c.thr[0], &sub[0], n, edge))
+                fit = edge;
+        }
+    }
+
+    // threshold by the rule
+    double t = -1;
+    if (rule.type == ratescan_rule::NSIGMA) {
+        t = fit.ped + rule.value * fit.sigma;
+    }
+    else if (rule.type == ratescan_rule::RATE) {
+        if (rule.value > 0 && fit.noise_rate > rule.value)
+            t = fit.ped + fit.sigma * sqrt(2 * log(fit.noise_rate / rule.value));
+        else if (rule.value > 0)
+            t = fit.ped;
+    }
+    else if (rule.type == ratescan_rule::SPE) {
+        if (fit.status == ratescan_fit::OK)
+            t = fit.ped + rule.value * (fit.spe_edge - fit.ped);
+    }
+    if (t >= 0)
+        fit.threshold = (int)ceil(t);
+    return fit;
+}
+
+int ratescan::fit_all(const ratescan_rule &rule, int nthreads)
+{
+    int ncurve = fCurves.size();
+    fFits.resize(ncurve);
+    if (nthreads <= 0)
+        nthreads = std::thread::hardware_concurrency();
+    if (nthreads <= 0)
+        nthreads = 1;
+    if (nthreads > ncurve)
+        nthreads = (ncurve > 0)? ncurve : 1;
+
+    std::vector<std::thread> workers;
+    for (int t=0; t < nthreads; ++t) {
+        int begin = (long)ncurve * t / nthreads;
+        int end = (long)ncurve * (t + 1) / nthreads;
+        workers.push_back(std::thread([=, &rule] {
+            for (int i=begin; i < end; ++i)
+                fFits[i] = fit_curve(fCurves[i], rule);
+        }));
+    }
+    for (int t=0; t < nthreads; ++t)
+        workers[t].join();
+
+    int nok = 0;
+    for (int i=0; i < ncurve; ++i)
+        nok += (fFits[i].status == ratescan_fit::OK);
+    return nok;
+}
+
+void ratescan::print(FILE *fp) const
+{
+    static const char *status[] = {"ok", "no noise edge", "no plateau"};
+    fprintf(fp, "slot chan  points      ped    sigma   noise(Hz)"
+                "  plateau(Hz)   spe_edge  spe_width  thr  status\n");
+    for (size_t i=0; i < fFits.size(); ++i) {
+        const ratescan_curve &c = fCurves[i];
+        const ratescan_fit &f = fFits[i];
+        fprintf(fp, "%4d %4d %7d %8.2f %8.2f %11.4g %12.4g %10.2f %10.2f %4d  %s\n",
+                c.slot, c.chan, (int)c.thr.size(), f.ped, f.sigma,
+                f.noise_rate, f.plateau, f.spe_edge, f.spe_width,
+                f.threshold, status[f.status]);
+    }
+}
+
+int ratescan::write_config(const char *fname, const char *host,
+                           const ratescan_rule &rule, int relative,
+                           int defthr) const
+{
+    FILE *outfile = fopen(fname, "w");
+    if (outfile == 0)
+        return -1;
+
+    std::map<int, std::vector<int> > slots;
+    for (size_t i=0; i < fFits.size(); ++i) {
+        const ratescan_curve &c = fCurves[i];
+        if (c.chan < 0 || c.chan > 15)
+            continue;
+        if (slots.find(c.slot) == slots.end())
+            slots[c.slot] = std::vector<int>(16, defthr);
+        int thr = fFits[i].threshold;
+        if (thr >= 0 && relative)
+            thr -= (int)floor(fFits[i].ped + 0.5);
+        if (thr >= 0)
+            slots[c.slot][c.chan] = thr;
+    }
+
+    time_t result = time(NULL);
+    fprintf(outfile, "# %s", ctime(&result));
+    fprintf(outfile, "# thresholds determined using faFitRates, rule %s%s\n",
+            rule.str().c_str(), (relative)? ", relative to pedestal" : "");
+    fprintf(outfile, "# channels without a fitted threshold set to %i\n\n",
+            defthr);
+    fprintf(outfile, "CRATE  %s \n\n", host);
+    std::map<int, std::vector<int> >::const_iterator it;
+    for (it = slots.begin(); it != slots.end(); ++it) {
+        fprintf(outfile, "############################\n");
+        fprintf(outfile, "FADC250_SLOTS   %i  \n", it->first);
+        fprintf(outfile, "#########################\n");
+        fprintf(outfile, "FADC250_ALLCH_THR   ");
+        for (int chan=0; chan < 16; ++chan)
+            fprintf(outfile, "%4i  ", it->second[chan]);
+        fprintf(outfile, "\n\n");
+    }
+    fclose(outfile);
+    return 0;
+}
@@ -0,0 +1,103 @@
+//
+// ratescan - analysis of scaler rate vs threshold scans: fits the
+//            pedestal noise edge and the single photoelectron plateau
+//            of each channel and picks a threshold per channel.
+//
+// version: october 16, 2026
+//
+// Notes:
+//  1. Input is the output of faMapRates (one file per channel, named
+//     *_s<slot>c<chan>.txt, lines "threshold rate"), ratevsthreshold_allchan
+//     (columnar, "# thresh s<slot>c<chan> ..." header then one line per
+//     threshold) or ratevsthreshold_collect.py ("threshold <t>" lines
+//     followed by "slot <s>: <16 rates>" lines).  Points from several
+//     files for the same slot/channel are merged.
+//  2. Model, with T the threshold:
+//     - noise edge: R = A exp(-(T-ped)^2 / (2 sigma^2)), from a weighted
+//       parabola fit to log(R) around the rate maximum;
+//     - single photoelectron plateau: R = P / (1 + exp((T-mu)/s)) for
+//       T >= ped + 4 sigma, P from linear least squares at each (mu, s),
+//       (mu, s) from a grid search refined by a shrinking pattern search.
+//  3. Threshold rules (ratescan_rule):
+//     - nsigma:N   T = ped + N sigma
+//     - rate:R     lowest T where the noise edge rate drops to R
+//     - spe:F      T = ped + F (mu - ped), needs the plateau fit
+//
+
+#ifndef RATESCAN_HH
+#define RATESCAN_HH
+
+#include <vector>
+#include <string>
+#include <stdio.h>
+
+struct ratescan_curve
+{
+    int slot;
+    int chan;
+    std::vector<double> thr;     // sorted
+    std::vector<double> rate;
+};
+
+struct ratescan_fit
+{
+    enum { OK=0, NO_NOISE_EDGE=1, NO_PLATEAU=2 };
+    int status;
+    double ped;          // noise edge centre
+    double sigma;        // noise edge width
+    double noise_rate;   // noise edge height A
+    double plateau;      // plateau rate P
+    double spe_edge;     // single photoelectron edge mu
+    double spe_width;    // single photoelectron edge width s
+    int threshold;       // chosen by the rule, -1 if the rule failed
+};
+
+struct ratescan_rule
+{
+    enum { NSIGMA, RATE, SPE } type;
+    double value;
+
+    // parse "nsigma:N", "rate:R" or "spe:F"; returns false if invalid
+    bool parse(const char *spec);
+    std::string str() const;
+};
+
+class ratescan
+{
+  public:
+    ratescan();
+    ~ratescan();
+
+    // add the curves in a scan output file, returns the number of
+    // points read or -1 if the file could not be read
+    int read(const char *fname);
+
+    int ncurves() const { return fCurves.size(); }
+    const ratescan_curve &curve(int i) const { return fCurves[i]; }
+    const ratescan_fit &fit(int i) const { return fFits[i]; }
+
+    // fit every curve on nthreads threads (0 = all cores) and apply
+    // the rule; returns the number of curves with status OK
+    int fit_all(const ratescan_rule &rule, int nthreads=0);
+
+    // fit a single curve
+    static ratescan_fit fit_curve(const ratescan_curve &c,
+                                  const ratescan_rule &rule);
+
+    // print one line per channel
+    void print(FILE *fp) const;
+
+    // write FADC250_SLOTS / FADC250_ALLCH_THR blocks as faTweakPedestals
+    // does; thresholds relative to the fitted pedestal if relative,
+    // channels without a threshold get defthr.  Returns OK or -1.
+    int write_config(const char *fname, const char *host,
+                     const ratescan_rule &rule, int relative,
+                     int defthr) const;
+
+  protected:
+    ratescan_curve &get(int slot, int chan);
+    std::vector<ratescan_curve> fCurves;
+    std::vector<ratescan_fit> fFits;
+};
+
+#endif
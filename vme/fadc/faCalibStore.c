@@ -0,0 +1,361 @@
+/* Module: faCalibStore.c
+ *
+ * Description: FADC250 Calibration Store
+ *              Last calibrated DAC and readout threshold of each channel,
+ *              with the baseline the DAC was calibrated to, the measured
+ *              baseline noise and the time of the calibration, kept in a
+ *              local text file keyed by module serial number
+ *              (faGetSerialNumber) and channel.  Modules keep their
+ *              calibration when they move between slots or crates.
+ *
+ *              Calibration tools start their search from the stored
+ *              values (faCalibGet) and record the result (faCalibSet,
+ *              faCalibSave).  faCalibRestore, or faInit with
+ *              FA_INIT_CALIB_RESTORE, loads the stored values into the
+ *              modules without a scan.
+ *
+ *              The file is FA_CALIB_STORE_ENV if set, otherwise
+ *              FA_CALIB_STORE_DEFAULT in $HOME.  One line per channel:
+ *                 serial  chan  dac  thr  ped  noise  updated
+ *
+ *              No locking: use from one configuration thread.
+ *
+ */
+
+typedef struct
+{
+  char           serial[FA_CALIB_SN_LEN];
+  faCalibChannel chan[FA_MAX_ADC_CHANNELS];
+} faCalibEntry;
+
+static faCalibEntry faCalibTable[FA_CALIB_MAX_MODULES];
+static int          faCalibNmod = 0;
+static int          faCalibLoaded = 0;
+
+/* Serial number of the module in each slot, read over VME once.
+   faInit clears it (faCalibSerialClear): modules may have moved. */
+static char         faCalibSerial[FA_MAX_BOARDS+1][FA_CALIB_SN_LEN];
+
+static void
+faCalibSerialClear()
+{
+  memset(faCalibSerial, 0, sizeof(faCalibSerial));
+}
+
+static void
+faCalibClearChannel(faCalibChannel *c)
+{
+  c->dac = -1;
+  c->thr = -1;
+  c->ped = 0;
+  c->noise = -1;
+  c->updated = 0;
+}
+
+static const char *
+faCalibPath(const char *path, char *buf, int len)
+{
+  const char *home;
+
+  if(path)
+    return path;
+  if((path = getenv(FA_CALIB_STORE_ENV)) != NULL)
+    return path;
+  home = getenv("HOME");
+  snprintf(buf, len, "%s/%s", home ? home : ".", FA_CALIB_STORE_DEFAULT);
+  return buf;
+}
+
+static faCalibEntry *
+faCalibFind(const char *serial, int create)
+{
+  int imod, ichan;
+
+  for(imod = 0; imod < faCalibNmod; imod++)
+    if(strcmp(faCalibTable[imod].serial, serial) == 0)
+      return &faCalibTable[imod];
+
+  if(!create || (faCalibNmod >= FA_CALIB_MAX_MODULES))
+    return NULL;
+
+  imod = faCalibNmod++;
+  strncpy(faCalibTable[imod].serial, serial, FA_CALIB_SN_LEN - 1);
+  faCalibTable[imod].serial[FA_CALIB_SN_LEN - 1] = 0;
+  for(ichan = 0; ichan < FA_MAX_ADC_CHANNELS; ichan++)
+    faCalibClearChannel(&faCalibTable[imod].chan[ichan]);
+
+  return &faCalibTable[imod];
+}
+
+/* Store entry of the module in slot id */
+static faCalibEntry *
+faCalibModule(int id, int create)
+{
+  char *sn;
+
+  if(!faCalibLoaded)
+    faCalibLoad(NULL);
+
+  if(id==0) id=fadcID[0];
+  if((id<=0) || (id>FA_MAX_BOARDS))
+    return NULL;
+
+  sn = faCalibSerial[id];
+  if(sn[0] == 0)
+    {
+      memset(sn, 0, FA_CALIB_SN_LEN);
+      if(faGetSerialNumber(id, (char **)sn, 0) <= 0)
+	{
+	  sn[0] = 0;
+	  return NULL;
+	}
+    }
+
+  return faCalibFind(sn, create);
+}
+
+/**
+ *  @ingroup Config
+ *  @brief Read the calibration store, replacing the values held in memory.
+ *         A missing file is an empty store.
+ *  @param path Store file, NULL for the default
+ *  @return Number of channels read, otherwise ERROR.
+ */
+int
+faCalibLoad(const char *path)
+{
+  char buf[256], line[256], sn[FA_CALIB_SN_LEN];
+  faCalibChannel c;
+  faCalibEntry *e;
+  int ichan, nchan = 0;
+  FILE *f;
+
+  faCalibNmod = 0;
+  faCalibLoaded = 1;
+
+  path = faCalibPath(path, buf, sizeof(buf));
+  if((f = fopen(path, "r")) == NULL)
+    return 0;
+
+  while(fgets(line, sizeof(line), f))
+    {
+      if(line[0] == '#')
+	continue;
+      if(sscanf(line, "%23s %d %d %d %f %f %u", sn, &ichan, &c.dac, &c.thr,
+		&c.ped, &c.noise, &c.updated) != 7)
+	continue;
+      if((ichan < 0) || (ichan >= FA_MAX_ADC_CHANNELS))
+	continue;
+      if((e = faCalibFind(sn, 1)) == NULL)
+	{
+	  printf("%s: WARN: More than %d modules in %s\n",
+		 __FUNCTION__, FA_CALIB_MAX_MODULES, path);
+	  break;
+	}
+      e->chan[ichan] = c;
+      nchan++;
+    }
+  fclose(f);
+
+  return nchan;
+}
+
+/**
+ *  @ingroup Config
+ *  @brief Write the calibration store.  The file is replaced in one step
+ *         (written to a temporary file and renamed).
+ *  @param path Store file, NULL for the default
+ *  @return Number of channels written, otherwise ERROR.
+ */
+int
+faCalibSave(const char *path)
+{
+  char buf[256], tmp[272];
+  faCalibChannel *c;
+  int imod, ichan, nchan = 0;
+  FILE *f;
+
+  path = faCalibPath(path, buf, sizeof(buf));
+  snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+  if((f = fopen(tmp, "w")) == NULL)
+    {
+      printf("%s: ERROR: Unable to write %s\n", __FUNCTION__, tmp);
+      return ERROR;
+    }
+
+  fprintf(f, "# fadc250 calibration store\n");
+  fprintf(f, "# serial          chan   dac   thr      ped    noise     updated\n");
+  for(imod = 0; imod < faCalibNmod; imod++)
+    {
+      for(ichan = 0; ichan < FA_MAX_ADC_CHANNELS; ichan++)
+	{
+	  c = &faCalibTable[imod].chan[ichan];
+	  if(c->updated == 0)
+	    continue;
+	  fprintf(f, "%-16s %5d %5d %5d %8.2f %8.3f %11u\n",
+		  faCalibTable[imod].serial, ichan, c->dac, c->thr,
+		  c->ped, c->noise, c->updated);
+	  nchan++;
+	}
+    }
+
+  if((fclose(f) != 0) || (rename(tmp, path) != 0))
+    {
+      printf("%s: ERROR: Unable to replace %s\n", __FUNCTION__, path);
+      return ERROR;
+    }
+
+  return nchan;
+}
+
+/**
+ *  @ingroup Config
+ *  @brief Get the stored calibration of a channel of the module in slot id.
+ *         The store is read on first use.
+ *  @param id Slot number
+ *  @param chan Channel number
+ *  @param cal Filled with the stored values
+ *  @return OK if the channel has stored values, otherwise ERROR.
+ */
+int
+faCalibGet(int id, int chan, faCalibChannel *cal)
+{
+  faCalibEntry *e;
+
+  if(id==0) id=fadcID[0];
+
+  if((id<=0) || (id>21) || (FAp[id] == NULL) || (cal == NULL) ||
+     (chan < 0) || (chan >= FA_MAX_ADC_CHANNELS))
+    return ERROR;
+
+  faCalibClearChannel(cal);
+  if((e = faCalibModule(id, 0)) == NULL)
+    return ERROR;
+
+  *cal = e->chan[chan];
+  return (cal->updated != 0) ? OK : ERROR;
+}
+
+/**
+ *  @ingroup Config
+ *  @brief Record the calibration of a channel of the module in slot id.
+ *         Negative dac, thr or noise keep the stored value.  The change is
+ *         kept in memory until faCalibSave.
+ *  @param id Slot number
+ *  @param chan Channel number
+ *  @param cal Calibration; updated 0 for the current time
+ *  @return OK if successful, otherwise ERROR.
+ */
+int
+faCalibSet(int id, int chan, const faCalibChannel *cal)
+{
+  faCalibEntry *e;
+  faCalibChannel *c;
+
+  if(id==0) id=fadcID[0];
+
+  if((id<=0) || (id>21) || (FAp[id] == NULL) || (cal == NULL) ||
+     (chan < 0) || (chan >= FA_MAX_ADC_CHANNELS))
+    {
+      logMsg("faCalibSet: ERROR : ADC in slot %d is not initialized \n",id,0,0,0,0,0);
+      return ERROR;
+    }
+
+  if((e = faCalibModule(id, 1)) == NULL)
+    {
+      logMsg("faCalibSet: ERROR : No serial number or store full for slot %d\n",id,0,0,0,0,0);
+      return ERROR;
+    }
+
+  c = &e->chan[chan];
+  if(cal->dac >= 0)
+    {
+      c->dac = cal->dac;
+      c->ped = cal->ped;
+    }
+  if(cal->thr >= 0)
+    c->thr = cal->thr;
+  if(cal->noise >= 0)
+    c->noise = cal->noise;
+  c->updated = cal->updated ? cal->updated : (unsigned int)time(NULL);
+
+  return OK;
+}
+
+/* Queue the stored values of one module, returns the number of channels */
+static int
+faCalibQueue(int id, int rflag)
+{
+  faCalibEntry *e;
+  faCalibChannel *c;
+  int ichan, nchan = 0;
+
+  if((e = faCalibModule(id, 0)) == NULL)
+    return 0;
+
+  for(ichan = 0; ichan < FA_MAX_ADC_CHANNELS; ichan++)
+    {
+      c = &e->chan[ichan];
+      if(c->updated == 0)
+	continue;
+      if((rflag & FA_CALIB_DAC) && (c->dac >= 0))
+	faTransSetDAC(id, c->dac, (1<<ichan));
+      if((rflag & FA_CALIB_THR) && (c->thr >= 0))
+	faTransSetThreshold(id, c->thr, (1<<ichan));
+      nchan++;
+    }
+
+  return nchan;
+}
+
+/**
+ *  @ingroup Config
+ *  @brief Load the stored DAC values and/or thresholds into the module in
+ *         slot id, in one register transaction.
+ *  @param id Slot number
+ *  @param rflag FA_CALIB_DAC and/or FA_CALIB_THR
+ *  @return Number of channels with stored values, otherwise ERROR.
+ */
+int
+faCalibRestore(int id, int rflag)
+{
+  int nchan;
+
+  if(id==0) id=fadcID[0];
+
+  if((id<=0) || (id>21) || (FAp[id] == NULL))
+    {
+      logMsg("faCalibRestore: ERROR : ADC in slot %d is not initialized \n",id,0,0,0,0,0);
+      return ERROR;
+    }
+
+  if(faTransBegin() != OK)
+    return ERROR;
+  nchan = faCalibQueue(id, rflag);
+  if(faTransCommit() == ERROR)
+    return ERROR;
+
+  return nchan;
+}
+
+/**
+ *  @ingroup Config
+ *  @brief Load the stored DAC values and/or thresholds into all initialized
+ *         modules, in one register transaction.
+ *  @param rflag FA_CALIB_DAC and/or FA_CALIB_THR
+ *  @return Number of channels with stored values, otherwise ERROR.
+ */
+int
+faGCalibRestore(int rflag)
+{
+  int ifa, nchan = 0;
+
+  if(faTransBegin() != OK)
+    return ERROR;
+  for(ifa = 0; ifa < nfadc; ifa++)
+    nchan += faCalibQueue(faSlot(ifa), rflag);
+  if(faTransCommit() == ERROR)
+    return ERROR;
+
+  return nchan;
+}
@@ -0,0 +1,368 @@
+/* Module: faConfigFile.c
+ *
+ * Description: FADC250 Configuration File Loader
+ *              Reads the DAC and readout threshold settings of the .cnf
+ *              files written by the calibration tools (faCalibPedestals,
+ *              faTweakPedestals, faFitRates):
+ *
+ *                 CRATE           <name>|all
+ *                 FADC250_SLOTS   <slot> [<slot> ...]|all
+ *                 FADC250_ALLCH_DAC   <16 values>
+ *                 FADC250_ALLCH_THR   <16 values>
+ *
+ *              and applies them to the modules in the crate, writing only
+ *              the registers that differ from the module.  The current
+ *              values are read once per module (through the register
+ *              shadow, if enabled) and the changes are issued as one
+ *              register transaction (faTransBegin/faTransCommit).
+ *
+ *              Several files can be read into the same faCnf, later files
+ *              overriding earlier ones channel by channel (e.g. the DAC
+ *              file of faCalibPedestals, then the threshold file of
+ *              faFitRates).  Other keywords are ignored.
+ *
+ *              Example:
+ *                 static faCnf cnf;
+ *                 faCnfClear(&cnf);
+ *                 faCnfRead("roc1_fadc250_default.cnf", "roc1", &cnf);
+ *                 faCnfApply(&cnf, NULL, FA_CNF_DAC | FA_CNF_THR);
+ *
+ */
+
+/* Slot list of the current FADC250_SLOTS section, 0 if none */
+static unsigned int
+faCnfSlotList(char *s)
+{
+  unsigned int mask = 0;
+  char *end;
+  long slot;
+
+  while(*s)
+    {
+      while((*s == ' ') || (*s == '\t'))
+	s++;
+      if(*s == 0)
+	break;
+      if(strncmp(s, "all", 3) == 0)
+	return 0x3ffffe;
+      slot = strtol(s, &end, 10);
+      if(end == s)
+	return 0;
+      if((slot >= 1) && (slot <= 21))
+	mask |= (1<<slot);
+      s = end;
+    }
+
+  return mask;
+}
+
+/* Parse the 16 values of an ALLCH line, returns the number found */
+static int
+faCnfValues(char *s, unsigned short *val, int max)
+{
+  char *end;
+  long v;
+  int n = 0;
+
+  for(;;)
+    {
+      v = strtol(s, &end, 10);
+      if(end == s)
+	break;
+      if((n >= FA_MAX_ADC_CHANNELS) || (v < 0) || (v > max))
+	return -1;
+      val[n++] = v;
+      s = end;
+    }
+
+  return n;
+}
+
+/**
+ *  @ingroup Config
+ *  @brief Clear the settings of a configuration, before the first faCnfRead.
+ *  @param cnf Configuration
+ */
+void
+faCnfClear(faCnf *cnf)
+{
+  if(cnf)
+    memset(cnf, 0, sizeof(faCnf));
+}
+
+/**
+ *  @ingroup Config
+ *  @brief Read the DAC and threshold settings of a .cnf file into a
+ *         configuration, overriding the settings it already has for the
+ *         same channels.
+ *  @param path Configuration file
+ *  @param crate Only read CRATE sections of this name (or "all").
+ *               NULL for all sections.
+ *  @param cnf Configuration
+ *  @return Number of channel settings read, otherwise ERROR.
+ */
+int
+faCnfRead(const char *path, const char *crate, faCnf *cnf)
+{
+  char *buf, *line, *next, *key, *s;
+  unsigned short val[FA_MAX_ADC_CHANNELS];
+  unsigned int slots = 0;
+  int incrate = (crate == NULL);
+  int isdac, max, nval, slot, ichan, iline = 0, nset = 0;
+  long size;
+  FILE *f;
+
+  if((path == NULL) || (cnf == NULL))
+    return ERROR;
+
+  if((f = fopen(path, "r")) == NULL)
+    {
+      printf("%s: ERROR: Unable to open %s\n", __FUNCTION__, path);
+      return ERROR;
+    }
+
+  /* Whole file in one read, parsed in place */
+  fseek(f, 0, SEEK_END);
+  size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  if((size < 0) || ((buf = (char *)malloc(size + 1)) == NULL))
+    {
+      fclose(f);
+      return ERROR;
+    }
+  size = fread(buf, 1, size, f);
+  buf[size] = 0;
+  fclose(f);
+
+  for(line = buf; line; line = next)
+    {
+      iline++;
+      if((next = strchr(line, '\n')) != NULL)
+	*next++ = 0;
+      if((s = strchr(line, '#')) != NULL)
+	*s = 0;
+
+      for(key = line; (*key == ' ') || (*key == '\t') || (*key == '\r'); key++);
+      for(s = key; *s && (*s != ' ') && (*s != '\t') && (*s != '\r'); s++);
+      if(s == key)
+	continue;
+      if(*s)
+	*s++ = 0;
+
+      if((strcmp(key, "CRATE") == 0) || (strcmp(key, "FADC250_CRATE") == 0))
+	{
+	  while((*s == ' ') || (*s == '\t'))
+	    s++;
+	  s[strcspn(s, " \t\r")] = 0;
+	  incrate = (crate == NULL) || (strcmp(s, "all") == 0) ||
+	    (strcmp(s, crate) == 0);
+	  slots = 0;
+	  continue;
+	}
+
+      if(!incrate)
+	continue;
+
+      if((strcmp(key, "FADC250_SLOTS") == 0) || (strcmp(key, "FADC250_SLOT") == 0))
+	{
+	  if((slots = faCnfSlotList(s)) == 0)
+	    printf("%s: WARN: %s:%d: Invalid slot list\n", __FUNCTION__, path, iline);
+	  continue;
+	}
+
+      if(strcmp(key, "FADC250_ALLCH_DAC") == 0)
+	isdac = 1;
+      else if(strcmp(key, "FADC250_ALLCH_THR") == 0)
+	isdac = 0;
+      else
+	continue;
+
+      max = isdac ? FA_DAC_VALUE_MASK : 0xffff;
+      if((nval = faCnfValues(s, val, max)) != FA_MAX_ADC_CHANNELS)
+	{
+	  printf("%s: WARN: %s:%d: %s needs %d values from 0 to %d, ignored\n",
+		 __FUNCTION__, path, iline, key, FA_MAX_ADC_CHANNELS, max);
+	  continue;
+	}
+      if(slots == 0)
+	{
+	  printf("%s: WARN: %s:%d: %s outside of a FADC250_SLOTS section, ignored\n",
+		 __FUNCTION__, path, iline, key);
+	  continue;
+	}
+
+      for(slot = 1; slot <= 21; slot++)
+	{
+	  if(!(slots & (1<<slot)))
+	    continue;
+	  for(ichan = 0; ichan < FA_MAX_ADC_CHANNELS; ichan++)
+	    {
+	      if(isdac)
+		cnf->slot[slot].dac[ichan] = val[ichan];
+	      else
+		cnf->slot[slot].thr[ichan] = val[ichan];
+	    }
+	  if(isdac)
+	    cnf->slot[slot].dacmask = 0xffff;
+	  else
+	    cnf->slot[slot].thrmask = 0xffff;
+	  nset += FA_MAX_ADC_CHANNELS;
+	}
+    }
+
+  free(buf);
+
+  return nset;
+}
+
+/* Compare the 8 register pairs at reg with the settings of the channels in
+   setmask, and queue the pairs that differ.  Returns the mask of channels
+   changed.  The first channel of each pair is in bits 31-16. */
+static unsigned short
+faCnfDiff(int id, volatile unsigned short *reg, const unsigned int *cur,
+	  const unsigned short *want, unsigned short setmask, unsigned short vmask,
+	  unsigned short *old, int dryrun)
+{
+  unsigned short changed = 0;
+  unsigned int newval;
+  int ii;
+
+  for(ii = 0; ii < FA_MAX_ADC_CHANNELS; ii += 2)
+    {
+      newval = cur[ii>>1];
+      old[ii]   = (newval >> 16) & vmask;
+      old[ii+1] = newval & vmask;
+
+      if(((1<<ii) & setmask) && (old[ii] != want[ii]))
+	{
+	  newval = (newval & 0xFFFF) | ((unsigned int)want[ii] << 16);
+	  changed |= (1<<ii);
+	}
+      if(((1<<(ii+1)) & setmask) && (old[ii+1] != want[ii+1]))
+	{
+	  newval = (newval & 0xFFFF0000) | want[ii+1];
+	  changed |= (1<<(ii+1));
+	}
+
+      if((changed & (3<<ii)) && !dryrun)
+	faTransWrite32(id, (unsigned long)&reg[ii] - (unsigned long)FAp[id], newval);
+    }
+
+  return changed;
+}
+
+/**
+ *  @ingroup Config
+ *  @brief Apply a configuration to the initialized modules, writing only
+ *         the DAC and threshold registers that differ from the module.
+ *
+ *    The DAC and threshold registers of each module are read once, and
+ *    the changed registers written in one register transaction.  Settings
+ *    for slots without an initialized module are counted in delta->nmissing.
+ *
+ *  @param cnf Configuration
+ *  @param delta If not NULL, filled with the changes
+ *  @param aflag
+ *    - FA_CNF_DAC: Apply the DAC settings
+ *    - FA_CNF_THR: Apply the readout thresholds
+ *    - FA_CNF_DRYRUN: Only compare, do not write
+ *    - FA_CNF_VERBOSE: Print each changed channel
+ *  @return Number of channels changed (or to change, with FA_CNF_DRYRUN),
+ *          otherwise ERROR.
+ */
+int
+faCnfApply(const faCnf *cnf, faCnfDelta *delta, int aflag)
+{
+  faCnfDelta d;
+  unsigned int cur[FA_MAX_ADC_CHANNELS];
+  unsigned short old[FA_MAX_ADC_CHANNELS];
+  const faCnfSlot *cs;
+  int dryrun = (aflag & FA_CNF_DRYRUN) ? 1 : 0;
+  int ifa, id, ii, nwrite = 0;
+
+  if((cnf == NULL) || !(aflag & (FA_CNF_DAC | FA_CNF_THR)))
+    return ERROR;
+
+  memset(&d, 0, sizeof(d));
+  for(id = 1; id <= 21; id++)
+    {
+      if((FAp[id] == NULL) && (cnf->slot[id].dacmask || cnf->slot[id].thrmask))
+	d.nmissing++;
+    }
+
+  if(!dryrun && (faTransBegin() != OK))
+    return ERROR;
+
+  for(ifa = 0; ifa < nfadc; ifa++)
+    {
+      id = faSlot(ifa);
+      cs = &cnf->slot[id];
+      if((cs->dacmask == 0) && (cs->thrmask == 0))
+	continue;
+      d.nslots++;
+
+      /* DAC and threshold registers of the module, 8 words each */
+      FASLOTLOCK(id);
+      for(ii = 0; ii < FA_MAX_ADC_CHANNELS/2; ii++)
+	{
+	  cur[ii] =
+	    faShadowRead32(id, (volatile unsigned int *)&FAp[id]->dac[2*ii]);
+	  cur[ii + FA_MAX_ADC_CHANNELS/2] =
+	    faShadowRead32(id, (volatile unsigned int *)&FAp[id]->adc_thres[2*ii]);
+	}
+      FASLOTUNLOCK(id);
+
+      if((aflag & FA_CNF_DAC) && cs->dacmask)
+	{
+	  d.dacmask[id] = faCnfDiff(id, FAp[id]->dac, &cur[0],
+				    cs->dac, cs->dacmask, FA_DAC_VALUE_MASK,
+				    old, dryrun);
+	  for(ii = 0; ii < FA_MAX_ADC_CHANNELS; ii++)
+	    {
+	      if(!(d.dacmask[id] & (1<<ii)))
+		continue;
+	      d.ndac++;
+	      if(aflag & FA_CNF_VERBOSE)
+		printf("  slot %2d chan %2d  DAC        %5d -> %5d\n",
+		       id, ii, old[ii], cs->dac[ii]);
+	    }
+	}
+
+      if((aflag & FA_CNF_THR) && cs->thrmask)
+	{
+	  d.thrmask[id] = faCnfDiff(id, FAp[id]->adc_thres,
+				    &cur[FA_MAX_ADC_CHANNELS/2],
+				    cs->thr, cs->thrmask, 0xffff, old, dryrun);
+	  for(ii = 0; ii < FA_MAX_ADC_CHANNELS; ii++)
+	    {
+	      if(!(d.thrmask[id] & (1<<ii)))
+		continue;
+	      d.nthr++;
+	      if(aflag & FA_CNF_VERBOSE)
+		printf("  slot %2d chan %2d  threshold  %5d -> %5d\n",
+		       id, ii, old[ii], cs->thr[ii]);
+	    }
+	}
+    }
+
+  if(!dryrun)
+    {
+      if((nwrite = faTransCommit()) == ERROR)
+	return ERROR;
+    }
+  else
+    {
+      for(id = 1; id <= 21; id++)
+	for(ii = 0; ii < FA_MAX_ADC_CHANNELS; ii += 2)
+	  nwrite += ((d.dacmask[id] >> ii) & 3) ? 1 : 0;
+      for(id = 1; id <= 21; id++)
+	for(ii = 0; ii < FA_MAX_ADC_CHANNELS; ii += 2)
+	  nwrite += ((d.thrmask[id] >> ii) & 3) ? 1 : 0;
+    }
+  d.nwrite = nwrite;
+
+  if(delta)
+    *delta = d;
+
+  return d.ndac + d.nthr;
+}
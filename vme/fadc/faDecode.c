@@ -0,0 +1,727 @@
+/* Module: faDecode.c
+ *
+ * Description: FADC250 Block Decoder
+ *              Reentrant, allocation-free decoding of a complete
+ *              faReadBlock buffer into structure-of-arrays hit records.
+ *              No stdio in the decoding path; errors are accumulated as
+ *              bits in the decoder context.
+ *
+ *              Dispatch is through a table of handlers indexed by the
+ *              4-bit data type (FA_DATA_TYPE_MASK).  Continuation words
+ *              are passed to the handler of the last type-defining word.
+ *              Handlers return the number of additional words they
+ *              consumed, so raw windows are skipped in one step.
+ *
+ *              Example:
+ *                 static unsigned char hitmem[...];
+ *                 faHits hits;
+ *                 faDecoder dec;
+ *
+ *                 faHitsAttach(&hits, hitmem, maxhits);
+ *                 faDecodeInit(&dec, &hits, FA_DECODE_SWAP);
+ *                 ...
+ *                 faDecodeReset(&dec);
+ *                 nhits = faDecodeBlock(&dec, data, dCnt);
+ *
+ *              Raw window samples referenced by the hits are unpacked with
+ *              faUnpackRawSamples, which selects an AVX2 or SSSE3 kernel
+ *              at runtime when the CPU supports it.
+ *
+ */
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FA_UNPACK_X86
+#include <immintrin.h>
+#endif
+
+typedef int (*faDecodeHandler)(faDecoder *d, const unsigned int *data,
+			       unsigned int iw, unsigned int nwrds,
+			       unsigned int w, int newtype);
+
+#define FA_DECODE_WORD(_d, _w) \
+  (((_d)->flags & FA_DECODE_SWAP) ? LSWAP(_w) : (_w))
+
+static int
+faDecodeNewHit(faDecoder *d)
+{
+  faHits *h = d->hits;
+  int ih = h->nhits;
+
+  if(ih >= h->maxhits)
+    {
+      d->errors |= FA_DECODE_ERR_OVERFLOW;
+      return -1;
+    }
+
+  h->slot[ih]     = d->slot;
+  h->chan[ih]     = d->chan;
+  h->event[ih]    = d->event;
+  h->time[ih]     = 0;
+  h->integral[ih] = 0;
+  h->samples[ih]  = FA_HIT_NO_SAMPLES;
+  h->nsamples[ih] = 0;
+  h->peak[ih]     = 0;
+  h->pedsum[ih]   = 0;
+  h->flags[ih]    = 0;
+  h->nhits++;
+
+  return ih;
+}
+
+static int
+faDecodeBlockHeader(faDecoder *d, const unsigned int *data, unsigned int iw,
+		    unsigned int nwrds, unsigned int w, int newtype)
+{
+  if(newtype)
+    {
+      d->slot      = (w & FA_DATA_SLOT_MASK) >> 22;
+      d->blk_num   = (w & 0x3FF00) >> 8;
+      d->n_evts    = (w & 0xFF);
+      d->blk_start = iw;
+      d->nblocks++;
+    }
+  else
+    {
+      d->PL  = (w & 0x1FFC0000) >> 18;
+      d->NSB = (w & 0x0003FE00) >> 9;
+      d->NSA = (w & 0x000001FF);
+    }
+  return 0;
+}
+
+static int
+faDecodeBlockTrailer(faDecoder *d, const unsigned int *data, unsigned int iw,
+		     unsigned int nwrds, unsigned int w, int newtype)
+{
+  if(!newtype)
+    {
+      d->errors |= FA_DECODE_ERR_SEQUENCE;
+      return 0;
+    }
+
+  if(((w & FA_DATA_SLOT_MASK) >> 22) != d->slot)
+    d->errors |= FA_DECODE_ERR_SLOT;
+
+  if((w & FA_DATA_WRDCNT_MASK) != (iw - d->blk_start + 1))
+    d->errors |= FA_DECODE_ERR_WORDCOUNT;
+
+  d->cur = -1;
+  return 0;
+}
+
+static int
+faDecodeEventHeader(faDecoder *d, const unsigned int *data, unsigned int iw,
+		    unsigned int nwrds, unsigned int w, int newtype)
+{
+  int ichan;
+
+  if(!newtype)
+    {
+      d->errors |= FA_DECODE_ERR_SEQUENCE;
+      return 0;
+    }
+
+  if(((w & FA_DATA_SLOT_MASK) >> 22) != d->slot)
+    d->errors |= FA_DECODE_ERR_SLOT;
+
+  d->event      = (w & 0x3FFFFF);
+  d->ttime_word = 0;
+  d->trig_time  = 0;
+  d->cur        = -1;
+  d->evt_first  = d->hits->nhits;
+  for(ichan = 0; ichan < FA_MAX_ADC_CHANNELS; ichan++)
+    d->raw_off[ichan] = FA_HIT_NO_SAMPLES;
+  d->nevents++;
+
+  return 0;
+}
+
+static int
+faDecodeTriggerTime(faDecoder *d, const unsigned int *data, unsigned int iw,
+		    unsigned int nwrds, unsigned int w, int newtype)
+{
+  if(newtype)
+    {
+      d->trig_time  = (w & 0xFFFFFF);
+      d->ttime_word = 1;
+    }
+  else if(d->ttime_word == 1)
+    {
+      d->trig_time |= ((unsigned long long)(w & 0xFFFFFF)) << 24;
+      d->ttime_word = 2;
+    }
+  else
+    d->errors |= FA_DECODE_ERR_SEQUENCE;
+
+  return 0;
+}
+
+static int
+faDecodeWindowRaw(faDecoder *d, const unsigned int *data, unsigned int iw,
+		  unsigned int nwrds, unsigned int w, int newtype)
+{
+  unsigned int width, nw, off;
+  int ih, chan;
+
+  if(!newtype)
+    {
+      /* Sample words are consumed with the header */
+      d->errors |= FA_DECODE_ERR_SEQUENCE;
+      return 0;
+    }
+
+  chan  = (w & 0x7800000) >> 23;
+  width = (w & 0xFFF);
+  nw    = (width + 1) >> 1;
+  off   = iw + 1;
+
+  if(off + nw > nwrds)
+    {
+      d->errors |= FA_DECODE_ERR_TRUNCATED;
+      nw = nwrds - off;
+      width = nw << 1;
+    }
+
+  d->raw_off[chan] = off;
+  d->raw_ns[chan]  = width;
+  d->chan          = chan;
+
+  /* Pulse parameters for this channel may have preceded the window */
+  for(ih = d->evt_first; ih < d->hits->nhits; ih++)
+    {
+      if((d->hits->chan[ih] == chan) &&
+	 (d->hits->samples[ih] == FA_HIT_NO_SAMPLES))
+	{
+	  d->hits->samples[ih]  = off;
+	  d->hits->nsamples[ih] = width;
+	  d->hits->flags[ih]   |= FA_HIT_RAW;
+	  break;
+	}
+    }
+
+  if(ih == d->hits->nhits)
+    {
+      ih = faDecodeNewHit(d);
+      if(ih < 0)
+	return ERROR;
+      d->hits->samples[ih]  = off;
+      d->hits->nsamples[ih] = width;
+      d->hits->flags[ih]    = FA_HIT_RAW;
+    }
+
+  d->cur = -1;
+  return nw;
+}
+
+static int
+faDecodePulseParam(faDecoder *d, const unsigned int *data, unsigned int iw,
+		   unsigned int nwrds, unsigned int w, int newtype)
+{
+  faHits *h = d->hits;
+  int ih;
+
+  if(newtype)
+    {
+      /* Channel ID and Pedestal Info */
+      d->chan      = (w & 0x00078000) >> 15;
+      d->pedsum    = (w & 0x00003fff);
+      d->ped_flags = (w & (1<<14)) ? FA_HIT_PED_QUALITY : 0;
+      d->cur       = -1;
+      return 0;
+    }
+
+  if(w & (1<<30))
+    {
+      /* Integral of n-th pulse in window.  The first pulse takes over
+	 a raw-only hit from an earlier window of the same channel */
+      for(ih = d->evt_first; ih < h->nhits; ih++)
+	if((h->chan[ih] == d->chan) && (h->flags[ih] == FA_HIT_RAW))
+	  break;
+
+      if(ih == h->nhits)
+	{
+	  ih = faDecodeNewHit(d);
+	  if(ih < 0)
+	    return ERROR;
+	}
+
+      h->integral[ih] = (w & 0x3ffff000) >> 12;
+      h->pedsum[ih]   = d->pedsum;
+      h->flags[ih]    = FA_HIT_PULSE | FA_HIT_NO_TIME | d->ped_flags
+	| ((w & (1<<11)) ? FA_HIT_NSA_EXT : 0)
+	| ((w & (1<<10)) ? FA_HIT_OVERFLOW : 0)
+	| ((w & (1<<9))  ? FA_HIT_UNDERFLOW : 0);
+
+      if(d->raw_off[d->chan] != FA_HIT_NO_SAMPLES)
+	{
+	  h->samples[ih]  = d->raw_off[d->chan];
+	  h->nsamples[ih] = d->raw_ns[d->chan];
+	  h->flags[ih]   |= FA_HIT_RAW;
+	}
+      d->cur = ih;
+    }
+  else
+    {
+      /* Time of n-th pulse in window */
+      ih = d->cur;
+      if((ih < 0) || !(h->flags[ih] & FA_HIT_NO_TIME))
+	{
+	  d->errors |= FA_DECODE_ERR_SEQUENCE;
+	  return 0;
+	}
+
+      h->time[ih]   = (w & 0x3fff8000) >> 15;
+      h->peak[ih]   = (w & 0x00007ff8) >> 3;
+      h->flags[ih] &= ~FA_HIT_NO_TIME;
+      h->flags[ih] |= ((w & 0x2) ? FA_HIT_NOVPEAK : 0)
+	| ((w & 0x1) ? FA_HIT_TIME_QUALITY : 0);
+    }
+
+  return 0;
+}
+
+static int
+faDecodeScaler(faDecoder *d, const unsigned int *data, unsigned int iw,
+	       unsigned int nwrds, unsigned int w, int newtype)
+{
+  unsigned int nw;
+
+  if(!newtype)
+    return 0;
+
+  /* Skip the scaler words */
+  nw = (w & 0x3F);
+  if(iw + 1 + nw > nwrds)
+    {
+      d->errors |= FA_DECODE_ERR_TRUNCATED;
+      nw = nwrds - iw - 1;
+    }
+
+  return nw;
+}
+
+static int
+faDecodeInvalid(faDecoder *d, const unsigned int *data, unsigned int iw,
+		unsigned int nwrds, unsigned int w, int newtype)
+{
+  d->errors |= FA_DECODE_ERR_INVALID;
+  return 0;
+}
+
+static int
+faDecodeSkip(faDecoder *d, const unsigned int *data, unsigned int iw,
+	     unsigned int nwrds, unsigned int w, int newtype)
+{
+  return 0;
+}
+
+static int
+faDecodeUndefined(faDecoder *d, const unsigned int *data, unsigned int iw,
+		  unsigned int nwrds, unsigned int w, int newtype)
+{
+  d->errors |= FA_DECODE_ERR_TYPE;
+  return 0;
+}
+
+static const faDecodeHandler faDecodeTable[16] =
+  {
+    faDecodeBlockHeader,   /*  0: BLOCK HEADER */
+    faDecodeBlockTrailer,  /*  1: BLOCK TRAILER */
+    faDecodeEventHeader,   /*  2: EVENT HEADER */
+    faDecodeTriggerTime,   /*  3: TRIGGER TIME */
+    faDecodeWindowRaw,     /*  4: WINDOW RAW DATA */
+    faDecodeUndefined,     /*  5 */
+    faDecodeUndefined,     /*  6: PULSE RAW DATA (v1 firmware) */
+    faDecodeUndefined,     /*  7: PULSE INTEGRAL (v1 firmware) */
+    faDecodeUndefined,     /*  8: PULSE TIME (v1 firmware) */
+    faDecodePulseParam,    /*  9: PULSE PARAMETERS */
+    faDecodeUndefined,     /* 10 */
+    faDecodeUndefined,     /* 11 */
+    faDecodeScaler,        /* 12: SCALER HEADER */
+    faDecodeSkip,          /* 13: END OF EVENT */
+    faDecodeInvalid,       /* 14: DATA NOT VALID */
+    faDecodeSkip           /* 15: FILLER WORD */
+  };
+
+/**
+ *  @ingroup Readout
+ *  @brief Size of the caller-owned memory required by faHitsAttach
+ *  @param maxhits Number of hits to hold
+ *  @return Size in bytes
+ */
+unsigned int
+faHitsBufferSize(int maxhits)
+{
+  return maxhits * (2*sizeof(unsigned char) + 4*sizeof(unsigned int)
+		    + 4*sizeof(unsigned short)) + 16;
+}
+
+/**
+ *  @ingroup Readout
+ *  @brief Carve the hit arrays out of a single caller-owned block of memory
+ *  @param hits Hit records to initialize
+ *  @param mem Memory of at least faHitsBufferSize(maxhits) bytes
+ *  @param maxhits Number of hits to hold
+ *  @return OK if successful, otherwise ERROR.
+ */
+int
+faHitsAttach(faHits *hits, void *mem, int maxhits)
+{
+  unsigned long p;
+
+  if((hits == NULL) || (mem == NULL) || (maxhits <= 0))
+    {
+      printf("%s: ERROR: Invalid arguments\n", __FUNCTION__);
+      return ERROR;
+    }
+
+  /* Largest elements first, keeping each array naturally aligned */
+  p = ((unsigned long)mem + 3) & ~3UL;
+  hits->event    = (unsigned int *)p;   p += maxhits * sizeof(unsigned int);
+  hits->time     = (unsigned int *)p;   p += maxhits * sizeof(unsigned int);
+  hits->integral = (unsigned int *)p;   p += maxhits * sizeof(unsigned int);
+  hits->samples  = (unsigned int *)p;   p += maxhits * sizeof(unsigned int);
+  hits->nsamples = (unsigned short *)p; p += maxhits * sizeof(unsigned short);
+  hits->peak     = (unsigned short *)p; p += maxhits * sizeof(unsigned short);
+  hits->pedsum   = (unsigned short *)p; p += maxhits * sizeof(unsigned short);
+  hits->flags    = (unsigned short *)p; p += maxhits * sizeof(unsigned short);
+  hits->slot     = (unsigned char *)p;  p += maxhits * sizeof(unsigned char);
+  hits->chan     = (unsigned char *)p;
+
+  hits->maxhits = maxhits;
+  hits->nhits   = 0;
+
+  return OK;
+}
+
+/**
+ *  @ingroup Readout
+ *  @brief Initialize a block decoder context
+ *  @param dec Decoder context
+ *  @param hits Caller-owned hit records to fill
+ *  @param flags Decoder flags
+ *    - FA_DECODE_SWAP: Buffer is big-endian (as returned by faReadBlock DMA)
+ *  @return OK if successful, otherwise ERROR.
+ */
+int
+faDecodeInit(faDecoder *dec, faHits *hits, unsigned int flags)
+{
+  if((dec == NULL) || (hits == NULL))
+    {
+      printf("%s: ERROR: Invalid arguments\n", __FUNCTION__);
+      return ERROR;
+    }
+
+  if((hits->slot == NULL) || (hits->chan == NULL) || (hits->event == NULL) ||
+     (hits->time == NULL) || (hits->integral == NULL) || (hits->samples == NULL) ||
+     (hits->nsamples == NULL) || (hits->peak == NULL) || (hits->pedsum == NULL) ||
+     (hits->flags == NULL))
+    {
+      printf("%s: ERROR: Hit arrays not assigned\n", __FUNCTION__);
+      return ERROR;
+    }
+
+  memset(dec, 0, sizeof(faDecoder));
+  dec->flags = flags;
+  dec->hits  = hits;
+  faDecodeReset(dec);
+
+  return OK;
+}
+
+/**
+ *  @ingroup Readout
+ *  @brief Reset the hit count, error bits and stream state of a decoder,
+ *         for reuse with a new buffer.
+ *  @param dec Decoder context
+ */
+void
+faDecodeReset(faDecoder *dec)
+{
+  int ichan;
+
+  dec->errors    = 0;
+  dec->type      = 15;
+  dec->cur       = -1;
+  dec->evt_first = 0;
+  for(ichan = 0; ichan < FA_MAX_ADC_CHANNELS; ichan++)
+    {
+      dec->raw_off[ichan] = FA_HIT_NO_SAMPLES;
+      dec->raw_ns[ichan]  = 0;
+    }
+  dec->hits->nhits = 0;
+}
+
+/**
+ *  @ingroup Readout
+ *  @brief Decode a buffer of fADC250 data (one or more blocks, as returned
+ *         by faReadBlock) into the decoder's hit records.  Reentrant:
+ *         all state is held in the decoder context.
+ *
+ *  Hits are appended.  Sample offsets are word offsets into @p data.
+ *
+ *  @param dec Decoder context
+ *  @param data Buffer to decode
+ *  @param nwrds Number of words in the buffer
+ *  @return Number of hits appended, or ERROR if the hit arrays filled up.
+ *          Other decoding errors are reported in dec->errors.
+ */
+int
+faDecodeBlock(faDecoder *dec, const unsigned int *data, int nwrds)
+{
+  unsigned int iw, w;
+  int nhits0, rval, newtype;
+
+  if((dec == NULL) || (data == NULL) || (nwrds < 0))
+    return ERROR;
+
+  nhits0 = dec->hits->nhits;
+
+  for(iw = 0; iw < (unsigned int)nwrds; iw++)
+    {
+      w = FA_DECODE_WORD(dec, data[iw]);
+
+      newtype = (w & FA_DATA_TYPE_DEFINE) ? 1 : 0;
+      if(newtype)
+	dec->type = (w & FA_DATA_TYPE_MASK) >> 27;
+
+      rval = (*faDecodeTable[dec->type])(dec, data, iw, nwrds, w, newtype);
+      if(rval < 0)
+	{
+	  dec->nwords += iw;
+	  return ERROR;
+	}
+
+      iw += rval;
+    }
+
+  dec->nwords += nwrds;
+
+  return dec->hits->nhits - nhits0;
+}
+
+/*************************************************************
+ * Raw window sample unpacking
+ *
+ *   Each FA_DATA_WINDOW_RAW continuation word holds two samples,
+ *   first sample in the upper half.  Per sample:
+ *     bits 12-0: ADC value
+ *     bit    12: overflow  (0x1000)
+ *     bit    13: invalid   (0x2000)
+ *   Samples are written masked to 0x1fff.
+ */
+
+typedef int (*faUnpackKernel)(const unsigned int *data, int nwrds, short *samples,
+			      int swap, unsigned int *ninvalid, unsigned int *noverflow);
+
+static int
+faUnpackRawScalar(const unsigned int *data, int nwrds, short *samples,
+		  int swap, unsigned int *ninvalid, unsigned int *noverflow)
+{
+  unsigned int w, hi, lo, inv = 0, ovf = 0;
+  int iw;
+
+  for(iw = 0; iw < nwrds; iw++)
+    {
+      w  = swap ? LSWAP(data[iw]) : data[iw];
+      hi = w >> 16;
+      lo = w & 0xffff;
+
+      samples[2*iw]   = hi & 0x1fff;
+      samples[2*iw+1] = lo & 0x1fff;
+
+      inv += ((hi >> 13) & 1) + ((lo >> 13) & 1);
+      ovf += ((hi >> 12) & 1) + ((lo >> 12) & 1);
+    }
+
+  *ninvalid  += inv;
+  *noverflow += ovf;
+
+  return 2*nwrds;
+}
+
+#ifdef FA_UNPACK_X86
+/* Horizontal sum of 16-bit lane counters */
+__attribute__((target("ssse3")))
+static unsigned int
+faUnpackHsum128(__m128i acc)
+{
+  __m128i s = _mm_madd_epi16(acc, _mm_set1_epi16(1));
+  s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4e));
+  s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xb1));
+  return (unsigned int)_mm_cvtsi128_si32(s);
+}
+
+/* pshufb patterns producing host-order int16 samples, upper half first:
+   big-endian words -> bytes [1,0,3,2], host-order words -> bytes [2,3,0,1] */
+#define FA_UNPACK_SHUF_BE  1,0,3,2, 5,4,7,6, 9,8,11,10, 13,12,15,14
+#define FA_UNPACK_SHUF_LE  2,3,0,1, 6,7,4,5, 10,11,8,9, 14,15,12,13
+
+/* Lane counters are signed 16 bits (for pmaddwd), and the AVX2 kernel adds
+   two lanes before summing; flush before they can wrap */
+#define FA_UNPACK_FLUSH    0x2000
+
+__attribute__((target("ssse3")))
+static int
+faUnpackRawSSSE3(const unsigned int *data, int nwrds, short *samples,
+		 int swap, unsigned int *ninvalid, unsigned int *noverflow)
+{
+  const __m128i shuf = swap ?
+    _mm_setr_epi8(FA_UNPACK_SHUF_BE) : _mm_setr_epi8(FA_UNPACK_SHUF_LE);
+  const __m128i mask = _mm_set1_epi16(0x1fff);
+  const __m128i binv = _mm_set1_epi16(0x2000);
+  const __m128i bovf = _mm_set1_epi16(0x1000);
+  __m128i ainv = _mm_setzero_si128(), aovf = _mm_setzero_si128(), v;
+  unsigned int inv = 0, ovf = 0;
+  int iw = 0, n = 0;
+
+  for(; iw + 4 <= nwrds; iw += 4)
+    {
+      v = _mm_loadu_si128((const __m128i *)&data[iw]);
+      v = _mm_shuffle_epi8(v, shuf);
+      ainv = _mm_add_epi16(ainv, _mm_srli_epi16(_mm_and_si128(v, binv), 13));
+      aovf = _mm_add_epi16(aovf, _mm_srli_epi16(_mm_and_si128(v, bovf), 12));
+      _mm_storeu_si128((__m128i *)&samples[2*iw], _mm_and_si128(v, mask));
+
+      if(++n == FA_UNPACK_FLUSH)
+	{
+	  inv += faUnpackHsum128(ainv);
+	  ovf += faUnpackHsum128(aovf);
+	  ainv = aovf = _mm_setzero_si128();
+	  n = 0;
+	}
+    }
+
+  *ninvalid  += inv + faUnpackHsum128(ainv);
+  *noverflow += ovf + faUnpackHsum128(aovf);
+
+  faUnpackRawScalar(&data[iw], nwrds - iw, &samples[2*iw], swap, ninvalid, noverflow);
+
+  return 2*nwrds;
+}
+
+__attribute__((target("avx2")))
+static int
+faUnpackRawAVX2(const unsigned int *data, int nwrds, short *samples,
+		int swap, unsigned int *ninvalid, unsigned int *noverflow)
+{
+  const __m256i shuf = swap ?
+    _mm256_setr_epi8(FA_UNPACK_SHUF_BE, FA_UNPACK_SHUF_BE) :
+    _mm256_setr_epi8(FA_UNPACK_SHUF_LE, FA_UNPACK_SHUF_LE);
+  const __m256i mask = _mm256_set1_epi16(0x1fff);
+  const __m256i binv = _mm256_set1_epi16(0x2000);
+  const __m256i bovf = _mm256_set1_epi16(0x1000);
+  __m256i ainv = _mm256_setzero_si256(), aovf = _mm256_setzero_si256(), v;
+  unsigned int inv = 0, ovf = 0;
+  int iw = 0, n = 0;
+
+  for(; iw + 8 <= nwrds; iw += 8)
+    {
+      v = _mm256_loadu_si256((const __m256i *)&data[iw]);
+      v = _mm256_shuffle_epi8(v, shuf);
+      ainv = _mm256_add_epi16(ainv, _mm256_srli_epi16(_mm256_and_si256(v, binv), 13));
+      aovf = _mm256_add_epi16(aovf, _mm256_srli_epi16(_mm256_and_si256(v, bovf), 12));
+      _mm256_storeu_si256((__m256i *)&samples[2*iw], _mm256_and_si256(v, mask));
+
+      if((++n == FA_UNPACK_FLUSH) || (iw + 16 > nwrds))
+	{
+	  inv += faUnpackHsum128(_mm_add_epi16(_mm256_castsi256_si128(ainv),
+					       _mm256_extracti128_si256(ainv, 1)));
+	  ovf += faUnpackHsum128(_mm_add_epi16(_mm256_castsi256_si128(aovf),
+					       _mm256_extracti128_si256(aovf, 1)));
+	  ainv = aovf = _mm256_setzero_si256();
+	  n = 0;
+	}
+    }
+
+  *ninvalid  += inv;
+  *noverflow += ovf;
+
+  faUnpackRawScalar(&data[iw], nwrds - iw, &samples[2*iw], swap, ninvalid, noverflow);
+
+  return 2*nwrds;
+}
+#endif /* FA_UNPACK_X86 */
+
+static faUnpackKernel faUnpackRawKernel = NULL;
+static const char    *faUnpackRawKernelName = "scalar";
+
+static void
+faUnpackRawSelect()
+{
+  faUnpackKernel k = faUnpackRawScalar;
+  const char *name = "scalar";
+
+#ifdef FA_UNPACK_X86
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx2"))
+    {
+      k = faUnpackRawAVX2;
+      name = "avx2";
+    }
+  else if(__builtin_cpu_supports("ssse3"))
+    {
+      k = faUnpackRawSSSE3;
+      name = "ssse3";
+    }
+#endif
+
+  faUnpackRawKernelName = name;
+  faUnpackRawKernel = k;
+}
+
+/**
+ *  @ingroup Readout
+ *  @brief Unpack the samples of a raw window (FA_DATA_WINDOW_RAW continuation
+ *         words) into an int16 array, masking off the flag bits and counting
+ *         invalid (0x2000) and overflow (0x1000) samples.
+ *
+ *  The fastest kernel supported by the CPU (AVX2, SSSE3 or scalar) is selected
+ *  on the first call.
+ *
+ *  @param data First sample word (e.g. &buffer[hits.samples[ihit]])
+ *  @param nwrds Number of sample words
+ *  @param samples Destination, room for 2*nwrds samples
+ *  @param flags
+ *    - FA_DECODE_SWAP: Words are big-endian (as returned by faReadBlock DMA)
+ *  @param ninvalid If not NULL, incremented by the number of invalid samples
+ *  @param noverflow If not NULL, incremented by the number of overflow samples
+ *  @return Number of samples written, otherwise ERROR.
+ */
+int
+faUnpackRawSamples(const unsigned int *data, int nwrds, short *samples,
+		   unsigned int flags, unsigned int *ninvalid, unsigned int *noverflow)
+{
+  unsigned int inv = 0, ovf = 0;
+  int rval;
+
+  if((data == NULL) || (samples == NULL) || (nwrds < 0))
+    return ERROR;
+
+  if(faUnpackRawKernel == NULL)
+    faUnpackRawSelect();
+
+  rval = (*faUnpackRawKernel)(data, nwrds, samples, (flags & FA_DECODE_SWAP) ? 1 : 0,
+			      &inv, &ovf);
+
+  if(ninvalid)
+    *ninvalid += inv;
+  if(noverflow)
+    *noverflow += ovf;
+
+  return rval;
+}
+
+/**
+ *  @ingroup Readout
+ *  @brief Name of the raw sample unpacking kernel in use
+ *  @return "avx2", "ssse3" or "scalar"
+ */
+const char *
+faUnpackRawSamplesKernel()
+{
+  if(faUnpackRawKernel == NULL)
+    faUnpackRawSelect();
+
+  return faUnpackRawKernelName;
+}
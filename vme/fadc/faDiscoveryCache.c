@@ -0,0 +1,189 @@
+/* Module: faDiscoveryCache.c
+ *
+ * Description: FADC250 Discovery Cache
+ *              The modules found by faInit (slot, A24 address, firmware
+ *              versions, serial number), kept in a local file so that the
+ *              next faInit with FA_INIT_DISCOVERY_CACHE and the same
+ *              addr, addr_inc, nadc and A32 base does not probe the empty
+ *              slots.  Each cached module is checked before use: the
+ *              version, slot number, processing FPGA version and serial
+ *              number registers must read back as cached.  If any does
+ *              not (module removed, moved, swapped or reflashed), faInit
+ *              probes the crate as usual and rewrites the file.
+ *
+ *              A module put into a slot that was empty when the file was
+ *              written is not seen until the file is rewritten: remove it,
+ *              or call faInit once without FA_INIT_DISCOVERY_CACHE.
+ *
+ *              The file is FA_DISCOVERY_CACHE_ENV if set, otherwise
+ *              FA_DISCOVERY_CACHE_DEFAULT in $HOME (not a shared
+ *              directory: another user could plant the file, or a link
+ *              in its place).  Not used with FA_INIT_USE_ADDRLIST.
+ *
+ */
+
+typedef struct
+{
+  int          slot;
+  unsigned int a24;          /* VME A24 address */
+  unsigned int version;      /* version register */
+  unsigned int proc;         /* Processing FPGA version */
+  unsigned int sn[3];        /* serial_number registers */
+} faDiscoveryEntry;
+
+static const char *
+faDiscoveryPath(char *buf, int len)
+{
+  const char *path, *home;
+
+  if((path = getenv(FA_DISCOVERY_CACHE_ENV)) != NULL)
+    return path;
+  home = getenv("HOME");
+  snprintf(buf, len, "%s/%s", home ? home : ".", FA_DISCOVERY_CACHE_DEFAULT);
+  return buf;
+}
+
+/* Key of the faInit call: the cache is only used for the same scan */
+static void
+faDiscoveryKey(char *key, int len, UINT32 addr, UINT32 addr_inc, int nadc,
+	       int noFirmwareCheck)
+{
+  snprintf(key, len, "key 0x%06x 0x%06x %d 0x%08x %d",
+	   addr, addr_inc, nadc, fadcA32Base, noFirmwareCheck);
+}
+
+/* Read the registers compared against the cache */
+static int
+faDiscoveryRead(unsigned long laddr, faDiscoveryEntry *e)
+{
+  volatile struct fadc_struct *fa = (struct fadc_struct *)laddr;
+  unsigned int rdata;
+  int i;
+
+#ifdef VXWORKS
+  if(vxMemProbe((char *) &(fa->version),VX_READ,4,(char *)&rdata) < 0)
+    return ERROR;
+#else
+  if(vmeMemProbe((char *) &(fa->version),4,(char *)&rdata) < 0)
+    return ERROR;
+#endif
+
+  e->version = rdata;
+  e->slot = ((vmeRead32(&(fa->intr)))&FA_SLOT_ID_MASK)>>16;
+  e->proc = vmeRead32(&fa->adc_status[0]) & FA_ADC_VERSION_MASK;
+  for(i = 0; i < 3; i++)
+    e->sn[i] = vmeRead32(&fa->serial_number[i]);
+
+  return OK;
+}
+
+/*
+ * Set up the modules in the cache, as the probe loop of faInit would.
+ * Returns the number of modules, 0 if the cache is missing, for another
+ * scan, or does not match the crate.
+ */
+static int
+faDiscoveryRestore(UINT32 addr, UINT32 addr_inc, int nadc, int noFirmwareCheck,
+		   int *errFlag, int *minSlot, int *maxSlot)
+{
+  faDiscoveryEntry e[FA_MAX_BOARDS], cur;
+  char key[80], line[160], buf[256];
+  int n = 0, ii, err = 0;
+  FILE *f;
+
+  if((f = fopen(faDiscoveryPath(buf, sizeof(buf)), "r")) == NULL)
+    return 0;
+
+  faDiscoveryKey(key, sizeof(key), addr, addr_inc, nadc, noFirmwareCheck);
+  while(fgets(line, sizeof(line), f))
+    {
+      if(line[0] == '#')
+	continue;
+      if(strncmp(line, "key ", 4) == 0)
+	{
+	  line[strcspn(line, "\n")] = 0;
+	  if(strcmp(line, key) != 0)
+	    {
+	      fclose(f);
+	      return 0;
+	    }
+	  continue;
+	}
+      if(sscanf(line, "errflag %d", &err) == 1)
+	continue;
+      if(n >= FA_MAX_BOARDS)
+	break;
+      if(sscanf(line, "%d %x %x %x %x %x %x", &e[n].slot, &e[n].a24,
+		&e[n].version, &e[n].proc, &e[n].sn[0], &e[n].sn[1],
+		&e[n].sn[2]) == 7)
+	n++;
+    }
+  fclose(f);
+
+  if(n == 0)
+    return 0;
+
+  /* Every cached module must still be there, as cached */
+  for(ii = 0; ii < n; ii++)
+    {
+      if((e[ii].slot <= 0) || (e[ii].slot > 21) ||
+	 (faDiscoveryRead(e[ii].a24 + fadcA24Offset, &cur) != OK) ||
+	 (cur.version != e[ii].version) || (cur.slot != e[ii].slot) ||
+	 (cur.proc != e[ii].proc) || (cur.sn[0] != e[ii].sn[0]) ||
+	 (cur.sn[1] != e[ii].sn[1]) || (cur.sn[2] != e[ii].sn[2]))
+	{
+	  printf("faInit: Crate does not match the discovery cache, probing\n");
+	  return 0;
+	}
+    }
+
+  for(ii = 0; ii < n; ii++)
+    {
+      FAp[e[ii].slot] = (struct fadc_struct *)((unsigned long)e[ii].a24 + fadcA24Offset);
+      fadcRev[e[ii].slot] = e[ii].version & FA_VERSION_MASK;
+      fadcProcRev[e[ii].slot] = e[ii].proc;
+      fadcID[ii] = e[ii].slot;
+      if(e[ii].slot >= *maxSlot) *maxSlot = e[ii].slot;
+      if(e[ii].slot <= *minSlot) *minSlot = e[ii].slot;
+
+      printf("Initialized FADC %2d  Slot #%2d at VME (Local) address 0x%06x (0x%lx) \n",
+	     ii, e[ii].slot, e[ii].a24, (unsigned long) FAp[e[ii].slot]);
+    }
+  *errFlag = err;
+
+  return n;
+}
+
+/* Write the modules found by the probe loop of faInit */
+static void
+faDiscoverySave(UINT32 addr, UINT32 addr_inc, int nadc, int noFirmwareCheck,
+		int errFlag)
+{
+  faDiscoveryEntry e;
+  char key[80], buf[256], tmp[272];
+  const char *path = faDiscoveryPath(buf, sizeof(buf));
+  int ii;
+  FILE *f;
+
+  snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+  if((f = fopen(tmp, "w")) == NULL)
+    return;
+
+  faDiscoveryKey(key, sizeof(key), addr, addr_inc, nadc, noFirmwareCheck);
+  fprintf(f, "# fadc250 discovery cache, written by faInit\n");
+  fprintf(f, "%s\n", key);
+  fprintf(f, "errflag %d\n", errFlag);
+  fprintf(f, "# slot  a24       version    proc   serial_number[0-2]\n");
+  for(ii = 0; ii < nfadc; ii++)
+    {
+      if(faDiscoveryRead((unsigned long)FAp[fadcID[ii]], &e) != OK)
+	continue;
+      fprintf(f, "%2d  0x%06x  0x%08x 0x%04x 0x%08x 0x%08x 0x%08x\n",
+	      fadcID[ii],
+	      (UINT32)((unsigned long)FAp[fadcID[ii]] - fadcA24Offset),
+	      e.version, e.proc, e.sn[0], e.sn[1], e.sn[2]);
+    }
+
+  if((fclose(f) != 0) || (rename(tmp, path) != 0))
+    remove(tmp);
+}
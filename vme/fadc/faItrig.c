@@ -24,7 +24,7 @@ faItrigStatus(int id, int sFlag)
     }
 
   /* Express Time in ns - 4ns/clk  */
-  FALOCK;
+  FASLOTLOCK(id);
   status   =  vmeRead32(&FAp[id]->hitsum_status)&0xffff;
   config   =  vmeRead32(&FAp[id]->hitsum_cfg)&0xffff;
   twidth   =  (vmeRead32(&FAp[id]->hitsum_trig_width)&0xffff)*FA_ADC_NS_PER_CLK;
@@ -34,7 +34,7 @@ faItrigStatus(int id, int sFlag)
   sum_th   =  vmeRead32(&FAp[id]->hitsum_sum_thresh)&0xffff;
   itrigCnt =  vmeRead32(&FAp[id]->internal_trig_scal);
   trigOut  =  vmeRead32(&FAp[id]->ctrl1)&FA_ITRIG_OUT_MASK;
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   vers     = status&FA_ITRIG_VERSION_MASK;
   mode     = config&FA_ITRIG_MODE_MASK;
@@ -95,9 +95,9 @@ faItrigSetMode(int id, int tmode, unsigned int wWidth, unsigned int wMask,
     }
 
   /* Make sure we are not enabled or running */
-  FALOCK;
+  FASLOTLOCK(id);
   config = vmeRead32(&FAp[id]->hitsum_cfg)&FA_ITRIG_CONFIG_MASK;
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
   if((config&FA_ITRIG_ENABLE_MASK) == 0) 
     {
       printf("faItrigSetMode: ERROR: Internal triggers are enabled - Disable first\n");
@@ -114,7 +114,7 @@ faItrigSetMode(int id, int tmode, unsigned int wWidth, unsigned int wMask,
   if(tTable != NULL) 
     {
       printf("faItrigSetMode: Loading trigger table from address 0x%lx \n",(unsigned long) tTable);
-      FALOCK;
+      FASLOTLOCK(id);
       vmeWrite32(&FAp[id]->s_adr, FA_SADR_AUTO_INCREMENT);
       vmeWrite32(&FAp[id]->hitsum_pattern, 0);  /* Make sure address 0 is not a valid trigger */
       for(ii=1;ii<=0xffff;ii++) 
@@ -124,14 +124,14 @@ faItrigSetMode(int id, int tmode, unsigned int wWidth, unsigned int wMask,
 	  else
 	    vmeWrite32(&FAp[id]->hitsum_pattern, 0);
 	}
-      FAUNLOCK;
+      FASLOTUNLOCK(id);
     }
 
   switch(tmode) 
     {
     case FA_ITRIG_SUM_MODE:
       /* Load Sum Threshhold if in range */
-      FALOCK;
+      FASLOTLOCK(id);
       if((sumThresh > 0)&&(sumThresh <= 0xffff)) 
 	{
 	  vmeWrite32(&FAp[id]->hitsum_sum_thresh, sumThresh);
@@ -139,18 +139,18 @@ faItrigSetMode(int id, int tmode, unsigned int wWidth, unsigned int wMask,
       else
 	{
 	  printf("faItrigSetMode: ERROR: Sum Threshold out of range (0<st<=0xffff)\n");
-	  FAUNLOCK;
+	  FASLOTUNLOCK(id);
 	  return(ERROR);
 	}
       stat = (config&~FA_ITRIG_MODE_MASK) | FA_ITRIG_SUM_MODE;
       vmeWrite32(&FAp[id]->hitsum_cfg, stat);
-      FAUNLOCK;
+      FASLOTUNLOCK(id);
       printf("faItrigSetMode: Configure for SUM Mode (Threshold = 0x%x)\n",sumThresh);
       break;
 
     case FA_ITRIG_COIN_MODE:
       /* Set Coincidence Input Channels */
-      FALOCK;
+      FASLOTLOCK(id);
       if((cMask > 0)&&(cMask <= 0xffff)) 
 	{
 	  vmeWrite32(&FAp[id]->hitsum_coin_bits, cMask);
@@ -158,18 +158,18 @@ faItrigSetMode(int id, int tmode, unsigned int wWidth, unsigned int wMask,
       else
 	{
 	  printf("faItrigSetMode: ERROR: Coincidence channel mask out of range (0<cc<=0xffff)\n");
-	  FAUNLOCK;
+	  FASLOTUNLOCK(id);
 	  return(ERROR);
 	}
       stat = (config&~FA_ITRIG_MODE_MASK) | FA_ITRIG_COIN_MODE;
       vmeWrite32(&FAp[id]->hitsum_cfg, stat);
-      FAUNLOCK;
+      FASLOTUNLOCK(id);
       printf("faItrigSetMode: Configure for COINCIDENCE Mode (channel mask = 0x%x)\n",cMask);
       break;
 
     case FA_ITRIG_WINDOW_MODE:
       /* Set Trigger Window width and channel mask */
-      FALOCK;
+      FASLOTLOCK(id);
       if((wMask > 0)&&(wMask <= 0xffff)) 
 	{
 	  vmeWrite32(&FAp[id]->hitsum_window_bits, wMask);
@@ -177,7 +177,7 @@ faItrigSetMode(int id, int tmode, unsigned int wWidth, unsigned int wMask,
       else
 	{
 	  printf("faItrigSetMode: ERROR: Trigger Window channel mask out of range (0<wc<=0xffff)\n");
-	  FAUNLOCK;
+	  FASLOTUNLOCK(id);
 	  return(ERROR);
 	}
       if((wWidth > 0)&&(wWidth <= FA_ITRIG_MAX_WIDTH)) 
@@ -188,21 +188,21 @@ faItrigSetMode(int id, int tmode, unsigned int wWidth, unsigned int wMask,
       else
 	{
 	  printf("faItrigSetMode: ERROR: Trigger Window width out of range (0<ww<=0x200)\n");
-	  FAUNLOCK;
+	  FASLOTUNLOCK(id);
 	  return(ERROR);
 	}
       stat = (config&~FA_ITRIG_MODE_MASK) | FA_ITRIG_WINDOW_MODE;
       vmeWrite32(&FAp[id]->hitsum_cfg, stat);
-      FAUNLOCK;
+      FASLOTUNLOCK(id);
       printf("faItrigSetMode: Configure for Trigger WINDOW Mode (channel mask = 0x%x, width = %d ns)\n",
 	     wMask,wTime);
       break;
 
     case FA_ITRIG_TABLE_MODE:
-      FALOCK;
+      FASLOTLOCK(id);
       stat = (config&~FA_ITRIG_MODE_MASK) | FA_ITRIG_TABLE_MODE;
       vmeWrite32(&FAp[id]->hitsum_cfg, stat);
-      FAUNLOCK;
+      FASLOTUNLOCK(id);
       printf("faItrigSetMode: Configure for Trigger TABLE Mode\n");
     }
   
@@ -237,12 +237,12 @@ faItrigInitTable(int id, unsigned int *table)
     }
 
   /* Check and make sure we are not running */
-  FALOCK;
+  FASLOTLOCK(id);
   config = vmeRead32(&FAp[id]->hitsum_cfg);
   if((config&FA_ITRIG_ENABLE_MASK) !=  FA_ITRIG_DISABLED) 
     {
       printf("faItrigInitTable: ERROR: Cannot update Trigger Table while trigger is Enabled\n");
-      FAUNLOCK;
+      FASLOTUNLOCK(id);
       return(ERROR);
     }
 
@@ -272,7 +272,7 @@ faItrigInitTable(int id, unsigned int *table)
 	}
       
     }
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
   
   return(OK);
 }
@@ -295,12 +295,12 @@ faItrigSetHBwidth(int id, unsigned short hbWidth, unsigned short hbMask)
     }
 
   /* Check and make sure we are not running */
-  FAUNLOCK;
+  FASLOTLOCK(id);
   config = vmeRead32(&FAp[id]->hitsum_cfg);
   if((config&FA_ITRIG_ENABLE_MASK) !=  FA_ITRIG_DISABLED) 
     {
       printf("faItrigSetHBwidth: ERROR: Cannot set HB widths while trigger is Enabled\n");
-      FAUNLOCK;
+      FASLOTUNLOCK(id);
       return(ERROR);
     }
   
@@ -317,7 +317,7 @@ faItrigSetHBwidth(int id, unsigned short hbWidth, unsigned short hbMask)
 	  vmeWrite32(&FAp[id]->hitsum_hit_info, hbval);  /* Set Value */
 	}
     }
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
   
   return(OK);
 }
@@ -341,11 +341,11 @@ faItrigGetHBwidth(int id, unsigned int chan)
       return(0xffffffff);
     }
   
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&FAp[id]->s_adr, chan);             /* Set Channel */
   EIEIO;    
   rval = vmeRead32(&FAp[id]->hitsum_hit_info)&FA_ITRIG_HB_WIDTH_MASK;  /* Get Value */
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
   
   return(rval);
 }
@@ -365,12 +365,12 @@ faItrigSetHBdelay(int id, unsigned short hbDelay, unsigned short hbMask)
     }
   
   /* Check and make sure we are not running */
-  FALOCK;
+  FASLOTLOCK(id);
   config = vmeRead32(&FAp[id]->hitsum_cfg);
   if((config&FA_ITRIG_ENABLE_MASK) !=  FA_ITRIG_DISABLED) 
     {
       printf("faItrigSetHBdelay: ERROR: Cannot set HB delays while trigger is Enabled\n");
-      FAUNLOCK;
+      FASLOTUNLOCK(id);
       return(ERROR);
     }
   
@@ -388,7 +388,7 @@ faItrigSetHBdelay(int id, unsigned short hbDelay, unsigned short hbMask)
 	  vmeWrite32(&FAp[id]->hitsum_hit_info, hbval);  /* Set Value */
 	}
     }
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
   
   return(OK);
 }
@@ -412,11 +412,11 @@ faItrigGetHBdelay(int id, unsigned int chan)
       return(0xffffffff);
     }
      
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&FAp[id]->s_adr, chan);             /* Set Channel */
   EIEIO;    
   rval = (vmeRead32(&FAp[id]->hitsum_hit_info)&FA_ITRIG_HB_DELAY_MASK)>>8;  /* Get Value */
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return(rval);
 }
@@ -436,14 +436,14 @@ faItrigPrintHBinfo(int id)
       return;
     }
   
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&FAp[id]->s_adr, ii);
   for(ii=0;ii<FA_MAX_ADC_CHANNELS;ii++) 
     {
       vmeWrite32(&FAp[id]->s_adr, ii);
       hbval[ii] = vmeRead32(&FAp[id]->hitsum_hit_info)&FA_ITRIG_HB_INFO_MASK;  /* Get Values */
     }
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
   
   printf(" HitBit (width,delay) in nsec for FADC Inputs in slot %d:",id);
   for(ii=0;ii<FA_MAX_ADC_CHANNELS;ii++) 
@@ -472,13 +472,13 @@ faItrigSetOutWidth(int id, unsigned short itrigWidth)
   
   if(itrigWidth>FA_ITRIG_MAX_WIDTH) itrigWidth = FA_ITRIG_MAX_WIDTH;
   
-  FALOCK;
+  FASLOTLOCK(id);
   if(itrigWidth)
     vmeWrite32(&FAp[id]->hitsum_trig_width, itrigWidth);
   
   EIEIO;
   retval = vmeRead32(&FAp[id]->hitsum_trig_width)&0xffff;
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
   
   return(retval);
 }
@@ -496,7 +496,7 @@ faItrigEnable(int id, int eflag)
       return;
     }
   
-  FALOCK;
+  FASLOTLOCK(id);
   rval = vmeRead32(&FAp[id]->hitsum_cfg);
   rval &= ~(FA_ITRIG_DISABLED);
   
@@ -507,7 +507,7 @@ faItrigEnable(int id, int eflag)
       vmeWrite32(&FAp[id]->ctrl1,  vmeRead32(&FAp[id]->ctrl1) 
 		 | (FA_ENABLE_LIVE_TRIG_OUT | FA_ENABLE_TRIG_OUT_FP));
     }
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
   
 }
 
@@ -524,7 +524,7 @@ faItrigDisable(int id, int dflag)
       return;
     }
   
-  FALOCK;
+  FASLOTLOCK(id);
   rval = vmeRead32(&FAp[id]->hitsum_cfg);
   rval |= FA_ITRIG_DISABLED;
   
@@ -536,7 +536,7 @@ faItrigDisable(int id, int dflag)
       rval &= ~(FA_ENABLE_LIVE_TRIG_OUT | FA_ENABLE_TRIG_OUT_FP);
       vmeWrite32(&FAp[id]->ctrl1, rval);
     }
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
   
 }
 
@@ -554,11 +554,11 @@ faItrigGetTableVal(int id, unsigned short pMask)
       return(ERROR);
     }
   
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&FAp[id]->s_adr, pMask);
   EIEIO; /* Make sure write comes before read */
   rval = vmeRead32(&FAp[id]->hitsum_pattern)&0x1;
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return(rval);
 }
@@ -575,13 +575,13 @@ faItrigSetTableVal(int id, unsigned short tval, unsigned short pMask)
       return;
     }
   
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&FAp[id]->s_adr, pMask);
   if(tval)
     vmeWrite32(&FAp[id]->hitsum_pattern, 1);
   else
     vmeWrite32(&FAp[id]->hitsum_pattern, 0);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
   
 }
 
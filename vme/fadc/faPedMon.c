@@ -0,0 +1,285 @@
+/* Module: faPedMon.c
+ *
+ * Description: FADC250 Pedestal Monitor
+ *              Running mean and variance of the baseline of each channel,
+ *              accumulated from samples read while the crate is idle
+ *              (faPedMonSample) or from the pre-trigger samples of mode 10
+ *              raw windows decoded by faDecodeBlock (faPedMonAddHits).
+ *
+ *              Samples are reduced in batches of up to FA_PEDMON_BATCH:
+ *              integer sums of the deviations from the first sample of
+ *              the batch, taken over all 16 channels together so the
+ *              compiler can vectorize them.  Each batch is then merged
+ *              into the running statistics with the pairwise form of
+ *              Welford's update.
+ *
+ *              No locking: one faPedMon per thread.
+ *
+ *              Example (readout list, mode 10):
+ *                 static faPedMon pm;
+ *                 faPedMonInit(&pm, 0);
+ *                 ...
+ *                 nhits = faDecodeBlock(&dec, data, dCnt);
+ *                 faPedMonAddHits(&pm, data, &hits, 8, FA_DECODE_SWAP);
+ *                 ...
+ *                 faPedMonGet(&pm, slot, chan, &mean, &var);
+ *
+ */
+
+/* Deviations within a batch stay below 4096, so the sums of squares of
+   FA_PEDMON_BATCH of them fit in 32 bits */
+#define FA_PEDMON_BATCH   64
+
+/* Merge a batch of n samples, sum and sumsq of deviations from ref,
+   into the running statistics of one channel */
+static void
+faPedMonMerge(faPedMon *pm, int id, int chan, int n, int ref, int sum,
+	      unsigned int sumsq)
+{
+  double nb = n, na = pm->n[id][chan], nt = na + nb;
+  double mb = ref + sum / nb;
+  double m2b = sumsq - ((double)sum * sum) / nb;
+  double delta = mb - pm->mean[id][chan];
+
+  pm->mean[id][chan] += delta * nb / nt;
+  pm->m2[id][chan]   += m2b + delta * delta * na * nb / nt;
+  pm->n[id][chan]    += n;
+}
+
+/**
+ *  @ingroup Status
+ *  @brief Initialize a pedestal monitor, clearing all statistics.
+ *  @param pm Pedestal monitor
+ *  @param maxvalue Samples above this value exclude the window (or batch
+ *                  sample) from the statistics, as maxvalue in faProcPedConfig.
+ *                  0 for no limit.
+ *  @return OK if successful, otherwise ERROR.
+ */
+int
+faPedMonInit(faPedMon *pm, int maxvalue)
+{
+  if(pm == NULL)
+    return ERROR;
+
+  memset(pm, 0, sizeof(faPedMon));
+  pm->maxvalue = (maxvalue > 0) ? maxvalue : 0x1fff;
+
+  return OK;
+}
+
+/**
+ *  @ingroup Status
+ *  @brief Clear the statistics of a pedestal monitor, e.g. after they
+ *         have been published, keeping its configuration.
+ *  @param pm Pedestal monitor
+ */
+void
+faPedMonClear(faPedMon *pm)
+{
+  int maxvalue;
+
+  if(pm == NULL)
+    return;
+
+  maxvalue = pm->maxvalue;
+  memset(pm, 0, sizeof(faPedMon));
+  pm->maxvalue = maxvalue;
+}
+
+/**
+ *  @ingroup Status
+ *  @brief Add samples of one channel to a pedestal monitor.
+ *  @param pm Pedestal monitor
+ *  @param id Slot number
+ *  @param chan Channel number
+ *  @param samples Sample values (0x1fff masked, as from faUnpackRawSamples)
+ *  @param n Number of samples
+ *  @return Number of samples added, 0 if any sample is above the
+ *          monitor's maxvalue, otherwise ERROR.
+ */
+int
+faPedMonAddSamples(faPedMon *pm, int id, int chan, const short *samples, int n)
+{
+  int i, ib, nb, ref, d, sum;
+  unsigned int sumsq;
+  int vmax = 0;
+
+  if((pm == NULL) || (id <= 0) || (id > FA_MAX_BOARDS) ||
+     (chan < 0) || (chan >= FA_MAX_ADC_CHANNELS) || (n < 0))
+    return ERROR;
+
+  for(i = 0; i < n; i++)
+    vmax = (samples[i] > vmax) ? samples[i] : vmax;
+  if(vmax > pm->maxvalue)
+    {
+      pm->nreject[id][chan]++;
+      return 0;
+    }
+
+  for(ib = 0; ib < n; ib += FA_PEDMON_BATCH)
+    {
+      nb = (n - ib < FA_PEDMON_BATCH) ? n - ib : FA_PEDMON_BATCH;
+      ref = samples[ib];
+      sum = 0;
+      sumsq = 0;
+      for(i = 0; i < nb; i++)
+	{
+	  d = samples[ib + i] - ref;
+	  sum += d;
+	  sumsq += d * d;
+	}
+      faPedMonMerge(pm, id, chan, nb, ref, sum, sumsq);
+    }
+
+  return n;
+}
+
+/**
+ *  @ingroup Status
+ *  @brief Add the pre-trigger samples of the raw windows in a decoded block
+ *         to a pedestal monitor.  Windows with invalid or overflow samples,
+ *         or with a pre-trigger sample above maxvalue, are skipped.
+ *  @param pm Pedestal monitor
+ *  @param data Buffer given to faDecodeBlock
+ *  @param hits Hits filled by faDecodeBlock
+ *  @param npre Number of samples at the start of each window to use
+ *  @param flags
+ *    - FA_DECODE_SWAP: Words are big-endian, as for faDecodeInit
+ *  @return Number of windows added, otherwise ERROR.
+ */
+int
+faPedMonAddHits(faPedMon *pm, const unsigned int *data, const faHits *hits,
+		int npre, unsigned int flags)
+{
+  short samples[FA_PEDMON_BATCH];
+  unsigned int inv, ovf;
+  int ih, ns, nwin = 0;
+
+  if((pm == NULL) || (data == NULL) || (hits == NULL) ||
+     (npre <= 0) || (npre > FA_PEDMON_BATCH))
+    return ERROR;
+
+  for(ih = 0; ih < hits->nhits; ih++)
+    {
+      if(!(hits->flags[ih] & FA_HIT_RAW))
+	continue;
+
+      ns = (hits->nsamples[ih] < npre) ? hits->nsamples[ih] : npre;
+      if(ns <= 0)
+	continue;
+
+      inv = ovf = 0;
+      faUnpackRawSamples(&data[hits->samples[ih]], (ns + 1) >> 1, samples,
+			 flags, &inv, &ovf);
+      if(inv || ovf)
+	{
+	  if(hits->slot[ih] <= FA_MAX_BOARDS)
+	    pm->nreject[hits->slot[ih]][hits->chan[ih] & 0xf]++;
+	  continue;
+	}
+
+      if(faPedMonAddSamples(pm, hits->slot[ih], hits->chan[ih] & 0xf,
+			    samples, ns) > 0)
+	nwin++;
+    }
+
+  return nwin;
+}
+
+/**
+ *  @ingroup Status
+ *  @brief Read the current sample of all channels of a module nreads times
+ *         (faReadAllChannelSamples) and add them to a pedestal monitor.
+ *         Only for use while the module is not taking data.
+ *  @param pm Pedestal monitor
+ *  @param id Slot number
+ *  @param nreads Number of reads of the 16 channels
+ *  @return Number of reads added, otherwise ERROR.
+ */
+int
+faPedMonSample(faPedMon *pm, int id, int nreads)
+{
+  unsigned int data[FA_MAX_ADC_CHANNELS/2];
+  int ref[FA_MAX_ADC_CHANNELS], sum[FA_MAX_ADC_CHANNELS];
+  unsigned int sumsq[FA_MAX_ADC_CHANNELS];
+  int vmax[FA_MAX_ADC_CHANNELS];
+  int v[FA_MAX_ADC_CHANNELS];
+  int ir, ib, nb, chan, d;
+
+  if(id==0) id=fadcID[0];
+
+  if((pm == NULL) || (id<=0) || (id>FA_MAX_BOARDS) || (FAp[id] == NULL))
+    {
+      logMsg("faPedMonSample: ERROR : ADC in slot %d is not initialized \n",id,0,0,0,0,0);
+      return(ERROR);
+    }
+
+  for(ib = 0; ib < nreads; ib += FA_PEDMON_BATCH)
+    {
+      nb = (nreads - ib < FA_PEDMON_BATCH) ? nreads - ib : FA_PEDMON_BATCH;
+      for(ir = 0; ir < nb; ir++)
+	{
+	  if(faReadAllChannelSamples(id, data) == ERROR)
+	    return ERROR;
+
+	  /* Even channels in the lower half */
+	  for(chan = 0; chan < FA_MAX_ADC_CHANNELS; chan++)
+	    v[chan] = (data[chan >> 1] >> ((chan & 1) << 4)) & 0xfff;
+
+	  if(ir == 0)
+	    for(chan = 0; chan < FA_MAX_ADC_CHANNELS; chan++)
+	      {
+		ref[chan] = v[chan];
+		sum[chan] = 0;
+		sumsq[chan] = 0;
+		vmax[chan] = 0;
+	      }
+
+	  for(chan = 0; chan < FA_MAX_ADC_CHANNELS; chan++)
+	    {
+	      d = v[chan] - ref[chan];
+	      sum[chan] += d;
+	      sumsq[chan] += d * d;
+	      vmax[chan] = (v[chan] > vmax[chan]) ? v[chan] : vmax[chan];
+	    }
+	}
+
+      for(chan = 0; chan < FA_MAX_ADC_CHANNELS; chan++)
+	{
+	  if(vmax[chan] > pm->maxvalue)
+	    pm->nreject[id][chan]++;
+	  else
+	    faPedMonMerge(pm, id, chan, nb, ref[chan], sum[chan], sumsq[chan]);
+	}
+    }
+
+  return nreads;
+}
+
+/**
+ *  @ingroup Status
+ *  @brief Get the statistics of a channel from a pedestal monitor.
+ *  @param pm Pedestal monitor
+ *  @param id Slot number
+ *  @param chan Channel number
+ *  @param mean If not NULL, filled with the mean sample value
+ *  @param var If not NULL, filled with the sample variance
+ *  @return Number of samples accumulated, otherwise ERROR.
+ */
+int
+faPedMonGet(faPedMon *pm, int id, int chan, double *mean, double *var)
+{
+  unsigned int n;
+
+  if((pm == NULL) || (id <= 0) || (id > FA_MAX_BOARDS) ||
+     (chan < 0) || (chan >= FA_MAX_ADC_CHANNELS))
+    return ERROR;
+
+  n = pm->n[id][chan];
+  if(mean)
+    *mean = pm->mean[id][chan];
+  if(var)
+    *var = (n > 1) ? pm->m2[id][chan] / (n - 1) : 0;
+
+  return n;
+}
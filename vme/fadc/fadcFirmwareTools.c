@@ -30,6 +30,9 @@ char          *MSC_filename_LX110 = "LX110_firmware.dat"; /* Default firmware fo
 char          *MSC_filename_FX70T = "FX70T_firmware.dat"; /* Default firmware for FX70T */
 int            MSC_loaded = 0;             /* 1(0) if firmware loaded (not loaded) */
 
+/* Percent done of the current SRAM download, verify or zero, by slot */
+static volatile int fadcFirmwarePercent[FA_MAX_BOARDS+1];
+
 /*************************************************************
  * fadcFirmwareLoad
  *   - main routine to load up firmware for FADC with specific id
@@ -62,9 +65,9 @@ fadcFirmwareLoad(int id, int chip, int pFlag)
     chip=FADC_FIRMWARE_LX110; 
 
   /* Perform a hardware and software reset */
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&FAp[id]->reset, 0xFFFF);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
   taskDelay(60);
 
   /* Check if FADC is Ready */
@@ -92,12 +95,12 @@ fadcFirmwareLoad(int id, int chip, int pFlag)
   taskDelay(1);
   printf("%s: Loading PROM with SRAM data \n",__FUNCTION__);
 
-  FALOCK;
+  FASLOTLOCK(id);
   if(chip==FADC_FIRMWARE_LX110)
     vmeWrite32(&FAp[id]->prom_reg1,FA_PROMREG1_SRAM_TO_PROM1);
   else if(chip==FADC_FIRMWARE_FX70T)
     vmeWrite32(&FAp[id]->prom_reg1,FA_PROMREG1_SRAM_TO_PROM2);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
   taskDelay(1);
 
   if(fadcFirmwareTestReady(id, 60000, pFlag) != OK) /* Wait til it's done */
@@ -112,12 +115,12 @@ fadcFirmwareLoad(int id, int chip, int pFlag)
 
   fadcFirmwareZeroSRAM(id);
 
-  FALOCK;
+  FASLOTLOCK(id);
   if(chip==FADC_FIRMWARE_LX110)
     vmeWrite32(&FAp[id]->prom_reg1,FA_PROMREG1_PROM1_TO_SRAM);
   else if(chip==FADC_FIRMWARE_FX70T)
     vmeWrite32(&FAp[id]->prom_reg1,FA_PROMREG1_PROM2_TO_SRAM);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
   taskDelay(1);
 
   if(fadcFirmwareTestReady(id, 60000, pFlag) != OK) /* Wait til it's done */
@@ -138,12 +141,12 @@ fadcFirmwareLoad(int id, int chip, int pFlag)
     
   /* PROM to FPGA (Reboot FPGA) */
   printf("%s: Rebooting FPGA \n",__FUNCTION__);
-  FALOCK;
+  FASLOTLOCK(id);
   if(chip==FADC_FIRMWARE_LX110)
     vmeWrite32(&FAp[id]->prom_reg1,FA_PROMREG1_REBOOT_FPGA1);
   else if(chip==FADC_FIRMWARE_FX70T)
     vmeWrite32(&FAp[id]->prom_reg1,FA_PROMREG1_REBOOT_FPGA2);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
   taskDelay(1);
 		      
   if(fadcFirmwareTestReady(id, 60000, pFlag) != OK) /* Wait til it's done */
@@ -218,7 +221,9 @@ fadcFirmwareGLoad(int chip, int pFlag)
       else
 	{
 	  passed[id] = 1;
+	  FASLOTLOCK(id);
 	  vmeWrite32(&FAp[id]->reset, 0xFFFF);
+	  FASLOTUNLOCK(id);
 	}
     }
   FAUNLOCK;
@@ -273,10 +278,12 @@ fadcFirmwareGLoad(int chip, int pFlag)
       id = fadcID[ifadc];
       if(passed[id]) /* Skip the ones that have previously failed */
 	{
+	  FASLOTLOCK(id);
 	  if(chip==FADC_FIRMWARE_LX110)
 	    vmeWrite32(&FAp[id]->prom_reg1,FA_PROMREG1_SRAM_TO_PROM1);
 	  else if(chip==FADC_FIRMWARE_FX70T)
 	    vmeWrite32(&FAp[id]->prom_reg1,FA_PROMREG1_SRAM_TO_PROM2);
+	  FASLOTUNLOCK(id);
 	}
     }
   FAUNLOCK;
@@ -306,12 +313,12 @@ fadcFirmwareGLoad(int chip, int pFlag)
       if(passed[id]) /* Skip the ones that have previously failed */
 	{
 	  fadcFirmwareZeroSRAM(id);
-	  FALOCK;
+	  FASLOTLOCK(id);
 	  if(chip==FADC_FIRMWARE_LX110)
 	    vmeWrite32(&FAp[id]->prom_reg1,FA_PROMREG1_PROM1_TO_SRAM);
 	  else if(chip==FADC_FIRMWARE_FX70T)
 	    vmeWrite32(&FAp[id]->prom_reg1,FA_PROMREG1_PROM2_TO_SRAM);
-	  FAUNLOCK;
+	  FASLOTUNLOCK(id);
 	}
     }
 
@@ -362,12 +369,12 @@ fadcFirmwareGLoad(int chip, int pFlag)
       id = fadcID[ifadc];
       if(passed[id]) /* Skip the ones that have previously failed */
 	{
-	  FALOCK;
+	  FASLOTLOCK(id);
 	  if(chip==FADC_FIRMWARE_LX110)
 	    vmeWrite32(&FAp[id]->prom_reg1,FA_PROMREG1_REBOOT_FPGA1);
 	  else if(chip==FADC_FIRMWARE_FX70T)
 	    vmeWrite32(&FAp[id]->prom_reg1,FA_PROMREG1_REBOOT_FPGA2);
-	  FAUNLOCK;
+	  FASLOTUNLOCK(id);
 	}
     }
   taskDelay(1);
@@ -406,6 +413,281 @@ fadcFirmwareGLoad(int chip, int pFlag)
 
 }
 
+/*************************************************************
+ * fadcFirmwarePLoad
+ *   - load up firmware for all initialized modules, each module
+ *     running the steps of fadcFirmwareLoad on its own thread.
+ *     The SRAM transfers (download, zero, verify) take the VME bus
+ *     one module at a time, so the first module starts its PROM
+ *     write as soon as its own download is verified, and the PROM
+ *     write and readback waits of each module overlap the SRAM
+ *     transfers of the others, instead of every step waiting for
+ *     the slowest module as in fadcFirmwareGLoad.  Steps are numbered
+ *     as in fadcFirmwareGLoad (fadcFirmwarePassedMask).
+ *
+ *   - pFlag: print the progress of each module every second,
+ *            otherwise when a module changes step and every 10s
+ *
+ *  NOTE: Make call to 
+ *     fadcFirmwareSetFilename(...);
+ *   if not using firmware from the default
+ */
+
+#ifndef VXWORKS
+#define FA_FW_NSTEPS 7
+
+static const char *fadcFirmwareStepName[FA_FW_NSTEPS+1] =
+  {
+    "reset", "ready", "SRAM load", "PROM write", "PROM read", "verify",
+    "reboot", "done"
+  };
+
+static int fadcFirmwareChip;
+static volatile int fadcFirmwareStep[FA_MAX_BOARDS+1];
+static volatile int fadcFirmwareRunning[FA_MAX_BOARDS+1];
+/* Held for the SRAM transfers: sharing the bus between modules would
+   only delay the PROM write of all of them */
+static pthread_mutex_t fadcFirmwareBusMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* fadcFirmwareTestReady, without the printout */
+static int
+fadcFirmwareWaitReady(int id, int n_try)
+{
+  int ii, value;
+
+  for(ii = 0; ii < n_try; ii++)
+    {
+      taskDelay(1);
+      FASLOTLOCK(id);
+      value = vmeRead32(&FAp[id]->prom_reg1);
+      FASLOTUNLOCK(id);
+      if(value & FA_PROMREG1_READY)
+	return OK;
+    }
+
+  return ERROR;
+}
+
+static void
+fadcFirmwarePromCmd(int id, int chip, unsigned int lx110, unsigned int fx70t)
+{
+  FASLOTLOCK(id);
+  if(chip==FADC_FIRMWARE_LX110)
+    vmeWrite32(&FAp[id]->prom_reg1,lx110);
+  else if(chip==FADC_FIRMWARE_FX70T)
+    vmeWrite32(&FAp[id]->prom_reg1,fx70t);
+  FASLOTUNLOCK(id);
+}
+
+static void *
+fadcFirmwareWorker(void *arg)
+{
+  int id = (int)(long)arg, chip = fadcFirmwareChip, rval = OK;
+
+  /* Perform a hardware and software reset */
+  fadcFirmwareStep[id] = 0;
+  FASLOTLOCK(id);
+  vmeWrite32(&FAp[id]->reset, 0xFFFF);
+  FASLOTUNLOCK(id);
+  taskDelay(60);
+
+  /* Check if FADC is Ready */
+  fadcFirmwareStep[id] = 1;
+  rval = fadcFirmwareWaitReady(id, 60);
+
+  /* Data to SRAM */
+  if(rval == OK)
+    {
+      fadcFirmwareStep[id] = 2;
+      fadcFirmwarePercent[id] = 0;
+      pthread_mutex_lock(&fadcFirmwareBusMutex);
+      fadcFirmwareDownloadConfigData(id);
+      rval = fadcFirmwareVerifyDownload(id);
+      pthread_mutex_unlock(&fadcFirmwareBusMutex);
+    }
+
+  /* SRAM TO PROM */
+  if(rval == OK)
+    {
+      fadcFirmwareStep[id] = 3;
+      fadcFirmwarePromCmd(id, chip, FA_PROMREG1_SRAM_TO_PROM1, FA_PROMREG1_SRAM_TO_PROM2);
+      taskDelay(1);
+      rval = fadcFirmwareWaitReady(id, 60000);
+    }
+
+  /* PROM TO SRAM (For verification) */
+  if(rval == OK)
+    {
+      fadcFirmwareStep[id] = 4;
+      fadcFirmwarePercent[id] = 0;
+      pthread_mutex_lock(&fadcFirmwareBusMutex);
+      fadcFirmwareZeroSRAM(id);
+      pthread_mutex_unlock(&fadcFirmwareBusMutex);
+      fadcFirmwarePromCmd(id, chip, FA_PROMREG1_PROM1_TO_SRAM, FA_PROMREG1_PROM2_TO_SRAM);
+      taskDelay(1);
+      rval = fadcFirmwareWaitReady(id, 60000);
+    }
+
+  /* Compare SRAM to Data Array */
+  if(rval == OK)
+    {
+      fadcFirmwareStep[id] = 5;
+      fadcFirmwarePercent[id] = 0;
+      pthread_mutex_lock(&fadcFirmwareBusMutex);
+      rval = fadcFirmwareVerifyDownload(id);
+      pthread_mutex_unlock(&fadcFirmwareBusMutex);
+    }
+
+  /* PROM to FPGA (Reboot FPGA) */
+  if(rval == OK)
+    {
+      fadcFirmwareStep[id] = 6;
+      fadcFirmwarePromCmd(id, chip, FA_PROMREG1_REBOOT_FPGA1, FA_PROMREG1_REBOOT_FPGA2);
+      taskDelay(1);
+      rval = fadcFirmwareWaitReady(id, 60000);
+    }
+
+  if(rval == OK)
+    {
+      passed[id] = 1;
+      fadcFirmwareStep[id] = FA_FW_NSTEPS;
+    }
+  else
+    {
+      passed[id] = 0;
+      stepfail[id] = fadcFirmwareStep[id];
+    }
+  fadcFirmwareRunning[id] = 0;
+
+  return NULL;
+}
+
+static void
+fadcFirmwarePrintProgress(int elapsed)
+{
+  int ifadc, id, step;
+
+  printf("%4ds:", elapsed);
+  for(ifadc=0; ifadc<nfadc; ifadc++)
+    {
+      id = fadcID[ifadc];
+      step = fadcFirmwareStep[id];
+      if(!fadcFirmwareRunning[id] && !passed[id])
+	printf("  %2d FAILED", id);
+      else if((step == 2) || (step == 4) || (step == 5))
+	printf("  %2d %s %d%%", id, fadcFirmwareStepName[step],
+	       fadcFirmwarePercent[id]);
+      else
+	printf("  %2d %s", id, fadcFirmwareStepName[step]);
+    }
+  printf("\n");
+  fflush(stdout);
+}
+#endif
+
+int
+fadcFirmwarePLoad(int chip, int pFlag)
+{
+#ifdef VXWORKS
+  return fadcFirmwareGLoad(chip, pFlag);
+#else
+  pthread_t worker[FA_MAX_BOARDS+1];
+  int lastStep[FA_MAX_BOARDS+1], started[FA_MAX_BOARDS+1];
+  int ifadc, id, nrun, changed, elapsed = 0, nfail = 0;
+
+  if(chip<0 || chip>2)
+    {
+      printf("%s: ERROR:  Invalid chip parameter %d\n",
+	     __FUNCTION__,chip);
+      return ERROR;
+    }
+
+  if(chip==2) /* Fix for discrepancy between Linux and vxWorks implementation */
+    chip=FADC_FIRMWARE_LX110; 
+
+  if(MSC_loaded != 1)
+    {
+      printf("%s: ERROR : Firmware was not loaded\n",
+	     __FUNCTION__);
+      return ERROR;
+    }
+
+  fadcFirmwareChip = chip;
+  printf("%s: Programming %d FADC(s)\n", __FUNCTION__, nfadc);
+
+  for(ifadc=0 ; ifadc<nfadc; ifadc++)
+    {
+      id = fadcID[ifadc];
+      passed[id] = 0;
+      stepfail[id] = 0;
+      lastStep[id] = -1;
+      fadcFirmwareStep[id] = 0;
+      fadcFirmwarePercent[id] = 0;
+      fadcFirmwareRunning[id] = 0;
+      started[id] = 0;
+      if((id<=0) || (id>21) || (FAp[id] == NULL)) 
+	{
+	  printf("%s: ERROR : ADC in slot %d is not initialized \n",
+		 __FUNCTION__,id);
+	  continue;
+	}
+
+      fadcFirmwareRunning[id] = 1;
+      if(pthread_create(&worker[id], NULL, fadcFirmwareWorker, (void *)(long)id) != 0)
+	{
+	  printf("%s: ERROR: Unable to start the thread for FADC %2d\n",
+		 __FUNCTION__,id);
+	  fadcFirmwareRunning[id] = 0;
+	}
+      else
+	started[id] = 1;
+    }
+
+  do
+    {
+      taskDelay(60);
+      elapsed++;
+
+      nrun = 0;
+      changed = 0;
+      for(ifadc=0 ; ifadc<nfadc; ifadc++)
+	{
+	  id = fadcID[ifadc];
+	  if(fadcFirmwareRunning[id])
+	    nrun++;
+	  if(fadcFirmwareStep[id] != lastStep[id])
+	    changed = 1;
+	  lastStep[id] = fadcFirmwareStep[id];
+	}
+
+      if(changed || pFlag || (elapsed % 10) == 0 || (nrun == 0))
+	fadcFirmwarePrintProgress(elapsed);
+    }
+  while(nrun > 0);
+
+  for(ifadc=0 ; ifadc<nfadc; ifadc++)
+    {  
+      id = fadcID[ifadc];
+      if(started[id])
+	pthread_join(worker[id], NULL);
+
+      if(passed[id])
+	{
+	  printf("%s: Done programming FADC %2d\n",
+		 __FUNCTION__,id);
+	}
+      else
+	{
+	  printf("%s: FAILED programming FADC %2d at step %d (%s)\n",
+		 __FUNCTION__,id,stepfail[id],fadcFirmwareStepName[stepfail[id]]);
+	  nfail++;
+	}
+    }
+
+  return (nfail > 0) ? ERROR : OK;
+#endif
+}
+
 void 
 fadcFirmwareDownloadConfigData(int id)
 {
@@ -428,10 +710,10 @@ fadcFirmwareDownloadConfigData(int id)
     
   /* write SRAM address register */
   /* start at 0 and increment address after write to mem1 data register */ 
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&FAp[id]->mem_adr, 0x80000000); 
   value = vmeRead32(&FAp[id]->mem_adr);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 #ifdef DEBUG
   printf("%s: FADC %2d memory address at start of writes = 0x%08x\n\n",
 	 __FUNCTION__,id,value);
@@ -451,15 +733,18 @@ fadcFirmwareDownloadConfigData(int id)
 	}
 	  
       /* write 32-bit data word to  mem1 data register */ 
-      FALOCK;
+      FASLOTLOCK(id);
       vmeWrite32(&FAp[id]->mem1_data, Word32Bits);
-      FAUNLOCK;
+      FASLOTUNLOCK(id);
+
+      if((ByteCount & 0xFFFF) == 0)
+	fadcFirmwarePercent[id] = (int)((100.*ByteCount)/ArraySize);
     }
 
 #ifdef DEBUG
-  FALOCK;
+  FASLOTLOCK(id);
   value = vmeRead32(&FAp[id]->mem_adr);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
   printf("%s: FADC %2d memory address after write = 0x%08x\n\n",
 	 __FUNCTION__,id,value);
 #endif
@@ -500,10 +785,10 @@ fadcFirmwareVerifyDownload (int id)
     
   /* write SRAM address register */
   /* start at 0 and increment address after read from mem1 data register */ 
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&FAp[id]->mem_adr, 0x0000 | FA_MEM_ADR_INCR_MEM1);
   value = vmeRead32(&FAp[id]->mem_adr);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 #ifdef DEBUG
   printf("%s: FADC %2d memory address at start of read = 0x%08x\n\n",
 	 __FUNCTION__,id,value);
@@ -521,9 +806,12 @@ fadcFirmwareVerifyDownload (int id)
 	}
 	
       /* read 32-bit data word from mem1 data register */ 
-      FALOCK;
+      FASLOTLOCK(id);
       RdWord32Bits = (unsigned int)vmeRead32(&FAp[id]->mem1_data);
-      FAUNLOCK;
+      FASLOTUNLOCK(id);
+
+      if((ByteCount & 0xFFFF) == 0)
+	fadcFirmwarePercent[id] = (int)((100.*ByteCount)/ArraySize);
 
 #ifdef DEBUG
       if(ByteCount<40)
@@ -550,9 +838,9 @@ fadcFirmwareVerifyDownload (int id)
 	}
     }
     
-  FALOCK;
+  FASLOTLOCK(id);
   value = vmeRead32(&FAp[id]->mem_adr);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 #ifdef DEBUG
   printf("%s: memory address after read = 0x%08x\n\n",
 	 __FUNCTION__,value);
@@ -593,9 +881,9 @@ fadcFirmwareTestReady(int id, int n_try, int pFlag)
 	fflush(stdout);
       }
       taskDelay(1);		/* wait */
-      FALOCK;
+      FASLOTLOCK(id);
       value = vmeRead32(&FAp[id]->prom_reg1);
-      FAUNLOCK;
+      FASLOTUNLOCK(id);
       if( value & FA_PROMREG1_READY )	/* bit 31 asserted means ready */
 	{
 	  result = OK;
@@ -633,34 +921,38 @@ fadcFirmwareZeroSRAM (int id)
     }
 
   /* set address = 0; allow increment on mem2 access */
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&FAp[id]->mem_adr, 0x0000 | FA_MEM_ADR_INCR_MEM2);    	
    		    
   for( ii = 0; ii < 0x80000; ii++) 	/* write ZERO to entire memory */
     {
       vmeWrite32(&FAp[id]->mem1_data, 0);
       vmeWrite32(&FAp[id]->mem2_data, 0);
+      if((ii & 0x3FFF) == 0)
+	fadcFirmwarePercent[id] = (ii*100)/(2*0x80000);
     }	    		
 		    
   /* reset address = 0; allow increment on mem2 access */
   vmeWrite32(&FAp[id]->mem_adr, 0x0000 | FA_MEM_ADR_INCR_MEM2);
      		    
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   /* read and test expected memory data */	    
   for( ii = 0; ii < 0x80000; ii++) 	
     {
-      FALOCK;
+      FASLOTLOCK(id);
       value_1 = vmeRead32(&FAp[id]->mem1_data);
       value_2 = vmeRead32(&FAp[id]->mem2_data);
-      FAUNLOCK;
+      FASLOTUNLOCK(id);
+      if((ii & 0x3FFF) == 0)
+	fadcFirmwarePercent[id] = 50 + (ii*100)/(2*0x80000);
 	    	    	
       if( (value_1 != 0) || (value_2 != 0) )
 	{
 	  ErrorCount++;
-	  FALOCK;
+	  FASLOTLOCK(id);
 	  value = vmeRead32(&FAp[id]->mem_adr) & 0xFFFFF;	    	    	    
-	  FAUNLOCK;
+	  FASLOTUNLOCK(id);
 	  if(!stopPrint)
 	    {
 	      printf("%s: ERROR: FADC %2d  address = %8X    mem1 read = %8X    mem2 read = %8X\n",
@@ -26,7 +26,9 @@
 #include "jvme.h"
 #endif
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #ifdef VXWORKS
 #include <logLib.h>
 #include <taskLib.h>
@@ -41,17 +43,63 @@
 /* Include ADC definitions */
 #include "fadcLib.h"
 
+/* Lock usage counters, indexed as faLock: 0 = crate lock, 1-21 = slot */
+#define FA_NLOCKS (FA_MAX_BOARDS+2)
+unsigned int faLockCount[FA_NLOCKS];      /* Times the lock was taken */
+unsigned int faLockContention[FA_NLOCKS]; /* Times it was already held */
+
 #ifdef VXWORKS
 #define FALOCK
 #define FAUNLOCK
+#define FASLOTLOCK(x)
+#define FASLOTUNLOCK(x)
 #define FASDCLOCK
 #define FASDCUNLOCK
 #else
-/* Mutex to guard flexio read/writes */
+/* Mutexes to guard register read/writes
+ *   faMutex             : Crate lock.  DMA engine, multiblock token chain
+ *                         and library state shared by all modules.
+ *   faSlotMutex[slot]   : Registers of the module in that slot.
+ * Take the crate lock before any slot lock, never the other way around.
+ * faMutex keeps its name and type: programs linked with the library
+ * (fadcLib_extensions.c) define and lock it as the crate lock.
+ */
 pthread_mutex_t   faMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t faSlotMutex[FA_NLOCKS] =
+  { [0 ... FA_NLOCKS-1] = PTHREAD_MUTEX_INITIALIZER };
 pthread_mutex_t   fasdcMutex = PTHREAD_MUTEX_INITIALIZER;
-#define FALOCK      if(pthread_mutex_lock(&faMutex)<0) perror("pthread_mutex_lock");
-#define FAUNLOCK    if(pthread_mutex_unlock(&faMutex)<0) perror("pthread_mutex_unlock");
+
+static pthread_mutex_t *
+faLockMutex(int lock)
+{
+  return (lock == 0) ? &faMutex : &faSlotMutex[lock];
+}
+
+static void
+faLock(int lock)
+{
+  if((lock<0) || (lock>=FA_NLOCKS)) lock = 0;
+
+  if(pthread_mutex_trylock(faLockMutex(lock)) != 0)
+    {
+      if(pthread_mutex_lock(faLockMutex(lock)) != 0) perror("pthread_mutex_lock");
+      faLockContention[lock]++;
+    }
+  faLockCount[lock]++;
+}
+
+static void
+faUnlock(int lock)
+{
+  if((lock<0) || (lock>=FA_NLOCKS)) lock = 0;
+
+  if(pthread_mutex_unlock(faLockMutex(lock)) != 0) perror("pthread_mutex_unlock");
+}
+
+#define FALOCK          faLock(0)
+#define FAUNLOCK        faUnlock(0)
+#define FASLOTLOCK(x)   faLock(x)
+#define FASLOTUNLOCK(x) faUnlock(x)
 #define FASDCLOCK   if(pthread_mutex_lock(&fasdcMutex)<0) perror("pthread_mutex_lock");
 #define FASDCUNLOCK if(pthread_mutex_unlock(&fasdcMutex)<0) perror("pthread_mutex_unlock");
 #endif
@@ -103,12 +151,135 @@ struct fadc_data_struct fadc_data;
 int fadcBlockError=FA_BLOCKERROR_NO_ERROR; /* Whether (>0) or not (0) Block Transfer had an error */
 int fadcAlignmentDebug=0;                            /* Flag to send alignment sequence to CTP */
 
+/* Asynchronous block readout (faReadBlockStart/faReadBlockWait) */
+volatile UINT32 *fadcDmaBuf[FA_MAX_DMA_BUFFERS];     /* Registered DMA target buffers */
+int fadcDmaBufState[FA_MAX_DMA_BUFFERS];             /* FA_DMABUF_FREE, _BUSY or _FULL */
+int fadcDmaNbuf=0;                                   /* Number of registered buffers */
+int fadcDmaBufWords=0;                               /* Size of each buffer in words */
+int fadcDmaNext=0;                                   /* Next buffer to transfer into */
+int fadcDmaBusy=-1;                                  /* Buffer with a transfer in progress */
+int fadcDmaId=0, fadcDmaRmode=0;                     /* Slot and mode of the transfer in progress */
+
+/* Register shadow (faSetShadowMode), indexed by slot and register word */
+#define FA_SHADOW_NWORDS (sizeof(struct fadc_struct)>>2)
+int fadcShadowMode=FA_SHADOW_DISABLE;                /* FA_SHADOW_DISABLE, _ENABLE or _VERIFY */
+unsigned int  fadcShadow[(FA_MAX_BOARDS+2)][FA_SHADOW_NWORDS];      /* Last value written */
+unsigned char fadcShadowValid[(FA_MAX_BOARDS+2)][FA_SHADOW_NWORDS]; /* >0 if fadcShadow is current */
+
+/* Batched register writes (faTransBegin/faTransCommit) */
+int fadcTransOpen=0;                                 /* >0 while a transaction is being built */
+unsigned int  fadcTransVal[(FA_MAX_BOARDS+2)][FA_SHADOW_NWORDS];    /* Queued register value */
+unsigned char fadcTransQueued[(FA_MAX_BOARDS+2)][FA_SHADOW_NWORDS]; /* >0 if a write is queued */
+
+/* Write-through register shadow.
+ *   Only registers whose writes all go through faShadowWrite32 may be read
+ *   back with faShadowRead32/16: the 16 bit DAC and threshold pairs,
+ *   adc_config[0], adc_config[1] and adc_nsa.  Call with the slot lock held.
+ */
+static int
+faShadowIndex(int id, volatile void *reg)
+{
+  return (int)(((unsigned long)reg - (unsigned long)FAp[id])>>2);
+}
+
+static void
+faShadowWrite32(int id, volatile unsigned int *reg, unsigned int val)
+{
+  int iword = faShadowIndex(id, reg);
+
+  vmeWrite32(reg, val);
+  fadcShadow[id][iword] = val;
+  fadcShadowValid[id][iword] = 1;
+}
+
+static unsigned int
+faShadowRead32(int id, volatile unsigned int *reg)
+{
+  int iword = faShadowIndex(id, reg);
+  unsigned int val;
+
+  if(fadcShadowMode == FA_SHADOW_DISABLE)
+    return vmeRead32(reg);
+
+  if((fadcShadowMode == FA_SHADOW_ENABLE) && fadcShadowValid[id][iword])
+    return fadcShadow[id][iword];
+
+  val = vmeRead32(reg);
+  if((fadcShadowMode == FA_SHADOW_VERIFY) && fadcShadowValid[id][iword]
+     && (val != fadcShadow[id][iword]))
+    logMsg("faShadowRead32: ERROR: Slot %d register 0x%03x = 0x%08x, shadow = 0x%08x\n",
+	   id, iword<<2, val, fadcShadow[id][iword],5,6);
+
+  fadcShadow[id][iword] = val;
+  fadcShadowValid[id][iword] = 1;
+
+  return val;
+}
+
+static void
+faShadowClear(int id)
+{
+  memset(fadcShadowValid[id], 0, sizeof(fadcShadowValid[id]));
+}
+
+static unsigned short
+faShadowRead16(int id, volatile unsigned short *reg)
+{
+  int iword = faShadowIndex(id, reg);
+  int upper = ((((unsigned long)reg)&0x2)==0); /* Lower address holds bits 31-16 */
+  volatile unsigned short *pair = upper ? reg : (reg - 1);
+  unsigned int val;
+  unsigned short rval;
+
+  if(fadcShadowMode == FA_SHADOW_DISABLE)
+    return vmeRead16(reg);
+
+  if(fadcShadowMode == FA_SHADOW_ENABLE)
+    {
+      if(!fadcShadowValid[id][iword])
+	{
+	  val = (vmeRead16(&pair[0])<<16) | vmeRead16(&pair[1]);
+	  fadcShadow[id][iword] = val;
+	  fadcShadowValid[id][iword] = 1;
+	}
+      val = fadcShadow[id][iword];
+      return upper ? (val>>16) : (val&0xFFFF);
+    }
+
+  rval = vmeRead16(reg);
+  if(fadcShadowValid[id][iword])
+    {
+      val = fadcShadow[id][iword];
+      val = upper ? (val>>16) : (val&0xFFFF);
+      if(rval != val)
+	logMsg("faShadowRead16: ERROR: Slot %d register 0x%03x = 0x%04x, shadow = 0x%04x\n",
+	       id, (int)((unsigned long)reg - (unsigned long)FAp[id]), rval, val,5,6);
+    }
+
+  return rval;
+}
+
 /* Internal triggering tools */
 #include "faItrig.c"
 
 /* Include Firmware Tools */
 #include "fadcFirmwareTools.c"
 
+/* Discovery cache used by faInit */
+#include "faDiscoveryCache.c"
+
+/* Block decoder */
+#include "faDecode.c"
+
+/* Pedestal monitor */
+#include "faPedMon.c"
+
+/* Calibration store */
+#include "faCalibStore.c"
+
+/* Configuration file loader */
+#include "faConfigFile.c"
+
 /**
  * @defgroup Config Initialization/Configuration
  * @defgroup SDCConfig SDC Initialization/Configuration
@@ -179,6 +350,17 @@ int fadcAlignmentDebug=0;                            /* Flag to send alignment s
  *      bit 18:  Skip firmware check.  Useful for firmware updating.
  *             0 Perform firmware check
  *             1 Skip firmware check
+ *
+ *      bit 19:  Restore DAC values and thresholds from the calibration
+ *               store (faGCalibRestore) once the modules are found.
+ *             0 Leave DAC values and thresholds as they are
+ *             1 Restore them
+ *
+ *      bit 20:  Use the discovery cache (faDiscoveryCache.c) to find the
+ *               modules without probing every address.
+ *             0 Probe every address
+ *             1 Check and use the modules found by the last probe with
+ *               the same addr, addr_inc and nadc; probe if they differ
  * </pre>
  *      
  *
@@ -203,7 +385,9 @@ faInit(UINT32 addr, UINT32 addr_inc, int nadc, int iFlag)
     = {FA_SUPPORTED_PROC_FIRMWARE};
   unsigned short proc_version=0;
   int icheck=0, proc_supported=0;
+  int useCache=0, cached=0;
 
+  faCalibSerialClear();
 
   // Alex
   /* Check if we have already Initialized boards before */
@@ -234,6 +418,9 @@ faInit(UINT32 addr, UINT32 addr_inc, int nadc, int iFlag)
   /* Are we skipping the firmware check? */
   noFirmwareCheck=(iFlag&FA_INIT_SKIP_FIRMWARE_CHECK)>>18;
 
+  /* Use the modules of the last probe, if they are still there? */
+  useCache=((iFlag&FA_INIT_DISCOVERY_CACHE) && !useList);
+
   /* Check for valid address */
   if(addr==0) 
     {
@@ -273,9 +460,14 @@ faInit(UINT32 addr, UINT32 addr_inc, int nadc, int iFlag)
   fadcInited = nfadc = 0;
   fadcUseSDC = 0;
   bzero((char *)fadcChanDisable,sizeof(fadcChanDisable));
+  bzero((char *)fadcShadowValid,sizeof(fadcShadowValid));
   bzero((char *)fadcID,sizeof(fadcID));
 
-  for (ii=0;ii<nadc;ii++) 
+  if(useCache)
+    nfadc = cached = faDiscoveryRestore(addr, addr_inc, nadc, noFirmwareCheck,
+					&errFlag, &minSlot, &maxSlot);
+
+  for (ii=0;(ii<nadc) && !cached;ii++) 
     {
       if(useList==1)
 	{
@@ -401,6 +593,9 @@ faInit(UINT32 addr, UINT32 addr_inc, int nadc, int iFlag)
 	}
     }
 
+  if(useCache && !cached && (nfadc > 0))
+    faDiscoverySave(addr, addr_inc, nadc, noFirmwareCheck, errFlag);
+
 
 
   // Alex
@@ -765,6 +960,12 @@ faInit(UINT32 addr, UINT32 addr_inc, int nadc, int iFlag)
   if(!noBoardInit)
     fadcInited = nfadc;
 
+  if((iFlag & FA_INIT_CALIB_RESTORE) && (nfadc > 0))
+    {
+      ii = faGCalibRestore(FA_CALIB_DAC | FA_CALIB_THR);
+      printf("faInit: Restored %d channel(s) from the calibration store\n", ii);
+    }
+
   if(errFlag > 0) 
     {
       printf("faInit: WARN: Unable to initialize all requested FADC Modules (%d)\n",
@@ -926,6 +1127,119 @@ faSetClockSource(int id, int clkSrc)
   return OK;
 }
 
+/* Registers copied by faSnapshot: section (FA_SNAPSHOT_*), byte offset,
+   number of 32 bit words, and >0 if the words hold pairs of 16 bit
+   registers.  Only registers without read side effects that are decoded
+   by faStatus, faGStatus or a readout list BOR record are listed, and each
+   caller asks for the sections it decodes: faGStatus reads what it did
+   before the snapshot, no more.  The A24 registers answer single cycles
+   only, so each word is one VME read. */
+static const struct
+{
+  unsigned short section;
+  unsigned short offset;
+  unsigned short nwords;
+  unsigned short pairs;
+} faSnapshotMap[] =
+  {
+    {FA_SNAPSHOT_STATUS,   0x000,  5, 0},   /* version - blk_level */
+    {FA_SNAPSHOT_DETAIL,   0x014,  1, 0},   /* intr */
+    {FA_SNAPSHOT_STATUS,   0x018,  2, 0},   /* adr32, adr_mb */
+    {FA_SNAPSHOT_CONFIG,   0x024,  2, 0},   /* delay, itrig_cfg */
+    {FA_SNAPSHOT_STATUS,   0x030,  1, 0},   /* trig_scal */
+    {FA_SNAPSHOT_DETAIL,   0x034,  1, 0},   /* ev_count */
+    {FA_SNAPSHOT_STATUS,   0x038,  1, 0},   /* blk_count */
+    {FA_SNAPSHOT_DETAIL,   0x044,  1, 0},   /* internal_trig_scal */
+    {FA_SNAPSHOT_STATUS,   0x048,  1, 0},   /* ram_word_count */
+    {FA_SNAPSHOT_DAC,      0x050,  8, 1},   /* dac[16] */
+    {FA_SNAPSHOT_DETAIL,   0x084,  1, 0},   /* trigger_control */
+    {FA_SNAPSHOT_CONFIG,   0x088,  1, 0},   /* trig21_delay */
+    {FA_SNAPSHOT_STATUS,   0x0A0,  1, 0},   /* berr_module_scal */
+    {FA_SNAPSHOT_STATUS,   0x0AC,  1, 0},   /* lost_trig_scal */
+    {FA_SNAPSHOT_STATUS,   0x0B4,  1, 0},   /* trig2_scal */
+    {FA_SNAPSHOT_STATUS,   0x0BC,  1, 0},   /* syncreset_scal */
+    {FA_SNAPSHOT_STATUS,   0x0D0,  1, 0},   /* mgt_status */
+    {FA_SNAPSHOT_CONFIG,   0x0E4,  3, 0},   /* serial_number[3] */
+    {FA_SNAPSHOT_DETAIL,   0x0F0,  1, 0},   /* scaler_interval */
+    {FA_SNAPSHOT_STATUS,   0x100,  6, 0},   /* adc_status[3], adc_config[0-2] */
+    {FA_SNAPSHOT_CONFIG,   0x118,  1, 0},   /* adc_config[3] */
+    {FA_SNAPSHOT_STATUS,   0x11C,  4, 0},   /* adc_ptw - adc_nsa */
+    {FA_SNAPSHOT_THRES,    0x12C,  8, 1},   /* adc_thres[16] */
+    {FA_SNAPSHOT_STATUS,   0x14C,  2, 0},   /* config6, config7 */
+    {FA_SNAPSHOT_PEDESTAL, 0x158, 16, 0},   /* adc_pedestal[16] */
+    {FA_SNAPSHOT_STATUS,   0x198,  1, 0},   /* config3 */
+  };
+#define FA_SNAPSHOT_NRANGES (sizeof(faSnapshotMap)/sizeof(faSnapshotMap[0]))
+
+/**
+ *  @ingroup Status
+ *  @brief Copy the configuration and status registers of the module into
+ *    a register image in memory
+ *
+ *    The registers of the requested sections are read in one pass, with
+ *    the module lock held, and 16 bit register arrays (DAC, thresholds)
+ *    are read as 32 bit pairs.  Registers that are not copied read back
+ *    as 0 in the image.
+ *
+ *  @param id Slot number
+ *  @param image Where to copy the registers
+ *  @param smask Mask of sections to copy
+ *     - FA_SNAPSHOT_STATUS   Registers shown by faStatus and faGStatus
+ *     - FA_SNAPSHOT_DETAIL   Registers shown by faStatus only
+ *     - FA_SNAPSHOT_CONFIG   Remaining BOR registers (delays, serial number)
+ *     - FA_SNAPSHOT_DAC      DAC values
+ *     - FA_SNAPSHOT_THRES    Channel thresholds
+ *     - FA_SNAPSHOT_PEDESTAL Channel pedestals
+ *     - FA_SNAPSHOT_ALL      All of the above
+ *  @return Number of VME reads made, otherwise ERROR.
+ */
+int
+faSnapshot(int id, struct fadc_struct *image, int smask)
+{
+  int irange, iword, iend, nread=0;
+  unsigned int val;
+  unsigned int *dest = (unsigned int *)image;
+
+  if(id==0) id=fadcID[0];
+
+  if((id<=0) || (id>21) || (FAp[id] == NULL)) 
+    {
+      logMsg("faSnapshot: ERROR : ADC in slot %d is not initialized \n",id,0,0,0,0,0);
+      return ERROR;
+    }
+
+  if(image == NULL)
+    {
+      logMsg("faSnapshot: ERROR: Invalid image address\n",1,2,3,4,5,6);
+      return ERROR;
+    }
+
+  memset(image, 0, sizeof(struct fadc_struct));
+
+  FASLOTLOCK(id);
+  for(irange=0; irange<FA_SNAPSHOT_NRANGES; irange++)
+    {
+      if((faSnapshotMap[irange].section & smask) == 0)
+	continue;
+
+      iword = faSnapshotMap[irange].offset>>2;
+      for(iend = iword + faSnapshotMap[irange].nwords; iword<iend; iword++)
+	{
+	  val = vmeRead32((volatile unsigned int *)FAp[id] + iword);
+#ifndef VXWORKS
+	  /* The lower address holds bits 31-16: put it first in memory */
+	  if(faSnapshotMap[irange].pairs)
+	    val = (val<<16) | (val>>16);
+#endif
+	  dest[iword] = val;
+	  nread++;
+	}
+    }
+  FASLOTUNLOCK(id);
+
+  return nread;
+}
+
 /**
  *  @ingroup Status
  *  @brief Print Status of fADC250 to standard out
@@ -956,6 +1270,7 @@ faStatus(int id, int sflag)
   unsigned int MNPED, MMAXPED;
 
   unsigned int adc_proc = 0;
+  struct fadc_struct st;
 
 
   if(id==0) id=fadcID[0];
@@ -967,44 +1282,45 @@ faStatus(int id, int sflag)
       return;
     }
 
-  FALOCK;
-  vers   =  vmeRead32(&FAp[id]->version);
+  faSnapshot(id, &st, FA_SNAPSHOT_STATUS | FA_SNAPSHOT_DETAIL);
+
+  vers   =  st.version;
   bid    = ((vers)&FA_BOARD_MASK)>>16;
   brev   = (vers)&FA_VERSION_MASK;
 
-  csr    = (vmeRead32(&(FAp[id]->csr)))&FA_CSR_MASK;
-  ctrl1  = (vmeRead32(&(FAp[id]->ctrl1)))&FA_CONTROL_MASK;
-  ctrl2  = (vmeRead32(&(FAp[id]->ctrl2)))&FA_CONTROL2_MASK;
-  count  = (vmeRead32(&(FAp[id]->ev_count)))&FA_EVENT_COUNT_MASK;
-  bcount = (vmeRead32(&(FAp[id]->blk_count)))&FA_BLOCK_COUNT_MASK;
-  blevel  = (vmeRead32(&(FAp[id]->blk_level)))&FA_BLOCK_LEVEL_MASK;
-  ramWords = (vmeRead32(&(FAp[id]->ram_word_count)))&FA_RAM_DATA_MASK;
-  itrigCnt = vmeRead32(&FAp[id]->internal_trig_scal);
-  trigCnt = vmeRead32(&(FAp[id]->trig_scal));
-  trig2Cnt = vmeRead32(&FAp[id]->trig2_scal);
-  srCnt = vmeRead32(&FAp[id]->syncreset_scal);
-  intr   = vmeRead32(&(FAp[id]->intr));
-  addr32 = vmeRead32(&(FAp[id]->adr32));
+  csr    = st.csr&FA_CSR_MASK;
+  ctrl1  = st.ctrl1&FA_CONTROL_MASK;
+  ctrl2  = st.ctrl2&FA_CONTROL2_MASK;
+  count  = st.ev_count&FA_EVENT_COUNT_MASK;
+  bcount = st.blk_count&FA_BLOCK_COUNT_MASK;
+  blevel  = st.blk_level&FA_BLOCK_LEVEL_MASK;
+  ramWords = st.ram_word_count&FA_RAM_DATA_MASK;
+  itrigCnt = st.internal_trig_scal;
+  trigCnt = st.trig_scal;
+  trig2Cnt = st.trig2_scal;
+  srCnt = st.syncreset_scal;
+  intr   = st.intr;
+  addr32 = st.adr32;
   a32Base = (addr32&FA_A32_ADDR_MASK)<<16;
-  addrMB = vmeRead32(&(FAp[id]->adr_mb));
+  addrMB = st.adr_mb;
   ambMin =  (addrMB&FA_AMB_MIN_MASK)<<16;
   ambMax =  (addrMB&FA_AMB_MAX_MASK);
-  berr_count = vmeRead32(&(FAp[id]->berr_module_scal));
+  berr_count = st.berr_module_scal;
 
   for(ii=0;ii<3;ii++) 
     {
-      adcStat[ii] = (vmeRead32(&(FAp[id]->adc_status[ii]))&0xFFFF);
-      adcConf[ii] = (vmeRead32(&(FAp[id]->adc_config[ii]))&0xFFFF);
+      adcStat[ii] = (st.adc_status[ii]&0xFFFF);
+      adcConf[ii] = (st.adc_config[ii]&0xFFFF);
     }    
 
   //printf(" ----------------------   SASCHA 11111  =  0x%X \n", vmeRead32(&FAp[id]->adc_config[0]));
 
 
 
-  PTW =  ((vmeRead32(&(FAp[id]->adc_ptw))&0xFFFF) + 1)*FA_ADC_NS_PER_CLK;
-  PL  =  (vmeRead32(&(FAp[id]->adc_pl))&0xFFFF)*FA_ADC_NS_PER_CLK;
-  nsb_reg =  (vmeRead32(&(FAp[id]->adc_nsb))&0xFFFF);
-  nsa_reg =  (vmeRead32(&(FAp[id]->adc_nsa))&0xFFFF);
+  PTW =  ((st.adc_ptw&0xFFFF) + 1)*FA_ADC_NS_PER_CLK;
+  PL  =  (st.adc_pl&0xFFFF)*FA_ADC_NS_PER_CLK;
+  nsb_reg =  (st.adc_nsb&0xFFFF);
+  nsa_reg =  (st.adc_nsa&0xFFFF);
   NSB =  (nsb_reg&FA_ADC_NSB_READBACK_MASK)*FA_ADC_NS_PER_CLK;
   NSA =  (nsa_reg&FA_ADC_NSA_READBACK_MASK)*FA_ADC_NS_PER_CLK;
   NSA_tp =  ((nsa_reg&FA_ADC_TNSA_MASK)>>9)*FA_ADC_NS_PER_CLK;
@@ -1026,22 +1342,21 @@ faStatus(int id, int sflag)
   adc_enabled = (adcConf[0]&FA_ADC_PROC_ENABLE);
   playbackMode = (adcConf[0]&FA_ADC_PLAYBACK_MODE)>>7;
   adcChanDisabled = (adcConf[1]&FA_ADC_CHAN_MASK);
-  threshold_tp = vmeRead32(&FAp[id]->config3)&FA_ADC_TPT_MASK;
-  NPED = (vmeRead32(&FAp[id]->config7) & FA_ADC_CONFIG7_NPED_MASK)>>10;
-  MAXPED = vmeRead32(&FAp[id]->config7) & FA_ADC_CONFIG7_MAXPED_MASK;
+  threshold_tp = st.config3&FA_ADC_TPT_MASK;
+  NPED = (st.config7 & FA_ADC_CONFIG7_NPED_MASK)>>10;
+  MAXPED = st.config7 & FA_ADC_CONFIG7_MAXPED_MASK;
   NSAT = ( ((adcConf[0] & FA_ADC_CONFIG1_NSAT_MASK)>>10) + 1);
   
-  mgtStatus = vmeRead32(&(FAp[id]->mgt_status));
-  scaler_interval = vmeRead32(&FAp[id]->scaler_interval) & FA_SCALER_INTERVAL_MASK;
-  trigger_control = vmeRead32(&FAp[id]->trigger_control);
-  lost_trig_scal  = vmeRead32(&FAp[id]->lost_trig_scal);
+  mgtStatus = st.mgt_status;
+  scaler_interval = st.scaler_interval & FA_SCALER_INTERVAL_MASK;
+  trigger_control = st.trigger_control;
+  lost_trig_scal  = st.lost_trig_scal;
 
-  MNPED    =  ( ((vmeRead32(&FAp[id]->config6) & 0x3C00)>>10) + 1);
-  MMAXPED  =  (vmeRead32(&FAp[id]->config6) & 0x3FF);
+  MNPED    =  ( ((st.config6 & 0x3C00)>>10) + 1);
+  MMAXPED  =  (st.config6 & 0x3FF);
                
   
 
-  FAUNLOCK;
   ctrl_temp = faGetCtrlFPGATemp(id,0);
   proc_temp = faGetProcFPGATemp(id,0);
   core_volt = faGetCtrlFPGAVoltage(id,0,0);
@@ -1323,54 +1638,24 @@ faGStatus(int sflag)
 
   unsigned int adc_proc = 0;
 
-  FALOCK;
   for (ifa=0;ifa<nfadc;ifa++) 
     {
       id = faSlot(ifa);
       a24addr[id]    = (unsigned int)((unsigned long)FAp[id] - fadcA24Offset);
-      st[id].version = vmeRead32(&FAp[id]->version);
-      st[id].adr32   = vmeRead32(&FAp[id]->adr32);
-      st[id].adr_mb  = vmeRead32(&FAp[id]->adr_mb);
-
-      st[id].ctrl1   = vmeRead32(&FAp[id]->ctrl1);
-      st[id].ctrl2   = vmeRead32(&FAp[id]->ctrl2);
-
-      st[id].csr     = vmeRead32(&FAp[id]->csr);
-      
-      st[id].config6 =  vmeRead32(&FAp[id]->config6);
-
-      st[id].config7 =  vmeRead32(&FAp[id]->config7);
-
+      faSnapshot(id, &st[id], FA_SNAPSHOT_STATUS | FA_SNAPSHOT_PEDESTAL);
 
       for(ii=0;ii<3;ii++) 
 	{
-	  st[id].adc_status[ii] =  vmeRead32(&FAp[id]->adc_status[ii])&0xFFFF;
-	  st[id].adc_config[ii] =  vmeRead32(&FAp[id]->adc_config[ii])&0xFFFF;
+	  st[id].adc_status[ii] &= 0xFFFF;
+	  st[id].adc_config[ii] &= 0xFFFF;
 	}    
-      st[id].adc_ptw = vmeRead32(&FAp[id]->adc_ptw);
-      st[id].adc_pl  = vmeRead32(&FAp[id]->adc_pl);
-      st[id].adc_nsb = vmeRead32(&FAp[id]->adc_nsb);
-      st[id].adc_nsa = vmeRead32(&FAp[id]->adc_nsa);
-
-      st[id].config3 = vmeRead32(&FAp[id]->config3);
-      st[id].blk_count = vmeRead32(&FAp[id]->blk_count);
-      st[id].blk_level = vmeRead32(&FAp[id]->blk_level);
-      st[id].ram_word_count = vmeRead32(&FAp[id]->ram_word_count)&FA_RAM_DATA_MASK;
-
-      st[id].trig_scal      = vmeRead32(&(FAp[id]->trig_scal));
-      st[id].trig2_scal     = vmeRead32(&FAp[id]->trig2_scal);
-      st[id].syncreset_scal = vmeRead32(&FAp[id]->syncreset_scal);
-      st[id].berr_module_scal = vmeRead32(&FAp[id]->berr_module_scal);
-      st[id].lost_trig_scal = vmeRead32(&FAp[id]->lost_trig_scal);
-
-      st[id].mgt_status = vmeRead32(&FAp[id]->mgt_status);
+      st[id].ram_word_count &= FA_RAM_DATA_MASK;
 
       for(ii = 0;ii < FA_MAX_ADC_CHANNELS;ii++){
-        st[id].adc_pedestal[ii] = vmeRead32(&FAp[id]->adc_pedestal[ii]) & FA_ADC_PEDESTAL_MASK;
+        st[id].adc_pedestal[ii] &= FA_ADC_PEDESTAL_MASK;
       }
 
     }
-  FAUNLOCK;
   for (ifa=0;ifa<nfadc;ifa++) 
     {
       id = faSlot(ifa);
@@ -1655,6 +1940,64 @@ faGStatus(int sflag)
 
 }
 
+/**
+ *  @ingroup Status
+ *  @brief Return the usage counters of a library lock
+ *  @param id Slot number of the module lock, or 0 for the crate lock
+ *  @param count Where to return the number of times the lock was taken
+ *  @param contention Where to return the number of times the lock was
+ *     already held by another thread when requested
+ *  @return OK if successful, otherwise ERROR.
+ */
+int
+faGetLockStats(int id, unsigned int *count, unsigned int *contention)
+{
+  if((id<0) || (id>21))
+    {
+      logMsg("faGetLockStats: ERROR : Invalid lock %d\n",id,2,3,4,5,6);
+      return ERROR;
+    }
+
+  if(count)
+    *count = faLockCount[id];
+  if(contention)
+    *contention = faLockContention[id];
+
+  return OK;
+}
+
+/**
+ *  @ingroup Status
+ *  @brief Print the usage counters of the crate lock and the module locks
+ *    of all initialized fADC250s
+ */
+void
+faPrintLockStats()
+{
+  int ifa, id;
+
+  printf("\n fADC250 library locks\n");
+  printf("  Lock      Taken   Contended\n");
+  printf("  crate  %10u  %10u\n", faLockCount[0], faLockContention[0]);
+  for(ifa=0; ifa<nfadc; ifa++)
+    {
+      id = faSlot(ifa);
+      printf("  slot %2d%10u  %10u\n", id, faLockCount[id], faLockContention[id]);
+    }
+  printf("\n");
+}
+
+/**
+ *  @ingroup Status
+ *  @brief Reset the usage counters of all library locks
+ */
+void
+faResetLockStats()
+{
+  memset(faLockCount, 0, sizeof(faLockCount));
+  memset(faLockContention, 0, sizeof(faLockContention));
+}
+
 /**
  *  @ingroup Status
  *  @brief Get the firmware versions of each FPGA
@@ -1679,13 +2022,13 @@ faGetFirmwareVersions(int id, int pflag)
       return(ERROR);
     }
   
-  FALOCK;
+  FASLOTLOCK(id);
   /* Control FPGA firmware version */
   cntl = vmeRead32(&FAp[id]->version) & 0xFFFF;
 
   /* Processing FPGA firmware version */
   proc = vmeRead32(&(FAp[id]->adc_status[0]))&FA_ADC_VERSION_MASK;
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   rval = (cntl) | (proc<<16);
 
@@ -1847,7 +2190,7 @@ faSetProcMode(int id, int pmode, unsigned int PL, unsigned int PTW,
   //  faSetNormalMode(id,0);
 
 
-  FALOCK;
+  FASLOTLOCK(id);
   /* Disable ADC processing while writing window info */
   if(pmode == FA_ADC_PROC_MODE_PULSE_PARAM)
     mode_bit = 0;
@@ -1870,15 +2213,15 @@ faSetProcMode(int id, int pmode, unsigned int PL, unsigned int PTW,
 
   /* Configure the mode (mode_bit), # of pulses (NP), # samples above TET (NSAT)
      keep TNSAT, if it's already been configured */
-  vmeWrite32(&FAp[id]->adc_config[0],
-	     (vmeRead32(&FAp[id]->adc_config[0]) & FA_ADC_CONFIG1_TNSAT_MASK) |
+  faShadowWrite32(id, &FAp[id]->adc_config[0],
+	     (faShadowRead32(id, &FAp[id]->adc_config[0]) & FA_ADC_CONFIG1_TNSAT_MASK) |
 	     (mode_bit << 8) | ((NP-1) << 4) | ((NSAT-1) << 10) );
 
   //printf(" ----------------------   SASCHA =  0x%X \n", vmeRead32(&FAp[id]->adc_config[0]));
   
 
   /* Disable user-requested channels */
-  vmeWrite32(&FAp[id]->adc_config[1], fadcChanDisable[id]);
+  faShadowWrite32(id, &FAp[id]->adc_config[1], fadcChanDisable[id]);
 
   /* Set window parameters */
   vmeWrite32(&FAp[id]->adc_pl, PL);
@@ -1887,8 +2230,8 @@ faSetProcMode(int id, int pmode, unsigned int PL, unsigned int PTW,
   /* Set Readback NSB, NSA
      NSA */
   vmeWrite32(&FAp[id]->adc_nsb, NSB);
-  vmeWrite32(&FAp[id]->adc_nsa,
-	     (vmeRead32(&FAp[id]->adc_nsa) & FA_ADC_TNSA_MASK) |
+  faShadowWrite32(id, &FAp[id]->adc_nsa,
+	     (faShadowRead32(id, &FAp[id]->adc_nsa) & FA_ADC_TNSA_MASK) |
 	     NSA );
 
   /* Set Pedestal parameters */
@@ -1899,11 +2242,11 @@ faSetProcMode(int id, int pmode, unsigned int PL, unsigned int PTW,
   vmeWrite32(&FAp[id]->config3, FA_ADC_DEFAULT_TPT);
 
   /* Enable ADC processing */
-  vmeWrite32(&FAp[id]->adc_config[0],
-	     vmeRead32(&FAp[id]->adc_config[0]) | FA_ADC_PROC_ENABLE );
+  faShadowWrite32(id, &FAp[id]->adc_config[0],
+	     faShadowRead32(id, &FAp[id]->adc_config[0]) | FA_ADC_PROC_ENABLE );
 
 
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   //  faSetTriggerStopCondition(id, faCalcMaxUnAckTriggers(pmode,PTW,NSA,NSB,NP));
   //  faSetTriggerBusyCondition(id, faCalcMaxUnAckTriggers(pmode,PTW,NSA,NSB,NP));
@@ -2042,7 +2385,7 @@ faSetTriggerStopCondition(int id, int trigger_max)
       return ERROR;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   if(trigger_max>0)
     {
       vmeWrite32(&FAp[id]->trigger_control,
@@ -2056,7 +2399,7 @@ faSetTriggerStopCondition(int id, int trigger_max)
 		 (vmeRead32(&FAp[id]->trigger_control) & 
 		  ~(FA_TRIGCTL_TRIGSTOP_EN | FA_TRIGCTL_MAX2_MASK)));
     }
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return OK;
 }
@@ -2088,7 +2431,7 @@ faSetTriggerBusyCondition(int id, int trigger_max)
       return ERROR;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   if(trigger_max>0)
     {
       vmeWrite32(&FAp[id]->trigger_control,
@@ -2102,7 +2445,7 @@ faSetTriggerBusyCondition(int id, int trigger_max)
 		 (vmeRead32(&FAp[id]->trigger_control) & 
 		  ~(FA_TRIGCTL_BUSY_EN | FA_TRIGCTL_MAX1_MASK)));
     }
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return OK;
 }
@@ -2152,15 +2495,15 @@ faSetTriggerPathSamples(int id, unsigned int TNSA, unsigned int TNSAT)
       TNSAT = FA_ADC_DEFAULT_TNSAT;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
 
-  readback_nsa     = vmeRead32(&FAp[id]->adc_nsa)       & FA_ADC_NSA_READBACK_MASK;
-  readback_config1 = vmeRead32(&FAp[id]->adc_config[0]) & ~FA_ADC_CONFIG1_TNSAT_MASK;
+  readback_nsa     = faShadowRead32(id, &FAp[id]->adc_nsa)       & FA_ADC_NSA_READBACK_MASK;
+  readback_config1 = faShadowRead32(id, &FAp[id]->adc_config[0]) & ~FA_ADC_CONFIG1_TNSAT_MASK;
 
-  vmeWrite32(&FAp[id]->adc_nsa,       (TNSA  << 9)  | readback_nsa);
-  vmeWrite32(&FAp[id]->adc_config[0], ((TNSAT-1) << 12) | readback_config1);
+  faShadowWrite32(id, &FAp[id]->adc_nsa,       (TNSA  << 9)  | readback_nsa);
+  faShadowWrite32(id, &FAp[id]->adc_config[0], ((TNSAT-1) << 12) | readback_config1);
 
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return OK;
 }
@@ -2218,11 +2561,11 @@ faSetTriggerPathThreshold(int id, unsigned int TPT)
       TPT = FA_ADC_MAX_TPT;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&FAp[id]->config3, 
 	     (vmeRead32(&FAp[id]->config3) & ~FA_ADC_CONFIG3_TPT_MASK) | 
 	     TPT);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return OK;
 }
@@ -2299,7 +2642,7 @@ faSetNormalMode(int id, int opt)
 
   unsigned int read_status = 0;
 
-  FALOCK;
+  FASLOTLOCK(id);
 
   taskDelay(1);
   vmeWrite32(&FAp[id]->adc_config[2], 0);
@@ -2373,7 +2716,7 @@ faSetNormalMode(int id, int opt)
   faWaitForAdcReady(id);
   vmeWrite32(&FAp[id]->adc_config[2], 0xC0);
 
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
 
 }
@@ -2400,7 +2743,7 @@ faSetInvertedMode(int id)
     return;
   }
 
-  FALOCK;
+  FASLOTLOCK(id);
   faWaitForAdcReady(id);
   vmeWrite32(&FAp[id]->adc_config[3], 0x1404);
   faWaitForAdcReady(id);
@@ -2418,7 +2761,7 @@ faSetInvertedMode(int id)
   vmeWrite32(&FAp[id]->adc_config[2], 0x40 | 0x80);
   faWaitForAdcReady(id);
   vmeWrite32(&FAp[id]->adc_config[2], 0x40);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 }
 
 /**
@@ -2459,7 +2802,7 @@ faSetPPG(int id, int pmode, unsigned short *sdata, int nsamples)
   if((nsamples <= 0)||(nsamples>FA_PPG_MAX_SAMPLES)) nsamples = FA_PPG_MAX_SAMPLES;
   diff = FA_PPG_MAX_SAMPLES - nsamples;
 
-  FALOCK;
+  FASLOTLOCK(id);
   for(ii=0;ii<(nsamples-2);ii++) 
     {
       vmeWrite32(&FAp[id]->adc_test_data, (sdata[ii]|FA_PPG_WRITE_VALUE));
@@ -2483,7 +2826,7 @@ faSetPPG(int id, int pmode, unsigned short *sdata, int nsamples)
   /*   vmeWrite32(&FAp[id]->adc_test_data, (sdata[(nsamples-2)]&FA_PPG_SAMPLE_MASK)); */
   /*   vmeWrite32(&FAp[id]->adc_test_data, (sdata[(nsamples-1)]&FA_PPG_SAMPLE_MASK)); */
     
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
   
   return(OK);
 }
@@ -2501,8 +2844,8 @@ faPPGEnable(int id)
 
   if(id==0) id=fadcID[0];
   
-  FALOCK;
-  val1 = (vmeRead32(&FAp[id]->adc_config[0])&0xFFFF);
+  FASLOTLOCK(id);
+  val1 = (faShadowRead32(id, &FAp[id]->adc_config[0])&0xFFFF);
 
 
   //  val1 |= (FA_PPG_ENABLE | 0xff00); 
@@ -2510,8 +2853,8 @@ faPPGEnable(int id)
   // Alex
   val1 |= FA_PPG_ENABLE; 
 
-  vmeWrite32(&FAp[id]->adc_config[0], val1);
-  FAUNLOCK;
+  faShadowWrite32(id, &FAp[id]->adc_config[0], val1);
+  FASLOTUNLOCK(id);
   
 
   printf(" PPGEnable adc_config[0] 0x%x \n", val1);
@@ -2537,113 +2880,291 @@ faPPGDisable(int id)
       return;
     }
 
-  FALOCK;
-  val1 = (vmeRead32(&FAp[id]->adc_config[0])&0xFFFF);
+  FASLOTLOCK(id);
+  val1 = (faShadowRead32(id, &FAp[id]->adc_config[0])&0xFFFF);
 
 
   val1 &= ~FA_PPG_ENABLE;
 
   // Alex
   //  val1 &= ~(0xff00);
-  vmeWrite32(&FAp[id]->adc_config[0], val1);
-  FAUNLOCK;
+  faShadowWrite32(id, &FAp[id]->adc_config[0], val1);
+  FASLOTUNLOCK(id);
 
 }
 
-/**
- *  @ingroup Readout
- *  @brief General Data readout routine
- *
- *  @param  id     Slot number of module to read
- *  @param  data   local memory address to place data
- *  @param  nwrds  Max number of words to transfer
- *  @param  rflag  Readout Flag
- * <pre>
- *              0 - programmed I/O from the specified board
- *              1 - DMA transfer using Universe/Tempe DMA Engine 
- *                    (DMA VME transfer Mode must be setup prior)
- *              2 - Multiblock DMA transfer (Multiblock must be enabled
- *                     and daisychain in place or SD being used)
- * </pre>
- *  @return Number of words inserted into data if successful.  Otherwise ERROR.
+/*
+ * Messages from the readout path (faReadBlock and the DMA completion) go
+ * through FALOGHOT: at most FA_LOG_RATE per second from each call site,
+ * the rest are counted and reported with the next message from that site.
+ * They are given to the function set with faSetLogFunc (e.g. the shared
+ * memory log ring), or to logMsg.  The counts are not locked, so the limit
+ * is approximate when several threads log from the same site.
  */
-int
-faReadBlock(int id, volatile UINT32 *data, int nwrds, int rflag)
+typedef struct
 {
-  int ii, blknum, evnum1;
-  int stat, retVal, xferCount, rmode, async;
-  int dCnt, berr=0;
-  int dummy=0;
-  volatile unsigned int *laddr;
-  unsigned int bhead, ehead, val;
-  unsigned int vmeAdr, csr;
+  time_t       sec;
+  unsigned int count;
+  unsigned int suppressed;
+} faLogSite;
 
-  if(id==0) id=fadcID[0];
+static FA_LOG_FUNC faLogFunc = NULL;
 
-  if((id<=0) || (id>21) || (FAp[id] == NULL)) 
+static void
+faLogHot(faLogSite *site, const char *fmt, long a1, long a2, long a3,
+	 long a4, long a5, long a6)
+{
+  time_t now = time(NULL);
+
+  if(now != site->sec)
     {
-      logMsg("faReadBlock: ERROR : FADC in slot %d is not initialized \n",id,0,0,0,0,0);
-      return(ERROR);
+      if(site->suppressed)
+	{
+	  /* FA_LOG_FUNC takes its arguments as long, as logMsg on vxWorks */
+	  if(faLogFunc)
+	    faLogFunc("%d messages suppressed: %s",site->suppressed,(long)fmt,0,0,0,0);
+	  else
+	    logMsg("%d messages suppressed: %s",site->suppressed,fmt,0,0,0,0);
+	}
+      site->sec = now;
+      site->count = 0;
+      site->suppressed = 0;
     }
 
-  if(data==NULL) 
+  if(++site->count > FA_LOG_RATE)
     {
-      logMsg("faReadBlock: ERROR: Invalid Destination address\n",0,0,0,0,0,0);
-      return(ERROR);
+      site->suppressed++;
+      return;
     }
 
-  fadcBlockError=FA_BLOCKERROR_NO_ERROR;
-  if(nwrds <= 0) nwrds= (FA_MAX_ADC_CHANNELS*FA_MAX_DATA_PER_CHANNEL) + 8;
-  rmode = rflag&0x0f;
-  async = rflag&0x80;
-  
-  if(rmode >= 1) 
-    { /* Block Transfers */
-    
-      /*Assume that the DMA programming is already setup. */
-      /* Don't Bother checking if there is valid data - that should be done prior
-	 to calling the read routine */
+  if(faLogFunc)
+    faLogFunc(fmt,a1,a2,a3,a4,a5,a6);
+  else
+    logMsg(fmt,a1,a2,a3,a4,a5,a6);
+}
 
-      /* Check for 8 byte boundary for address - insert dummy word (Slot 0 FADC Dummy DATA)*/
-      if((unsigned long) (data)&0x7) 
+#define FALOGHOT(fmt,a1,a2,a3,a4,a5,a6) do {				\
+    static faLogSite _faLogSite;					\
+    faLogHot(&_faLogSite,fmt,(long)(a1),(long)(a2),(long)(a3),		\
+	     (long)(a4),(long)(a5),(long)(a6));				\
+  } while(0)
+
+/**
+ *  @ingroup Config
+ *  @brief Send the messages of the readout path (faReadBlock,
+ *         faReadBlockWait) to func instead of logMsg.
+ *  @param func Function called as logMsg, NULL for logMsg
+ *  @return OK
+ */
+int
+faSetLogFunc(FA_LOG_FUNC func)
+{
+  faLogFunc = func;
+  return OK;
+}
+
+/*
+ * Classify a completed DMA block transfer from the value returned by
+ * sysVmeDmaDone/vmeDmaDone, set fadcBlockError, and return the number of
+ * words in the buffer (including the alignment dummy word).
+ * Must be called with the crate lock (FALOCK) held.
+ */
+static int
+faBlockTransferResult(const char *caller, int id, int rmode, int nwrds, int dummy, int retVal)
+{
+  int stat, xferCount;
+  unsigned int csr;
+
+  if(retVal > 0) 
+    {
+      /* Check to see that Bus error was generated by FADC */
+      if(rmode == 2) 
+	{
+	  csr = vmeRead32(&(FAp[fadcMaxSlot]->csr));  /* from Last FADC */
+	  stat = (csr)&FA_CSR_BERR_STATUS;  /* from Last FADC */
+	}
+      else
+	{
+	  csr = vmeRead32(&(FAp[id]->csr));  /* from Last FADC */
+	  stat = (csr)&FA_CSR_BERR_STATUS;  /* from Last FADC */
+	}
+      if((retVal>0) && (stat)) 
 	{
 #ifdef VXWORKS
-	  *data = FA_DUMMY_DATA;
+	  xferCount = (nwrds - (retVal>>2) + dummy);  /* Number of Longwords transfered */
 #else
-	  *data = LSWAP(FA_DUMMY_DATA);
+	  xferCount = ((retVal>>2) + dummy);  /* Number of Longwords transfered */
 #endif
-	  dummy = 1;
-	  laddr = (data + 1);
-	} 
-      else 
-	{
-	  dummy = 0;
-	  laddr = data;
+	  return(xferCount); /* Return number of data words transfered */
 	}
-
-      FALOCK;
-      if(rmode == 2) 
-	{ /* Multiblock Mode */
-	  if((vmeRead32(&(FAp[id]->ctrl1))&FA_FIRST_BOARD)==0) 
+      else
+	{
+#ifdef VXWORKS
+	  xferCount = (nwrds - (retVal>>2) + dummy);  /* Number of Longwords transfered */
+	  FALOGHOT("%s: DMA transfer terminated by unknown BUS Error (csr=0x%x xferCount=%d id=%d)\n",
+		 caller,csr,xferCount,id,0,0);
+	  fadcBlockError=FA_BLOCKERROR_UNKNOWN_BUS_ERROR;
+#else
+	  xferCount = ((retVal>>2) + dummy);  /* Number of Longwords transfered */
+	  if((retVal>>2)==nwrds)
 	    {
-	      logMsg("faReadBlock: ERROR: FADC in slot %d is not First Board\n",id,0,0,0,0,0);
-	      FAUNLOCK;
-	      return(ERROR);
+	      FALOGHOT("%s: WARN: DMA transfer terminated by word count 0x%x\n",caller,nwrds,0,0,0,0);
+	      fadcBlockError=FA_BLOCKERROR_TERM_ON_WORDCOUNT;
+	    }
+	  else
+	    {
+	      FALOGHOT("%s: DMA transfer terminated by unknown BUS Error (csr=0x%x xferCount=%d id=%d)\n",
+		     caller,csr,xferCount,id,0,0);
+	      fadcBlockError=FA_BLOCKERROR_UNKNOWN_BUS_ERROR;
 	    }
-	  vmeAdr = (unsigned int)((unsigned long)(FApmb) - fadcA32Offset);
+#endif
+	  return(xferCount);
 	}
-      else
+    } 
+  else if (retVal == 0)
+    { /* Block Error finished without Bus Error */
+#ifdef VXWORKS
+      FALOGHOT("%s: WARN: DMA transfer terminated by word count 0x%x\n",caller,nwrds,0,0,0,0);
+#else
+      FALOGHOT("%s: WARN: DMA transfer returned zero word count 0x%x\n",caller,nwrds,0,0,0,0);
+#endif
+      fadcBlockError=FA_BLOCKERROR_ZERO_WORD_COUNT;
+      return(nwrds);
+    } 
+  else 
+    {  /* Error in DMA */
+#ifdef VXWORKS
+      FALOGHOT("%s: ERROR: sysVmeDmaDone returned an Error\n",caller,0,0,0,0,0);
+#else
+      FALOGHOT("%s: ERROR: vmeDmaDone returned an Error\n",caller,0,0,0,0,0);
+#endif
+      fadcBlockError=FA_BLOCKERROR_DMADONE_ERROR;
+      return(retVal>>2);
+    }
+}
+
+/*
+ * Start a DMA transfer of nwrds words from the module in slot id (rmode 1)
+ * or from the multiblock window (rmode 2) into laddr.  Must be called with
+ * the crate lock held: it covers the (shared) bridge DMA engine and the
+ * multiblock token passing.  Refused while an asynchronous transfer
+ * (faReadBlockStart) is outstanding.  Returns 0 if the transfer was started.
+ */
+static int
+faDmaStart(const char *caller, int id, volatile unsigned int *laddr, int nwrds,
+	   int rmode)
+{
+  int retVal;
+  unsigned int vmeAdr;
+
+  if(fadcDmaBusy >= 0)
+    {
+      FALOGHOT("%s: ERROR: Transfer into buffer %d still in progress\n",
+	       caller,fadcDmaBusy,0,0,0,0);
+      return(ERROR);
+    }
+
+  if(rmode == 2) 
+    { /* Multiblock Mode */
+      if((vmeRead32(&(FAp[id]->ctrl1))&FA_FIRST_BOARD)==0) 
 	{
-	  vmeAdr = (unsigned int)((unsigned long)(FApd[id]) - fadcA32Offset);
+	  FALOGHOT("%s: ERROR: FADC in slot %d is not First Board\n",caller,id,0,0,0,0);
+	  return(ERROR);
 	}
+      vmeAdr = (unsigned int)((unsigned long)(FApmb) - fadcA32Offset);
+    }
+  else
+    {
+      vmeAdr = (unsigned int)((unsigned long)(FApd[id]) - fadcA32Offset);
+    }
+#ifdef VXWORKS
+  retVal = sysVmeDmaSend((UINT32)laddr, vmeAdr, (nwrds<<2), 0);
+#else
+  retVal = vmeDmaSend((unsigned long)laddr, vmeAdr, (nwrds<<2));
+#endif
+  if(retVal != 0) 
+    {
+      FALOGHOT("%s: ERROR in DMA transfer Initialization 0x%x\n",caller,retVal,0,0,0,0);
+      return(retVal);
+    }
+
+  return(0);
+}
+
+/**
+ *  @ingroup Readout
+ *  @brief General Data readout routine
+ *
+ *  @param  id     Slot number of module to read
+ *  @param  data   local memory address to place data
+ *  @param  nwrds  Max number of words to transfer
+ *  @param  rflag  Readout Flag
+ * <pre>
+ *              0 - programmed I/O from the specified board
+ *              1 - DMA transfer using Universe/Tempe DMA Engine 
+ *                    (DMA VME transfer Mode must be setup prior)
+ *              2 - Multiblock DMA transfer (Multiblock must be enabled
+ *                     and daisychain in place or SD being used)
+ * </pre>
+ *  @return Number of words inserted into data if successful.  Otherwise ERROR.
+ */
+int
+faReadBlock(int id, volatile UINT32 *data, int nwrds, int rflag)
+{
+  int ii, blknum, evnum1;
+  int retVal, rmode, async;
+  int dCnt, berr=0;
+  int dummy=0;
+  volatile unsigned int *laddr;
+  unsigned int bhead, ehead, val;
+
+  if(id==0) id=fadcID[0];
+
+  if((id<=0) || (id>21) || (FAp[id] == NULL)) 
+    {
+      FALOGHOT("faReadBlock: ERROR : FADC in slot %d is not initialized \n",id,0,0,0,0,0);
+      return(ERROR);
+    }
+
+  if(data==NULL) 
+    {
+      FALOGHOT("faReadBlock: ERROR: Invalid Destination address\n",0,0,0,0,0,0);
+      return(ERROR);
+    }
+
+  fadcBlockError=FA_BLOCKERROR_NO_ERROR;
+  if(nwrds <= 0) nwrds= (FA_MAX_ADC_CHANNELS*FA_MAX_DATA_PER_CHANNEL) + 8;
+  rmode = rflag&0x0f;
+  async = rflag&0x80;
+  
+  if(rmode >= 1) 
+    { /* Block Transfers */
+    
+      /*Assume that the DMA programming is already setup. */
+      /* Don't Bother checking if there is valid data - that should be done prior
+	 to calling the read routine */
+
+      /* Check for 8 byte boundary for address - insert dummy word (Slot 0 FADC Dummy DATA)*/
+      if((unsigned long) (data)&0x7) 
+	{
 #ifdef VXWORKS
-      retVal = sysVmeDmaSend((UINT32)laddr, vmeAdr, (nwrds<<2), 0);
+	  *data = FA_DUMMY_DATA;
 #else
-      retVal = vmeDmaSend((unsigned long)laddr, vmeAdr, (nwrds<<2));
+	  *data = LSWAP(FA_DUMMY_DATA);
 #endif
+	  dummy = 1;
+	  laddr = (data + 1);
+	} 
+      else 
+	{
+	  dummy = 0;
+	  laddr = data;
+	}
+
+      FALOCK;
+      retVal = faDmaStart("faReadBlock", id, laddr, nwrds, rmode);
       if(retVal != 0) 
 	{
-	  logMsg("faReadBlock: ERROR in DMA transfer Initialization 0x%x\n",retVal,0,0,0,0,0);
 	  FAUNLOCK;
 	  return(retVal);
 	}
@@ -2663,85 +3184,16 @@ faReadBlock(int id, volatile UINT32 *data, int nwrds, int rflag)
 #endif
 	}
 
-      if(retVal > 0) 
-	{
-	  /* Check to see that Bus error was generated by FADC */
-	  if(rmode == 2) 
-	    {
-	      csr = vmeRead32(&(FAp[fadcMaxSlot]->csr));  /* from Last FADC */
-	      stat = (csr)&FA_CSR_BERR_STATUS;  /* from Last FADC */
-	    }
-	  else
-	    {
-	      csr = vmeRead32(&(FAp[id]->csr));  /* from Last FADC */
-	      stat = (csr)&FA_CSR_BERR_STATUS;  /* from Last FADC */
-	    }
-	  if((retVal>0) && (stat)) 
-	    {
-#ifdef VXWORKS
-	      xferCount = (nwrds - (retVal>>2) + dummy);  /* Number of Longwords transfered */
-#else
-	      xferCount = ((retVal>>2) + dummy);  /* Number of Longwords transfered */
-	      /* 	xferCount = (retVal + dummy);  /\* Number of Longwords transfered *\/ */
-#endif
-	      FAUNLOCK;
-	      return(xferCount); /* Return number of data words transfered */
-	    }
-	  else
-	    {
-#ifdef VXWORKS
-	      xferCount = (nwrds - (retVal>>2) + dummy);  /* Number of Longwords transfered */
-	      logMsg("faReadBlock: DMA transfer terminated by unknown BUS Error (csr=0x%x xferCount=%d id=%d)\n",
-		     csr,xferCount,id,0,0,0);
-	      fadcBlockError=FA_BLOCKERROR_UNKNOWN_BUS_ERROR;
-#else
-	      xferCount = ((retVal>>2) + dummy);  /* Number of Longwords transfered */
-	      if((retVal>>2)==nwrds)
-		{
-		  logMsg("faReadBlock: WARN: DMA transfer terminated by word count 0x%x\n",nwrds,0,0,0,0,0);
-		  fadcBlockError=FA_BLOCKERROR_TERM_ON_WORDCOUNT;
-		}
-	      else
-		{
-		  logMsg("faReadBlock: DMA transfer terminated by unknown BUS Error (csr=0x%x xferCount=%d id=%d)\n",
-			 csr,xferCount,id,0,0,0);
-		  fadcBlockError=FA_BLOCKERROR_UNKNOWN_BUS_ERROR;
-		}
-#endif
-	      FAUNLOCK;
-	      return(xferCount);
-	      /* 	return(ERROR); */
-	    }
-	} 
-      else if (retVal == 0)
-	{ /* Block Error finished without Bus Error */
-#ifdef VXWORKS
-	  logMsg("faReadBlock: WARN: DMA transfer terminated by word count 0x%x\n",nwrds,0,0,0,0,0);
-#else
-	  logMsg("faReadBlock: WARN: DMA transfer returned zero word count 0x%x\n",nwrds,0,0,0,0,0);
-#endif
-	  fadcBlockError=FA_BLOCKERROR_ZERO_WORD_COUNT;
-	  FAUNLOCK;
-	  return(nwrds);
-	} 
-      else 
-	{  /* Error in DMA */
-#ifdef VXWORKS
-	  logMsg("faReadBlock: ERROR: sysVmeDmaDone returned an Error\n",0,0,0,0,0,0);
-#else
-	  logMsg("faReadBlock: ERROR: vmeDmaDone returned an Error\n",0,0,0,0,0,0);
-#endif
-	  fadcBlockError=FA_BLOCKERROR_DMADONE_ERROR;
-	  FAUNLOCK;
-	  return(retVal>>2);
-	}
+      retVal = faBlockTransferResult("faReadBlock", id, rmode, nwrds, dummy, retVal);
+      FAUNLOCK;
+      return(retVal);
 
     } 
   else 
     {  /*Programmed IO */
 
       /* Check if Bus Errors are enabled. If so then disable for Prog I/O reading */
-      FALOCK;
+      FASLOTLOCK(id);
       berr = vmeRead32(&(FAp[id]->ctrl1))&FA_ENABLE_BERR;
       if(berr)
 	vmeWrite32(&(FAp[id]->ctrl1),vmeRead32(&(FAp[id]->ctrl1)) & ~FA_ENABLE_BERR);
@@ -2777,14 +3229,14 @@ faReadBlock(int id, volatile UINT32 *data, int nwrds, int rflag)
 	  /* We got bad data - Check if there is any data at all */
 	  if( (vmeRead32(&(FAp[id]->ev_count)) & FA_EVENT_COUNT_MASK) == 0) 
 	    {
-	      logMsg("faReadBlock: FIFO Empty (0x%08x)\n",bhead,0,0,0,0,0);
-	      FAUNLOCK;
+	      FALOGHOT("faReadBlock: FIFO Empty (0x%08x)\n",bhead,0,0,0,0,0);
+	      FASLOTUNLOCK(id);
 	      return(0);
 	    } 
 	  else 
 	    {
-	      logMsg("faReadBlock: ERROR: Invalid Header Word 0x%08x\n",bhead,0,0,0,0,0);
-	      FAUNLOCK;
+	      FALOGHOT("faReadBlock: ERROR: Invalid Header Word 0x%08x\n",bhead,0,0,0,0,0);
+	      FASLOTUNLOCK(id);
 	      return(ERROR);
 	    }
 	}
@@ -2810,11 +3262,10 @@ faReadBlock(int id, volatile UINT32 *data, int nwrds, int rflag)
 	vmeWrite32(&(FAp[id]->ctrl1),
 		   vmeRead32(&(FAp[id]->ctrl1)) | FA_ENABLE_BERR);
 
-      FAUNLOCK;
+      FASLOTUNLOCK(id);
       return(dCnt);
     }
 
-  FAUNLOCK;
   return(OK);
 }
 
@@ -2947,108 +3398,347 @@ faReadBlockStatus(int id, volatile UINT32 *data, int nwrds, int rflag)
   
 }
 
+
 /**
  *  @ingroup Readout
- *  @brief Print the current available block to standard out
- *  @param id Slot number
- *  @param rflag Not used
- *  @return Number of words read if successful, otherwise ERROR.
+ *  @brief Register the DMA target buffers used by faReadBlockStart
+ *
+ *    Transfers go into the buffers in turn.  While the caller decodes or
+ *    ships one buffer, the next block can be transferring into another.
+ *    Buffers must be DMA-able (e.g. from a dmaPList pool) and 8 byte aligned.
+ *
+ *  @param bufs   Array of buffer addresses
+ *  @param nbufs  Number of buffers (1 - FA_MAX_DMA_BUFFERS), 0 to unregister
+ *  @param nwrds  Size of each buffer in words (max words per transfer)
+ *  @return OK if successful, otherwise ERROR.
  */
 int
-faPrintBlock(int id, int rflag)
+faReadBlockSetBuffers(volatile UINT32 **bufs, int nbufs, int nwrds)
 {
+  int ibuf;
 
-  int ii, blknum, evnum1;
-  int nwrds=32768, dCnt, berr=0;
-  unsigned int data, bhead, ehead;
-
-  if(id==0) id=fadcID[0];
-
-  if((id<=0) || (id>21) || (FAp[id] == NULL)) 
+  if((nbufs < 0) || (nbufs > FA_MAX_DMA_BUFFERS))
     {
-      printf("faPrintEvent: ERROR : FADC in slot %d is not initialized \n",id);
-      return(ERROR);
+      logMsg("faReadBlockSetBuffers: ERROR: Invalid number of buffers (%d)\n",nbufs,2,3,4,5,6);
+      return ERROR;
     }
 
-  /* Check if data available */
-  FALOCK;
-  if((vmeRead32(&(FAp[id]->ev_count))&FA_EVENT_COUNT_MASK)==0) 
+  if((nbufs > 0) && ((bufs == NULL) || (nwrds <= 0)))
     {
-      printf("faPrintEvent: ERROR: FIFO Empty\n");
-      FAUNLOCK;
-      return(0);
+      logMsg("faReadBlockSetBuffers: ERROR: Invalid buffers (0x%lx, %d words)\n",
+	     (unsigned long)bufs,nwrds,3,4,5,6);
+      return ERROR;
     }
 
-  /* Check if Bus Errors are enabled. If so then disable for reading */
-  berr = vmeRead32(&(FAp[id]->ctrl1))&FA_ENABLE_BERR;
-  if(berr)
-    vmeWrite32(&(FAp[id]->ctrl1),
-	       vmeRead32(&(FAp[id]->ctrl1)) & ~FA_ENABLE_BERR);
-  
-  dCnt = 0;
-  /* Read Block Header - should be first word */
-  bhead = (unsigned int) *FApd[id];
-#ifndef VXWORKS
-  bhead = LSWAP(bhead);
-#endif
-  if( (bhead&FA_DATA_TYPE_DEFINE)&&((bhead&FA_DATA_TYPE_MASK) == FA_DATA_BLOCK_HEADER)) 
-    {
-      blknum = bhead&FA_DATA_BLKNUM_MASK;
-      ehead = (unsigned int) *FApd[id];
-#ifndef VXWORKS
-      ehead = LSWAP(ehead);
-#endif
-      evnum1 = ehead&FA_DATA_TRIGNUM_MASK;
-      printf("%4d: ",dCnt+1); 
-      faDataDecode(bhead);
-      dCnt++;
-      printf("%4d: ",dCnt+1); 
-      faDataDecode(ehead);
-      dCnt++;
-    }
-  else
+  for(ibuf=0; ibuf<nbufs; ibuf++)
     {
-      /* We got bad data - Check if there is any data at all */
-      if((vmeRead32(&(FAp[id]->ev_count))&FA_EVENT_COUNT_MASK)==0) 
-	{
-	  logMsg("faPrintBlock: FIFO Empty (0x%08x)\n",bhead,0,0,0,0,0);
-	  FAUNLOCK;
-	  return(0);
-	} 
-      else 
+      if((bufs[ibuf] == NULL) || ((unsigned long)(bufs[ibuf])&0x7))
 	{
-	  logMsg("faPrintBlock: ERROR: Invalid Header Word 0x%08x\n",bhead,0,0,0,0,0);
-	  FAUNLOCK;
-	  return(ERROR);
+	  logMsg("faReadBlockSetBuffers: ERROR: Buffer %d (0x%lx) is not 8 byte aligned\n",
+		 ibuf,(unsigned long)bufs[ibuf],3,4,5,6);
+	  return ERROR;
 	}
     }
-  
-  ii=0;
-  while(ii<nwrds) 
+
+  FALOCK;
+  if(fadcDmaBusy >= 0)
     {
-      data = (unsigned int) *FApd[id];
-#ifndef VXWORKS
-      data = LSWAP(data);
-#endif
-      printf("%4d: ",dCnt+1+ii); 
-      faDataDecode(data);
-      if((data&FA_DATA_TYPE_DEFINE)&&((data&FA_DATA_TYPE_MASK) == FA_DATA_BLOCK_TRAILER))
-	break;
-      if((data&FA_DATA_TYPE_DEFINE)&&((data&FA_DATA_TYPE_MASK) == FA_DATA_INVALID))
-	break;
-      ii++;
+      logMsg("faReadBlockSetBuffers: ERROR: Transfer in progress\n",1,2,3,4,5,6);
+      FAUNLOCK;
+      return ERROR;
     }
-  ii++;
-  dCnt += ii;
-
 
-  if(berr)
-    vmeWrite32(&(FAp[id]->ctrl1),
-	       vmeRead32( &(FAp[id]->ctrl1)) | FA_ENABLE_BERR );
-  
+  for(ibuf=0; ibuf<FA_MAX_DMA_BUFFERS; ibuf++)
+    {
+      fadcDmaBuf[ibuf] = (ibuf < nbufs) ? bufs[ibuf] : NULL;
+      fadcDmaBufState[ibuf] = FA_DMABUF_FREE;
+    }
+  fadcDmaNbuf = nbufs;
+  fadcDmaBufWords = nwrds;
+  fadcDmaNext = 0;
   FAUNLOCK;
-  return(dCnt);
-  
+
+  return OK;
+}
+
+/**
+ *  @ingroup Readout
+ *  @brief Start a DMA block transfer into the next registered buffer, and
+ *         return without waiting for it to complete.
+ *
+ *    Complete the transfer with faReadBlockWait, and give the buffer back
+ *    with faReadBlockRelease once its data has been used.  Only one
+ *    transfer can be in progress at a time (one DMA engine).
+ *
+ * <pre>
+ *    Double buffered readout, where block N is shipped while block N+1
+ *    is transferred:
+ *
+ *      faReadBlockStart(slot, 2);
+ *      nwords = faReadBlockWait(&data);       <- block N
+ *      ... block N+1 ready ...
+ *      faReadBlockStart(slot, 2);             <- block N+1 transfers
+ *      ship(data, nwords);                    <- meanwhile, use block N
+ *      faReadBlockRelease(data);
+ *      nwords = faReadBlockWait(&data);       <- block N+1
+ * </pre>
+ *
+ *  @param  id     Slot number of module to read
+ *  @param  rflag  Readout Flag
+ * <pre>
+ *              1 - DMA transfer using Universe/Tempe DMA Engine 
+ *                    (DMA VME transfer Mode must be setup prior)
+ *              2 - Multiblock DMA transfer (Multiblock must be enabled
+ *                     and daisychain in place or SD being used)
+ * </pre>
+ *  @return Index of the buffer receiving the block if successful, otherwise ERROR.
+ */
+int
+faReadBlockStart(int id, int rflag)
+{
+  int ibuf, rmode, rval;
+
+  if(id==0) id=fadcID[0];
+
+  if((id<=0) || (id>21) || (FAp[id] == NULL)) 
+    {
+      logMsg("faReadBlockStart: ERROR : FADC in slot %d is not initialized \n",id,0,0,0,0,0);
+      return(ERROR);
+    }
+
+  rmode = rflag&0x0f;
+  if((rmode != 1) && (rmode != 2))
+    {
+      logMsg("faReadBlockStart: ERROR: Invalid readout mode (%d)\n",rmode,2,3,4,5,6);
+      return(ERROR);
+    }
+
+  /* The buffer checks, the start of the transfer and the state update
+     are one step under the crate lock, so that two callers can not start
+     transfers into the same buffer */
+  FALOCK;
+  if(fadcDmaNbuf == 0)
+    {
+      logMsg("faReadBlockStart: ERROR: No buffers registered (faReadBlockSetBuffers)\n",
+	     1,2,3,4,5,6);
+      FAUNLOCK;
+      return(ERROR);
+    }
+  if(fadcDmaBusy >= 0)
+    {
+      logMsg("faReadBlockStart: ERROR: Transfer into buffer %d still in progress\n",
+	     fadcDmaBusy,2,3,4,5,6);
+      FAUNLOCK;
+      return(ERROR);
+    }
+  ibuf = fadcDmaNext;
+  if(fadcDmaBufState[ibuf] != FA_DMABUF_FREE)
+    {
+      logMsg("faReadBlockStart: ERROR: Buffer %d has not been released\n",ibuf,2,3,4,5,6);
+      FAUNLOCK;
+      return(ERROR);
+    }
+
+  /* Registered buffers are 8 byte aligned: no dummy word */
+  fadcBlockError=FA_BLOCKERROR_NO_ERROR;
+  rval = faDmaStart("faReadBlockStart", id, fadcDmaBuf[ibuf], fadcDmaBufWords, rmode);
+  if(rval != 0)
+    {
+      FAUNLOCK;
+      return(ERROR);
+    }
+
+  fadcDmaBufState[ibuf] = FA_DMABUF_BUSY;
+  fadcDmaBusy  = ibuf;
+  fadcDmaId    = id;
+  fadcDmaRmode = rmode;
+  fadcDmaNext  = (ibuf + 1) % fadcDmaNbuf;
+  FAUNLOCK;
+
+  return(ibuf);
+}
+
+/**
+ *  @ingroup Readout
+ *  @brief Wait for the transfer started by faReadBlockStart to complete.
+ *
+ *    The result is classified as in faReadBlock (see faGetBlockError).
+ *
+ *  @param  data   Where to return the address of the filled buffer (may be NULL)
+ *  @return Number of words in the buffer, or ERROR if no transfer was started.
+ */
+int
+faReadBlockWait(volatile UINT32 **data)
+{
+  int retVal, ibuf;
+
+  if(fadcDmaBusy < 0)
+    {
+      logMsg("faReadBlockWait: ERROR: No transfer in progress\n",1,2,3,4,5,6);
+      return(ERROR);
+    }
+
+#ifdef VXWORKS
+  retVal = sysVmeDmaDone(10000,1);
+#else
+  retVal = vmeDmaDone();
+#endif
+
+  FALOCK;
+  retVal = faBlockTransferResult("faReadBlockWait", fadcDmaId, fadcDmaRmode,
+				 fadcDmaBufWords, 0, retVal);
+  ibuf = fadcDmaBusy;
+  fadcDmaBufState[ibuf] = FA_DMABUF_FULL;
+  fadcDmaBusy = -1;
+  if(data)
+    *data = fadcDmaBuf[ibuf];
+  FAUNLOCK;
+
+  return(retVal);
+}
+
+/**
+ *  @ingroup Readout
+ *  @brief Check for a transfer started by faReadBlockStart that has not
+ *         been completed with faReadBlockWait.
+ *  @return 1 if a transfer is outstanding, otherwise 0.
+ */
+int
+faReadBlockPending()
+{
+  return (fadcDmaBusy >= 0) ? 1 : 0;
+}
+
+/**
+ *  @ingroup Readout
+ *  @brief Return a buffer filled by faReadBlockWait for reuse.
+ *  @param  data   Buffer address returned by faReadBlockWait
+ *  @return OK if successful, otherwise ERROR.
+ */
+int
+faReadBlockRelease(volatile UINT32 *data)
+{
+  int ibuf;
+
+  FALOCK;
+  for(ibuf=0; ibuf<fadcDmaNbuf; ibuf++)
+    {
+      if((fadcDmaBuf[ibuf] == data) && (fadcDmaBufState[ibuf] == FA_DMABUF_FULL))
+	{
+	  fadcDmaBufState[ibuf] = FA_DMABUF_FREE;
+	  FAUNLOCK;
+	  return OK;
+	}
+    }
+  FAUNLOCK;
+
+  logMsg("faReadBlockRelease: ERROR: 0x%lx is not a filled buffer\n",
+	 (unsigned long)data,2,3,4,5,6);
+  return ERROR;
+}
+
+/**
+ *  @ingroup Readout
+ *  @brief Print the current available block to standard out
+ *  @param id Slot number
+ *  @param rflag Not used
+ *  @return Number of words read if successful, otherwise ERROR.
+ */
+int
+faPrintBlock(int id, int rflag)
+{
+
+  int ii, blknum, evnum1;
+  int nwrds=32768, dCnt, berr=0;
+  unsigned int data, bhead, ehead;
+
+  if(id==0) id=fadcID[0];
+
+  if((id<=0) || (id>21) || (FAp[id] == NULL)) 
+    {
+      printf("faPrintEvent: ERROR : FADC in slot %d is not initialized \n",id);
+      return(ERROR);
+    }
+
+  /* Check if data available */
+  FASLOTLOCK(id);
+  if((vmeRead32(&(FAp[id]->ev_count))&FA_EVENT_COUNT_MASK)==0) 
+    {
+      printf("faPrintEvent: ERROR: FIFO Empty\n");
+      FASLOTUNLOCK(id);
+      return(0);
+    }
+
+  /* Check if Bus Errors are enabled. If so then disable for reading */
+  berr = vmeRead32(&(FAp[id]->ctrl1))&FA_ENABLE_BERR;
+  if(berr)
+    vmeWrite32(&(FAp[id]->ctrl1),
+	       vmeRead32(&(FAp[id]->ctrl1)) & ~FA_ENABLE_BERR);
+  
+  dCnt = 0;
+  /* Read Block Header - should be first word */
+  bhead = (unsigned int) *FApd[id];
+#ifndef VXWORKS
+  bhead = LSWAP(bhead);
+#endif
+  if( (bhead&FA_DATA_TYPE_DEFINE)&&((bhead&FA_DATA_TYPE_MASK) == FA_DATA_BLOCK_HEADER)) 
+    {
+      blknum = bhead&FA_DATA_BLKNUM_MASK;
+      ehead = (unsigned int) *FApd[id];
+#ifndef VXWORKS
+      ehead = LSWAP(ehead);
+#endif
+      evnum1 = ehead&FA_DATA_TRIGNUM_MASK;
+      printf("%4d: ",dCnt+1); 
+      faDataDecode(bhead);
+      dCnt++;
+      printf("%4d: ",dCnt+1); 
+      faDataDecode(ehead);
+      dCnt++;
+    }
+  else
+    {
+      /* We got bad data - Check if there is any data at all */
+      if((vmeRead32(&(FAp[id]->ev_count))&FA_EVENT_COUNT_MASK)==0) 
+	{
+	  logMsg("faPrintBlock: FIFO Empty (0x%08x)\n",bhead,0,0,0,0,0);
+	  FASLOTUNLOCK(id);
+	  return(0);
+	} 
+      else 
+	{
+	  logMsg("faPrintBlock: ERROR: Invalid Header Word 0x%08x\n",bhead,0,0,0,0,0);
+	  FASLOTUNLOCK(id);
+	  return(ERROR);
+	}
+    }
+  
+  ii=0;
+  while(ii<nwrds) 
+    {
+      data = (unsigned int) *FApd[id];
+#ifndef VXWORKS
+      data = LSWAP(data);
+#endif
+      printf("%4d: ",dCnt+1+ii); 
+      faDataDecode(data);
+      if((data&FA_DATA_TYPE_DEFINE)&&((data&FA_DATA_TYPE_MASK) == FA_DATA_BLOCK_TRAILER))
+	break;
+      if((data&FA_DATA_TYPE_DEFINE)&&((data&FA_DATA_TYPE_MASK) == FA_DATA_INVALID))
+	break;
+      ii++;
+    }
+  ii++;
+  dCnt += ii;
+
+
+  if(berr)
+    vmeWrite32(&(FAp[id]->ctrl1),
+	       vmeRead32( &(FAp[id]->ctrl1)) | FA_ENABLE_BERR );
+  
+  FASLOTUNLOCK(id);
+  return(dCnt);
+  
 }
 
 /**
@@ -3070,9 +3760,9 @@ faReadCSR(int id)
       return(0);
     }
   
-  FALOCK;
+  FASLOTLOCK(id);
   rval = vmeRead32(&(FAp[id]->csr));
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
   
   return(rval);
 }
@@ -3094,9 +3784,10 @@ faClear(int id)
       logMsg("faClear: ERROR : ADC in slot %d is not initialized \n",id,0,0,0,0,0);
       return;
     }
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&(FAp[id]->csr),FA_CSR_SOFT_RESET);
-  FAUNLOCK;
+  faShadowClear(id);
+  FASLOTUNLOCK(id);
 }
 
 /**
@@ -3119,7 +3810,10 @@ faGClear()
 	}
       else
 	{
+	  FASLOTLOCK(id);
 	  vmeWrite32(&(FAp[id]->csr),FA_CSR_SOFT_RESET);
+	  faShadowClear(id);
+	  FASLOTUNLOCK(id);
 	}
     }
   FAUNLOCK;
@@ -3143,9 +3837,9 @@ faClearError(int id)
       return;
     }
   
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&(FAp[id]->csr),FA_CSR_ERROR_CLEAR);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
 }
 
@@ -3169,7 +3863,9 @@ faGClearError()
 	}
       else
 	{
+	  FASLOTLOCK(id);
 	  vmeWrite32(&(FAp[id]->csr),FA_CSR_ERROR_CLEAR);
+	  FASLOTUNLOCK(id);
 	}
     }
   FAUNLOCK;
@@ -3198,7 +3894,7 @@ faReset(int id, int iFlag)
       return;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   if(iFlag==0)
     {
       a32addr = vmeRead32(&(FAp[id]->adr32));
@@ -3206,6 +3902,7 @@ faReset(int id, int iFlag)
     }
 
   vmeWrite32(&(FAp[id]->csr),FA_CSR_HARD_RESET);
+  faShadowClear(id);
   taskDelay(10);
 
   if(iFlag==0)
@@ -3213,7 +3910,7 @@ faReset(int id, int iFlag)
       vmeWrite32(&(FAp[id]->adr32),a32addr);
       vmeWrite32(&(FAp[id]->adr_mb),addrMB);
     }
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
 }
 
@@ -3236,15 +3933,20 @@ faGReset(int iFlag)
       for(ifa=0; ifa<nfadc; ifa++)
 	{
 	  id = faSlot(ifa);
+	  FASLOTLOCK(id);
 	  a32addr[id] = vmeRead32(&(FAp[id]->adr32));
 	  addrMB[id]  = vmeRead32(&(FAp[id]->adr_mb));
+	  FASLOTUNLOCK(id);
 	}
     }
   
   for(ifa=0; ifa<nfadc; ifa++)
     {
       id = faSlot(ifa);
+      FASLOTLOCK(id);
       vmeWrite32(&(FAp[id]->csr),FA_CSR_HARD_RESET);
+      faShadowClear(id);
+      FASLOTUNLOCK(id);
     }
 
   taskDelay(10);
@@ -3254,43 +3956,482 @@ faGReset(int iFlag)
       for(ifa=0; ifa<nfadc; ifa++)
 	{
 	  id = faSlot(ifa);
+	  FASLOTLOCK(id);
 	  vmeWrite32(&(FAp[id]->adr32),a32addr[id]);
 	  vmeWrite32(&(FAp[id]->adr_mb),addrMB[id]);
+	  FASLOTUNLOCK(id);
+	}
+    }
+
+  FAUNLOCK;
+
+}
+
+
+
+/**
+ *  @ingroup Config
+ *  @brief Perform either a soft clear or soft reset
+ *  @param id Slot number
+ *  @param cflag 
+ *    -  0: Soft Clear
+ *    - >0: Soft Reset
+ */
+void
+faSoftReset(int id, int cflag)
+{
+  if(id==0) id=fadcID[0];
+
+  if((id<=0) || (id>21) || (FAp[id] == NULL)) 
+    {
+      logMsg("faReset: ERROR : ADC in slot %d is not initialized \n",id,0,0,0,0,0);
+      return;
+    }
+
+  FASLOTLOCK(id);
+  if(cflag) /* perform soft clear */
+    vmeWrite32(&(FAp[id]->csr),FA_CSR_SOFT_CLEAR);
+  else      /* normal soft reset */
+    vmeWrite32(&(FAp[id]->csr),FA_CSR_SOFT_RESET);
+  faShadowClear(id);
+  FASLOTUNLOCK(id);
+  
+}
+
+/**
+ *  @ingroup Config
+ *  @brief Select how the library uses its write-through shadow of the
+ *    configuration registers
+ *
+ *    Setters that modify part of a register (DAC and threshold pairs,
+ *    adc_config[0-1], adc_nsa) normally read it back over VME first.
+ *    With the shadow enabled they use the value last written instead,
+ *    and faSetDAC skips its readback check.
+ *
+ *    The shadow is invalidated by faReset, faSoftReset, faClear and the
+ *    DAC resets.  Call faShadowInvalidate after writing those registers
+ *    other than through this library.
+ *
+ *  @param mode
+ *     - FA_SHADOW_DISABLE: Always read the module (default)
+ *     - FA_SHADOW_ENABLE: Use the shadow when it is current
+ *     - FA_SHADOW_VERIFY: Read the module and report differences from the shadow
+ *  @return OK if successful, otherwise ERROR.
+ */
+int
+faSetShadowMode(int mode)
+{
+  if((mode < FA_SHADOW_DISABLE) || (mode > FA_SHADOW_VERIFY))
+    {
+      logMsg("faSetShadowMode: ERROR: Invalid mode (%d)\n",mode,2,3,4,5,6);
+      return ERROR;
+    }
+
+  FALOCK;
+  fadcShadowMode = mode;
+  FAUNLOCK;
+
+  return OK;
+}
+
+/**
+ *  @ingroup Status
+ *  @brief Return the register shadow mode set by faSetShadowMode
+ */
+int
+faGetShadowMode()
+{
+  return fadcShadowMode;
+}
+
+/**
+ *  @ingroup Config
+ *  @brief Invalidate the register shadow of the module, so that the next
+ *    access to each register reads the module
+ *  @param id Slot number
+ *  @return OK if successful, otherwise ERROR.
+ */
+int
+faShadowInvalidate(int id)
+{
+  if(id==0) id=fadcID[0];
+
+  if((id<=0) || (id>21) || (FAp[id] == NULL)) 
+    {
+      logMsg("faShadowInvalidate: ERROR : ADC in slot %d is not initialized \n",id,0,0,0,0,0);
+      return ERROR;
+    }
+
+  FASLOTLOCK(id);
+  faShadowClear(id);
+  FASLOTUNLOCK(id);
+
+  return OK;
+}
+
+/**
+ *  @ingroup Config
+ *  @brief Start a batch of register writes
+ *
+ *    Writes queued with faTransWrite32, faTransSetDAC and faTransSetThreshold
+ *    for any number of modules are held until faTransCommit, which issues
+ *    them under a single acquisition of the library locks.  Writes to the
+ *    same register are merged, so that setting the 16 DAC channels of a
+ *    module one at a time costs 8 VME writes.
+ *
+ *  @return OK if successful, otherwise ERROR.
+ *  @sa faTransCommit faTransAbort
+ */
+int
+faTransBegin()
+{
+  FALOCK;
+  if(fadcTransOpen)
+    {
+      FAUNLOCK;
+      logMsg("faTransBegin: ERROR: Transaction already open\n",1,2,3,4,5,6);
+      return ERROR;
+    }
+
+  memset(fadcTransQueued, 0, sizeof(fadcTransQueued));
+  fadcTransOpen = 1;
+  FAUNLOCK;
+
+  return OK;
+}
+
+/*
+ * Queue a register write.  Must be called with the crate lock held.
+ */
+static void
+faTransQueue(int id, int iword, unsigned int val)
+{
+  fadcTransVal[id][iword] = val;
+  fadcTransQueued[id][iword] = 1;
+}
+
+/*
+ * Current value of a 16 bit register pair: the queued write, if there is
+ * one, otherwise the module (or shadow) value.  Must be called with the
+ * crate lock held.
+ */
+static unsigned int
+faTransPair(int id, volatile unsigned short *reg)
+{
+  int iword = faShadowIndex(id, reg);
+  unsigned int val;
+
+  if(fadcTransQueued[id][iword])
+    return fadcTransVal[id][iword];
+
+  FASLOTLOCK(id);
+  val = (faShadowRead16(id, &reg[0])<<16) | faShadowRead16(id, &reg[1]);
+  FASLOTUNLOCK(id);
+
+  return val;
+}
+
+/* Registers faTransWrite32 accepts: byte offset and number of 32 bit
+   words.  Configuration registers only, that read back what was written.
+   Command and self-clearing registers (csr, reset, prom_reg1, mem_adr,
+   scaler_ctrl, mgt_ctrl, adc_config[2-3], ...) and the control words
+   with enable or go bits (ctrl1, ctrl2, intr, trigger_control) must not
+   be merged or shadowed. */
+static const struct
+{
+  unsigned short offset;
+  unsigned short nwords;
+} faTransConfigMap[] =
+  {
+    {0x010,  1},   /* blk_level */
+    {0x018,  2},   /* adr32, adr_mb */
+    {0x024,  2},   /* delay, itrig_cfg */
+    {0x050,  8},   /* dac[16] */
+    {0x088,  1},   /* trig21_delay */
+    {0x0C0,  1},   /* busy_level */
+    {0x0F0,  2},   /* scaler_interval, sum_threshold */
+    {0x10C,  2},   /* adc_config[0-1] */
+    {0x11C,  4},   /* adc_ptw, adc_pl, adc_nsb, adc_nsa */
+    {0x12C, 10},   /* adc_thres[16], config6, config7 */
+    {0x158, 17},   /* adc_pedestal[16], config3 */
+  };
+#define FA_TRANS_NCONFIG (sizeof(faTransConfigMap)/sizeof(faTransConfigMap[0]))
+
+/**
+ *  @ingroup Config
+ *  @brief Queue a register write in the open transaction
+ *
+ *    Only configuration registers are accepted (faTransConfigMap).  Command
+ *    registers are written directly, e.g. with faReset or faSetProcMode.
+ *
+ *  @param id Slot number
+ *  @param offset Byte offset of the register in struct fadc_struct,
+ *     e.g. offsetof(struct fadc_struct, blk_level)
+ *  @param val Value to write
+ *  @return OK if successful, otherwise ERROR.
+ */
+int
+faTransWrite32(int id, unsigned int offset, unsigned int val)
+{
+  int irange, config=0;
+
+  if(id==0) id=fadcID[0];
+
+  if((id<=0) || (id>21) || (FAp[id] == NULL)) 
+    {
+      logMsg("faTransWrite32: ERROR : ADC in slot %d is not initialized \n",id,0,0,0,0,0);
+      return ERROR;
+    }
+
+  for(irange=0; irange<FA_TRANS_NCONFIG; irange++)
+    {
+      if((offset >= faTransConfigMap[irange].offset) &&
+	 (offset < faTransConfigMap[irange].offset + (faTransConfigMap[irange].nwords<<2)))
+	config = 1;
+    }
+
+  if((offset & 0x3) || !config)
+    {
+      logMsg("faTransWrite32: ERROR: Register offset 0x%x is not a configuration register\n",
+	     offset,2,3,4,5,6);
+      return ERROR;
+    }
+
+  FALOCK;
+  if(!fadcTransOpen)
+    {
+      FAUNLOCK;
+      logMsg("faTransWrite32: ERROR: No open transaction\n",1,2,3,4,5,6);
+      return ERROR;
+    }
+  faTransQueue(id, offset>>2, val);
+  FAUNLOCK;
+
+  return OK;
+}
+
+/**
+ *  @ingroup Config
+ *  @brief Queue a change of the DAC value of the specified channel mask in
+ *    the open transaction
+ *  @param id Slot number
+ *  @param dvalue DAC Value
+ *  @param chmask Mask of channels to set
+ *  @return OK if successful, otherwise ERROR.
+ *  @sa faSetDAC
+ */
+int
+faTransSetDAC(int id, unsigned short dvalue, unsigned short chmask)
+{
+  int ii;
+  unsigned int newval;
+
+  if(id==0) id=fadcID[0];
+
+  if((id<=0) || (id>21) || (FAp[id] == NULL)) 
+    {
+      logMsg("faTransSetDAC: ERROR : ADC in slot %d is not initialized \n",id,0,0,0,0,0);
+      return ERROR;
+    }
+
+  if(chmask==0) chmask = 0xffff;  /* Set All channels the same */
+
+  if(dvalue>0xfff) 
+    {
+      logMsg("faTransSetDAC: ERROR : DAC value (%d) out of range (0-4095) \n",
+	     dvalue,0,0,0,0,0);
+      return ERROR;
+    }
+
+  FALOCK;
+  if(!fadcTransOpen)
+    {
+      FAUNLOCK;
+      logMsg("faTransSetDAC: ERROR: No open transaction\n",1,2,3,4,5,6);
+      return ERROR;
+    }
+
+  for(ii=0; ii<FA_MAX_ADC_CHANNELS; ii+=2)
+    {
+      if(((3<<ii)&chmask)==0)
+	continue;
+
+      newval = faTransPair(id, &FAp[id]->dac[ii]);
+      if((1<<ii)&chmask)
+	newval = (newval & 0xFFFF) | ((dvalue&FA_DAC_VALUE_MASK)<<16);
+      if((1<<(ii+1))&chmask)
+	newval = (newval & 0xFFFF0000) | (dvalue&FA_DAC_VALUE_MASK);
+
+      faTransQueue(id, faShadowIndex(id, &FAp[id]->dac[ii]), newval);
+    }
+  FAUNLOCK;
+
+  return OK;
+}
+
+/**
+ *  @ingroup Config
+ *  @brief Queue a change of the readout threshold of the specified channel
+ *    mask in the open transaction
+ *  @param id Slot number
+ *  @param tvalue Threshold value
+ *  @param chmask Mask of channels to set
+ *  @return OK if successful, otherwise ERROR.
+ *  @sa faSetThreshold
+ */
+int
+faTransSetThreshold(int id, unsigned short tvalue, unsigned short chmask)
+{
+  int ii;
+  unsigned int newval;
+
+  if(id==0) id=fadcID[0];
+
+  if((id<=0) || (id>21) || (FAp[id] == NULL)) 
+    {
+      logMsg("faTransSetThreshold: ERROR : ADC in slot %d is not initialized \n",id,0,0,0,0,0);
+      return ERROR;
+    }
+
+  if(chmask==0) chmask = 0xffff;  /* Set All channels the same */
+
+  FALOCK;
+  if(!fadcTransOpen)
+    {
+      FAUNLOCK;
+      logMsg("faTransSetThreshold: ERROR: No open transaction\n",1,2,3,4,5,6);
+      return ERROR;
+    }
+
+  for(ii=0; ii<FA_MAX_ADC_CHANNELS; ii+=2)
+    {
+      if(((3<<ii)&chmask)==0)
+	continue;
+
+      newval = faTransPair(id, &FAp[id]->adc_thres[ii]);
+      if((1<<ii)&chmask)
+	newval = (newval & 0xFFFF) | (tvalue<<16);
+      if((1<<(ii+1))&chmask)
+	newval = (newval & 0xFFFF0000) | tvalue;
+
+      faTransQueue(id, faShadowIndex(id, &FAp[id]->adc_thres[ii]), newval);
+    }
+  FAUNLOCK;
+
+  return OK;
+}
+
+/*
+ * Readback of a DAC channel pair written by faTransCommit, with the write
+ * timeout check done by faSetDAC.  Must be called with the slot lock held.
+ */
+static int
+faTransCheckDAC(int id, int ii, unsigned int val)
+{
+  unsigned int lovalue = val>>16, hivalue = val & 0xFFFF;
+  unsigned int lovalue_rb, hivalue_rb;
+
+  lovalue_rb = vmeRead16(&FAp[id]->dac[ii]);
+  hivalue_rb = vmeRead16(&FAp[id]->dac[ii+1]);
+
+  if((lovalue_rb == lovalue) && (hivalue_rb == hivalue))
+    return OK;
+
+  printf("%s: ERROR: Slot %d: Readback of DAC Channels (%d, %d) != Write value\n",
+	 __FUNCTION__, id, ii, ii+1);
+  printf("  %2d: Read: 0x%04x %s Write: 0x%04x\n",
+	 ii, lovalue_rb & FA_DAC_VALUE_MASK,
+	 (lovalue_rb & FA_DAC_WRITE_TIMEOUT_ERROR)?
+	 "-Write Timeout ERROR-":
+	 "                     ",
+	 lovalue);
+  printf("  %2d: Read: 0x%04x %s Write: 0x%04x\n",
+	 ii+1, hivalue_rb & FA_DAC_VALUE_MASK,
+	 (hivalue_rb & FA_DAC_WRITE_TIMEOUT_ERROR)?
+	 "-Write Timeout ERROR-":
+	 "                     ",
+	 hivalue);
+
+  /* The module does not hold what was written */
+  fadcShadowValid[id][faShadowIndex(id, &FAp[id]->dac[ii])] = 0;
+
+  return ERROR;
+}
+
+/**
+ *  @ingroup Config
+ *  @brief Issue the register writes queued since faTransBegin
+ *
+ *    The crate lock is held for the whole commit, and each module lock
+ *    while that module is written.  Registers are written in address order
+ *    within each module, modules in the order found by faInit.  DAC writes
+ *    are read back as in faSetDAC, unless the register shadow is trusted
+ *    (FA_SHADOW_ENABLE).
+ *
+ *  @return Number of register writes issued, ERROR if there is no open
+ *     transaction or a DAC readback failed.  All queued writes are issued
+ *     in either case.
+ */
+int
+faTransCommit()
+{
+  int ifa, id, iword, idac, nwrite=0, rval=OK;
+
+  FALOCK;
+  if(!fadcTransOpen)
+    {
+      FAUNLOCK;
+      logMsg("faTransCommit: ERROR: No open transaction\n",1,2,3,4,5,6);
+      return ERROR;
+    }
+
+  for(ifa=0; ifa<nfadc; ifa++)
+    {
+      id = faSlot(ifa);
+      if(memchr(fadcTransQueued[id], 1, FA_SHADOW_NWORDS) == NULL)
+	continue;
+
+      idac = faShadowIndex(id, &FAp[id]->dac[0]);
+
+      FASLOTLOCK(id);
+      for(iword=0; iword<FA_SHADOW_NWORDS; iword++)
+	{
+	  if(fadcTransQueued[id][iword])
+	    {
+	      faShadowWrite32(id, (volatile unsigned int *)FAp[id] + iword,
+			      fadcTransVal[id][iword]);
+	      nwrite++;
+
+	      if((iword >= idac) && (iword < idac + FA_MAX_ADC_CHANNELS/2) &&
+		 (fadcShadowMode != FA_SHADOW_ENABLE))
+		{
+		  if(faTransCheckDAC(id, (iword-idac)<<1, fadcTransVal[id][iword]) != OK)
+		    rval = ERROR;
+		}
+	    }
 	}
+      FASLOTUNLOCK(id);
     }
 
+  fadcTransOpen = 0;
   FAUNLOCK;
 
-}
-
+  if(rval != OK)
+    return ERROR;
 
+  return nwrite;
+}
 
 /**
  *  @ingroup Config
- *  @brief Perform either a soft clear or soft reset
- *  @param id Slot number
- *  @param cflag 
- *    -  0: Soft Clear
- *    - >0: Soft Reset
+ *  @brief Discard the register writes queued since faTransBegin
  */
 void
-faSoftReset(int id, int cflag)
+faTransAbort()
 {
-  if(id==0) id=fadcID[0];
-
-  if((id<=0) || (id>21) || (FAp[id] == NULL)) 
-    {
-      logMsg("faReset: ERROR : ADC in slot %d is not initialized \n",id,0,0,0,0,0);
-      return;
-    }
-
   FALOCK;
-  if(cflag) /* perform soft clear */
-    vmeWrite32(&(FAp[id]->csr),FA_CSR_SOFT_CLEAR);
-  else      /* normal soft reset */
-    vmeWrite32(&(FAp[id]->csr),FA_CSR_SOFT_RESET);
+  fadcTransOpen = 0;
   FAUNLOCK;
-  
 }
 
 /**
@@ -3315,9 +4456,9 @@ faResetToken(int id)
       return;
     }
   
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&(FAp[id]->reset),FA_RESET_TOKEN);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 }
 
 /**
@@ -3339,9 +4480,9 @@ faTokenStatus(int id)
       return ERROR;
     }
   
-  FALOCK;
+  FASLOTLOCK(id);
   rval = (vmeRead32(&FAp[id]->csr) & FA_CSR_TOKEN_STATUS)>>4;
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return rval;
 }
@@ -3386,9 +4527,9 @@ faSetCalib(int id, unsigned short sdelay, unsigned short tdelay)
       return;
     }
   
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&(FAp[id]->delay),(sdelay<<16) | tdelay);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
 }
 
@@ -3419,10 +4560,10 @@ faSetChannelDisable(int id, int channel)
 
   fadcChanDisable[id] = fadcChanDisable[id] | (1<<channel);
 
-  FALOCK;
+  FASLOTLOCK(id);
   /* Write New Disable Mask */
-  vmeWrite32(&(FAp[id]->adc_config[1]), fadcChanDisable[id]);
-  FAUNLOCK;
+  faShadowWrite32(id, &FAp[id]->adc_config[1], fadcChanDisable[id]);
+  FASLOTUNLOCK(id);
   
   return OK;
 }
@@ -3460,10 +4601,10 @@ faSetChannelDisableMask(int id, unsigned short cmask)
 
   fadcChanDisable[id] = cmask;  /* Set Global Variable */
 
-  FALOCK;
+  FASLOTLOCK(id);
   /* Write New Disable Mask */
-  vmeWrite32(&(FAp[id]->adc_config[1]), fadcChanDisable[id]);
-  FAUNLOCK;
+  faShadowWrite32(id, &FAp[id]->adc_config[1], fadcChanDisable[id]);
+  FASLOTUNLOCK(id);
 
   return OK;
 }
@@ -3495,10 +4636,10 @@ faSetChannelEnable(int id, int channel)
 
   fadcChanDisable[id] = fadcChanDisable[id] & (~(1<<channel) & 0xFFFF);
 
-  FALOCK;
+  FASLOTLOCK(id);
   /* Write New Disable Mask */
-  vmeWrite32(&(FAp[id]->adc_config[1]), fadcChanDisable[id]);
-  FAUNLOCK;
+  faShadowWrite32(id, &FAp[id]->adc_config[1], fadcChanDisable[id]);
+  FASLOTUNLOCK(id);
   
   return OK;
 }
@@ -3523,10 +4664,10 @@ faSetChannelEnableMask(int id, unsigned short enMask)
 
   fadcChanDisable[id] = ~(enMask) & FA_ADC_CHAN_MASK;
 
-  FALOCK;
+  FASLOTLOCK(id);
   /* Write New Disable Mask */
-  vmeWrite32(&FAp[id]->adc_config[1], fadcChanDisable[id]);
-  FAUNLOCK;
+  faShadowWrite32(id, &FAp[id]->adc_config[1], fadcChanDisable[id]);
+  FASLOTUNLOCK(id);
   
   return OK;
 }
@@ -3552,9 +4693,9 @@ faGetChannelMask(int id, int type)
       return ERROR;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   fadcChanDisable[id] = vmeRead32(&FAp[id]->adc_config[1]) & FA_ADC_CHAN_MASK;
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   if(type!=0)
     rval = (~fadcChanDisable[id]) & FA_ADC_CHAN_MASK;
@@ -3581,7 +4722,7 @@ faEnableSyncSrc(int id)
       return;
     }
     
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&(FAp[id]->ctrl2), FA_CTRL_GO | FA_CTRL_ENABLE_SRESET);
 
   /* Keep this bit set, if it is */
@@ -3590,7 +4731,7 @@ faEnableSyncSrc(int id)
   if(fadcAlignmentDebug)
     {
       /* Disable front end channel data */
-      vmeWrite32(&FAp[id]->adc_config[1],0xffff);
+      faShadowWrite32(id, &FAp[id]->adc_config[1],0xffff);
 
       printf("%s: Enabling alignment debugging sequence\n",__FUNCTION__);
       /* Enable data alignment debugging sequence */
@@ -3608,7 +4749,7 @@ faEnableSyncSrc(int id)
       vmeWrite32(&FAp[id]->mgt_ctrl, FA_MGT_FRONT_END_TO_CTP | FA_MGT_ENABLE_DATA_ALIGNMENT | reg);
     }
 
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   /* Allow time for the fADC250 to CTP lanes to come back up */
   taskDelay(1);
@@ -3648,7 +4789,7 @@ faEnable(int id, int eflag, int bank)
       return;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
 
 #if 0
 
@@ -3665,7 +4806,7 @@ faEnable(int id, int eflag, int bank)
   if(stat==0)
     {
       logMsg("faEnable: ERROR: ADC in slot %d NOT READY to Enable.\n",id,0,0,0,0,0);
-      FAUNLOCK;
+      FASLOTUNLOCK(id);
       return;
     }
 
@@ -3680,7 +4821,7 @@ faEnable(int id, int eflag, int bank)
       /* Disable data alignment debugging sequence */
       vmeWrite32(&FAp[id]->mgt_ctrl, FA_MGT_FRONT_END_TO_CTP | FA_MGT_ENABLE_DATA_ALIGNMENT | reg);
       /* Re-enable front end channel data */
-      vmeWrite32(&FAp[id]->adc_config[1], fadcChanDisable[id]);
+      faShadowWrite32(id, &FAp[id]->adc_config[1], fadcChanDisable[id]);
     }
 
 
@@ -3696,7 +4837,7 @@ faEnable(int id, int eflag, int bank)
 		 FA_CTRL_GO | FA_CTRL_ENABLE_TRIG | FA_CTRL_ENABLE_SRESET);
     }
 
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 }
 
 /**
@@ -3742,7 +4883,7 @@ faDisable(int id, int eflag)
       return;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   /* Wait until PROC has finished processing buffered triggers */
   stat = vmeRead32(&FAp[id]->adc_status[1]) & FA_ADC_STATUS1_TRIG_RCV_DONE;
 
@@ -3756,7 +4897,7 @@ faDisable(int id, int eflag)
   if(stat==0)
     {
       logMsg("faDisable: ERROR: ADC in slot %d NOT READY to Disable.\n",id,0,0,0,0,0);
-      FAUNLOCK;
+      FASLOTUNLOCK(id);
       return;
     }
 
@@ -3764,7 +4905,7 @@ faDisable(int id, int eflag)
     vmeWrite32(&(FAp[id]->ctrl2),0);   /* Turn FIFO Transfer off as well */
   else
     vmeWrite32(&(FAp[id]->ctrl2),FA_CTRL_GO);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 }
 
 /**
@@ -3803,12 +4944,12 @@ faTrig(int id)
       return;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   if( vmeRead32(&(FAp[id]->ctrl1)) & (FA_ENABLE_SOFT_TRIG) )
     vmeWrite32(&(FAp[id]->csr), FA_CSR_TRIGGER);
   else
     logMsg("faTrig: ERROR: Software Triggers not enabled",0,0,0,0,0,0);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 }
 
 /**
@@ -3839,12 +4980,12 @@ faTrig2(int id)
       logMsg("faTrig2: ERROR : ADC in slot %d is not initialized \n",id,0,0,0,0,0);
       return;
     }
-  FALOCK;
+  FASLOTLOCK(id);
   if( vmeRead32(&(FAp[id]->ctrl1)) & (FA_ENABLE_SOFT_TRIG) )
     vmeWrite32(&(FAp[id]->csr), FA_CSR_SOFT_PULSE_TRIG2);
   else
     logMsg("faTrig2: ERROR: Software Triggers not enabled",0,0,0,0,0,0);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 }
 
 /**
@@ -3886,9 +5027,9 @@ faSetTrig21Delay(int id, int delay)
       return ERROR;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&FAp[id]->trig21_delay, delay);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return OK;
 }
@@ -3911,9 +5052,9 @@ faGetTrig21Delay(int id)
       return ERROR;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   rval = vmeRead32(&FAp[id]->trig21_delay) & FA_TRIG21_DELAY_MASK;
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return rval;
 }
@@ -3936,10 +5077,10 @@ faEnableInternalPlaybackTrigger(int id)
       return ERROR;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&FAp[id]->ctrl1, 
 	     (vmeRead32(&FAp[id]->ctrl1) & ~FA_TRIG_MASK) | FA_TRIG_VME_PLAYBACK);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return OK;
 }
@@ -3961,12 +5102,12 @@ faSync(int id)
       return;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   if(vmeRead32(&(FAp[id]->ctrl1))&(FA_ENABLE_SOFT_SRESET))
     vmeWrite32(&(FAp[id]->csr), FA_CSR_SYNC);
   else
     logMsg("faSync: ERROR: Software Sync Resets not enabled\n",0,0,0,0,0,0);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 }
 
 
@@ -3993,12 +5134,12 @@ faDready(int id, int dflag)
       return(ERROR);
     }
   
-  FALOCK;
+  FASLOTLOCK(id);
   if(dflag)
     dcnt = vmeRead32(&(FAp[id]->blk_count))&FA_BLOCK_COUNT_MASK;
   else
     dcnt = vmeRead32(&(FAp[id]->ev_count))&FA_EVENT_COUNT_MASK;
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   
   return(dcnt);
@@ -4023,9 +5164,9 @@ faBready(int id)
       return(ERROR);
     }
   
-  FALOCK;
+  FASLOTLOCK(id);
   stat = (vmeRead32(&(FAp[id]->csr))) &FA_CSR_BLOCK_READY;
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   if(stat)
     return(1);
@@ -4107,7 +5248,7 @@ faBusyLevel(int id, unsigned int val, int bflag)
     return(ERROR);
   
   /* if Val > 0 then set the Level else leave it alone*/
-  FALOCK;
+  FASLOTLOCK(id);
   if(val) 
     {
       if(bflag)
@@ -4121,7 +5262,7 @@ faBusyLevel(int id, unsigned int val, int bflag)
       if(bflag)
 	vmeWrite32(&(FAp[id]->busy_level),(blreg | FA_FORCE_BUSY));
     }
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return((blreg&FA_BUSY_LEVEL_MASK));
 }
@@ -4146,10 +5287,10 @@ faBusy(int id)
       return(ERROR);
     }
   
-  FALOCK;
+  FASLOTLOCK(id);
   blreg = vmeRead32(&(FAp[id]->busy_level))&FA_BUSY_LEVEL_MASK;
   dreg  = vmeRead32(&(FAp[id]->ram_word_count))&FA_RAM_DATA_MASK;
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   if(dreg>=blreg)
     return(1);
@@ -4175,13 +5316,13 @@ faEnableSoftTrig(int id)
     }
   
   /* Clear the source */
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&(FAp[id]->ctrl1),
 	     vmeRead32(&(FAp[id]->ctrl1)) & ~FA_TRIG_MASK );
   /* Set Source and Enable*/
   vmeWrite32(&(FAp[id]->ctrl1),
 	     vmeRead32(&(FAp[id]->ctrl1)) | (FA_TRIG_VME | FA_ENABLE_SOFT_TRIG) );
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 }
 
 /**
@@ -4218,10 +5359,10 @@ faDisableSoftTrig(int id)
       return;
     }
   
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&(FAp[id]->ctrl1), 
 	     vmeRead32(&(FAp[id]->ctrl1)) & ~FA_ENABLE_SOFT_TRIG );
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
 }
 
@@ -4243,13 +5384,13 @@ faEnableSoftSync(int id)
     }
   
   /* Clear the source */
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&(FAp[id]->ctrl1),
 	     vmeRead32(&(FAp[id]->ctrl1)) & ~FA_SRESET_MASK);
   /* Set Source and Enable*/
   vmeWrite32(&(FAp[id]->ctrl1),
 	     vmeRead32(&(FAp[id]->ctrl1)) | (FA_SRESET_VME | FA_ENABLE_SOFT_SRESET));
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 }
 
 /**
@@ -4269,10 +5410,10 @@ faDisableSoftSync(int id)
       return;
     }
   
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&(FAp[id]->ctrl1),
 	     vmeRead32(&(FAp[id]->ctrl1)) & ~FA_ENABLE_SOFT_SRESET);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
 }
 
@@ -4293,10 +5434,10 @@ faEnableClk(int id)
       return;
     }
   
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&(FAp[id]->ctrl1),
 	     vmeRead32(&(FAp[id]->ctrl1)) | (FA_REF_CLK_INTERNAL|FA_ENABLE_INTERNAL_CLK) );
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
 }
 
@@ -4317,10 +5458,10 @@ faDisableClk(int id)
       return;
     }
   
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&(FAp[id]->ctrl1),
 	     vmeRead32(&(FAp[id]->ctrl1)) & ~FA_ENABLE_INTERNAL_CLK );
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
 }
 
@@ -4366,10 +5507,10 @@ faEnableTriggerOut(int id, int output)
       break;
 	
     }
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&(FAp[id]->ctrl1),
 	     vmeRead32(&(FAp[id]->ctrl1)) | bitset );
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
 
 
@@ -4392,10 +5533,10 @@ faEnableBusError(int id)
       return;
     }
   
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&(FAp[id]->ctrl1),
 	     vmeRead32(&(FAp[id]->ctrl1)) | FA_ENABLE_BERR );
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
 }
 
@@ -4411,8 +5552,10 @@ faGEnableBusError()
   FALOCK;
   for(ii=0;ii<nfadc;ii++) 
     {
+      FASLOTLOCK(fadcID[ii]);
       vmeWrite32(&(FAp[fadcID[ii]]->ctrl1),
 		 vmeRead32(&(FAp[fadcID[ii]]->ctrl1)) | FA_ENABLE_BERR );
+      FASLOTUNLOCK(fadcID[ii]);
     }
   FAUNLOCK;
   
@@ -4435,10 +5578,10 @@ faDisableBusError(int id)
       return;
     }
   
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&(FAp[id]->ctrl1),
 	     vmeRead32(&(FAp[id]->ctrl1)) & ~FA_ENABLE_BERR );
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
 }
 
@@ -4467,30 +5610,33 @@ faEnableMultiBlock(int tflag)
   else
     mode = (FA_ENABLE_MULTIBLOCK | FA_MB_TOKEN_VIA_P2);
     
+  /* Token setup is crate wide: hold the crate lock over the whole chain */
+  FALOCK;
   for(ii=0;ii<nfadc;ii++) 
     {
       id = fadcID[ii];
-      FALOCK;
+      FASLOTLOCK(id);
       vmeWrite32(&(FAp[id]->ctrl1),
 		 vmeRead32(&(FAp[id]->ctrl1)) | mode );
-      FAUNLOCK;
+      FASLOTUNLOCK(id);
       faDisableBusError(id);
       if(id == fadcMinSlot) 
 	{
-	  FALOCK;
+	  FASLOTLOCK(id);
 	  vmeWrite32(&(FAp[id]->ctrl1),
 		     vmeRead32(&(FAp[id]->ctrl1)) | FA_FIRST_BOARD );
-	  FAUNLOCK;
+	  FASLOTUNLOCK(id);
 	}
       if(id == fadcMaxSlot) 
 	{
-	  FALOCK;
+	  FASLOTLOCK(id);
 	  vmeWrite32(&(FAp[id]->ctrl1),
 		     vmeRead32(&(FAp[id]->ctrl1)) | FA_LAST_BOARD );
-	  FAUNLOCK;
+	  FASLOTUNLOCK(id);
 	  faEnableBusError(id);   /* Enable Bus Error only on Last Board */
 	}
     }
+  FAUNLOCK;
 
 }
 
@@ -4511,8 +5657,12 @@ faDisableMultiBlock()
   
   FALOCK;
   for(ii=0;ii<nfadc;ii++)
-    vmeWrite32(&(FAp[fadcID[ii]]->ctrl1),
-	       vmeRead32(&(FAp[fadcID[ii]]->ctrl1)) & ~FA_ENABLE_MULTIBLOCK );
+    {
+      FASLOTLOCK(fadcID[ii]);
+      vmeWrite32(&(FAp[fadcID[ii]]->ctrl1),
+		 vmeRead32(&(FAp[fadcID[ii]]->ctrl1)) & ~FA_ENABLE_MULTIBLOCK );
+      FASLOTUNLOCK(fadcID[ii]);
+    }
   FAUNLOCK;
 
 }
@@ -4538,11 +5688,11 @@ faSetBlockLevel(int id, int level)
     }
   
   if(level<=0) level = 1;
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&(FAp[id]->blk_level), level);
   fadcBlockLevel = level;
   rval = vmeRead32(&(FAp[id]->blk_level)) & FA_BLOCK_LEVEL_MASK;
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return(rval);
 
@@ -4561,7 +5711,11 @@ faGSetBlockLevel(int level)
   if(level<=0) level = 1;
   FALOCK;
   for(ii=0;ii<nfadc;ii++)
-    vmeWrite32(&(FAp[fadcID[ii]]->blk_level), level);
+    {
+      FASLOTLOCK(fadcID[ii]);
+      vmeWrite32(&(FAp[fadcID[ii]]->blk_level), level);
+      FASLOTUNLOCK(fadcID[ii]);
+    }
   FAUNLOCK;
 
   fadcBlockLevel = level;
@@ -4590,14 +5744,14 @@ faSetClkSource(int id, int source)
       return(ERROR);
     }
   
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&(FAp[id]->ctrl1),
 	     vmeRead32(&(FAp[id]->ctrl1)) & ~FA_REF_CLK_SEL_MASK );
   if((source<0)||(source>7)) source = FA_REF_CLK_INTERNAL;
   vmeWrite32(&(FAp[id]->ctrl1),
 	     vmeRead32(&(FAp[id]->ctrl1)) | source );
   rval = vmeRead32(&(FAp[id]->ctrl1)) & FA_REF_CLK_SEL_MASK;
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
 
   return(rval);
@@ -4636,14 +5790,14 @@ faSetTrigSource(int id, int source)
       logMsg("faSetTrigSource: ERROR: Invalid source (%d)\n",source,2,3,4,5,6);
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&(FAp[id]->ctrl1),
 	     vmeRead32(&(FAp[id]->ctrl1)) & ~FA_TRIG_SEL_MASK );
   if((source<0)||(source>7)) source = FA_TRIG_FP_ISYNC;
   vmeWrite32(&(FAp[id]->ctrl1),
 	     vmeRead32(&(FAp[id]->ctrl1)) | source );
   rval = vmeRead32(&(FAp[id]->ctrl1)) & FA_TRIG_SEL_MASK;
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return(rval);
 
@@ -4677,14 +5831,14 @@ faSetSyncSource(int id, int source)
       return(ERROR);
     }
   
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&(FAp[id]->ctrl1),
 	     vmeRead32(&(FAp[id]->ctrl1)) & ~FA_SRESET_SEL_MASK );
   if((source<0)||(source>7)) source = FA_SRESET_FP_ISYNC;
   vmeWrite32(&(FAp[id]->ctrl1),
 	     vmeRead32(&(FAp[id]->ctrl1)) | source );
   rval = vmeRead32(&(FAp[id]->ctrl1)) & FA_SRESET_SEL_MASK;
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return(rval);
 
@@ -4710,13 +5864,13 @@ faEnableFP(int id)
       return;
     }
   
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&(FAp[id]->ctrl1),
 	     vmeRead32(&(FAp[id]->ctrl1)) & 
 	     ~(FA_TRIG_SEL_MASK | FA_SRESET_SEL_MASK | FA_ENABLE_SOFT_SRESET | FA_ENABLE_SOFT_TRIG));
   vmeWrite32(&(FAp[id]->ctrl1),
 	     vmeRead32(&(FAp[id]->ctrl1)) | (FA_TRIG_FP_ISYNC | FA_SRESET_FP_ISYNC));
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
 }
 
@@ -4749,11 +5903,11 @@ faSetTrigOut(int id, int trigout)
       return ERROR;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&(FAp[id]->ctrl1),
 	     (vmeRead32(&(FAp[id]->ctrl1)) & ~FA_TRIGOUT_MASK) |
 	     trigout<<12);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return OK;
 }
@@ -4775,9 +5929,9 @@ faResetTriggerCount(int id)
       return(ERROR);
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&FAp[id]->trig_scal,FA_TRIG_SCAL_RESET);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return OK;
 }
@@ -4807,13 +5961,13 @@ faSetThreshold(int id, unsigned short tvalue, unsigned short chmask)
 
   if(chmask==0) chmask = 0xffff;  /* Set All channels the same */
 
-  FALOCK;
+  FASLOTLOCK(id);
   for(ii=0;ii<FA_MAX_ADC_CHANNELS;ii++) 
     {
       if(ii%2==0)
 	{
-	  lovalue = (vmeRead16(&FAp[id]->adc_thres[ii]));
-	  hivalue = (vmeRead16(&FAp[id]->adc_thres[ii+1]));
+	  lovalue = (faShadowRead16(id, &FAp[id]->adc_thres[ii]));
+	  hivalue = (faShadowRead16(id, &FAp[id]->adc_thres[ii+1]));
 
 	  if((1<<ii)&chmask)
 	    {
@@ -4827,7 +5981,7 @@ faSetThreshold(int id, unsigned short tvalue, unsigned short chmask)
 	    }
 
 	  if(doWrite)
-	    vmeWrite32((unsigned int *)&(FAp[id]->adc_thres[ii]),
+	    faShadowWrite32(id, (volatile unsigned int *)&FAp[id]->adc_thres[ii],
 		       lovalue<<16 | hivalue);
 
 	  lovalue = 0; 
@@ -4835,7 +5989,7 @@ faSetThreshold(int id, unsigned short tvalue, unsigned short chmask)
 	  doWrite=0;
 	}
     }
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return(OK);
 }
@@ -4860,12 +6014,12 @@ faPrintThreshold(int id)
       return(ERROR);
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   for(ii=0;ii<FA_MAX_ADC_CHANNELS;ii++)
     {
       tval[ii] = vmeRead16(&(FAp[id]->adc_thres[ii]));
     }
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
 
   printf(" Threshold Settings for FADC in slot %d:",id);
@@ -4917,10 +6071,10 @@ faProcPedConfig(int id, int nsamples, int maxvalue)
       return ERROR;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&FAp[id]->config7,
 	     (nsamples - 1)<<10 | maxvalue);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
   
   return OK;
 }
@@ -4980,10 +6134,10 @@ faSampleConfig(int id, int nsamples, int maxvalue)
       return ERROR;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&FAp[id]->config6,
 	     (nsamples - 1)<<10 | maxvalue);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
   
   return OK;
 }
@@ -5035,19 +6189,19 @@ faReadChannelSample(int id, int chan)
       return ERROR;
     }
 
-  FALOCK;
-  write = vmeRead32(&FAp[id]->adc_config[0]) & 0xFF;
+  FASLOTLOCK(id);
+  write = faShadowRead32(id, &FAp[id]->adc_config[0]) & 0xFF;
   
   // Alex
   //  vmeWrite32(&FAp[id]->adc_config[0], write | 
   //	     ((chan<<8) | FA_ADC_CONFIG0_CHAN_READ_ENABLE) );
 
-  vmeWrite32(&FAp[id]->adc_config[0], (write |  FA_ADC_CONFIG0_CHAN_READ_ENABLE) );
+  faShadowWrite32(id, &FAp[id]->adc_config[0], (write |  FA_ADC_CONFIG0_CHAN_READ_ENABLE) );
 
 
   rval = vmeRead32(&FAp[id]->adc_status[2]) & FA_ADC_STATUS2_CHAN_DATA_MASK;
 
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return rval;
 }
@@ -5074,15 +6228,15 @@ faReadAllChannelSamples(int id, volatile unsigned int *data)
       return(ERROR);
     }
   
-  FALOCK;
+  FASLOTLOCK(id);
 
-  write = vmeRead32(&FAp[id]->adc_config[0]) & 0xFFFF;
+  write = faShadowRead32(id, &FAp[id]->adc_config[0]) & 0xFFFF;
 
   // Enable processing
-  vmeWrite32(&FAp[id]->adc_config[0], (write |  FA_ADC_CONFIG0_CHAN_READ_ENABLE) );
+  faShadowWrite32(id, &FAp[id]->adc_config[0], (write |  FA_ADC_CONFIG0_CHAN_READ_ENABLE) );
 
   // Disable processing
-  vmeWrite32(&FAp[id]->adc_config[0], (write &  (~FA_ADC_CONFIG0_CHAN_READ_ENABLE)) );
+  faShadowWrite32(id, &FAp[id]->adc_config[0], (write &  (~FA_ADC_CONFIG0_CHAN_READ_ENABLE)) );
 
 
   for(ichan = 0; ichan < FA_MAX_ADC_CHANNELS; ichan++)
@@ -5107,7 +6261,7 @@ faReadAllChannelSamples(int id, volatile unsigned int *data)
   //  printf("faReadAllChannelSamples End readout :  adc_config[0]   0x%x \n",(write &  (~FA_ADC_CONFIG0_CHAN_READ_ENABLE)) );
 
 
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return (FA_MAX_ADC_CHANNELS/2);
 }
@@ -5145,14 +6299,14 @@ faSetDAC(int id, unsigned short dvalue, unsigned short chmask)
       return(ERROR);
     }
   
-  FALOCK;
+  FASLOTLOCK(id);
   for(ii=0;ii<FA_MAX_ADC_CHANNELS;ii++)
     {
 
       if(ii%2==0)
 	{
-	  lovalue = (vmeRead16(&FAp[id]->dac[ii]));
-	  hivalue = (vmeRead16(&FAp[id]->dac[ii+1]));
+	  lovalue = (faShadowRead16(id, &FAp[id]->dac[ii]));
+	  hivalue = (faShadowRead16(id, &FAp[id]->dac[ii+1]));
 
 	  if((1<<ii)&chmask)
 	    {
@@ -5170,20 +6324,28 @@ faSetDAC(int id, unsigned short dvalue, unsigned short chmask)
 
               //              taskDelay(1);
 
-	      vmeWrite32((unsigned int *)&(FAp[id]->dac[ii]), 
+	      faShadowWrite32(id, (volatile unsigned int *)&FAp[id]->dac[ii], 
 			 lovalue<<16 | hivalue);
 
 
               // Alex
               //              taskDelay(1);
 
-	      /* Readback to check values, and write timeout error */
-
-	      lovalue_rb = (vmeRead16(&FAp[id]->dac[ii]));
+	      /* Readback to check values, and write timeout error.
+		 Skipped when the register shadow is trusted */
+	      if(fadcShadowMode == FA_SHADOW_ENABLE)
+		{
+		  lovalue_rb = lovalue;
+		  hivalue_rb = hivalue;
+		}
+	      else
+		{
+		  lovalue_rb = (vmeRead16(&FAp[id]->dac[ii]));
 
               //              taskDelay(1);
 
-	      hivalue_rb = (vmeRead16(&FAp[id]->dac[ii+1]));
+		  hivalue_rb = (vmeRead16(&FAp[id]->dac[ii+1]));
+		}
               
               
               //              printf(" lovalue_rb  %d   %d  %d \n", lovalue_rb, lovalue, ii);
@@ -5216,7 +6378,7 @@ faSetDAC(int id, unsigned short dvalue, unsigned short chmask)
 	}
 
     }
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return(rval);
 }
@@ -5288,10 +6450,10 @@ faPrintDAC(int id)
       return;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   for(ii=0;ii<FA_MAX_ADC_CHANNELS;ii++)
     dval[ii] = vmeRead16(&(FAp[id]->dac[ii])) & FA_DAC_VALUE_MASK;
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
   
   
   printf(" DAC Settings for FADC in slot %d:",id);
@@ -5331,10 +6493,10 @@ faGetDAC(int id, unsigned short *indata)
       return ERROR;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   for(idac=0;idac<FA_MAX_ADC_CHANNELS;idac++)
     indata[idac] = vmeRead16(&(FAp[id]->dac[idac])) & FA_DAC_VALUE_MASK;
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return OK;
 }
@@ -5366,9 +6528,9 @@ faGetChannelDAC(int id, int channel)
       return ERROR;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   dac = vmeRead16(&(FAp[id]->dac[channel])) & FA_DAC_VALUE_MASK;
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return dac;
 }
@@ -5411,9 +6573,9 @@ faSetChannelPedestal(int id, unsigned int chan, unsigned int ped)
       return(ERROR);
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&FAp[id]->adc_pedestal[chan], ped);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return(OK);
 }
@@ -5445,9 +6607,9 @@ faGetChannelPedestal(int id, unsigned int chan)
       return(ERROR);
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   rval = vmeRead32(&FAp[id]->adc_pedestal[chan]) & FA_ADC_PEDESTAL_MASK;
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return(rval);
 }
@@ -5485,7 +6647,7 @@ faSetMGTTestMode(int id, unsigned int mode)
 	   __FUNCTION__);
 
 #ifdef OLDMGTCTRL
-  FALOCK;
+  FASLOTLOCK(id);
   if(mode) 
     { /* After Sync Reset (Normal mode) */
       vmeWrite32(&FAp[id]->mgt_ctrl, FA_RELEASE_MGT_RESET);
@@ -5497,7 +6659,7 @@ faSetMGTTestMode(int id, unsigned int mode)
       vmeWrite32(&FAp[id]->mgt_ctrl,FA_RELEASE_MGT_RESET);
       vmeWrite32(&FAp[id]->mgt_ctrl,FA_MGT_ENABLE_DATA_ALIGNMENT);
     }
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 #else
   if(mode==0) /* Before sync reset */
     {
@@ -5556,7 +6718,7 @@ faSetHitbitsMode(int id, int enable)
       return(ERROR);
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   if(enable) 
     { 
       vmeWrite32(&FAp[id]->mgt_ctrl, 
@@ -5567,7 +6729,7 @@ faSetHitbitsMode(int id, int enable)
       vmeWrite32(&FAp[id]->mgt_ctrl, 
 		 vmeRead32(&FAp[id]->mgt_ctrl) & ~FA_MGT_HITBITS_TO_CTP);
     }
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return(OK);
 }
@@ -5608,9 +6770,9 @@ faGetHitbitsMode(int id)
       return(ERROR);
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   rval = (vmeRead32(&FAp[id]->mgt_ctrl)&FA_MGT_HITBITS_TO_CTP)>>3;
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return rval;
 }
@@ -5655,7 +6817,7 @@ faReadScalers(int id, volatile unsigned int *data, unsigned int chmask, int rfla
   doLatch = rflag&(1<<0);
   doClear = rflag&(1<<1);
 
-  FALOCK;
+  FASLOTLOCK(id);
   if(doLatch)
     vmeWrite32(&FAp[id]->scaler_ctrl,
 	       FA_SCALER_CTRL_ENABLE | FA_SCALER_CTRL_LATCH);
@@ -5675,7 +6837,7 @@ faReadScalers(int id, volatile unsigned int *data, unsigned int chmask, int rfla
   if(doClear)
     vmeWrite32(&FAp[id]->scaler_ctrl,
 	       FA_SCALER_CTRL_ENABLE | FA_SCALER_CTRL_RESET);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return dCnt;
 
@@ -5718,7 +6880,7 @@ faPrintScalers(int id, int rflag)
   doLatch = rflag&(1<<0);
   doClear = rflag&(1<<1);
 
-  FALOCK;
+  FASLOTLOCK(id);
   if(doLatch)
     vmeWrite32(&FAp[id]->scaler_ctrl,
 	       FA_SCALER_CTRL_ENABLE | FA_SCALER_CTRL_LATCH);
@@ -5733,7 +6895,7 @@ faPrintScalers(int id, int rflag)
   if(doClear)
     vmeWrite32(&FAp[id]->scaler_ctrl,
 	       FA_SCALER_CTRL_ENABLE | FA_SCALER_CTRL_RESET);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   printf("%s: Scaler Counts\n",__FUNCTION__);
   for(ichan=0; ichan<16; ichan++)
@@ -5767,10 +6929,10 @@ faClearScalers(int id)
       return ERROR;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&FAp[id]->scaler_ctrl,
 	     FA_SCALER_CTRL_ENABLE | FA_SCALER_CTRL_RESET);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return OK;
 }
@@ -5793,10 +6955,10 @@ faLatchScalers(int id)
       return ERROR;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&FAp[id]->scaler_ctrl,
 	     FA_SCALER_CTRL_ENABLE | FA_SCALER_CTRL_LATCH);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return OK;
 }
@@ -5819,9 +6981,9 @@ faEnableScalers(int id)
       return ERROR;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&FAp[id]->scaler_ctrl,FA_SCALER_CTRL_ENABLE);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return OK;
 }
@@ -5844,9 +7006,9 @@ faDisableScalers(int id)
       return ERROR;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&FAp[id]->scaler_ctrl,~FA_SCALER_CTRL_ENABLE);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return OK;
 }
@@ -5870,9 +7032,9 @@ faGetMinA32MB(int id)
       return ERROR;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   rval = (vmeRead32(&FAp[id]->adr_mb) & FA_AMB_MIN_MASK)<<16;
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return rval;
 }
@@ -5896,9 +7058,9 @@ faGetMaxA32MB(int id)
       return ERROR;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   rval = vmeRead32(&FAp[id]->adr_mb) & FA_AMB_MAX_MASK;
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return rval;
 }
@@ -5925,14 +7087,14 @@ faDataInsertAdcParameters(int id, int enable)
       return ERROR;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   if(enable)
     vmeWrite32(&FAp[id]->ctrl1,
 	       vmeRead32(&FAp[id]->ctrl1) | FA_ENABLE_ADC_PARAMETERS_DATA);
   else
     vmeWrite32(&FAp[id]->ctrl1,
 	       vmeRead32(&FAp[id]->ctrl1) & ~FA_ENABLE_ADC_PARAMETERS_DATA);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return OK;
 }
@@ -5981,14 +7143,14 @@ faDataSuppressTriggerTime(int id, int suppress)
       return ERROR;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   if(suppress)
     vmeWrite32(&FAp[id]->ctrl1,
 	       vmeRead32(&FAp[id]->ctrl1) | suppress_bits);
   else
     vmeWrite32(&FAp[id]->ctrl1,
 	       vmeRead32(&FAp[id]->ctrl1) & ~suppress_bits);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return OK;
 }
@@ -6013,9 +7175,9 @@ faGetCtrlFPGAData(int id)
       return ERROR;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   rval = vmeRead32(&FAp[id]->system_monitor);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return rval;
 }
@@ -6039,9 +7201,9 @@ faGetProcFPGAData(int id)
       return ERROR;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   rval = vmeRead32(&FAp[id]->status3) & 0xFFFF;
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return rval;
 }
@@ -6067,11 +7229,11 @@ faGetCtrlFPGATemp(int id, int pflag)
       return ERROR;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   rval = 
     ((float)(vmeRead32(&FAp[id]->system_monitor) & FA_SYSMON_CTRL_TEMP_MASK) *
      (503.975/1024.0) - 273.15);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   if(pflag)
     {
@@ -6114,7 +7276,7 @@ faGetCtrlFPGAVoltage(int id, int vtype, int pflag)
       return ERROR;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   reg = vmeRead32(&FAp[id]->system_monitor);
   if(vtype==0)
     {
@@ -6125,7 +7287,7 @@ faGetCtrlFPGAVoltage(int id, int vtype, int pflag)
       reg  = (reg & FA_SYSMON_FPGA_AUX_V_MASK)>>22;
     }
   rval = ((float)(reg))*3.0/1024.0;
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   if(pflag)
     {
@@ -6162,10 +7324,10 @@ faGetProcFPGATemp(int id, int pflag)
       return ERROR;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   reg = (vmeRead32(&FAp[id]->status3) & FA_STATUS3_PROC_TEMP_MASK);
   rval = ((float)reg * (503.975/1024.0) - 273.15);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   if(pflag)
     {
@@ -6203,7 +7365,7 @@ faPrintAuxScal(int id)
       return;
     }
   
-  FALOCK;
+  FASLOTLOCK(id);
   printf("Auxillary Scalers:\n");
   printf("       Word Count:         %d\n",
 	 vmeRead32(&FAp[id]->proc_words_scal));
@@ -6213,7 +7375,7 @@ faPrintAuxScal(int id)
 	 vmeRead32(&FAp[id]->trailer_scal));
   printf("  Lost Triggers  :         %d\n",
 	 vmeRead32(&FAp[id]->lost_trig_scal));
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return;
 }
@@ -6238,12 +7400,12 @@ faPrintFifoStatus(int id)
       return;
     }
   
-  FALOCK;
+  FASLOTLOCK(id);
   dflow = vmeRead32(&(FAp[id]->dataflow_status));
   ibuf = vmeRead32(&(FAp[id]->status[0]))&0xdfffdfff;
   bbuf = vmeRead32(&(FAp[id]->status[1]))&0x1fff1fff;
   obuf = vmeRead32(&(FAp[id]->status[2]))&0x3fff3fff;
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   printf("%s: Fifo Buffers Status (DataFlow Status = 0x%08x\n",
 	 __FUNCTION__,dflow);
@@ -6293,6 +7455,7 @@ faPrintFifoStatus(int id)
 /**
  *  @ingroup Status
  *  @brief Decode a data word from an fADC250 and print to standard out.
+ *         For online decoding of whole buffers, use faDecodeBlock.
  *  @param data 32bit fADC250 data word
  */
 void 
@@ -6608,13 +7771,13 @@ faTestSetSystemTestMode(int id, int mode)
   else 
     reg=0;
     
-  FALOCK;
+  FASLOTLOCK(id);
 
   vmeWrite32(&(FAp[id]->ctrl1),
 	     vmeRead32(&FAp[id]->ctrl1) | reg);
 
   /*   printf(" ctrl1 = 0x%08x\n",vmeRead32(&FAp[id]->ctrl1)); */
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
 }
 
@@ -6648,9 +7811,9 @@ faTestSetTrigOut(int id, int mode)
   else 
     reg=0;
     
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&(FAp[id]->testBit),reg);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
 }
 
@@ -6684,9 +7847,9 @@ faTestSetBusyOut(int id, int mode)
   else 
     reg=0;
     
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&(FAp[id]->testBit),reg);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
 }
 
@@ -6720,9 +7883,9 @@ faTestSetSdLink(int id, int mode)
   else 
     reg=0;
     
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&(FAp[id]->testBit),reg);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
 }
 
@@ -6756,9 +7919,9 @@ faTestSetTokenOut(int id, int mode)
   else 
     reg=0;
     
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&(FAp[id]->testBit),reg);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
 }
 
@@ -6785,9 +7948,9 @@ faTestGetStatBitB(int id)
       return ERROR;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   reg = (vmeRead32(&FAp[id]->testBit) & FA_TESTBIT_STATBITB)>>8;
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return reg;
 
@@ -6816,9 +7979,9 @@ faTestGetTokenIn(int id)
       return ERROR;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   reg = (vmeRead32(&FAp[id]->testBit) & FA_TESTBIT_TOKENIN)>>9;
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return reg;
 
@@ -6847,9 +8010,9 @@ faTestGetClock250CounterStatus(int id)
       return ERROR;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   reg = (vmeRead32(&FAp[id]->testBit) & FA_TESTBIT_CLOCK250_STATUS)>>15;
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return reg;
 
@@ -6878,9 +8041,9 @@ faTestGetClock250Counter(int id)
       return ERROR;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   reg = vmeRead32(&FAp[id]->clock250count);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return reg;
 
@@ -6909,9 +8072,9 @@ faTestGetSyncCounter(int id)
       return ERROR;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   reg = vmeRead32(&FAp[id]->syncp0count);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return reg;
 
@@ -6940,9 +8103,9 @@ faTestGetTrig1Counter(int id)
       return ERROR;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   reg = vmeRead32(&FAp[id]->trig1p0count);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return reg;
 
@@ -6971,9 +8134,9 @@ faTestGetTrig2Counter(int id)
       return ERROR;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   reg = vmeRead32(&FAp[id]->trig2p0count);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return reg;
 
@@ -7000,10 +8163,10 @@ faTestResetClock250Counter(int id)
       return;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&FAp[id]->clock250count,FA_CLOCK250COUNT_RESET);
   vmeWrite32(&FAp[id]->clock250count,FA_CLOCK250COUNT_START);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
 }
 
@@ -7028,9 +8191,9 @@ faTestResetSyncCounter(int id)
       return;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&FAp[id]->syncp0count,FA_SYNCP0COUNT_RESET);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
 }
 
@@ -7055,9 +8218,9 @@ faTestResetTrig1Counter(int id)
       return;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&FAp[id]->trig1p0count,FA_TRIG1P0COUNT_RESET);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
 }
 
@@ -7082,9 +8245,9 @@ faTestResetTrig2Counter(int id)
       return;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&FAp[id]->trig2p0count,FA_TRIG2P0COUNT_RESET);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
 }
 
@@ -7111,9 +8274,9 @@ faTestGetTestBitReg(int id)
       return 0;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   rval = vmeRead32(&FAp[id]->testBit);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return rval;
 }
@@ -7160,10 +8323,10 @@ faGetSerialNumber(int id, char **rval, int snfix)
       return ERROR;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   for(i=0; i<3; i++)
     sn[i] = vmeRead32(&FAp[id]->serial_number[i]);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   if(sn[0]==FA_SERIAL_NUMBER_ACDI)
     { /* ACDI */
@@ -7300,9 +8463,9 @@ faSetScalerBlockInterval(int id, unsigned int nblock)
       return ERROR;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&FAp[id]->scaler_interval,nblock);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return OK;
 }
@@ -7327,9 +8490,9 @@ faGetScalerBlockInterval(int id)
       return ERROR;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   rval = vmeRead32(&FAp[id]->scaler_interval) & FA_SCALER_INTERVAL_MASK;
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return rval;
 }
@@ -7363,10 +8526,10 @@ faForceEndOfBlock(int id, int scalers)
       return ERROR;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   /* Disable triggers to Processing FPGA (if enabled) */
-  proc_config = vmeRead32(&FAp[id]->adc_config[0]);
-  vmeWrite32(&FAp[id]->adc_config[0],
+  proc_config = faShadowRead32(id, &FAp[id]->adc_config[0]);
+  faShadowWrite32(id, &FAp[id]->adc_config[0],
 	     proc_config & ~(FA_ADC_PROC_ENABLE));
 
   csr = FA_CSR_FORCE_EOB_INSERT;
@@ -7403,9 +8566,9 @@ faForceEndOfBlock(int id, int scalers)
     }
 
   /* Restore the original state of the Processing FPGA */
-  vmeWrite32(&FAp[id]->adc_config[0], proc_config);
+  faShadowWrite32(id, &FAp[id]->adc_config[0], proc_config);
 
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return rval;
 }
@@ -7462,9 +8625,9 @@ faSetHistoryBufferThreshold(int id, int thres)
       return ERROR;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&FAp[id]->sum_threshold,thres);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return OK;
 }
@@ -7505,9 +8668,9 @@ faGetHistoryBufferThreshold(int id)
       return ERROR;
     }
   
-  FALOCK;
+  FASLOTLOCK(id);
   rval = vmeRead32(&FAp[id]->sum_threshold) & FA_SUM_THRESHOLD_MASK;
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return rval;
 }
@@ -7530,9 +8693,9 @@ faArmHistoryBuffer(int id)
       return ERROR;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&FAp[id]->sum_data, FA_SUM_DATA_ARM_HISTORY_BUFFER);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
   return OK;
 }
 
@@ -7570,9 +8733,9 @@ faHistoryBufferDReady(int id)
       return ERROR;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   rval = (vmeRead32(&FAp[id]->sum_threshold) & FA_SUM_THRESHOLD_DREADY)>>31;
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return rval;
 }
@@ -7598,7 +8761,7 @@ faReadHistoryBuffer(int id, volatile unsigned int *data, int nwrds)
       return ERROR;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   while(idata<nwrds)
     {
       data[idata] = vmeRead32(&FAp[id]->sum_data) & FA_SUM_DATA_SAMPLE_MASK;
@@ -7612,7 +8775,7 @@ faReadHistoryBuffer(int id, volatile unsigned int *data, int nwrds)
   /* Use this to clear the data ready bit (dont set back to zero) */
   vmeWrite32(&FAp[id]->sum_data,FA_SUM_DATA_ARM_HISTORY_BUFFER);
 
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
   dCnt += idata;
 
   return dCnt;
@@ -7900,7 +9063,7 @@ faSetDataFormat(int id, int format)
       return ERROR;
     }
   
-  FALOCK;
+  FASLOTLOCK(id);
 
 
   orig  = (vmeRead32(&FAp[id]->ctrl1) & (~FA_CTRL1_DATAFORMAT_MASK));
@@ -7908,7 +9071,7 @@ faSetDataFormat(int id, int format)
 
   printf("Write Format 0x%x \n", (orig | (format << 26)));
 
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return OK;
 }
@@ -7947,9 +9110,10 @@ faDACReset(int id)
       return;
     }
 
-  FALOCK;
+  FASLOTLOCK(id);
   vmeWrite32(&FAp[id]->reset, FA_RESET_DAC); 
-  FAUNLOCK;
+  faShadowClear(id);
+  FASLOTUNLOCK(id);
   
 }
 
@@ -7965,7 +9129,10 @@ faGDACReset()
   FALOCK;
   for(ifa=0; ifa<nfadc; ifa++)
     {
+      FASLOTLOCK(faSlot(ifa));
       vmeWrite32(&FAp[faSlot(ifa)]->reset, FA_RESET_DAC);
+      faShadowClear(faSlot(ifa));
+      FASLOTUNLOCK(faSlot(ifa));
     }
   FAUNLOCK;
   
@@ -7990,7 +9157,7 @@ int faReSetDAC(int id) {
       return(ERROR);
     }
   
-  FALOCK;
+  FASLOTLOCK(id);
   
 
   printf("Read DAC for FADC250  in slot %d \n", id);
@@ -8007,6 +9174,7 @@ int faReSetDAC(int id) {
   printf("Reset DAC \n");
   
   vmeWrite32(&FAp[id]->reset, FA_RESET_DAC);
+  faShadowClear(id);
 
   printf("Load  DAC \n");
   
@@ -8019,7 +9187,7 @@ int faReSetDAC(int id) {
       lovalue = (dacRead[ii]   &  FA_DAC_VALUE_MASK);
       hivalue = (dacRead[ii+1] &  FA_DAC_VALUE_MASK);
       
-      vmeWrite32((unsigned int *)&(FAp[id]->dac[ii]), 
+      faShadowWrite32(id, (volatile unsigned int *)&FAp[id]->dac[ii], 
                  lovalue<<16 | hivalue);
 
       // Alex
@@ -8054,7 +9222,7 @@ int faReSetDAC(int id) {
     hivalue = 0;
   }
   
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
   
   
   return 0;
@@ -8074,15 +9242,15 @@ void faPrintBaseline(int id)
       return(ERROR);
     }
   
-  FALOCK;
+  FASLOTLOCK(id);
 
-  write = vmeRead32(&FAp[id]->adc_config[0]) & 0xFFFF;
+  write = faShadowRead32(id, &FAp[id]->adc_config[0]) & 0xFFFF;
 
   // Enable processing
-  vmeWrite32(&FAp[id]->adc_config[0], (write |  FA_ADC_CONFIG0_CHAN_READ_ENABLE) );
+  faShadowWrite32(id, &FAp[id]->adc_config[0], (write |  FA_ADC_CONFIG0_CHAN_READ_ENABLE) );
 
   // Disable processing
-  vmeWrite32(&FAp[id]->adc_config[0], (write &  (~FA_ADC_CONFIG0_CHAN_READ_ENABLE)) );
+  faShadowWrite32(id, &FAp[id]->adc_config[0], (write &  (~FA_ADC_CONFIG0_CHAN_READ_ENABLE)) );
 
 
   for(ichan = 0; ichan < FA_MAX_ADC_CHANNELS; ichan++) {
@@ -8096,7 +9264,7 @@ void faPrintBaseline(int id)
   //  printf("faReadAllChannelSamples End readout :  adc_config[0]   0x%x \n",(write &  (~FA_ADC_CONFIG0_CHAN_READ_ENABLE)) );
 
 
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 }
 
 
@@ -8123,14 +9291,14 @@ int faSetDACCheck(int id, unsigned short dvalue, unsigned short chmask)
       return(ERROR);
     }
   
-  FALOCK;
+  FASLOTLOCK(id);
   for(ii=0;ii<FA_MAX_ADC_CHANNELS;ii++)
     {
 
       if(ii%2==0)
 	{
-	  lovalue = (vmeRead16(&FAp[id]->dac[ii]));
-	  hivalue = (vmeRead16(&FAp[id]->dac[ii+1]));
+	  lovalue = (faShadowRead16(id, &FAp[id]->dac[ii]));
+	  hivalue = (faShadowRead16(id, &FAp[id]->dac[ii+1]));
 
 	  if((1<<ii)&chmask)
 	    {
@@ -8145,7 +9313,7 @@ int faSetDACCheck(int id, unsigned short dvalue, unsigned short chmask)
 
 	  if(doWrite)
 	    {
-	      vmeWrite32((unsigned int *)&(FAp[id]->dac[ii]), 
+	      faShadowWrite32(id, (volatile unsigned int *)&FAp[id]->dac[ii], 
 			 lovalue<<16 | hivalue);
 	      /* Readback to check values, and write timeout error */
 	      lovalue_rb = (vmeRead16(&FAp[id]->dac[ii]));
@@ -8182,7 +9350,7 @@ int faSetDACCheck(int id, unsigned short dvalue, unsigned short chmask)
 	}
 
     }
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   return(rval);
 }
@@ -8202,7 +9370,7 @@ void faPrintPedestal(int id){
   
   printf(" Pedestal Settings for FADC in slot %d:",id);
 
-  FALOCK;
+  FASLOTLOCK(id);
 
   for(ii = 0;ii < FA_MAX_ADC_CHANNELS;ii++){
     
@@ -8211,7 +9379,7 @@ void faPrintPedestal(int id){
     printf("Chan %2d: %5d   ",(ii+1), rval );
   }
   
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
 }
 
@@ -8229,14 +9397,15 @@ void faPrintBaselineAll()
     id = faSlot(ifa);
 
     printf("\n  Board in slot  %d \nc\n",id);  
+    FASLOTLOCK(id);
 
-    write = vmeRead32(&FAp[id]->adc_config[0]) & 0xFFFF;
+    write = faShadowRead32(id, &FAp[id]->adc_config[0]) & 0xFFFF;
     
     // Enable processing
-    vmeWrite32(&FAp[id]->adc_config[0], (write |  FA_ADC_CONFIG0_CHAN_READ_ENABLE) );
+    faShadowWrite32(id, &FAp[id]->adc_config[0], (write |  FA_ADC_CONFIG0_CHAN_READ_ENABLE) );
     
     // Disable processing
-    vmeWrite32(&FAp[id]->adc_config[0], (write &  (~FA_ADC_CONFIG0_CHAN_READ_ENABLE)) );
+    faShadowWrite32(id, &FAp[id]->adc_config[0], (write &  (~FA_ADC_CONFIG0_CHAN_READ_ENABLE)) );
     
     
     for(ichan = 0; ichan < FA_MAX_ADC_CHANNELS; ichan++) {
@@ -8246,6 +9415,7 @@ void faPrintBaselineAll()
       printf("Channel =  %2d     %5d     Valid =  %d  Quality = %d  0x%x  \n", ichan,  (read &  0x3FFF), (read >> 15) & 0x1, (read >> 14) & 0x1, read );
       
     }    
+    FASLOTUNLOCK(id);
     
   //  printf("faReadAllChannelSamples End readout :  adc_config[0]   0x%x \n",(write &  (~FA_ADC_CONFIG0_CHAN_READ_ENABLE)) );
     
@@ -8393,7 +9563,7 @@ faSetProcModeDef(int id)
   
   //  faSetNormalMode(id,0);
 
-  FALOCK;
+  FASLOTLOCK(id);
   /* Disable ADC processing while writing window info */
   if(pmode == FA_ADC_PROC_MODE_PULSE_PARAM)
     mode_bit = 0;
@@ -8411,11 +9581,11 @@ faSetProcModeDef(int id)
 
   /* Configure the mode (mode_bit), # of pulses (NP), # samples above TET (NSAT)
      keep TNSAT, if it's already been configured */
-  vmeWrite32(&FAp[id]->adc_config[0],
-	     (vmeRead32(&FAp[id]->adc_config[0]) & FA_ADC_CONFIG1_TNSAT_MASK) |
+  faShadowWrite32(id, &FAp[id]->adc_config[0],
+	     (faShadowRead32(id, &FAp[id]->adc_config[0]) & FA_ADC_CONFIG1_TNSAT_MASK) |
 	     (mode_bit << 8) | ((NP-1) << 4) | ((NSAT-1) << 10) );
   /* Disable user-requested channels */
-  vmeWrite32(&FAp[id]->adc_config[1], fadcChanDisable[id]);
+  faShadowWrite32(id, &FAp[id]->adc_config[1], fadcChanDisable[id]);
 
   /* Set window parameters */
   vmeWrite32(&FAp[id]->adc_pl, PL);
@@ -8424,20 +9594,20 @@ faSetProcModeDef(int id)
   /* Set Readback NSB, NSA
      NSA */
   vmeWrite32(&FAp[id]->adc_nsb, NSB);
-  vmeWrite32(&FAp[id]->adc_nsa,
-	     (vmeRead32(&FAp[id]->adc_nsa) & FA_ADC_TNSA_MASK) |
+  faShadowWrite32(id, &FAp[id]->adc_nsa,
+	     (faShadowRead32(id, &FAp[id]->adc_nsa) & FA_ADC_TNSA_MASK) |
 	     NSA );
 
   /* Set Pedestal parameters */
   vmeWrite32(&FAp[id]->config7, (NPED-1)<<10 | (MAXPED));
 
   /* Enable ADC processing */
-  vmeWrite32(&FAp[id]->adc_config[0],
-	     vmeRead32(&FAp[id]->adc_config[0]) | FA_ADC_PROC_ENABLE );
+  faShadowWrite32(id, &FAp[id]->adc_config[0],
+	     faShadowRead32(id, &FAp[id]->adc_config[0]) | FA_ADC_PROC_ENABLE );
 
   /* Set default value of trigger path threshold (TPT) */
   vmeWrite32(&FAp[id]->config3, FA_ADC_DEFAULT_TPT);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
   //  faSetTriggerStopCondition(id, faCalcMaxUnAckTriggers(pmode,PTW,NSA,NSB,NP));
   //  faSetTriggerBusyCondition(id, faCalcMaxUnAckTriggers(pmode,PTW,NSA,NSB,NP));
@@ -8450,7 +9620,7 @@ void faResetADC(int id) {
 
   printf(" Reset ADC chip for FADC in slot %d \n", id);
 
-  FALOCK;
+  FASLOTLOCK(id);
 
   vmeWrite32(&FAp[id]->adc_config[2], 0x10);
   taskDelay(1);
@@ -8458,14 +9628,14 @@ void faResetADC(int id) {
   vmeWrite32(&FAp[id]->adc_config[2], 0);
   taskDelay(1);
 
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
 }
 
 void faWriteConfig(int id, int config, unsigned int value) {
 
 
-  FALOCK;
+  FASLOTLOCK(id);
 
   printf(" FAp address 0x%x \n", &FAp[id]);
 
@@ -8481,7 +9651,7 @@ void faWriteConfig(int id, int config, unsigned int value) {
     printf(" Write 0x%x to config 3 \n", value);
   }
   
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
 }
 
@@ -8489,12 +9659,12 @@ void faMGTReset(int id, int reset){
 
   printf(" Reset MGT in slot %id  reset %d\n",id, reset);
 
-  FALOCK;
+  FASLOTLOCK(id);
 
   if(reset) 
       vmeWrite32(&FAp[id]->mgt_ctrl, FA_MGT_RESET);
   else 
       vmeWrite32(&FAp[id]->mgt_ctrl,FA_RELEASE_MGT_RESET);
-  FAUNLOCK;
+  FASLOTUNLOCK(id);
 
 }
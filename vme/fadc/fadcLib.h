@@ -31,6 +31,7 @@
 #define FA_MAX_DATA_PER_CHANNEL  251
 #define FA_MAX_A32_MEM      0x800000   /* 8 Meg */
 #define FA_MAX_A32MB_SIZE   0x800000  /*  8 MB */
+#define FA_MAX_DMA_BUFFERS         8     /* faReadBlockStart target buffers */
 #define FA_VME_INT_LEVEL           3     
 #define FA_VME_INT_VEC          0xFA
 
@@ -198,6 +199,143 @@ fadc_data_struct
   unsigned int scaler_data_words;
 };
 
+/* Block decoder (faDecode.c) flags */
+#define FA_DECODE_SWAP            (1<<0)  /* Buffer words are big-endian, as DMA'd from the module */
+
+/* Block decoder error bits, accumulated in faDecoder.errors */
+#define FA_DECODE_ERR_OVERFLOW    (1<<0)  /* Hit arrays full, decoding stopped */
+#define FA_DECODE_ERR_TYPE        (1<<1)  /* Undefined data type */
+#define FA_DECODE_ERR_SLOT        (1<<2)  /* Trailer/event header slot does not match block header */
+#define FA_DECODE_ERR_WORDCOUNT   (1<<3)  /* Trailer word count does not match words in block */
+#define FA_DECODE_ERR_SEQUENCE    (1<<4)  /* Continuation word out of place */
+#define FA_DECODE_ERR_TRUNCATED   (1<<5)  /* Buffer ended inside a raw window */
+#define FA_DECODE_ERR_INVALID     (1<<6)  /* DATA NOT VALID word seen */
+
+/* Hit flags */
+#define FA_HIT_RAW                (1<<0)  /* Hit carries raw samples (samples/nsamples valid) */
+#define FA_HIT_PULSE              (1<<1)  /* Hit carries pulse parameters */
+#define FA_HIT_PED_QUALITY        (1<<2)  /* Pedestal quality bit */
+#define FA_HIT_NSA_EXT            (1<<3)  /* NSA extended beyond window */
+#define FA_HIT_OVERFLOW           (1<<4)  /* Sample(s) in overflow */
+#define FA_HIT_UNDERFLOW          (1<<5)  /* Sample(s) in underflow */
+#define FA_HIT_NOVPEAK            (1<<6)  /* Vpeak not found */
+#define FA_HIT_TIME_QUALITY       (1<<7)  /* Time quality bit */
+#define FA_HIT_NO_TIME            (1<<8)  /* Pulse time word not (yet) seen */
+
+#define FA_HIT_NO_SAMPLES         0xffffffff
+
+/* Structure-of-arrays hit records.  All arrays are owned by the caller
+   and must hold at least maxhits entries (see faHitsAttach) */
+typedef struct
+{
+  int             nhits;
+  int             maxhits;
+  unsigned char  *slot;
+  unsigned char  *chan;
+  unsigned int   *event;
+  unsigned int   *time;      /* Pulse time: coarse<<6 | fine (1/64 sample) */
+  unsigned int   *integral;  /* Pulse integral, or 0 for raw-only hits */
+  unsigned int   *samples;   /* Word offset of first raw sample word in the decoded buffer,
+                                or FA_HIT_NO_SAMPLES */
+  unsigned short *nsamples;
+  unsigned short *peak;
+  unsigned short *pedsum;
+  unsigned short *flags;
+} faHits;
+
+/* Reentrant decoder context: one per thread/stream */
+typedef struct
+{
+  unsigned int flags;
+  unsigned int errors;
+  unsigned int type;        /* Type of the last type-defining word */
+  unsigned int slot;        /* Slot from block header */
+  unsigned int blk_num;
+  unsigned int n_evts;
+  unsigned int PL, NSB, NSA;
+  unsigned int blk_start;   /* Word offset of the block header */
+  unsigned int event;       /* Current event number */
+  unsigned long long trig_time;
+  unsigned int ttime_word;  /* Trigger time words seen in this event */
+  unsigned int chan;        /* Channel of current pulse parameter group */
+  unsigned int ped_flags;
+  unsigned int pedsum;
+  int          cur;         /* Hit index of current pulse, -1 if none */
+  int          evt_first;   /* Hit index of first hit in current event */
+  unsigned int raw_off[FA_MAX_ADC_CHANNELS];
+  unsigned int raw_ns[FA_MAX_ADC_CHANNELS];
+  unsigned int nblocks;
+  unsigned int nevents;
+  unsigned int nwords;
+  faHits      *hits;
+} faDecoder;
+
+/* Pedestal monitor (faPedMon.c): running baseline statistics per channel,
+   indexed by slot */
+typedef struct
+{
+  int          maxvalue;   /* Windows with a sample above this are rejected */
+  unsigned int n[FA_MAX_BOARDS+1][FA_MAX_ADC_CHANNELS];
+  double       mean[FA_MAX_BOARDS+1][FA_MAX_ADC_CHANNELS];
+  double       m2[FA_MAX_BOARDS+1][FA_MAX_ADC_CHANNELS];  /* Sum of squared deviations */
+  unsigned int nreject[FA_MAX_BOARDS+1][FA_MAX_ADC_CHANNELS];
+} faPedMon;
+
+/* Calibration store (faCalibStore.c) */
+#define FA_CALIB_STORE_ENV        "FA_CALIB_STORE"  /* Store file */
+#define FA_CALIB_STORE_DEFAULT    ".fadc250_calib"  /* ... in $HOME, if FA_CALIB_STORE is not set */
+#define FA_CALIB_MAX_MODULES      256
+#define FA_CALIB_SN_LEN           24
+
+/* faCalibRestore flags */
+#define FA_CALIB_DAC              (1<<0)
+#define FA_CALIB_THR              (1<<1)
+
+typedef struct
+{
+  int          dac;      /* DAC setting, -1 if not stored */
+  int          thr;      /* Readout threshold, -1 if not stored */
+  float        ped;      /* Baseline the DAC setting was calibrated to */
+  float        noise;    /* Baseline sigma (ADC counts), -1 if not measured */
+  unsigned int updated;  /* time() of the last calibration, 0 if none */
+} faCalibChannel;
+
+/* Discovery cache (faDiscoveryCache.c) */
+#define FA_DISCOVERY_CACHE_ENV      "FA_DISCOVERY_CACHE"      /* Cache file */
+#define FA_DISCOVERY_CACHE_DEFAULT  ".fadc250_discovery"  /* ... in $HOME, if FA_DISCOVERY_CACHE is not set */
+
+/* Configuration file loader (faConfigFile.c): DAC and threshold settings
+   of the .cnf files, indexed by slot */
+typedef struct
+{
+  unsigned short dacmask;  /* Channels with a DAC setting */
+  unsigned short thrmask;  /* Channels with a threshold setting */
+  unsigned short dac[FA_MAX_ADC_CHANNELS];
+  unsigned short thr[FA_MAX_ADC_CHANNELS];
+} faCnfSlot;
+
+typedef struct
+{
+  faCnfSlot slot[22];
+} faCnf;
+
+/* Changes made by faCnfApply */
+typedef struct
+{
+  int            nslots;       /* Modules with settings */
+  int            nmissing;     /* Slots with settings but no module */
+  int            ndac;         /* DAC channels changed */
+  int            nthr;         /* Threshold channels changed */
+  int            nwrite;       /* Register writes */
+  unsigned short dacmask[22];  /* Channels changed, by slot */
+  unsigned short thrmask[22];
+} faCnfDelta;
+
+/* faCnfApply flags */
+#define FA_CNF_DAC                (1<<0)
+#define FA_CNF_THR                (1<<1)
+#define FA_CNF_DRYRUN             (1<<2)
+#define FA_CNF_VERBOSE            (1<<3)
 
 struct 
 fadc_sdc_struct 
@@ -678,6 +816,8 @@ extern const char *fa_mode_names[FA_MAX_PROC_MODE+1];
 #define FA_INIT_SKIP                (1<<16)
 #define FA_INIT_USE_ADDRLIST        (1<<17)
 #define FA_INIT_SKIP_FIRMWARE_CHECK (1<<18)
+#define FA_INIT_CALIB_RESTORE       (1<<19)
+#define FA_INIT_DISCOVERY_CACHE     (1<<20)
 
 /* fadcBlockError values */
 #define FA_BLOCKERROR_NO_ERROR          0
@@ -687,6 +827,30 @@ extern const char *fa_mode_names[FA_MAX_PROC_MODE+1];
 #define FA_BLOCKERROR_DMADONE_ERROR     4
 #define FA_BLOCKERROR_NTYPES            5
 
+/* faReadBlockStart buffer states */
+#define FA_DMABUF_FREE                  0
+#define FA_DMABUF_BUSY                  1
+#define FA_DMABUF_FULL                  2
+
+/* Readout path messages (faSetLogFunc) */
+#define FA_LOG_RATE                     10  /* per second and call site */
+typedef int (*FA_LOG_FUNC)(const char *fmt, long a1, long a2, long a3,
+			   long a4, long a5, long a6);
+
+/* faSetShadowMode modes */
+#define FA_SHADOW_DISABLE               0
+#define FA_SHADOW_ENABLE                1
+#define FA_SHADOW_VERIFY                2
+
+/* Register sections for faSnapshot */
+#define FA_SNAPSHOT_STATUS         (1<<0)
+#define FA_SNAPSHOT_CONFIG         (1<<1)
+#define FA_SNAPSHOT_DAC            (1<<2)
+#define FA_SNAPSHOT_THRES          (1<<3)
+#define FA_SNAPSHOT_PEDESTAL       (1<<4)
+#define FA_SNAPSHOT_DETAIL         (1<<5)
+#define FA_SNAPSHOT_ALL            0x3F
+
 /* Function Prototypes */
 STATUS faInit (UINT32 addr, UINT32 addr_inc, int nadc, int iFlag);
 int  faCheckAddresses(int id);
@@ -694,6 +858,10 @@ int  faSlot(unsigned int i);
 int  faSetClockSource(int id, int clkSrc);
 void faStatus(int id, int sflag);
 void faGStatus(int sflag);
+int  faSnapshot(int id, struct fadc_struct *image, int smask);
+int  faGetLockStats(int id, unsigned int *count, unsigned int *contention);
+void faPrintLockStats();
+void faResetLockStats();
 unsigned int faGetFirmwareVersions(int id, int pflag);
 
 int  faSetProcMode(int id, int pmode, unsigned int PL, unsigned int PTW, 
@@ -716,6 +884,12 @@ void faPPGEnable(int id);
 void faPPGDisable(int id);
 int  faReadBlock(int id, volatile UINT32 *data, int nwrds, int rflag);
 int  faGetBlockError(int pflag);
+int  faReadBlockSetBuffers(volatile UINT32 **bufs, int nbufs, int nwrds);
+int  faReadBlockStart(int id, int rflag);
+int  faReadBlockWait(volatile UINT32 **data);
+int  faReadBlockPending();
+int  faReadBlockRelease(volatile UINT32 *data);
+int  faSetLogFunc(FA_LOG_FUNC func);
 int  faPrintBlock(int id, int rflag);
 void faClear(int id);
 void faClearError(int id);
@@ -723,6 +897,15 @@ unsigned int faReadCSR(int id);
 void faReset(int id, int iFlag);
 void faGReset(int iFlag);
 void faSoftReset(int id, int cflag);
+int  faSetShadowMode(int mode);
+int  faGetShadowMode();
+int  faShadowInvalidate(int id);
+int  faTransBegin();
+int  faTransWrite32(int id, unsigned int offset, unsigned int val);
+int  faTransSetDAC(int id, unsigned short dvalue, unsigned short chmask);
+int  faTransSetThreshold(int id, unsigned short tvalue, unsigned short chmask);
+int  faTransCommit();
+void faTransAbort();
 void faResetToken(int id);
 int  faTokenStatus(int id);
 int  faGTokenStatus();
@@ -820,6 +1003,7 @@ float faGetProcFPGATemp(int id, int pflag);
 /* FADC Firmware Tools Prototypes */
 int  fadcFirmwareLoad(int id, int chip, int pFlag);
 int  fadcFirmwareGLoad(int chip, int pFlag);
+int  fadcFirmwarePLoad(int chip, int pFlag);
 void fadcFirmwareDownloadConfigData(int id);
 int  fadcFirmwareVerifyDownload (int id);
 int  fadcFirmwareTestReady(int id, int n_try, int pFlag);
@@ -886,6 +1070,37 @@ void faItrigDisable(int id, int dflag);
 int  faItrigGetTableVal(int id, unsigned short pMask);
 void faItrigSetTableVal(int id, unsigned short tval, unsigned short pMask);
 
+/* FADC Block Decoder Prototypes */
+unsigned int faHitsBufferSize(int maxhits);
+int  faHitsAttach(faHits *hits, void *mem, int maxhits);
+int  faDecodeInit(faDecoder *dec, faHits *hits, unsigned int flags);
+void faDecodeReset(faDecoder *dec);
+int  faDecodeBlock(faDecoder *dec, const unsigned int *data, int nwrds);
+int  faUnpackRawSamples(const unsigned int *data, int nwrds, short *samples,
+			unsigned int flags, unsigned int *ninvalid, unsigned int *noverflow);
+const char *faUnpackRawSamplesKernel();
+
+/* FADC Pedestal Monitor Prototypes */
+int  faPedMonInit(faPedMon *pm, int maxvalue);
+void faPedMonClear(faPedMon *pm);
+int  faPedMonAddSamples(faPedMon *pm, int id, int chan, const short *samples, int n);
+int  faPedMonAddHits(faPedMon *pm, const unsigned int *data, const faHits *hits,
+		     int npre, unsigned int flags);
+int  faPedMonSample(faPedMon *pm, int id, int nreads);
+int  faPedMonGet(faPedMon *pm, int id, int chan, double *mean, double *var);
+
+/* FADC Calibration Store Prototypes */
+int  faCalibLoad(const char *path);
+int  faCalibSave(const char *path);
+int  faCalibGet(int id, int chan, faCalibChannel *cal);
+int  faCalibSet(int id, int chan, const faCalibChannel *cal);
+int  faCalibRestore(int id, int rflag);
+int  faGCalibRestore(int rflag);
+
+void faCnfClear(faCnf *cnf);
+int  faCnfRead(const char *path, const char *crate, faCnf *cnf);
+int  faCnfApply(const faCnf *cnf, faCnfDelta *delta, int aflag);
+
 int  faSetDataFormat(int id, int format);
 void faGSetDataFormat(int format);
 
@@ -152,7 +152,7 @@ main(int argc, char *argv[])
     else
       goto REPEAT2;
 
-    fadcFirmwareGLoad(firmware_choice,0);
+    fadcFirmwarePLoad(firmware_choice,0);
 
     goto CLOSE;
 
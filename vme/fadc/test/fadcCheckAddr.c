@@ -61,22 +61,22 @@ main(int argc, char *argv[]) {
 	   (unsigned int)&(FAp[11]->dac[8])-(unsigned int)FAp[11]);
     printf("  status[0]        = 0x%x\n",
 	   (unsigned int)&(FAp[11]->status[0])-(unsigned int)FAp[11]);
-    printf("  aux[0]           = 0x%x\n",
-	   (unsigned int)&(FAp[11]->aux[0])-(unsigned int)FAp[11]);
-    printf("  ram_r_adr        = 0x%x\n",
-	   (unsigned int)&(FAp[11]->ram_r_adr)-(unsigned int)FAp[11]);
+    printf("  aux              = 0x%x\n",
+	   (unsigned int)&(FAp[11]->aux)-(unsigned int)FAp[11]);
+    printf("  ram_word_count   = 0x%x\n",
+	   (unsigned int)&(FAp[11]->ram_word_count)-(unsigned int)FAp[11]);
     printf("  berr_module_scal = 0x%x\n",
 	   (unsigned int)&(FAp[11]->berr_module_scal)-(unsigned int)FAp[11]);
-    printf("  aux_scal[2]      = 0x%x\n",
-	   (unsigned int)&(FAp[11]->aux_scal[2])-(unsigned int)FAp[11]);
+    printf("  proc_words_scal  = 0x%x\n",
+	   (unsigned int)&(FAp[11]->proc_words_scal)-(unsigned int)FAp[11]);
     printf("  busy_level       = 0x%x\n",
 	   (unsigned int)&(FAp[11]->busy_level)-(unsigned int)FAp[11]);
     printf("  mgt_status       = 0x%x\n",
 	   (unsigned int)&(FAp[11]->mgt_status)-(unsigned int)FAp[11]);
     printf("  adc_status[0]    = 0x%x\n",
 	   (unsigned int)&(FAp[11]->adc_status[0])-(unsigned int)FAp[11]);
-    printf("  ptw_max_buf      = 0x%x\n",
-	   (unsigned int)&(FAp[11]->ptw_max_buf)-(unsigned int)FAp[11]);
+    printf("  adc_ptw          = 0x%x\n",
+	   (unsigned int)&(FAp[11]->adc_ptw)-(unsigned int)FAp[11]);
     printf("  hitsum_status    = 0x%x\n",
 	   (unsigned int)&(FAp[11]->hitsum_status)-(unsigned int)FAp[11]);
     printf("  hitsum_pattern   = 0x%x\n",
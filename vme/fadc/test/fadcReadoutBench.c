@@ -0,0 +1,422 @@
+/*
+ * File:
+ *    fadcReadoutBench.c
+ *
+ * Description:
+ *    Readout throughput benchmark for faReadBlock.
+ *
+ *    Sweeps processing mode, PTW, block level, number of modules,
+ *    readout mode (1: one DMA per module, 2: multiblock token passing)
+ *    and DMA transfer mode, and writes one CSV line per setting:
+ *
+ *      words/s and blocks/s over the time spent in readout,
+ *      trigger-to-readout latency percentiles (per event, from the
+ *      software trigger to the end of the DMA of its block),
+ *      CPU time per block in the readout thread.
+ *
+ *    Triggers are software triggers (faInit iFlag trigger source
+ *    VME/Soft), issued at the requested rate.  Built as
+ *    fadcReadoutBenchSim, the crate is the in-memory emulator
+ *    (vme/jvmeSim) and a trigger reaches all modules at once, as from a
+ *    TI.
+ *
+ *    Usage:
+ *      fadcReadoutBench [-m modes] [-w ptws] [-b levels] [-n nslots]
+ *                       [-r rmodes] [-d dmamodes] [-e events] [-R rate]
+ *                       [-T threshold] [-f iflag] [-o file.csv]
+ *
+ *      Lists are comma separated, e.g. -m 9,10 -b 1,10,40,255 -n 1,4,16
+ *      dmamodes: d32 blt mblk 2evme sst160 sst267 sst320
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include "jvme.h"
+#include "fadcLib.h"
+#ifdef JVMESIM
+#include "jvmeSim.h"
+#endif
+
+#define MAX_LIST   32
+
+DMA_MEM_ID vmeIN,vmeOUT;
+extern DMANODE *the_event;
+extern unsigned int *dma_dabufp;
+
+extern int nfadc;                 /* Number of FADC250s verified with the library */
+extern int fadcID[FA_MAX_BOARDS]; /* Array of slot numbers, discovered by the library */
+extern unsigned int fadcAddrList[FA_MAX_BOARDS];
+
+/* Processing parameters not swept (faSetProcModeDef values) */
+#define BENCH_PL       900
+#define BENCH_NSB        3
+#define BENCH_NSA       15
+#define BENCH_NP         1
+#define BENCH_NPED       5
+#define BENCH_MAXPED     0
+#define BENCH_NSAT       1
+#define BENCH_DAC     3250
+
+typedef struct
+{
+  const char *name;
+  int dataType;
+  int sstMode;
+} benchDma;
+
+static const benchDma dmaModes[] =
+  {
+    {"d32",    1, 0},
+    {"blt",    2, 0},
+    {"mblk",   3, 0},
+    {"2evme",  4, 0},
+    {"sst160", 5, 0},
+    {"sst267", 5, 1},
+    {"sst320", 5, 2},
+  };
+#define NDMAMODES (int)(sizeof(dmaModes)/sizeof(benchDma))
+
+static double
+benchNow(clockid_t clk)
+{
+  struct timespec ts;
+  clock_gettime(clk, &ts);
+  return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+static int
+benchParseList(char *arg, int *list)
+{
+  char *tok;
+  int n=0;
+
+  for(tok = strtok(arg, ","); tok && (n < MAX_LIST); tok = strtok(NULL, ","))
+    list[n++] = strtol(tok, NULL, 0);
+
+  return n;
+}
+
+static int
+benchParseDma(char *arg, int *list)
+{
+  char *tok;
+  int n=0, idma;
+
+  for(tok = strtok(arg, ","); tok && (n < MAX_LIST); tok = strtok(NULL, ","))
+    {
+      for(idma=0; idma<NDMAMODES; idma++)
+	if(strcasecmp(tok, dmaModes[idma].name) == 0)
+	  break;
+      if(idma == NDMAMODES)
+	{
+	  fprintf(stderr, "Unknown DMA mode: %s\n", tok);
+	  exit(1);
+	}
+      list[n++] = idma;
+    }
+
+  return n;
+}
+
+static int
+benchCompare(const void *a, const void *b)
+{
+  double da = *(const double *)a, db = *(const double *)b;
+  return (da > db) - (da < db);
+}
+
+static double
+benchPercentile(double *sorted, int n, double p)
+{
+  int i;
+
+  if(n == 0)
+    return 0.;
+  i = (int)(p*(n-1) + 0.5);
+  return sorted[i];
+}
+
+/* Upper bound on the words in one block from nslots modules */
+static unsigned int
+benchMaxWords(int mode, int ptw, int level, int nslots)
+{
+  unsigned int chwords;
+
+  chwords = 3*BENCH_NP;                         /* Pulse header, integral, time */
+  if(mode != FA_ADC_PROC_MODE_PULSE_PARAM)
+    chwords += 1 + (ptw+1)/2;                   /* Raw window */
+
+  return nslots * (2 + 2 + level*(3 + 16*chwords)) + 4;
+}
+
+static void
+usage(char *prog)
+{
+  printf("Usage: %s [-m modes] [-w ptws] [-b levels] [-n nslots] [-r rmodes]\n", prog);
+  printf("          [-d dmamodes] [-e events] [-R rate] [-T threshold] [-f iflag]\n");
+  printf("          [-o file.csv]\n");
+  printf("  defaults: -m 9,10,11 -w 50 -b 1,10,40 -n 16 -r 1,2 -d sst267\n");
+  printf("            -e 10000 -R 0 (as fast as possible) -T 300 -f 0\n");
+  printf("            -o fadcReadoutBench.csv (- for stdout)\n");
+}
+
+int
+main(int argc, char *argv[])
+{
+  int modes[MAX_LIST]   = {9, 10, 11}, nmodes = 3;
+  int ptws[MAX_LIST]    = {50}, nptws = 1;
+  int levels[MAX_LIST]  = {1, 10, 40}, nlevels = 3;
+  int nslots[MAX_LIST]  = {16}, nnslots = 1;
+  int rmodes[MAX_LIST]  = {1, 2}, nrmodes = 2;
+  int dmas[MAX_LIST]    = {5}, ndmas = 1;
+  int nevents = 10000, iFlag = 0;
+  unsigned short threshold = 300;
+  double trigRate = 0;
+  char *outfile = "fadcReadoutBench.csv";
+  FILE *out;
+
+  int slots[FA_MAX_BOARDS], nfound, maxslots=0;
+  unsigned int maxwords=0, words;
+  int opt, im, iw, ib, in, ir, id, ii, islot;
+
+  while((opt = getopt(argc, argv, "m:w:b:n:r:d:e:R:T:f:o:h")) != -1)
+    {
+      switch(opt)
+	{
+	case 'm': nmodes  = benchParseList(optarg, modes);  break;
+	case 'w': nptws   = benchParseList(optarg, ptws);   break;
+	case 'b': nlevels = benchParseList(optarg, levels); break;
+	case 'n': nnslots = benchParseList(optarg, nslots); break;
+	case 'r': nrmodes = benchParseList(optarg, rmodes); break;
+	case 'd': ndmas   = benchParseDma(optarg, dmas);    break;
+	case 'e': nevents = strtol(optarg, NULL, 0);        break;
+	case 'R': trigRate = atof(optarg);                  break;
+	case 'T': threshold = strtol(optarg, NULL, 0);      break;
+	case 'f': iFlag = strtol(optarg, NULL, 0);          break;
+	case 'o': outfile = optarg;                         break;
+	default:
+	  usage(argv[0]);
+	  exit(1);
+	}
+    }
+
+  if(strcmp(outfile, "-") == 0)
+    out = stdout;
+  else if((out = fopen(outfile, "w")) == NULL)
+    {
+      perror(outfile);
+      exit(1);
+    }
+
+  vmeOpenDefaultWindows();
+
+  /* Find the modules in the crate */
+  vmeSetQuietFlag(1);
+  faInit((unsigned int)(3<<19), (1<<19), 18, iFlag);
+  vmeSetQuietFlag(0);
+  nfound = nfadc;
+  for(ii=0; ii<nfound; ii++)
+    slots[ii] = fadcID[ii];
+  if(nfound == 0)
+    {
+      printf("No fADC250s found\n");
+      goto CLOSE;
+    }
+
+  /* One buffer large enough for the largest setting */
+  for(in=0; in<nnslots; in++)
+    if(nslots[in] > maxslots)
+      maxslots = nslots[in];
+  if(maxslots > nfound)
+    maxslots = nfound;
+  for(im=0; im<nmodes; im++)
+    for(iw=0; iw<nptws; iw++)
+      for(ib=0; ib<nlevels; ib++)
+	{
+	  words = benchMaxWords(modes[im], ptws[iw], levels[ib], maxslots);
+	  if(words > maxwords)
+	    maxwords = words;
+	}
+
+  dmaPFreeAll();
+  vmeIN  = dmaPCreate("vmeIN", maxwords<<2, 1, 0);
+  vmeOUT = dmaPCreate("vmeOUT", 0, 0, 0);
+  dmaPReInitAll();
+
+  fprintf(out, "mode,ptw,blocklevel,nslots,rmode,dma,blocks,words,words_per_block,"
+	  "words_per_s,blocks_per_s,mbytes_per_s,lat_p50_us,lat_p90_us,lat_p99_us,"
+	  "lat_max_us,cpu_us_per_block,errors\n");
+
+  for(in=0; in<nnslots; in++)
+    for(ir=0; ir<nrmodes; ir++)
+      for(im=0; im<nmodes; im++)
+	for(iw=0; iw<nptws; iw++)
+	  for(ib=0; ib<nlevels; ib++)
+	    for(id=0; id<ndmas; id++)
+	      {
+		int mode = modes[im], ptw = ptws[iw], level = levels[ib];
+		int nslot = (nslots[in] < nfound) ? nslots[in] : nfound;
+		int rmode = rmodes[ir];
+		int nblocks = (nevents + level - 1)/level;
+		int iblk, iev, dCnt, nw, errors=0, itime, nlat=0;
+		unsigned int slotMask=0, maxw, gbready=0;
+		unsigned long long totalWords=0;
+		double *trigTime, *lat, tnext, tdone, wall=0, cpu=0;
+		double w0, c0;
+
+		if((rmode == 2) && (nslot < 2))
+		  {
+		    fprintf(stderr, "Skipping rmode 2 with %d module\n", nslot);
+		    continue;
+		  }
+
+		/* Configure the crate for this point */
+		for(islot=0; islot<nslot; islot++)
+		  fadcAddrList[islot] = slots[islot]<<19;
+		vmeSetQuietFlag(1);
+		ii = faInit(fadcAddrList[0], 0, nslot, iFlag | FA_INIT_USE_ADDRLIST);
+		vmeSetQuietFlag(0);
+		if((ii != OK) || (nfadc != nslot))
+		  {
+		    fprintf(stderr, "faInit found %d of %d modules\n", nfadc, nslot);
+		    continue;
+		  }
+
+		vmeDmaConfig(2, dmaModes[dmas[id]].dataType, dmaModes[dmas[id]].sstMode);
+
+		for(islot=0; islot<nslot; islot++)
+		  {
+		    faSetDAC(fadcID[islot], BENCH_DAC, 0);
+		    faSetThreshold(fadcID[islot], threshold, 0);
+		    faSetProcMode(fadcID[islot], mode, BENCH_PL, ptw, BENCH_NSB, BENCH_NSA,
+				  BENCH_NP, BENCH_NPED, BENCH_MAXPED, BENCH_NSAT);
+		    faSetBlockLevel(fadcID[islot], level);
+		    slotMask |= (1<<fadcID[islot]);
+		  }
+
+		if(rmode == 2)
+		  faEnableMultiBlock(1);
+		else
+		  {
+		    if(nslot > 1)
+		      faDisableMultiBlock();
+		    for(islot=0; islot<nslot; islot++)
+		      faEnableBusError(fadcID[islot]);
+		  }
+
+		for(islot=0; islot<nslot; islot++)
+		  {
+		    faClear(fadcID[islot]);
+		    faResetToken(fadcID[islot]);
+		    faResetTriggerCount(fadcID[islot]);
+		  }
+		faGEnable(0, 0);
+
+		maxw = benchMaxWords(mode, ptw, level, nslot);
+		trigTime = (double *)malloc(level*sizeof(double));
+		lat = (double *)malloc(nblocks*level*sizeof(double));
+		tnext = benchNow(CLOCK_MONOTONIC);
+
+		for(iblk=0; iblk<nblocks; iblk++)
+		  {
+		    /* Triggers for one block */
+		    for(iev=0; iev<level; iev++)
+		      {
+			if(trigRate > 0)
+			  {
+			    while(benchNow(CLOCK_MONOTONIC) < tnext)
+			      ;
+			    tnext += 1./trigRate;
+			  }
+#ifdef JVMESIM
+			vmeSimTrigger(1);
+#else
+			faGTrig();
+#endif
+			trigTime[iev] = benchNow(CLOCK_MONOTONIC);
+		      }
+
+		    /* Readout, as in the readout lists */
+		    w0 = benchNow(CLOCK_MONOTONIC);
+		    c0 = benchNow(CLOCK_THREAD_CPUTIME_ID);
+
+		    GETEVENT(vmeIN, iblk);
+		    for(itime=0; itime<100000; itime++)
+		      {
+			gbready = faGBready();
+			if(gbready == slotMask)
+			  break;
+		      }
+
+		    dCnt = 0;
+		    if(gbready != slotMask)
+		      errors++;
+		    else if(rmode == 2)
+		      {
+			dCnt = faReadBlock(fadcID[0], dma_dabufp, maxw, 2);
+			faResetToken(fadcID[0]);
+		      }
+		    else
+		      {
+			for(islot=0; islot<nslot; islot++)
+			  {
+			    nw = faReadBlock(fadcID[islot], dma_dabufp + dCnt, maxw - dCnt, 1);
+			    if(nw <= 0)
+			      {
+				dCnt = nw;
+				break;
+			      }
+			    dCnt += nw;
+			  }
+		      }
+
+		    tdone = benchNow(CLOCK_MONOTONIC);
+		    cpu  += benchNow(CLOCK_THREAD_CPUTIME_ID) - c0;
+		    wall += tdone - w0;
+
+		    if((dCnt <= 0) || (dCnt > (int)maxw))
+		      errors++;
+		    else
+		      {
+			totalWords += dCnt;
+			dma_dabufp += dCnt;
+		      }
+		    PUTEVENT(vmeOUT);
+		    dmaPFreeItem(dmaPGetItem(vmeOUT));
+
+		    for(iev=0; iev<level; iev++)
+		      lat[nlat++] = (tdone - trigTime[iev])*1e6;
+		  }
+
+		faGDisable(0);
+
+		qsort(lat, nlat, sizeof(double), benchCompare);
+		fprintf(out, "%d,%d,%d,%d,%d,%s,%d,%llu,%.1f,%.0f,%.1f,%.2f,%.1f,%.1f,%.1f,%.1f,%.2f,%d\n",
+			mode, ptw, level, nslot, rmode, dmaModes[dmas[id]].name,
+			nblocks, totalWords, (double)totalWords/nblocks,
+			totalWords/wall, nblocks/wall, totalWords*4e-6/wall,
+			benchPercentile(lat, nlat, 0.50), benchPercentile(lat, nlat, 0.90),
+			benchPercentile(lat, nlat, 0.99), benchPercentile(lat, nlat, 1.0),
+			cpu*1e6/nblocks, errors);
+		fflush(out);
+
+		free(trigTime);
+		free(lat);
+	      }
+
+ CLOSE:
+  if(out != stdout)
+    fclose(out);
+
+#ifdef JVMESIM
+  vmeSimPrintStats();
+#endif
+  dmaPFreeAll();
+  vmeCloseDefaultWindows();
+
+  exit(0);
+}
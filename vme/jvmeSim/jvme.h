@@ -0,0 +1,171 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  jvme.h  -  Drop-in replacement for the JLAB VME bridge library (jvme)
+ *             header, for building the module libraries and readout code
+ *             against the in-memory crate emulator (jvmeSim.c) instead
+ *             of a VME bridge.
+ *
+ *             Only the part of the jvme API used by fadcLib, vmeDSClib,
+ *             the readout lists and the utilities in this tree is
+ *             provided.  Signatures follow jvme.
+ *
+ *             Build with -I../jvmeSim (or -I$(JVMESIM)) ahead of the real
+ *             jvme include directory, and link with -ljvme from
+ *             vme/jvmeSim.  See README.jvmeSim.
+ *
+ *----------------------------------------------------------------------------*/
+
+#ifndef __JVME__
+#define __JVME__
+
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <time.h>
+
+#ifndef VXWORKS
+/* VxWorks compatibility types */
+typedef int            BOOL;
+typedef int            STATUS;
+typedef int            INT32;
+typedef short          INT16;
+typedef char           INT8;
+typedef unsigned int   UINT32;
+typedef unsigned short UINT16;
+typedef unsigned char  UINT8;
+typedef void         (*VOIDFUNCPTR)();
+typedef int          (*FUNCPTR)();
+
+#define LOCAL   static
+#define IMPORT  extern
+
+#ifndef OK
+#define OK       0
+#endif
+#ifndef ERROR
+#define ERROR   -1
+#endif
+#ifndef TRUE
+#define TRUE     1
+#endif
+#ifndef FALSE
+#define FALSE    0
+#endif
+
+/* VME bus is big-endian */
+#define LSWAP(x)        ((((x) & 0x000000ff) << 24) | \
+                         (((x) & 0x0000ff00) <<  8) | \
+                         (((x) & 0x00ff0000) >>  8) | \
+                         (((x) & 0xff000000) >> 24))
+
+#define SSWAP(x)        ((((x) & 0x00ff) << 8) | \
+                         (((x) & 0xff00) >> 8))
+
+/* 60 Hz ticks, as in jvme */
+#define taskDelay(ticks) usleep((ticks)*16667)
+
+#define logMsg printf
+#endif /* VXWORKS */
+
+/* GE bridge status, as returned by vmeOpenDefaultWindows in jvme */
+#ifndef GEF_SUCCESS
+typedef int GEF_STATUS;
+#define GEF_SUCCESS 0
+#endif
+
+/* Bridge access */
+int  vmeOpenDefaultWindows();
+int  vmeCloseDefaultWindows();
+int  vmeBusToLocalAdrs(int vmeAdrsSpace, char *vmeBusAdrs, char **pLocalAdrs);
+int  vmeLocalToVmeAdrs(unsigned long localAdrs, unsigned int *vmeAdrs,
+		       unsigned short *amCode);
+int  vmeMemProbe(char *addr, int size, char *retVal);
+void vmeSetQuietFlag(unsigned int pflag);
+int  vmeBusLock();
+int  vmeBusUnlock();
+
+/* Single cycles */
+unsigned char  vmeRead8(volatile unsigned char *addr);
+unsigned short vmeRead16(volatile unsigned short *addr);
+unsigned int   vmeRead32(volatile unsigned int *addr);
+void vmeWrite8(volatile unsigned char *addr, unsigned char val);
+void vmeWrite16(volatile unsigned short *addr, unsigned short val);
+void vmeWrite32(volatile unsigned int *addr, unsigned int val);
+
+/* DMA engine
+ *  vmeDmaConfig(addrType, dataType, sstMode);
+ *    addrType = 0 (A16)    1 (A24)    2 (A32)
+ *    dataType = 0 (D16)    1 (D32)    2 (BLK32) 3 (MBLK) 4 (2eVME) 5 (2eSST)
+ *    sstMode  = 0 (SST160) 1 (SST267) 2 (SST320)
+ */
+int  vmeDmaConfig(unsigned int addrType, unsigned int dataType, unsigned int sstMode);
+int  vmeDmaSend(unsigned long locAdrs, unsigned int vmeAdrs, int size);
+int  vmeDmaDone();
+
+/* DMA buffer pools (dmaPList) */
+typedef struct dmanode
+{
+  struct dmanode *n;             /* next node in list */
+  struct dmanode *p;             /* previous node in list */
+  struct dmalist *l;             /* pool the node was created in */
+  unsigned long   physMemBase;
+  unsigned long   partBaseAdr;
+  int             length;        /* Data length in words */
+  int             type;
+  int             nevent;
+  int             size;          /* Buffer size in bytes */
+  volatile unsigned int *data;
+} DMANODE;
+
+typedef struct dmalist
+{
+  DMANODE        *f;             /* first (oldest) node */
+  DMANODE        *l;             /* last node */
+  int             c;             /* nodes in list */
+  int             total;         /* nodes created for this list */
+  int             size;          /* Buffer size in bytes */
+  char            name[40];
+  DMANODE       **nodes;         /* nodes created for this list */
+  struct dmalist *next;
+} DMALIST;
+
+typedef DMALIST *DMA_MEM_ID;
+
+extern DMANODE      *the_event;
+extern unsigned int *dma_dabufp;
+
+DMA_MEM_ID dmaPCreate(char *name, int size, int c, int incr);
+void       dmaPFree(DMA_MEM_ID pPart);
+void       dmaPFreeAll();
+DMANODE   *dmaPGetItem(DMA_MEM_ID pPart);
+void       dmaPPutItem(DMA_MEM_ID pPart, DMANODE *pItem);
+void       dmaPFreeItem(DMANODE *pItem);
+int        dmaPReInit(DMA_MEM_ID pPart);
+int        dmaPReInitAll();
+void       dmaPStats(DMA_MEM_ID pPart);
+void       dmaPStatsAll();
+int        dmaPEmpty(DMA_MEM_ID pPart);
+extern DMA_MEM_ID dmaPList;
+
+#define GETEVENT(id, evnum) {                                           \
+    the_event = dmaPGetItem(id);                                        \
+    if(the_event == NULL)                                               \
+      {                                                                 \
+        printf("GETEVENT: ERROR: No buffers available in %s\n",         \
+               (id)->name);                                             \
+      }                                                                 \
+    else                                                                \
+      {                                                                 \
+        the_event->nevent = (evnum);                                    \
+        dma_dabufp = (unsigned int *)&(the_event->data[0]);             \
+      }                                                                 \
+  }
+
+#define PUTEVENT(id) {                                                  \
+    the_event->length = (int)(((unsigned long)(dma_dabufp) -            \
+                               (unsigned long)&(the_event->data[0]))>>2); \
+    dmaPPutItem(id, the_event);                                         \
+  }
+
+#endif /* __JVME__ */
@@ -0,0 +1,2406 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  jvmeSim.c  -  In-memory VME crate emulator implementing the jvme API
+ *
+ *     VME windows are plain process memory.  Each fADC250 and vmeDSC is a
+ *     register image at (slot<<19) in the A24 window, stored big-endian as
+ *     on the bus.  vmeRead and vmeWrite single cycles go through per-module
+ *     hooks that compute dynamic registers (csr, event/block counts,
+ *     scalers, channel samples) and act on command registers (resets,
+ *     triggers, token, latches).
+ *
+ *     Events are kept per module as trigger number/time records and are
+ *     formatted into a block only when the block is read by DMA, from
+ *     per-channel word templates that are rebuilt whenever the processing
+ *     configuration, DACs or thresholds change.  Single board and
+ *     multiblock (token passing) DMA reads terminate with a bus error on
+ *     the last module when bus errors are enabled, as in hardware.
+ *
+ *     Firmware update: the fADC250 configuration SRAM and PROMs
+ *     (mem_adr, mem1/2_data, prom_reg1) and the vmeDSC SPI flash (calCmd,
+ *     calBuf, calExe) hold the data written, and PROM and flash commands
+ *     stay busy for a time like the hardware's.  Reboots do not change the
+ *     firmware versions.
+ *
+ *     Not emulated: programmed I/O reads of the A32 FIFO by direct
+ *     pointer dereference (faReadBlock rflag=0, faPrintBlock), interrupts,
+ *     the SDC, playback and internal (HITSUM) triggers.
+ *
+ *----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "jvme.h"
+#include "jvmeSim.h"
+#include "fadcLib.h"
+#include "vmeDSClib.h"
+
+#define SIM_A24_SIZE      0x01000000
+#define SIM_A16_SIZE      0x00010000
+#define SIM_A32_BASE      0x08000000
+#define SIM_A32_SIZE      0x20000000
+#define SIM_SLOT_SHIFT    19
+#define SIM_SLOT_MASK     ((1<<SIM_SLOT_SHIFT)-1)
+#define SIM_MAX_SLOTS     21
+
+#define SIM_MAX_EVENTS    4096    /* Event records per module */
+#define SIM_MIN_EVENTS    64      /* Minimum buffered events before busy */
+#define SIM_NTEMPL        8       /* Pulse templates per channel */
+#define SIM_TMPL_WORDS    272     /* Words per template (raw window + pulse) */
+#define SIM_DSC_EVENTS    255     /* Events the DSC output FIFO can hold */
+
+#define SIM_FA_CTRL_FW    0x41
+#define SIM_FA_PROC_FW    0x0C12
+#define SIM_FA_SN_BASE    1000
+#define SIM_DSC_FW        0x10E
+#define SIM_DSC_A32_BASE  0x18000000
+
+/* Firmware update */
+#define SIM_FA_SRAM_WORDS  0x200000   /* Configuration SRAM, per memory */
+#define SIM_FA_PROM_NS     20000      /* SRAM to PROM, per word */
+#define SIM_FA_PROM_RD_NS  1000       /* PROM to SRAM, per word */
+#define SIM_FA_REBOOT_NS   200000000ULL
+#define SIM_DSC_FLASH_SIZE 0x200000   /* Numonyx M25P16 */
+#define SIM_DSC_FLASH_ID   0x20
+#define SIM_DSC_ERASE_NS   600000000ULL  /* 64 kB sector erase */
+#define SIM_DSC_PAGE_NS    640000ULL     /* 256 byte page program */
+
+#define SIM_DATA_NOT_VALID 0xF0000000
+#define SIM_DATA_FILLER    0xF8000000
+
+/* Big-endian register image access */
+#define RGET(p)     ((unsigned int)LSWAP(*(p)))
+#define RSET(p,v)   (*(p) = LSWAP((unsigned int)(v)))
+#define RGET16(p)   ((unsigned short)SSWAP(*(p)))
+
+#define FA_REG(m)   offsetof(struct fadc_struct, m)
+#define DSC_REG(m)  offsetof(struct dsc_struct, m)
+
+typedef struct
+{
+  int slot;
+  volatile struct fadc_struct *r;
+  unsigned long long rng;
+
+  /* Analog front end model */
+  double dac0[FA_MAX_ADC_CHANNELS];     /* DAC setting for the nominal baseline */
+  double noise[FA_MAX_ADC_CHANNELS];    /* Baseline noise (ADC counts rms) */
+  double sigrate[FA_MAX_ADC_CHANNELS];  /* Rate of physics pulses (Hz) */
+
+  /* Event records, not yet built into a block */
+  unsigned int       ev_num[SIM_MAX_EVENTS];
+  unsigned long long ev_time[SIM_MAX_EVENTS];
+  int ev_head, nev;
+  unsigned int trig_num;
+  unsigned long long sync_ns;
+  unsigned int blk_num;
+
+  /* Output FIFO: the block currently being read out */
+  unsigned int *obuf;
+  int osize, olen, opos, onev;
+  int berr;
+
+  /* Scalers */
+  double scal[FA_MAX_ADC_CHANNELS];
+  double tcount;
+  unsigned long long scal_ns;
+
+  int sample_chan;
+
+  /* Channel word templates */
+  unsigned int cfg_gen, tmpl_gen;
+  int mode, ptw;
+  unsigned int *tmpl;
+  int tmpl_len[FA_MAX_ADC_CHANNELS][SIM_NTEMPL+1];
+  int tmpl_hdr[FA_MAX_ADC_CHANNELS][SIM_NTEMPL+1];
+
+  /* Configuration SRAM and PROMs, allocated on first use */
+  unsigned int *sram[2];
+  unsigned int *prom[2];
+  unsigned int mem_adr;
+  int sram_len, prom_len[2];
+  unsigned long long prom_busy;
+} simFadc;
+
+typedef struct
+{
+  int slot;
+  volatile struct dsc_struct *r;
+  unsigned long long rng;
+
+  double sigrate[16];
+  double trg[16], tdc[16];
+  unsigned long long scal_ns;
+  unsigned long long ref_t0;
+
+  unsigned int cfg;
+  unsigned int evnum;
+  unsigned int *fifo;
+  int fsize, flen, fpos;
+  int evt_end[SIM_DSC_EVENTS+1];
+  int nevt;
+  int berr;
+
+  /* SPI flash, allocated on first use */
+  unsigned char *flash;
+  unsigned int spi_op, spi_addr;
+  int wel;
+  unsigned long long flash_busy;
+} simDsc;
+
+static pthread_mutex_t simMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t busMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t vmeBusMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t dmaPMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int simInited = 0;
+static volatile unsigned char *a24win = NULL;
+static volatile unsigned char *a16win = NULL;
+static volatile unsigned char *a32win = NULL;
+static unsigned long long simT0 = 0;
+
+static simFadc *simFa[SIM_MAX_SLOTS+1];
+static simDsc  *simDs[SIM_MAX_SLOTS+1];
+static int simToken = 0;       /* Slot holding the multiblock token, 0 if none */
+
+static unsigned int simSeed = 1;
+static double simOccupancy = 0.1;
+
+/* Trigger source */
+static double simTrigRate = 0.;
+static unsigned long long simTrigPeriod = 0;
+static unsigned long long simNextTrig = 0;
+static int simTrigRunning = 0;
+
+/* Bus cost model */
+static unsigned int simReadNs = 1000;
+static unsigned int simWriteNs = 300;
+static unsigned int simDmaSetupNs = 5000;
+static double simDmaMBps = 0;          /* 0: from vmeDmaConfig */
+static double simDmaNsPerByte = 1000./200.;
+static unsigned long long simBusFree = 0;
+
+/* DMA engine */
+static unsigned int simDmaData = 5, simDmaSst = 1;
+static int simDmaPending = 0;
+static int simDmaBytes = 0;
+static unsigned long long simDmaDoneAt = 0;
+
+static unsigned int simQuiet = 0;
+static vmeSimStats simStats;
+
+/* dmaPList globals */
+DMA_MEM_ID dmaPList = NULL;
+DMANODE *the_event = NULL;
+unsigned int *dma_dabufp = NULL;
+
+static void simInit();
+static void simCrateUpdate(unsigned long long now);
+
+/*----------------------------------------------------------------------------
+ * Time, random numbers and the bus
+ */
+
+static unsigned long long
+simClock()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec*1000000000ULL + ts.tv_nsec;
+}
+
+unsigned long long
+vmeSimNow()
+{
+  return simClock() - simT0;
+}
+
+static unsigned long long
+simRand(unsigned long long *s)
+{
+  /* splitmix64 */
+  unsigned long long z = (*s += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+static double
+simUniform(unsigned long long *s)
+{
+  return (simRand(s) >> 11) * (1.0/9007199254740992.0);
+}
+
+static double
+simGauss(unsigned long long *s)
+{
+  double u1 = simUniform(s), u2 = simUniform(s);
+  if(u1 < 1e-300) u1 = 1e-300;
+  return sqrt(-2.*log(u1)) * cos(2.*M_PI*u2);
+}
+
+static void
+simSpinUntil(unsigned long long t)
+{
+  while(vmeSimNow() < t)
+    ;
+}
+
+/* Occupy the bus for ns, starting when it is next free.  Returns the
+   completion time. */
+static unsigned long long
+simBusReserve(unsigned long long ns)
+{
+  unsigned long long now = vmeSimNow(), start, end;
+
+  pthread_mutex_lock(&busMutex);
+  start = (simBusFree > now) ? simBusFree : now;
+  end = start + ns;
+  simBusFree = end;
+  simStats.bus_ns += ns;
+  pthread_mutex_unlock(&busMutex);
+
+  return end;
+}
+
+static void
+simBusCycle(unsigned int ns)
+{
+  simSpinUntil(simBusReserve(ns));
+}
+
+static void
+simDmaRate()
+{
+  /* Sustained bandwidth (MB/s) by vmeDmaConfig dataType, and 2eSST rate */
+  static const double mbps[6] = { 10., 20., 25., 60., 100., 0. };
+  static const double sst[3]  = { 120., 200., 240. };
+  double rate;
+
+  if(simDmaMBps > 0)
+    rate = simDmaMBps;
+  else if(simDmaData == 5)
+    rate = sst[(simDmaSst < 3) ? simDmaSst : 2];
+  else
+    rate = mbps[(simDmaData < 5) ? simDmaData : 1];
+
+  simDmaNsPerByte = 1000./rate;
+}
+
+/*----------------------------------------------------------------------------
+ * fADC250 model
+ */
+
+static double
+simFadcBaseline(simFadc *f, int chan)
+{
+  double base = 150. + (f->dac0[chan] - (RGET16(&f->r->dac[chan]) & FA_DAC_VALUE_MASK))*0.65;
+
+  if(base < 0) base = 0;
+  if(base > 4095) base = 4095;
+  return base;
+}
+
+/* Threshold crossing rate (Hz) for an absolute threshold: baseline noise
+   crossings plus an exponential pulse height spectrum */
+static double
+simFadcRate(simFadc *f, int chan, unsigned int thres)
+{
+  double h, rate;
+
+  if(thres == 0)
+    return 0.;
+
+  h = thres - simFadcBaseline(f, chan);
+  rate = 5.0e6*exp(-h*h/(2.*f->noise[chan]*f->noise[chan]));
+  rate += (h > 0) ? f->sigrate[chan]*exp(-h/150.) : f->sigrate[chan];
+
+  return rate;
+}
+
+static void
+simFadcScalerUpdate(simFadc *f, unsigned long long now)
+{
+  unsigned int tpt;
+  double dt, n;
+  int ichan;
+
+  if(now <= f->scal_ns)
+    return;
+
+  dt = (now - f->scal_ns)*1e-9;
+  f->scal_ns = now;
+
+  if((RGET(&f->r->scaler_ctrl) & FA_SCALER_CTRL_ENABLE) == 0)
+    return;
+
+  tpt = RGET(&f->r->config3) & FA_ADC_CONFIG3_TPT_MASK;
+  for(ichan = 0; ichan < FA_MAX_ADC_CHANNELS; ichan++)
+    {
+      n = simFadcRate(f, ichan, tpt)*dt;
+      n += sqrt(n)*simGauss(&f->rng);
+      if(n > 0)
+	f->scal[ichan] += n;
+    }
+  f->tcount += dt*1e9/2048.;
+}
+
+static void
+simFadcScalerLatch(simFadc *f)
+{
+  int ichan;
+
+  for(ichan = 0; ichan < FA_MAX_ADC_CHANNELS; ichan++)
+    RSET(&f->r->scaler[ichan], (unsigned int)f->scal[ichan]);
+  RSET(&f->r->time_count, (unsigned int)f->tcount);
+}
+
+static void
+simFadcClear(simFadc *f)
+{
+  f->ev_head = f->nev = 0;
+  f->olen = f->opos = f->onev = 0;
+  f->berr = 0;
+}
+
+static void
+simFadcDefaults(simFadc *f)
+{
+  unsigned short dac[FA_MAX_ADC_CHANNELS];
+  int ichan;
+
+  for(ichan = 0; ichan < FA_MAX_ADC_CHANNELS; ichan++)
+    dac[ichan] = RGET16(&f->r->dac[ichan]);
+
+  memset((void *)f->r, 0, sizeof(struct fadc_struct));
+
+  RSET(&f->r->version, FA_BOARD_ID | SIM_FA_CTRL_FW);
+  RSET(&f->r->intr, f->slot<<16);
+  RSET(&f->r->blk_level, 1);
+  RSET(&f->r->adc_status[0], SIM_FA_PROC_FW);
+  RSET(&f->r->serial_number[0], FA_SERIAL_NUMBER_ACDI);
+  RSET(&f->r->serial_number[1], SIM_FA_SN_BASE + (simSeed%100)*21 + f->slot);
+  for(ichan = 0; ichan < FA_MAX_ADC_CHANNELS; ichan++)
+    f->r->dac[ichan] = SSWAP(dac[ichan]);
+
+  simFadcClear(f);
+  f->trig_num = 0;
+  f->blk_num = 0;
+  f->sync_ns = vmeSimNow();
+  memset(f->scal, 0, sizeof(f->scal));
+  f->tcount = 0;
+  f->scal_ns = f->sync_ns;
+  f->cfg_gen++;
+
+  if(simToken == f->slot)
+    simToken = 0;
+}
+
+static int
+simFadcEnabled(simFadc *f)
+{
+  unsigned int ctrl2 = RGET(&f->r->ctrl2);
+
+  return ((ctrl2 & (FA_CTRL_GO | FA_CTRL_ENABLE_TRIG)) ==
+	  (FA_CTRL_GO | FA_CTRL_ENABLE_TRIG));
+}
+
+static int
+simFadcLevel(simFadc *f)
+{
+  int level = RGET(&f->r->blk_level) & FA_BLOCK_LEVEL_MASK;
+
+  return (level > 0) ? level : 1;
+}
+
+/* Events the module can still accept before going busy */
+static int
+simFadcRoom(simFadc *f)
+{
+  int cap = simFadcLevel(f)*8;
+
+  if(cap < SIM_MIN_EVENTS) cap = SIM_MIN_EVENTS;
+  if(cap > SIM_MAX_EVENTS) cap = SIM_MAX_EVENTS;
+
+  return cap - f->nev;
+}
+
+static void
+simFadcPushEvent(simFadc *f, unsigned long long t)
+{
+  int i = (f->ev_head + f->nev) % SIM_MAX_EVENTS;
+
+  f->trig_num++;
+  f->ev_num[i]  = f->trig_num;
+  f->ev_time[i] = t;
+  f->nev++;
+}
+
+static int
+simFadcBlockReady(simFadc *f)
+{
+  return (f->opos < f->olen) || (f->nev >= simFadcLevel(f));
+}
+
+static int
+simFadcIsFirst(simFadc *f)
+{
+  return (RGET(&f->r->ctrl1) & FA_FIRST_BOARD) ? 1 : 0;
+}
+
+static void
+simFadcTokenReset(simFadc *f)
+{
+  if(simFadcIsFirst(f) && (RGET(&f->r->adr_mb) & FA_AMB_ENABLE))
+    simToken = f->slot;
+}
+
+/* Pulse shape with peak amplitude amp at sample t0+tau */
+static double
+simPulse(double amp, double t0, int isample)
+{
+  double u = (isample - t0)/2.5;
+
+  if(u <= 0)
+    return 0.;
+  return amp*u*u*exp(2.*(1.-u));
+}
+
+/* Build the per-channel word templates for the current configuration */
+static void
+simFadcBuild(simFadc *f)
+{
+  unsigned int cfg0 = RGET(&f->r->adc_config[0]);
+  unsigned int nsb, nsa, nped, thres;
+  unsigned int *w;
+  int ichan, k, i, n, tc, ip, coarse, fine, nover;
+  int ped, sum, vpeak, nsa_ext, over;
+  double base, amp, t0, vmid;
+  int s[FA_ADC_MAX_PTW+1];
+
+  switch((cfg0 & FA_ADC_PROC_MASK)>>8)
+    {
+    case 1:  f->mode = FA_ADC_PROC_MODE_RAW_PULSE_PARAM; break;
+    case 3:  f->mode = FA_ADC_PROC_MODE_RAW; break;
+    default: f->mode = FA_ADC_PROC_MODE_PULSE_PARAM; break;
+    }
+  if((cfg0 & FA_ADC_PROC_ENABLE) == 0)
+    f->mode = 0;
+
+  f->ptw = (RGET(&f->r->adc_ptw) & 0xFFFF) + 1;
+  if(f->ptw > FA_ADC_MAX_PTW) f->ptw = FA_ADC_MAX_PTW;
+  nsb = RGET(&f->r->adc_nsb) & 0xF;
+  nsa = RGET(&f->r->adc_nsa) & FA_ADC_NSA_READBACK_MASK;
+  nped = ((RGET(&f->r->config7) & FA_ADC_CONFIG7_NPED_MASK)>>10) + 1;
+  if(nped > (unsigned int)f->ptw) nped = f->ptw;
+
+  if(f->tmpl == NULL)
+    f->tmpl = (unsigned int *)malloc(FA_MAX_ADC_CHANNELS*(SIM_NTEMPL+1)*
+				     SIM_TMPL_WORDS*sizeof(unsigned int));
+
+  for(ichan = 0; ichan < FA_MAX_ADC_CHANNELS; ichan++)
+    {
+      base  = simFadcBaseline(f, ichan);
+      thres = RGET16(&f->r->adc_thres[ichan]) & FA_ADC_MAX_THRESH;
+      if(thres == 0)
+	thres = (unsigned int)(5*f->noise[ichan]) + 1;
+
+      for(k = 0; k <= SIM_NTEMPL; k++)
+	{
+	  w = &f->tmpl[(ichan*(SIM_NTEMPL+1) + k)*SIM_TMPL_WORDS];
+	  n = 0;
+	  f->tmpl_hdr[ichan][k] = -1;
+
+	  /* Samples: k < SIM_NTEMPL carry a pulse, k == SIM_NTEMPL is baseline only */
+	  amp = 30.*pow(1.6, k);
+	  t0  = f->ptw/3 + (k%3);
+	  over = 0;
+	  for(i = 0; i < f->ptw; i++)
+	    {
+	      double v = base + f->noise[ichan]*simGauss(&f->rng);
+	      if(k < SIM_NTEMPL)
+		v += simPulse(amp, t0, i);
+	      s[i] = (int)(v + 0.5);
+	      if(s[i] < 0) s[i] = 0;
+	      if(s[i] > 4095) { s[i] = 4095 | 0x1000; over = 1; }
+	    }
+	  s[f->ptw] = 0x2000;
+
+	  /* Pulse search: first sample over threshold above the pedestal */
+	  ped = 0;
+	  for(i = 0; i < (int)nped; i++)
+	    ped += s[i] & 0xFFF;
+	  tc = -1;
+	  for(i = nped; i < f->ptw; i++)
+	    {
+	      if((int)(s[i] & 0xFFF) - ped/(int)nped > (int)thres)
+		{
+		  tc = i;
+		  break;
+		}
+	    }
+
+	  if(f->mode == 0)
+	    {
+	      f->tmpl_len[ichan][k] = 0;
+	      continue;
+	    }
+
+	  if((f->mode == FA_ADC_PROC_MODE_RAW) ||
+	     ((f->mode == FA_ADC_PROC_MODE_RAW_PULSE_PARAM) && (tc >= 0)))
+	    {
+	      w[n++] = 0xA0000000 | (ichan<<23) | f->ptw;
+	      for(i = 0; i < f->ptw; i += 2)
+		w[n++] = (s[i]<<16) | s[i+1];
+	    }
+
+	  if((tc >= 0) && (f->mode != FA_ADC_PROC_MODE_RAW))
+	    {
+	      f->tmpl_hdr[ichan][k] = n;
+	      w[n++] = 0x80000000 | (9<<27) | (ichan<<15) | (ped & 0x3FFF);
+
+	      sum = 0; nover = 0; nsa_ext = 0;
+	      for(i = tc - (int)nsb; i < tc + (int)nsa; i++)
+		{
+		  if(i < 0) continue;
+		  if(i >= f->ptw) { nsa_ext = 1; break; }
+		  sum += s[i] & 0xFFF;
+		  if(s[i] & 0x1000) nover++;
+		}
+	      if(sum > 0x3FFFF) sum = 0x3FFFF;
+	      w[n++] = (1<<30) | (sum<<12) | (nsa_ext<<11) | (over<<10) | (nover & 0x1FF);
+
+	      ip = tc;
+	      while((ip+1 < f->ptw) && ((s[ip+1] & 0xFFF) >= (s[ip] & 0xFFF)))
+		ip++;
+	      vpeak = s[ip] & 0xFFF;
+	      vmid = (vpeak + ped/(double)nped)/2.;
+	      coarse = tc;
+	      while((coarse > 0) && ((s[coarse] & 0xFFF) >= vmid))
+		coarse--;
+	      fine = 0;
+	      if((s[coarse+1] & 0xFFF) != (s[coarse] & 0xFFF))
+		fine = (int)(64.*(vmid - (s[coarse] & 0xFFF))/
+			     ((s[coarse+1] & 0xFFF) - (s[coarse] & 0xFFF)));
+	      if(fine < 0) fine = 0;
+	      if(fine > 63) fine = 63;
+	      w[n++] = ((coarse & 0x1FF)<<21) | (fine<<15) | (vpeak<<3);
+	    }
+
+	  f->tmpl_len[ichan][k] = n;
+	}
+    }
+
+  f->tmpl_gen = f->cfg_gen;
+}
+
+static void
+simFadcGrow(simFadc *f, int nwords)
+{
+  if(f->osize >= nwords)
+    return;
+  f->osize = nwords + 1024;
+  f->obuf = (unsigned int *)realloc(f->obuf, f->osize*sizeof(unsigned int));
+}
+
+/* Build the next block from the event records into the output FIFO */
+static void
+simFadcFormatBlock(simFadc *f)
+{
+  unsigned int ctrl1 = RGET(&f->r->ctrl1);
+  unsigned int chdis = RGET(&f->r->adc_config[1]) & FA_ADC_CHAN_MASK;
+  unsigned int slot = f->slot, *w, *t;
+  unsigned long long ts;
+  int level = simFadcLevel(f);
+  int nev, iev, ichan, k, n, ie;
+
+  if(f->nev < level)
+    return;
+  nev = level;
+
+  if(f->tmpl_gen != f->cfg_gen)
+    simFadcBuild(f);
+
+  simFadcGrow(f, 4 + nev*(3 + FA_MAX_ADC_CHANNELS*SIM_TMPL_WORDS));
+  w = f->obuf;
+  n = 0;
+
+  w[n++] = 0x80000000 | (slot<<22) | ((f->blk_num & 0x3FF)<<8) | (nev & 0xFF);
+  if(ctrl1 & FA_ENABLE_ADC_PARAMETERS_DATA)
+    w[n++] = ((RGET(&f->r->adc_pl) & 0x7FF)<<18) |
+      ((RGET(&f->r->adc_nsb) & 0x1FF)<<9) | (RGET(&f->r->adc_nsa) & 0x1FF);
+
+  for(iev = 0; iev < nev; iev++)
+    {
+      ie = (f->ev_head + iev) % SIM_MAX_EVENTS;
+      w[n++] = 0x90000000 | (slot<<22) | (f->ev_num[ie] & 0x3FFFFF);
+      if((ctrl1 & FA_SUPPRESS_TRIGGER_TIME_DATA) == 0)
+	{
+	  ts = (f->ev_time[ie] - f->sync_ns)/FA_ADC_NS_PER_CLK;
+	  w[n++] = 0x98000000 | (ts & 0xFFFFFF);
+	  if((ctrl1 & FA_SUPPRESS_TRIGGER_TIME_WORD2_DATA) == 0)
+	    w[n++] = (ts>>24) & 0xFFFFFF;
+	}
+
+      for(ichan = 0; ichan < FA_MAX_ADC_CHANNELS; ichan++)
+	{
+	  if(chdis & (1<<ichan))
+	    continue;
+	  if(simUniform(&f->rng) < simOccupancy)
+	    k = simRand(&f->rng) % SIM_NTEMPL;
+	  else
+	    k = SIM_NTEMPL;
+	  if(f->tmpl_len[ichan][k] == 0)
+	    continue;
+	  t = &f->tmpl[(ichan*(SIM_NTEMPL+1) + k)*SIM_TMPL_WORDS];
+	  memcpy(&w[n], t, f->tmpl_len[ichan][k]*sizeof(unsigned int));
+	  if(f->tmpl_hdr[ichan][k] >= 0)
+	    w[n + f->tmpl_hdr[ichan][k]] |= (iev & 0xFF)<<19;
+	  n += f->tmpl_len[ichan][k];
+	}
+    }
+
+  n++;
+  w[n-1] = 0x88000000 | (slot<<22) | n;
+  if(n & 1)
+    w[n++] = SIM_DATA_FILLER;
+
+  f->ev_head = (f->ev_head + nev) % SIM_MAX_EVENTS;
+  f->nev -= nev;
+  f->olen = n;
+  f->opos = 0;
+  f->onev = nev;
+  f->blk_num++;
+  simStats.blocks++;
+}
+
+/* Move up to maxw words of the current block to dst (bus byte order).
+   Returns words moved; *done is set when the end of the block was reached */
+static int
+simFadcDrain(simFadc *f, volatile unsigned int *dst, int maxw, int *done)
+{
+  int n, i;
+
+  *done = 0;
+  if(f->opos >= f->olen)
+    simFadcFormatBlock(f);
+  if(f->opos >= f->olen)
+    {
+      *done = 1;
+      return 0;
+    }
+
+  n = f->olen - f->opos;
+  if(n > maxw) n = maxw;
+  for(i = 0; i < n; i++)
+    dst[i] = LSWAP(f->obuf[f->opos + i]);
+  f->opos += n;
+
+  if(f->opos >= f->olen)
+    {
+      f->olen = f->opos = f->onev = 0;
+      *done = 1;
+    }
+  return n;
+}
+
+static unsigned int
+simFadcSample(simFadc *f)
+{
+  int chan = f->sample_chan;
+  double v;
+
+  f->sample_chan = (f->sample_chan + 1) % FA_MAX_ADC_CHANNELS;
+  v = simFadcBaseline(f, chan) + f->noise[chan]*simGauss(&f->rng);
+  if(v < 0) v = 0;
+  if(v > 4095) return 4095 | 0x1000;
+  return (unsigned int)(v + 0.5);
+}
+
+/* Configuration SRAM and PROM memories, allocated on first use */
+static unsigned int *
+simFadcMem(unsigned int **m)
+{
+  if(*m == NULL)
+    *m = (unsigned int *)calloc(SIM_FA_SRAM_WORDS, sizeof(unsigned int));
+  return *m;
+}
+
+/* mem1_data (imem 0) or mem2_data (imem 1) access at mem_adr, which
+   increments after the access if enabled for that memory */
+static unsigned int
+simFadcMemAccess(simFadc *f, int imem, int write, unsigned int val)
+{
+  unsigned int *m = simFadcMem(&f->sram[imem]);
+  unsigned int a = f->mem_adr & (SIM_FA_SRAM_WORDS-1);
+
+  if(write)
+    {
+      m[a] = val;
+      if((imem == 0) && ((int)a >= f->sram_len))
+	f->sram_len = a + 1;
+    }
+  else
+    val = m[a];
+
+  if(f->mem_adr & (imem ? FA_MEM_ADR_INCR_MEM2 : FA_MEM_ADR_INCR_MEM1))
+    f->mem_adr = (f->mem_adr & ~(SIM_FA_SRAM_WORDS-1)) |
+      ((a + 1) & (SIM_FA_SRAM_WORDS-1));
+
+  return val;
+}
+
+/* prom_reg1 command: done at once, ready bit clear for the PROM time */
+static void
+simFadcPromCmd(simFadc *f, unsigned int cmd, unsigned long long now)
+{
+  unsigned long long ns = 0;
+  int ip;
+
+  switch(cmd)
+    {
+    case FA_PROMREG1_SRAM_TO_PROM1:
+    case FA_PROMREG1_SRAM_TO_PROM2:
+      ip = (cmd == FA_PROMREG1_SRAM_TO_PROM2);
+      memcpy(simFadcMem(&f->prom[ip]), simFadcMem(&f->sram[0]),
+	     f->sram_len*sizeof(unsigned int));
+      f->prom_len[ip] = f->sram_len;
+      ns = (unsigned long long)f->sram_len * SIM_FA_PROM_NS;
+      break;
+
+    case FA_PROMREG1_PROM1_TO_SRAM:
+    case FA_PROMREG1_PROM2_TO_SRAM:
+      ip = (cmd == FA_PROMREG1_PROM2_TO_SRAM);
+      memcpy(simFadcMem(&f->sram[0]), simFadcMem(&f->prom[ip]),
+	     f->prom_len[ip]*sizeof(unsigned int));
+      if(f->prom_len[ip] > f->sram_len)
+	f->sram_len = f->prom_len[ip];
+      ns = (unsigned long long)f->prom_len[ip] * SIM_FA_PROM_RD_NS;
+      break;
+
+    case FA_PROMREG1_REBOOT_FPGA1:
+    case FA_PROMREG1_REBOOT_FPGA2:
+      ns = SIM_FA_REBOOT_NS;
+      break;
+
+    default:
+      break;
+    }
+
+  f->prom_busy = now + ns;
+}
+
+static unsigned int
+simFadcRead(simFadc *f, unsigned int reg)
+{
+  unsigned int rval = 0;
+  unsigned long long now;
+
+  switch(reg)
+    {
+    case FA_REG(csr):
+      simCrateUpdate(vmeSimNow());
+      if((f->nev > 0) || (f->opos < f->olen))
+	rval |= FA_CSR_EVENT_AVAILABLE;
+      else
+	rval |= FA_CSR_FIFO1_EMPTY;
+      if(simFadcBlockReady(f))
+	rval |= FA_CSR_BLOCK_READY;
+      if(f->berr)
+	rval |= FA_CSR_BERR_STATUS;
+      if(simToken == f->slot)
+	rval |= FA_CSR_TOKEN_STATUS;
+      return rval;
+
+    case FA_REG(ev_count):
+      simCrateUpdate(vmeSimNow());
+      return (f->nev + f->onev) & FA_EVENT_COUNT_MASK;
+
+    case FA_REG(blk_count):
+    case FA_REG(blk_fifo_count):
+      simCrateUpdate(vmeSimNow());
+      return ((f->nev/simFadcLevel(f)) + ((f->opos < f->olen) ? 1 : 0))
+	& FA_BLOCK_COUNT_MASK;
+
+    case FA_REG(trig_scal):
+      return f->trig_num;
+
+    case FA_REG(adc_status[1]):
+      return FA_ADC_STATUS1_TRIG_RCV_DONE | (f->trig_num & FA_ADC_STATUS1_TRIGNUM_MASK);
+
+    case FA_REG(adc_status[2]):
+      return simFadcSample(f);
+
+    case FA_REG(time_count):
+      now = vmeSimNow();
+      simFadcScalerUpdate(f, now);
+      return RGET(&f->r->time_count);
+
+    case FA_REG(mem_adr):
+      return f->mem_adr;
+
+    case FA_REG(mem1_data):
+      return simFadcMemAccess(f, 0, 0, 0);
+
+    case FA_REG(mem2_data):
+      return simFadcMemAccess(f, 1, 0, 0);
+
+    case FA_REG(prom_reg1):
+      return (vmeSimNow() >= f->prom_busy) ? FA_PROMREG1_READY : 0;
+
+    default:
+      return RGET((volatile unsigned int *)((volatile char *)f->r + reg));
+    }
+}
+
+static void
+simFadcWrite(simFadc *f, unsigned int reg, unsigned int val)
+{
+  volatile unsigned int *p = (volatile unsigned int *)((volatile char *)f->r + reg);
+  unsigned int old = RGET(p);
+  unsigned long long now = vmeSimNow();
+
+  /* Registers that change the scaler rates: accumulate up to now first */
+  if(((reg >= FA_REG(dac[0])) && (reg < FA_REG(status[0]))) ||
+     (reg == FA_REG(config3)) || (reg == FA_REG(scaler_ctrl)))
+    simFadcScalerUpdate(f, now);
+
+  RSET(p, val);
+
+  switch(reg)
+    {
+    case FA_REG(csr):
+      RSET(p, 0);
+      if(val & FA_CSR_HARD_RESET)
+	{
+	  simFadcDefaults(f);
+	  break;
+	}
+      if(val & (FA_CSR_SOFT_RESET | FA_CSR_SOFT_CLEAR))
+	{
+	  simFadcClear(f);
+	  simFadcTokenReset(f);
+	}
+      if(val & FA_CSR_SYNC)
+	{
+	  simFadcClear(f);
+	  f->trig_num = 0;
+	  f->sync_ns = now;
+	  simFadcTokenReset(f);
+	}
+      if(val & FA_CSR_TRIGGER)
+	{
+	  if(simFadcEnabled(f) && (simFadcRoom(f) > 0))
+	    simFadcPushEvent(f, now);
+	}
+      break;
+
+    case FA_REG(ctrl2):
+      if(simFadcEnabled(f) && !(old & FA_CTRL_GO))
+	simFadcTokenReset(f);
+      if(simFadcEnabled(f) && (simTrigRate > 0) && !simTrigRunning)
+	{
+	  simTrigRunning = 1;
+	  simNextTrig = now + simTrigPeriod;
+	}
+      break;
+
+    case FA_REG(reset):
+      RSET(p, 0);
+      if(val & FA_RESET_TOKEN)
+	simFadcTokenReset(f);
+      if(val & FA_RESET_ADC_FIFO1)
+	simFadcClear(f);
+      break;
+
+    case FA_REG(scaler_ctrl):
+      if(val & FA_SCALER_CTRL_RESET)
+	{
+	  memset(f->scal, 0, sizeof(f->scal));
+	  f->tcount = 0;
+	  simFadcScalerLatch(f);
+	}
+      if(val & FA_SCALER_CTRL_LATCH)
+	simFadcScalerLatch(f);
+      RSET(p, val & FA_SCALER_CTRL_ENABLE);
+      break;
+
+    case FA_REG(mem_adr):
+      f->mem_adr = val;
+      break;
+
+    case FA_REG(mem1_data):
+      simFadcMemAccess(f, 0, 1, val);
+      break;
+
+    case FA_REG(mem2_data):
+      simFadcMemAccess(f, 1, 1, val);
+      break;
+
+    case FA_REG(prom_reg1):
+      simFadcPromCmd(f, val, now);
+      break;
+
+    case FA_REG(adc_config[0]):
+      if(val & FA_ADC_CONFIG0_CHAN_READ_ENABLE)
+	f->sample_chan = 0;
+      f->cfg_gen++;
+      break;
+
+    case FA_REG(ctrl1):
+    case FA_REG(adc_config[1]):
+    case FA_REG(adc_ptw):
+    case FA_REG(adc_pl):
+    case FA_REG(adc_nsb):
+    case FA_REG(adc_nsa):
+    case FA_REG(config7):
+      f->cfg_gen++;
+      break;
+
+    default:
+      if(((reg >= FA_REG(dac[0])) && (reg < FA_REG(status[0]))) ||
+	 ((reg >= FA_REG(adc_thres[0])) && (reg < FA_REG(config6))))
+	f->cfg_gen++;
+      break;
+    }
+}
+
+static simFadc *
+simFadcCreate(int slot)
+{
+  simFadc *f = (simFadc *)calloc(1, sizeof(simFadc));
+  int ichan;
+
+  f->slot = slot;
+  f->r = (volatile struct fadc_struct *)(a24win + (slot<<SIM_SLOT_SHIFT));
+  f->rng = ((unsigned long long)simSeed<<32) ^ (0xFADC0000ULL + slot);
+  simRand(&f->rng);
+
+  for(ichan = 0; ichan < FA_MAX_ADC_CHANNELS; ichan++)
+    {
+      f->dac0[ichan]    = 3150. + 200.*simUniform(&f->rng);
+      f->noise[ichan]   = 1.2 + 0.6*simUniform(&f->rng);
+      f->sigrate[ichan] = 1000. + 9000.*simUniform(&f->rng);
+      f->r->dac[ichan]  = SSWAP(3250);
+    }
+
+  simFadcDefaults(f);
+  return f;
+}
+
+/*----------------------------------------------------------------------------
+ * vmeDSC model
+ */
+
+static double
+simDscRate(simDsc *d, int chan, unsigned int thres)
+{
+  double h = thres;  /* -1 mV units */
+
+  return 2.0e6*exp(-h*h/(2.*4.*4.)) + d->sigrate[chan]*exp(-h/30.);
+}
+
+static void
+simDscScalerUpdate(simDsc *d, unsigned long long now)
+{
+  unsigned int enable, thr;
+  double dt, n;
+  int ichan;
+
+  if(now <= d->scal_ns)
+    return;
+
+  dt = (now - d->scal_ns)*1e-9;
+  d->scal_ns = now;
+
+  enable = RGET(&d->r->chEnable);
+  for(ichan = 0; ichan < 16; ichan++)
+    {
+      thr = RGET(&d->r->threshold[ichan]);
+      if(enable & (1<<ichan))
+	{
+	  n = simDscRate(d, ichan, thr & DSC_THRESHOLD_TDC_MASK)*dt;
+	  n += sqrt(n)*simGauss(&d->rng);
+	  if(n > 0) d->tdc[ichan] += n;
+	}
+      if(enable & (1<<(ichan+16)))
+	{
+	  n = simDscRate(d, ichan, (thr & DSC_THRESHOLD_TRG_MASK)>>16)*dt;
+	  n += sqrt(n)*simGauss(&d->rng);
+	  if(n > 0) d->trg[ichan] += n;
+	}
+    }
+}
+
+static unsigned int
+simDscRef(simDsc *d, unsigned long long now)
+{
+  return (unsigned int)((now - d->ref_t0)*(DSC_REFERENCE_RATE*1e-9));
+}
+
+static void
+simDscLatch(simDsc *d, int group, unsigned long long now)
+{
+  int ichan;
+
+  simDscScalerUpdate(d, now);
+  for(ichan = 0; ichan < 16; ichan++)
+    {
+      if(group == 1)
+	{
+	  RSET(&d->r->TrgScalerGrp1[ichan], (unsigned int)d->trg[ichan]);
+	  RSET(&d->r->TdcScalerGrp1[ichan], (unsigned int)d->tdc[ichan]);
+	}
+      else
+	{
+	  RSET(&d->r->TrgScalerGrp2[ichan], (unsigned int)d->trg[ichan]);
+	  RSET(&d->r->TdcScalerGrp2[ichan], (unsigned int)d->tdc[ichan]);
+	}
+    }
+  if(group == 1)
+    RSET(&d->r->refScalerGrp1, simDscRef(d, now));
+  else
+    RSET(&d->r->refScalerGrp2, simDscRef(d, now));
+}
+
+static void
+simDscClear(simDsc *d)
+{
+  d->flen = d->fpos = 0;
+  d->nevt = 0;
+  d->berr = 0;
+}
+
+static void
+simDscDefaults(simDsc *d)
+{
+  memset((void *)d->r, 0, sizeof(struct dsc_struct));
+
+  RSET(&d->r->firmwareRev, SIM_DSC_FW);
+  RSET(&d->r->boardID, DSC_BOARD_ID);
+  RSET(&d->r->Geo, ((d->slot<<SIM_SLOT_SHIFT)>>8)<<16 | d->slot);
+  RSET(&d->r->SerialNum, 100 + d->slot);
+  RSET(&d->r->SerialMfg, 0x41434449);
+  RSET(&d->r->chEnable, 0xFFFFFFFF);
+  RSET(&d->r->Adr32, ((SIM_DSC_A32_BASE + d->slot*DSC_MAX_A32_MEM)>>16) | DSC_ADR32_ENABLE);
+  RSET(&d->r->PulserStatus, DSC_PULSERSTATUS_INACTIVE);
+  RSET(&d->r->readoutCfg, DSC_READOUTCFG_BERR_ENABLE);
+
+  simDscClear(d);
+  d->cfg = 0;
+  d->evnum = 0;
+  memset(d->trg, 0, sizeof(d->trg));
+  memset(d->tdc, 0, sizeof(d->tdc));
+  d->scal_ns = d->ref_t0 = vmeSimNow();
+}
+
+/* Build one event from the configured scaler groups into the output FIFO */
+static void
+simDscTrigger(simDsc *d, unsigned long long now)
+{
+  static const int grp_off[4] = { 0, 16, 32, 48 };  /* TRG1, TDC1, TRG2, TDC2 */
+  unsigned int *w;
+  int n, start, igrp, ichan;
+
+  if(d->nevt >= SIM_DSC_EVENTS)
+    return;
+
+  if(d->cfg & DSC_READOUTSTART_LATCH_GRP1)
+    simDscLatch(d, 1, now);
+  if(d->cfg & DSC_READOUTSTART_LATCH_GRP2)
+    simDscLatch(d, 2, now);
+
+  if(d->fsize < d->flen + 80)
+    {
+      d->fsize = d->flen + 1024;
+      d->fifo = (unsigned int *)realloc(d->fifo, d->fsize*sizeof(unsigned int));
+    }
+  w = d->fifo;
+  start = n = d->flen;
+
+  d->evnum++;
+  w[n++] = 0x80000000 | (DSC_DATA_TYPE_BLOCKHEADER<<27) | (d->slot<<22) | 1;
+  w[n++] = 0x80000000 | (DSC_DATA_TYPE_EVENTHEADER<<27) | (d->slot<<22) |
+    (d->evnum & 0x3FFFFF);
+  w[n++] = 0x80000000 | (DSC_DATA_TYPE_SCALERHEADER<<27) | (d->cfg & 0x3F);
+  for(igrp = 0; igrp < 4; igrp++)
+    {
+      if((d->cfg & (1<<igrp)) == 0)
+	continue;
+      for(ichan = 0; ichan < 16; ichan++)
+	w[n++] = RGET(&d->r->TrgScalerGrp1[grp_off[igrp] + ichan]);
+    }
+  if(d->cfg & DSC_READOUTSTART_REF_GRP1)
+    w[n++] = RGET(&d->r->refScalerGrp1);
+  if(d->cfg & DSC_READOUTSTART_REF_GRP2)
+    w[n++] = RGET(&d->r->refScalerGrp2);
+  n++;
+  w[n-1] = 0x80000000 | (DSC_DATA_TYPE_EOB<<27) | (d->slot<<22) | (n - start);
+  if((n - start) & 1)
+    w[n++] = SIM_DATA_FILLER;
+
+  d->flen = n;
+  d->evt_end[d->nevt++] = n;
+}
+
+/* SPI flash transfer of calBuf[0] bytes, command and address in calBuf[1-4].
+   flags: bit 0 starts a command (chip select), bit 1 ends it.  A transfer
+   without bit 0 continues a read. */
+static void
+simDscSpi(simDsc *d, unsigned int flags, unsigned long long now)
+{
+  volatile unsigned int *buf = d->r->calBuf;
+  int len = RGET(&buf[0]) & 0x3FF, i;
+  unsigned int a;
+
+  if(d->flash == NULL)
+    {
+      d->flash = (unsigned char *)malloc(SIM_DSC_FLASH_SIZE);
+      memset(d->flash, 0xFF, SIM_DSC_FLASH_SIZE);
+    }
+
+  if(!(flags & 1))
+    {
+      if(d->spi_op == 0x03)
+	for(i = 0; i < len; i++, d->spi_addr++)
+	  RSET(&buf[1+i], d->flash[d->spi_addr & (SIM_DSC_FLASH_SIZE-1)]);
+      return;
+    }
+
+  d->spi_op = RGET(&buf[1]) & 0xFF;
+  a = ((RGET(&buf[2]) & 0xFF)<<16) | ((RGET(&buf[3]) & 0xFF)<<8) |
+    (RGET(&buf[4]) & 0xFF);
+  a &= (SIM_DSC_FLASH_SIZE-1);
+
+  switch(d->spi_op)
+    {
+    case 0x9F:			/* read id */
+      RSET(&buf[2], SIM_DSC_FLASH_ID);
+      break;
+
+    case 0x05:			/* read status */
+      RSET(&buf[2], ((now < d->flash_busy) ? 1 : 0) | (d->wel ? 2 : 0));
+      break;
+
+    case 0x06:			/* write enable */
+      d->wel = 1;
+      break;
+
+    case 0xD8:			/* sector erase */
+      if(d->wel && (now >= d->flash_busy))
+	{
+	  memset(d->flash + (a & ~0xFFFF), 0xFF, 0x10000);
+	  d->flash_busy = now + SIM_DSC_ERASE_NS;
+	}
+      d->wel = 0;
+      break;
+
+    case 0x02:			/* page program, wraps within the page */
+      if(d->wel && (now >= d->flash_busy))
+	{
+	  for(i = 0; i < len - 4; i++)
+	    d->flash[(a & ~0xFF) | ((a + i) & 0xFF)] &= RGET(&buf[5+i]) & 0xFF;
+	  d->flash_busy = now + SIM_DSC_PAGE_NS;
+	}
+      d->wel = 0;
+      break;
+
+    case 0x03:			/* read */
+      d->spi_addr = a;
+      for(i = 0; i < len - 4; i++, d->spi_addr++)
+	RSET(&buf[5+i], d->flash[d->spi_addr & (SIM_DSC_FLASH_SIZE-1)]);
+      break;
+
+    default:
+      break;
+    }
+
+  if(flags & 2)
+    d->spi_op = 0;
+}
+
+/* calExe: run the calCmd command, which then reads back 0xFFFFFFFF (done).
+   Only chip select and SPI transfers do anything; DAC loads, calibration
+   and FPGA reloads complete at once. */
+static void
+simDscCalExec(simDsc *d, unsigned long long now)
+{
+  unsigned int cmd = RGET(&d->r->calCmd);
+
+  switch(cmd & 0xFFFF)
+    {
+    case 1:			/* chip select */
+    case 2:			/* chip deselect */
+      d->spi_op = 0;
+      break;
+
+    case 3:
+      simDscSpi(d, cmd>>16, now);
+      break;
+
+    default:
+      break;
+    }
+
+  RSET(&d->r->calCmd, 0xFFFFFFFF);
+}
+
+static unsigned int
+simDscRead(simDsc *d, unsigned int reg)
+{
+  volatile unsigned int *p = (volatile unsigned int *)((volatile char *)d->r + reg);
+
+  switch(reg)
+    {
+    case DSC_REG(readoutCfg):
+      return (RGET(p) & ~DSC_READOUTCFG_EVENTS_READY_MASK) | (d->nevt<<24);
+
+    default:
+      return RGET(p);
+    }
+}
+
+static void
+simDscWrite(simDsc *d, unsigned int reg, unsigned int val)
+{
+  volatile unsigned int *p = (volatile unsigned int *)((volatile char *)d->r + reg);
+  unsigned long long now = vmeSimNow();
+
+  if((reg < DSC_REG(trgOut[0])) || (reg == DSC_REG(chEnable)))
+    simDscScalerUpdate(d, now);
+
+  switch(reg)
+    {
+    case DSC_REG(ScalerLatchGrp1):
+      simDscLatch(d, 1, now);
+      break;
+
+    case DSC_REG(ScalerLatchGrp2):
+      simDscLatch(d, 2, now);
+      break;
+
+    case DSC_REG(readoutClear):
+      if(val & DSC_READOUTCLEAR_CLEAR)
+	simDscClear(d);
+      break;
+
+    case DSC_REG(readoutStart):
+      /* A bare soft trigger keeps the configured scalers and source */
+      if((val & (DSC_READOUTSTART_MASK | DSC_READOUTSTART_SOURCE_MASK)) ||
+	 !(val & DSC_READOUTSTART_SOFT_TRIG))
+	d->cfg = val & (DSC_READOUTSTART_MASK | DSC_READOUTSTART_SOURCE_MASK);
+      RSET(p, d->cfg);
+      if((val & DSC_READOUTSTART_SOFT_TRIG) &&
+	 (d->cfg & DSC_READOUTSTART_SOURCE_SOFT))
+	simDscTrigger(d, now);
+      break;
+
+    case DSC_REG(boardID):
+    case DSC_REG(firmwareRev):
+      break;
+
+    case DSC_REG(calExe):
+      simDscCalExec(d, now);
+      break;
+
+    default:
+      RSET(p, val);
+      break;
+    }
+}
+
+static int
+simDscDrain(simDsc *d, volatile unsigned int *dst, int maxw, int *done)
+{
+  int n, i, end;
+
+  *done = 0;
+  if(d->nevt == 0)
+    {
+      *done = 1;
+      return 0;
+    }
+
+  end = d->evt_end[0];
+  n = end - d->fpos;
+  if(n > maxw) n = maxw;
+  for(i = 0; i < n; i++)
+    dst[i] = LSWAP(d->fifo[d->fpos + i]);
+  d->fpos += n;
+
+  if(d->fpos >= end)
+    {
+      d->nevt--;
+      memmove(&d->evt_end[0], &d->evt_end[1], d->nevt*sizeof(int));
+      if(d->nevt == 0)
+	d->flen = d->fpos = 0;
+      *done = 1;
+    }
+  return n;
+}
+
+static simDsc *
+simDscCreate(int slot)
+{
+  simDsc *d = (simDsc *)calloc(1, sizeof(simDsc));
+  int ichan;
+
+  d->slot = slot;
+  d->r = (volatile struct dsc_struct *)(a24win + (slot<<SIM_SLOT_SHIFT));
+  d->rng = ((unsigned long long)simSeed<<32) ^ (0xD5C00000ULL + slot);
+  simRand(&d->rng);
+  for(ichan = 0; ichan < 16; ichan++)
+    d->sigrate[ichan] = 1000. + 99000.*simUniform(&d->rng);
+
+  simDscDefaults(d);
+  return d;
+}
+
+/*----------------------------------------------------------------------------
+ * Crate: triggers, address decoding, DMA
+ */
+
+/* Deliver up to ntrig crate triggers at t, t+period, ...  Returns the
+   number accepted before the first enabled module went busy. */
+static int
+simCrateDeliver(int ntrig, unsigned long long t, unsigned long long period)
+{
+  int islot, room = ntrig, nenabled = 0, itrig;
+
+  for(islot = 1; islot <= SIM_MAX_SLOTS; islot++)
+    {
+      if(simFa[islot] && simFadcEnabled(simFa[islot]))
+	{
+	  nenabled++;
+	  if(simFadcRoom(simFa[islot]) < room)
+	    room = simFadcRoom(simFa[islot]);
+	}
+    }
+  if(nenabled == 0)
+    return ntrig;
+  if(room < 0)
+    room = 0;
+
+  for(islot = 1; islot <= SIM_MAX_SLOTS; islot++)
+    {
+      if(simFa[islot] && simFadcEnabled(simFa[islot]))
+	for(itrig = 0; itrig < room; itrig++)
+	  simFadcPushEvent(simFa[islot], t + itrig*period);
+    }
+
+  simStats.triggers += room;
+  return room;
+}
+
+static void
+simCrateUpdate(unsigned long long now)
+{
+  unsigned long long due;
+  int n;
+
+  if(simTrigRate < 0)
+    {
+      simCrateDeliver(SIM_MAX_EVENTS, now, 0);
+      return;
+    }
+
+  if((simTrigRate == 0) || !simTrigRunning || (now < simNextTrig))
+    return;
+
+  due = (now - simNextTrig)/simTrigPeriod + 1;
+  if(due > SIM_MAX_EVENTS)
+    {
+      /* The crate has been busy for most of this interval */
+      simStats.triggers_held += due - SIM_MAX_EVENTS;
+      simNextTrig += (due - SIM_MAX_EVENTS)*simTrigPeriod;
+      due = SIM_MAX_EVENTS;
+    }
+
+  n = simCrateDeliver((int)due, simNextTrig, simTrigPeriod);
+  simStats.triggers_held += due - n;
+  simNextTrig += due*simTrigPeriod;
+}
+
+static int
+simNextMbSlot(int slot)
+{
+  int islot;
+
+  for(islot = slot + 1; islot <= SIM_MAX_SLOTS; islot++)
+    if(simFa[islot] && (RGET(&simFa[islot]->r->adr_mb) & FA_AMB_ENABLE))
+      return islot;
+  return 0;
+}
+
+/* Multiblock read: each module from the token holder onward gives up one
+   block and passes the token.  The last board ends the transfer. */
+static int
+simFadcMbDrain(volatile unsigned int *dst, int maxw, int *berr)
+{
+  simFadc *f;
+  int nw = 0, done;
+
+  while(simToken && (nw < maxw))
+    {
+      f = simFa[simToken];
+      f->berr = 0;
+      nw += simFadcDrain(f, &dst[nw], maxw - nw, &done);
+      if(!done)
+	break;
+
+      if(RGET(&f->r->ctrl1) & FA_LAST_BOARD)
+	{
+	  simToken = 0;
+	  if(RGET(&f->r->ctrl1) & FA_ENABLE_BERR)
+	    {
+	      f->berr = 1;
+	      *berr = 1;
+	    }
+	  break;
+	}
+      simToken = simNextMbSlot(f->slot);
+    }
+
+  if(simToken == 0)
+    *berr = 1;
+  return nw;
+}
+
+/* Perform a DMA read from VME A32 address vmeAdr.  Returns bytes. */
+static int
+simDmaRead(unsigned int vmeAdr, volatile unsigned int *dst, int maxw)
+{
+  unsigned int reg, base;
+  int islot, nw = 0, done, berr = 0;
+  simFadc *f = NULL;
+  simDsc *d = NULL;
+
+  simCrateUpdate(vmeSimNow());
+
+  /* Multiblock window */
+  for(islot = 1; islot <= SIM_MAX_SLOTS; islot++)
+    {
+      if(simFa[islot] == NULL)
+	continue;
+      reg = RGET(&simFa[islot]->r->adr_mb);
+      if((reg & FA_AMB_ENABLE) &&
+	 (vmeAdr >= ((reg & FA_AMB_MIN_MASK)<<16)) && (vmeAdr < (reg & FA_AMB_MAX_MASK)))
+	{
+	  nw = simFadcMbDrain(dst, maxw, &berr);
+	  return nw<<2;
+	}
+    }
+
+  /* Single module windows */
+  for(islot = 1; islot <= SIM_MAX_SLOTS; islot++)
+    {
+      if(simFa[islot])
+	{
+	  reg = RGET(&simFa[islot]->r->adr32);
+	  base = (reg & FA_A32_ADDR_MASK)<<16;
+	  if((reg & FA_A32_ENABLE) && (vmeAdr >= base) && (vmeAdr < base + FA_MAX_A32_MEM))
+	    {
+	      f = simFa[islot];
+	      break;
+	    }
+	}
+      if(simDs[islot])
+	{
+	  reg = RGET(&simDs[islot]->r->Adr32);
+	  base = (reg & DSC_ADR32_BASE_MASK)<<16;
+	  if((reg & DSC_ADR32_ENABLE) && (vmeAdr >= base) && (vmeAdr < base + DSC_MAX_A32_MEM))
+	    {
+	      d = simDs[islot];
+	      break;
+	    }
+	}
+    }
+
+  if(f)
+    {
+      f->berr = 0;
+      nw = simFadcDrain(f, dst, maxw, &done);
+      if(done && (RGET(&f->r->ctrl1) & FA_ENABLE_BERR))
+	{
+	  f->berr = 1;
+	  return nw<<2;
+	}
+    }
+  else if(d)
+    {
+      d->berr = 0;
+      nw = simDscDrain(d, dst, maxw, &done);
+      if(done && (RGET(&d->r->readoutCfg) & DSC_READOUTCFG_BERR_ENABLE))
+	{
+	  d->berr = 1;
+	  return nw<<2;
+	}
+    }
+  else
+    return 0;  /* Nobody answered: bus error on the first cycle */
+
+  /* No bus error: the module keeps answering with "data not valid" */
+  for(; nw < maxw; nw++)
+    dst[nw] = LSWAP(SIM_DATA_NOT_VALID);
+
+  return nw<<2;
+}
+
+/*----------------------------------------------------------------------------
+ * Single cycle dispatch.  Called with simMutex held.
+ */
+
+#define IN_WIN(a, w, size)  ((w) && ((a) >= (unsigned long)(w)) && \
+			     ((a) < (unsigned long)(w) + (size)))
+
+static unsigned int
+simRead32(volatile unsigned int *addr, int *found)
+{
+  unsigned long a = (unsigned long)addr, off;
+  int slot;
+
+  *found = 1;
+  if(IN_WIN(a, a24win, SIM_A24_SIZE))
+    {
+      off = a - (unsigned long)a24win;
+      slot = off>>SIM_SLOT_SHIFT;
+      if((slot <= SIM_MAX_SLOTS) && simFa[slot])
+	return simFadcRead(simFa[slot], off & SIM_SLOT_MASK & ~3);
+      if((slot <= SIM_MAX_SLOTS) && simDs[slot])
+	return simDscRead(simDs[slot], off & SIM_SLOT_MASK & ~3);
+      *found = 0;
+      return 0xFFFFFFFF;
+    }
+
+  if(IN_WIN(a, a16win, SIM_A16_SIZE) || IN_WIN(a, a32win, SIM_A32_SIZE))
+    {
+      /* No A16 modules; A32 FIFO reads are DMA only */
+      *found = 0;
+      return 0xFFFFFFFF;
+    }
+
+  return LSWAP(*addr);
+}
+
+static void
+simWrite32(volatile unsigned int *addr, unsigned int val)
+{
+  unsigned long a = (unsigned long)addr, off;
+  int slot;
+
+  if(IN_WIN(a, a24win, SIM_A24_SIZE))
+    {
+      off = a - (unsigned long)a24win;
+      slot = off>>SIM_SLOT_SHIFT;
+      if((slot <= SIM_MAX_SLOTS) && simFa[slot])
+	simFadcWrite(simFa[slot], off & SIM_SLOT_MASK & ~3, val);
+      else if((slot <= SIM_MAX_SLOTS) && simDs[slot])
+	simDscWrite(simDs[slot], off & SIM_SLOT_MASK & ~3, val);
+      return;
+    }
+
+  if(IN_WIN(a, a16win, SIM_A16_SIZE) || IN_WIN(a, a32win, SIM_A32_SIZE))
+    return;
+
+  *addr = LSWAP(val);
+}
+
+/* 16 bit writes go straight to the image */
+static void
+simWrite16(volatile unsigned short *addr, unsigned short val)
+{
+  unsigned long a = (unsigned long)addr, off;
+  int slot;
+
+  if(IN_WIN(a, a24win, SIM_A24_SIZE))
+    {
+      off = a - (unsigned long)a24win;
+      slot = off>>SIM_SLOT_SHIFT;
+      if((slot <= SIM_MAX_SLOTS) && simFa[slot])
+	{
+	  simFadcScalerUpdate(simFa[slot], vmeSimNow());
+	  *addr = SSWAP(val);
+	  simFa[slot]->cfg_gen++;
+	}
+      else if((slot <= SIM_MAX_SLOTS) && simDs[slot])
+	*addr = SSWAP(val);
+      return;
+    }
+
+  if(IN_WIN(a, a16win, SIM_A16_SIZE) || IN_WIN(a, a32win, SIM_A32_SIZE))
+    return;
+
+  *addr = SSWAP(val);
+}
+
+static unsigned short
+simRead16(volatile unsigned short *addr, int *found)
+{
+  unsigned long a = (unsigned long)addr;
+  unsigned int rval;
+
+  if(IN_WIN(a, a24win, SIM_A24_SIZE) || IN_WIN(a, a16win, SIM_A16_SIZE) ||
+     IN_WIN(a, a32win, SIM_A32_SIZE))
+    {
+      /* Registers computed on read are 32 bit; this covers image reads and
+	 empty slots */
+      rval = simRead32((volatile unsigned int *)(a & ~3UL), found);
+      return (a & 2) ? (rval & 0xFFFF) : (rval>>16);
+    }
+
+  *found = 1;
+  return SSWAP(*addr);
+}
+
+/*----------------------------------------------------------------------------
+ * Initialization
+ */
+
+static int
+simParseSlots(const char *list, int *slots)
+{
+  const char *p = list;
+  char *end;
+  long lo, hi, i;
+  int n = 0;
+
+  while(*p)
+    {
+      lo = strtol(p, &end, 10);
+      if(end == p)
+	break;
+      hi = lo;
+      p = end;
+      if(*p == '-')
+	{
+	  hi = strtol(p+1, &end, 10);
+	  p = end;
+	}
+      for(i = lo; i <= hi; i++)
+	if((i >= 1) && (i <= SIM_MAX_SLOTS))
+	  slots[n++] = i;
+      while(*p == ',' || *p == ' ')
+	p++;
+    }
+
+  return n;
+}
+
+static void
+simRemoveModule(int slot)
+{
+  int i;
+
+  if(simFa[slot])
+    {
+      free(simFa[slot]->obuf);
+      free(simFa[slot]->tmpl);
+      for(i = 0; i < 2; i++)
+	{
+	  free(simFa[slot]->sram[i]);
+	  free(simFa[slot]->prom[i]);
+	}
+      free(simFa[slot]);
+      simFa[slot] = NULL;
+    }
+  if(simDs[slot])
+    {
+      free(simDs[slot]->fifo);
+      free(simDs[slot]->flash);
+      free(simDs[slot]);
+      simDs[slot] = NULL;
+    }
+  if(simToken == slot)
+    simToken = 0;
+  memset((void *)(a24win + (slot<<SIM_SLOT_SHIFT)), 0, 1<<SIM_SLOT_SHIFT);
+}
+
+static void
+simAddModule(int slot, int isDsc)
+{
+  simRemoveModule(slot);
+
+  if(isDsc)
+    simDs[slot] = simDscCreate(slot);
+  else
+    simFa[slot] = simFadcCreate(slot);
+}
+
+static void
+simInit()
+{
+  int slots[SIM_MAX_SLOTS+1], n, i;
+  const char *env;
+
+  if(simInited)
+    return;
+  simInited = 1;
+
+  simT0 = simClock();
+
+  a24win = (volatile unsigned char *)mmap(NULL, SIM_A24_SIZE, PROT_READ | PROT_WRITE,
+					  MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  a16win = (volatile unsigned char *)mmap(NULL, SIM_A16_SIZE, PROT_READ | PROT_WRITE,
+					  MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  a32win = (volatile unsigned char *)mmap(NULL, SIM_A32_SIZE, PROT_READ,
+					  MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if((a24win == MAP_FAILED) || (a16win == MAP_FAILED) || (a32win == MAP_FAILED))
+    {
+      perror("jvmeSim: mmap");
+      exit(1);
+    }
+
+  if((env = getenv("JVME_SIM_SEED")))
+    simSeed = strtoul(env, NULL, 0);
+  if((env = getenv("JVME_SIM_OCCUPANCY")))
+    simOccupancy = atof(env);
+  if((env = getenv("JVME_SIM_READ_NS")))
+    simReadNs = strtoul(env, NULL, 0);
+  if((env = getenv("JVME_SIM_WRITE_NS")))
+    simWriteNs = strtoul(env, NULL, 0);
+  if((env = getenv("JVME_SIM_DMA_SETUP_NS")))
+    simDmaSetupNs = strtoul(env, NULL, 0);
+  if((env = getenv("JVME_SIM_DMA_MBPS")))
+    simDmaMBps = atof(env);
+  simDmaRate();
+
+  env = getenv("JVME_SIM_FADC");
+  n = simParseSlots(env ? env : "3-10,13-20", slots);
+  for(i = 0; i < n; i++)
+    simAddModule(slots[i], 0);
+
+  if((env = getenv("JVME_SIM_DSC")))
+    {
+      n = simParseSlots(env, slots);
+      for(i = 0; i < n; i++)
+	simAddModule(slots[i], 1);
+    }
+
+  if((env = getenv("JVME_SIM_TRIGGER_RATE")))
+    {
+      simTrigRate = atof(env);
+      if(simTrigRate > 0)
+	simTrigPeriod = (unsigned long long)(1e9/simTrigRate);
+    }
+}
+
+/*----------------------------------------------------------------------------
+ * jvme API: bridge access
+ */
+
+int
+vmeOpenDefaultWindows()
+{
+  pthread_mutex_lock(&simMutex);
+  simInit();
+  pthread_mutex_unlock(&simMutex);
+  return OK;
+}
+
+int
+vmeCloseDefaultWindows()
+{
+  /* Module state is kept for the life of the process */
+  return OK;
+}
+
+int
+vmeBusToLocalAdrs(int vmeAdrsSpace, char *vmeBusAdrs, char **pLocalAdrs)
+{
+  unsigned long adr = (unsigned long)vmeBusAdrs;
+
+  pthread_mutex_lock(&simMutex);
+  simInit();
+  pthread_mutex_unlock(&simMutex);
+
+  switch(vmeAdrsSpace)
+    {
+    case 0x39: case 0x3A: case 0x3D: case 0x3E:
+      if(adr >= SIM_A24_SIZE)
+	break;
+      *pLocalAdrs = (char *)(a24win + adr);
+      return OK;
+
+    case 0x29: case 0x2D:
+      if(adr >= SIM_A16_SIZE)
+	break;
+      *pLocalAdrs = (char *)(a16win + adr);
+      return OK;
+
+    case 0x09: case 0x0A: case 0x0D: case 0x0E:
+      if((adr < SIM_A32_BASE) || (adr >= SIM_A32_BASE + SIM_A32_SIZE))
+	break;
+      *pLocalAdrs = (char *)(a32win + (adr - SIM_A32_BASE));
+      return OK;
+    }
+
+  if(!simQuiet)
+    printf("vmeBusToLocalAdrs: ERROR: VME address 0x%lx (AM 0x%x) not in a window\n",
+	   adr, vmeAdrsSpace);
+  return ERROR;
+}
+
+int
+vmeLocalToVmeAdrs(unsigned long localAdrs, unsigned int *vmeAdrs,
+		  unsigned short *amCode)
+{
+  if(IN_WIN(localAdrs, a24win, SIM_A24_SIZE))
+    {
+      *vmeAdrs = localAdrs - (unsigned long)a24win;
+      *amCode = 0x39;
+    }
+  else if(IN_WIN(localAdrs, a16win, SIM_A16_SIZE))
+    {
+      *vmeAdrs = localAdrs - (unsigned long)a16win;
+      *amCode = 0x29;
+    }
+  else if(IN_WIN(localAdrs, a32win, SIM_A32_SIZE))
+    {
+      *vmeAdrs = SIM_A32_BASE + (localAdrs - (unsigned long)a32win);
+      *amCode = 0x09;
+    }
+  else
+    return ERROR;
+
+  return OK;
+}
+
+int
+vmeMemProbe(char *addr, int size, char *retVal)
+{
+  unsigned int rval;
+  int found;
+
+  simBusCycle(simReadNs);
+  pthread_mutex_lock(&simMutex);
+  simStats.reads++;
+  if(size == 4)
+    {
+      rval = simRead32((volatile unsigned int *)addr, &found);
+      if(found) *(unsigned int *)retVal = rval;
+    }
+  else if(size == 2)
+    {
+      rval = simRead16((volatile unsigned short *)addr, &found);
+      if(found) *(unsigned short *)retVal = rval;
+    }
+  else
+    {
+      rval = simRead16((volatile unsigned short *)((unsigned long)addr & ~1UL), &found);
+      if(found) *retVal = ((unsigned long)addr & 1) ? (rval & 0xFF) : (rval>>8);
+    }
+  pthread_mutex_unlock(&simMutex);
+
+  return found ? OK : ERROR;
+}
+
+void
+vmeSetQuietFlag(unsigned int pflag)
+{
+  simQuiet = pflag;
+}
+
+int
+vmeBusLock()
+{
+  return pthread_mutex_lock(&vmeBusMutex) ? ERROR : OK;
+}
+
+int
+vmeBusUnlock()
+{
+  return pthread_mutex_unlock(&vmeBusMutex) ? ERROR : OK;
+}
+
+unsigned int
+vmeRead32(volatile unsigned int *addr)
+{
+  unsigned int rval;
+  int found;
+
+  simBusCycle(simReadNs);
+  pthread_mutex_lock(&simMutex);
+  simStats.reads++;
+  rval = simRead32(addr, &found);
+  pthread_mutex_unlock(&simMutex);
+
+  return rval;
+}
+
+unsigned short
+vmeRead16(volatile unsigned short *addr)
+{
+  unsigned short rval;
+  int found;
+
+  simBusCycle(simReadNs);
+  pthread_mutex_lock(&simMutex);
+  simStats.reads++;
+  rval = simRead16(addr, &found);
+  pthread_mutex_unlock(&simMutex);
+
+  return rval;
+}
+
+unsigned char
+vmeRead8(volatile unsigned char *addr)
+{
+  unsigned short rval;
+  int found;
+
+  simBusCycle(simReadNs);
+  pthread_mutex_lock(&simMutex);
+  simStats.reads++;
+  rval = simRead16((volatile unsigned short *)((unsigned long)addr & ~1UL), &found);
+  pthread_mutex_unlock(&simMutex);
+
+  return ((unsigned long)addr & 1) ? (rval & 0xFF) : (rval>>8);
+}
+
+void
+vmeWrite32(volatile unsigned int *addr, unsigned int val)
+{
+  simBusCycle(simWriteNs);
+  pthread_mutex_lock(&simMutex);
+  simStats.writes++;
+  simWrite32(addr, val);
+  pthread_mutex_unlock(&simMutex);
+}
+
+void
+vmeWrite16(volatile unsigned short *addr, unsigned short val)
+{
+  simBusCycle(simWriteNs);
+  pthread_mutex_lock(&simMutex);
+  simStats.writes++;
+  simWrite16(addr, val);
+  pthread_mutex_unlock(&simMutex);
+}
+
+void
+vmeWrite8(volatile unsigned char *addr, unsigned char val)
+{
+  simBusCycle(simWriteNs);
+  pthread_mutex_lock(&simMutex);
+  simStats.writes++;
+  /* No 8 bit registers are modelled: A24 and local memory only */
+  if(!IN_WIN((unsigned long)addr, a16win, SIM_A16_SIZE) &&
+     !IN_WIN((unsigned long)addr, a32win, SIM_A32_SIZE))
+    *addr = val;
+  pthread_mutex_unlock(&simMutex);
+}
+
+/*----------------------------------------------------------------------------
+ * jvme API: DMA engine
+ */
+
+int
+vmeDmaConfig(unsigned int addrType, unsigned int dataType, unsigned int sstMode)
+{
+  pthread_mutex_lock(&simMutex);
+  simDmaData = dataType;
+  simDmaSst = sstMode;
+  simDmaRate();
+  pthread_mutex_unlock(&simMutex);
+  return OK;
+}
+
+int
+vmeDmaSend(unsigned long locAdrs, unsigned int vmeAdrs, int size)
+{
+  unsigned long long cost;
+  int bytes;
+
+  pthread_mutex_lock(&simMutex);
+  if(simDmaPending)
+    {
+      pthread_mutex_unlock(&simMutex);
+      printf("vmeDmaSend: ERROR: DMA already in progress\n");
+      return ERROR;
+    }
+
+  bytes = simDmaRead(vmeAdrs, (volatile unsigned int *)locAdrs, size>>2);
+  simDmaPending = 1;
+  simDmaBytes = bytes;
+  simStats.dmas++;
+  simStats.dma_bytes += bytes;
+  cost = simDmaSetupNs + (unsigned long long)(bytes*simDmaNsPerByte);
+  simDmaDoneAt = simBusReserve(cost);
+  pthread_mutex_unlock(&simMutex);
+
+  return OK;
+}
+
+int
+vmeDmaDone()
+{
+  unsigned long long doneAt;
+  int bytes;
+
+  pthread_mutex_lock(&simMutex);
+  if(!simDmaPending)
+    {
+      pthread_mutex_unlock(&simMutex);
+      printf("vmeDmaDone: ERROR: No DMA in progress\n");
+      return ERROR;
+    }
+  doneAt = simDmaDoneAt;
+  bytes = simDmaBytes;
+  pthread_mutex_unlock(&simMutex);
+
+  simSpinUntil(doneAt);
+
+  pthread_mutex_lock(&simMutex);
+  simDmaPending = 0;
+  pthread_mutex_unlock(&simMutex);
+
+  return bytes;
+}
+
+/*----------------------------------------------------------------------------
+ * jvme API: DMA buffer pools
+ */
+
+static void
+dmaPAppend(DMA_MEM_ID pPart, DMANODE *pItem)
+{
+  pItem->n = NULL;
+  pItem->p = pPart->l;
+  if(pPart->l)
+    pPart->l->n = pItem;
+  else
+    pPart->f = pItem;
+  pPart->l = pItem;
+  pPart->c++;
+}
+
+DMA_MEM_ID
+dmaPCreate(char *name, int size, int c, int incr)
+{
+  DMA_MEM_ID pPart;
+  DMANODE *pItem;
+  void *buf;
+  int i;
+
+  pPart = (DMA_MEM_ID)calloc(1, sizeof(DMALIST));
+  strncpy(pPart->name, name, sizeof(pPart->name)-1);
+  pPart->size = size;
+
+  if(c > 0)
+    pPart->nodes = (DMANODE **)calloc(c, sizeof(DMANODE *));
+
+  for(i = 0; i < c; i++)
+    {
+      pItem = (DMANODE *)calloc(1, sizeof(DMANODE));
+      if(posix_memalign(&buf, 64, size))
+	{
+	  printf("dmaPCreate: ERROR: Unable to allocate %d buffers of %d bytes for %s\n",
+		 c, size, name);
+	  free(pItem);
+	  break;
+	}
+      pItem->data = (volatile unsigned int *)buf;
+      pItem->physMemBase = (unsigned long)buf;
+      pItem->partBaseAdr = (unsigned long)buf;
+      pItem->size = size;
+      pItem->l = pPart;
+      pPart->nodes[pPart->total++] = pItem;
+      dmaPAppend(pPart, pItem);
+    }
+
+  pthread_mutex_lock(&dmaPMutex);
+  pPart->next = dmaPList;
+  dmaPList = pPart;
+  pthread_mutex_unlock(&dmaPMutex);
+
+  return pPart;
+}
+
+void
+dmaPFree(DMA_MEM_ID pPart)
+{
+  DMA_MEM_ID *pp;
+  int i;
+
+  if(pPart == NULL)
+    return;
+
+  pthread_mutex_lock(&dmaPMutex);
+  for(pp = &dmaPList; *pp; pp = &(*pp)->next)
+    if(*pp == pPart)
+      {
+	*pp = pPart->next;
+	break;
+      }
+  pthread_mutex_unlock(&dmaPMutex);
+
+  for(i = 0; i < pPart->total; i++)
+    {
+      free((void *)pPart->nodes[i]->data);
+      free(pPart->nodes[i]);
+    }
+  free(pPart->nodes);
+  free(pPart);
+}
+
+void
+dmaPFreeAll()
+{
+  while(dmaPList)
+    dmaPFree(dmaPList);
+}
+
+DMANODE *
+dmaPGetItem(DMA_MEM_ID pPart)
+{
+  DMANODE *pItem;
+
+  pthread_mutex_lock(&dmaPMutex);
+  pItem = pPart->f;
+  if(pItem)
+    {
+      pPart->f = pItem->n;
+      if(pPart->f)
+	pPart->f->p = NULL;
+      else
+	pPart->l = NULL;
+      pPart->c--;
+      pItem->n = pItem->p = NULL;
+    }
+  pthread_mutex_unlock(&dmaPMutex);
+
+  return pItem;
+}
+
+void
+dmaPPutItem(DMA_MEM_ID pPart, DMANODE *pItem)
+{
+  pthread_mutex_lock(&dmaPMutex);
+  dmaPAppend(pPart, pItem);
+  pthread_mutex_unlock(&dmaPMutex);
+}
+
+void
+dmaPFreeItem(DMANODE *pItem)
+{
+  pItem->length = 0;
+  dmaPPutItem(pItem->l, pItem);
+}
+
+int
+dmaPReInitAll()
+{
+  DMA_MEM_ID pPart;
+  int i;
+
+  pthread_mutex_lock(&dmaPMutex);
+  for(pPart = dmaPList; pPart; pPart = pPart->next)
+    {
+      pPart->f = pPart->l = NULL;
+      pPart->c = 0;
+    }
+  for(pPart = dmaPList; pPart; pPart = pPart->next)
+    for(i = 0; i < pPart->total; i++)
+      {
+	pPart->nodes[i]->length = 0;
+	dmaPAppend(pPart, pPart->nodes[i]);
+      }
+  pthread_mutex_unlock(&dmaPMutex);
+
+  return OK;
+}
+
+int
+dmaPReInit(DMA_MEM_ID pPart)
+{
+  /* Nodes may be queued on other lists; reset every list */
+  return dmaPReInitAll();
+}
+
+int
+dmaPEmpty(DMA_MEM_ID pPart)
+{
+  return (pPart->c == 0);
+}
+
+void
+dmaPStats(DMA_MEM_ID pPart)
+{
+  printf("%-16s  size = %8d  total = %4d  available = %4d\n",
+	 pPart->name, pPart->size, pPart->total, pPart->c);
+}
+
+void
+dmaPStatsAll()
+{
+  DMA_MEM_ID pPart;
+
+  printf("dmaPStatsAll\n");
+  for(pPart = dmaPList; pPart; pPart = pPart->next)
+    dmaPStats(pPart);
+}
+
+/*----------------------------------------------------------------------------
+ * Emulator control
+ */
+
+int
+vmeSimAddFadc(int slot)
+{
+  if((slot < 1) || (slot > SIM_MAX_SLOTS))
+    {
+      printf("%s: ERROR: Invalid slot (%d)\n", __FUNCTION__, slot);
+      return ERROR;
+    }
+
+  pthread_mutex_lock(&simMutex);
+  simInit();
+  simAddModule(slot, 0);
+  pthread_mutex_unlock(&simMutex);
+
+  return OK;
+}
+
+int
+vmeSimAddDsc(int slot)
+{
+  if((slot < 1) || (slot > SIM_MAX_SLOTS))
+    {
+      printf("%s: ERROR: Invalid slot (%d)\n", __FUNCTION__, slot);
+      return ERROR;
+    }
+
+  pthread_mutex_lock(&simMutex);
+  simInit();
+  simAddModule(slot, 1);
+  pthread_mutex_unlock(&simMutex);
+
+  return OK;
+}
+
+void
+vmeSimClearModules()
+{
+  int islot;
+
+  pthread_mutex_lock(&simMutex);
+  simInit();
+  for(islot = 1; islot <= SIM_MAX_SLOTS; islot++)
+    simRemoveModule(islot);
+  pthread_mutex_unlock(&simMutex);
+}
+
+void
+vmeSimSetTriggerRate(double hz)
+{
+  int islot;
+
+  pthread_mutex_lock(&simMutex);
+  simInit();
+  simTrigRate = hz;
+  simTrigRunning = 0;
+  if(hz > 0)
+    {
+      simTrigPeriod = (unsigned long long)(1e9/hz);
+      if(simTrigPeriod == 0)
+	simTrigPeriod = 1;
+      for(islot = 1; islot <= SIM_MAX_SLOTS; islot++)
+	if(simFa[islot] && simFadcEnabled(simFa[islot]))
+	  {
+	    simTrigRunning = 1;
+	    simNextTrig = vmeSimNow() + simTrigPeriod;
+	    break;
+	  }
+    }
+  pthread_mutex_unlock(&simMutex);
+}
+
+int
+vmeSimTrigger(int ntrig)
+{
+  int rval;
+
+  pthread_mutex_lock(&simMutex);
+  simInit();
+  rval = simCrateDeliver(ntrig, vmeSimNow(), 0);
+  simStats.triggers_held += ntrig - rval;
+  pthread_mutex_unlock(&simMutex);
+
+  return rval;
+}
+
+void
+vmeSimSetCycleCost(unsigned int read_ns, unsigned int write_ns)
+{
+  pthread_mutex_lock(&simMutex);
+  simReadNs = read_ns;
+  simWriteNs = write_ns;
+  pthread_mutex_unlock(&simMutex);
+}
+
+void
+vmeSimSetDmaCost(unsigned int setup_ns, double mbps)
+{
+  pthread_mutex_lock(&simMutex);
+  simDmaSetupNs = setup_ns;
+  simDmaMBps = mbps;
+  simDmaRate();
+  pthread_mutex_unlock(&simMutex);
+}
+
+void
+vmeSimSetOccupancy(double occupancy)
+{
+  pthread_mutex_lock(&simMutex);
+  simOccupancy = occupancy;
+  pthread_mutex_unlock(&simMutex);
+}
+
+void
+vmeSimSetSeed(unsigned int seed)
+{
+  pthread_mutex_lock(&simMutex);
+  simSeed = seed;
+  pthread_mutex_unlock(&simMutex);
+}
+
+void
+vmeSimGetStats(vmeSimStats *stats)
+{
+  pthread_mutex_lock(&simMutex);
+  pthread_mutex_lock(&busMutex);
+  *stats = simStats;
+  pthread_mutex_unlock(&busMutex);
+  pthread_mutex_unlock(&simMutex);
+}
+
+void
+vmeSimResetStats()
+{
+  pthread_mutex_lock(&simMutex);
+  pthread_mutex_lock(&busMutex);
+  memset(&simStats, 0, sizeof(simStats));
+  pthread_mutex_unlock(&busMutex);
+  pthread_mutex_unlock(&simMutex);
+}
+
+void
+vmeSimPrintStats()
+{
+  vmeSimStats s;
+
+  vmeSimGetStats(&s);
+  printf("jvmeSim statistics\n");
+  printf("  Single cycles   : %llu reads  %llu writes\n", s.reads, s.writes);
+  printf("  DMA             : %llu transfers  %llu bytes\n", s.dmas, s.dma_bytes);
+  printf("  Bus busy        : %.6f s\n", s.bus_ns*1e-9);
+  printf("  Triggers        : %llu accepted  %llu held off\n",
+	 s.triggers, s.triggers_held);
+  printf("  fADC blocks     : %llu\n", s.blocks);
+}
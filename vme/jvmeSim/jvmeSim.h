@@ -0,0 +1,68 @@
+/*----------------------------------------------------------------------------*
+ *
+ *  jvmeSim.h  -  Control interface for the in-memory VME crate emulator
+ *
+ *     The emulator (jvmeSim.c) implements the jvme API declared in jvme.h
+ *     on top of register images of fADC250 and vmeDSC modules held in
+ *     process memory.  Module libraries (fadcLib, vmeDSClib) and readout
+ *     code link against it unchanged.
+ *
+ *     Bus timing is modelled: every single cycle and DMA transfer occupies
+ *     a shared "bus" for a configurable time, and the caller spins until
+ *     its access has completed.  Asynchronous DMA (vmeDmaSend followed
+ *     later by vmeDmaDone) overlaps with the caller like the real bridge.
+ *
+ *     The crate is populated at vmeOpenDefaultWindows() from the
+ *     environment, or explicitly with the routines below:
+ *
+ *       JVME_SIM_FADC          fADC250 slots     (default "3-10,13-20")
+ *       JVME_SIM_DSC           vmeDSC slots      (default none)
+ *       JVME_SIM_TRIGGER_RATE  Hz; 0 = software triggers only,
+ *                              <0 = free running (always ready)
+ *       JVME_SIM_OCCUPANCY     Probability of a pulse per channel/event (0.1)
+ *       JVME_SIM_READ_NS       Single cycle read time  (1000)
+ *       JVME_SIM_WRITE_NS      Single cycle write time (300)
+ *       JVME_SIM_DMA_SETUP_NS  DMA setup time per transfer (5000)
+ *       JVME_SIM_DMA_MBPS      DMA bandwidth override; default follows
+ *                              the vmeDmaConfig transfer mode
+ *       JVME_SIM_SEED          Random seed for the analog models (1)
+ *
+ *----------------------------------------------------------------------------*/
+
+#ifndef __JVMESIM__
+#define __JVMESIM__
+
+typedef struct
+{
+  unsigned long long reads;          /* Single cycle reads */
+  unsigned long long writes;         /* Single cycle writes */
+  unsigned long long dmas;           /* DMA transfers */
+  unsigned long long dma_bytes;      /* Bytes moved by DMA */
+  unsigned long long bus_ns;         /* Total time the bus was busy */
+  unsigned long long triggers;       /* Crate triggers accepted */
+  unsigned long long triggers_held;  /* Crate triggers lost to busy */
+  unsigned long long blocks;         /* fADC blocks built */
+} vmeSimStats;
+
+/* Crate population */
+int  vmeSimAddFadc(int slot);
+int  vmeSimAddDsc(int slot);
+void vmeSimClearModules();
+
+/* Trigger source */
+void vmeSimSetTriggerRate(double hz);
+int  vmeSimTrigger(int ntrig);
+
+/* Cost and data models */
+void vmeSimSetCycleCost(unsigned int read_ns, unsigned int write_ns);
+void vmeSimSetDmaCost(unsigned int setup_ns, double mbps);
+void vmeSimSetOccupancy(double occupancy);
+void vmeSimSetSeed(unsigned int seed);
+
+/* Time and statistics */
+unsigned long long vmeSimNow();
+void vmeSimGetStats(vmeSimStats *stats);
+void vmeSimResetStats();
+void vmeSimPrintStats();
+
+#endif /* __JVMESIM__ */
@@ -32,6 +32,8 @@
 #include <stdio.h>
 #include <string.h>
 #include <pthread.h>
+#include <sched.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "vmeDSClib.h"
@@ -41,8 +43,8 @@ int Ndsc = 0;                                     /* Number of DSCs in Crate */
 volatile struct dsc_struct *dscp[DSC_MAX_SLOTS+1]; /* pointers to DSC A24 memory map */
 volatile unsigned int *dscpd[DSC_MAX_SLOTS+1];     /* pointers to DSC A32 memory map */
 int dscID[DSC_MAX_BOARDS+1];                        /* array of slot numbers for DSCs */
-unsigned int dscA24Offset = 0;       /* Offset between VME A24 and Local address space */
-unsigned int dscA32Offset = 0;       /* Offset between VME A32 and Local address space */
+unsigned long dscA24Offset = 0;       /* Offset between VME A24 and Local address space */
+unsigned long dscA32Offset = 0;       /* Offset between VME A32 and Local address space */
 unsigned int dscA32Base   = 0x08000000;
 unsigned int dscAddrList[DSC_MAX_BOARDS];            /* array of a24 addresses for DSCs */
 static int dscIndexedBySlotNumber = 1;  /* How the library pointers are indexed */
@@ -58,11 +60,26 @@ static int dscIndexedBySlotNumber = 1;  /* How the library pointers are indexed
       }									\
   }
 
+/* CHECKID for the readout routines, rate limited (DSCLOGHOT) */
+#define CHECKID_HOT(id) {						\
+    if(id==0) id=dscID[0];						\
+    if((id<0) || (id>21) || (dscp[id] == NULL))				\
+      {									\
+	DSCLOGHOT("%s: ERROR: DSC in slot %d is not initialized \n",	\
+		  __FUNCTION__,id,3,4,5,6);				\
+	return ERROR;							\
+      }									\
+  }
+
 /* Mutex to guard flexio read/writes */
 pthread_mutex_t   dscMutex = PTHREAD_MUTEX_INITIALIZER;
 #define DSCLOCK   if(pthread_mutex_lock(&dscMutex)<0) perror("pthread_mutex_lock");
 #define DSCUNLOCK if(pthread_mutex_unlock(&dscMutex)<0) perror("pthread_mutex_unlock");
 
+/* Flash update progress by slot, no flash printout while set */
+static int dscFlashQuiet = 0;
+static volatile int dscFlashBytes[DSC_MAX_SLOTS+1];
+
 /*******************************************************************************
  *
  * vmeDSCInit - Initialize JLAB VME Discriminator/Scaler Library. 
@@ -94,7 +111,8 @@ pthread_mutex_t   dscMutex = PTHREAD_MUTEX_INITIALIZER;
 int
 vmeDSCInit(unsigned int addr, unsigned int addr_inc, int ndsc, int iFlag)
 {
-  unsigned int laddr, laddr_inc, errFlag, fwrev;
+  unsigned int errFlag, fwrev;
+  unsigned long laddr, laddr_inc;
   int res, ii, slotno;
   unsigned int boardID;
   int noBoardInit=0;
@@ -139,7 +157,7 @@ vmeDSCInit(unsigned int addr, unsigned int addr_inc, int ndsc, int iFlag)
 #ifdef VXWORKS
   res = sysBusToLocalAdrs(0x39,(char *)addr,(char **)&laddr);
 #else
-  res = vmeBusToLocalAdrs(0x39,(char *)addr,(char **)&laddr);
+  res = vmeBusToLocalAdrs(0x39,(char *)(unsigned long)addr,(char **)&laddr);
 #endif
   if (res != 0) 
     {
@@ -177,7 +195,7 @@ vmeDSCInit(unsigned int addr, unsigned int addr_inc, int ndsc, int iFlag)
       if(res < 0) 
 	{
 	  printf("%s: WARN: No addressable board at A24 Address 0x%x\n",
-		 __FUNCTION__,(UINT32) dsc - dscA24Offset);
+		 __FUNCTION__,(UINT32)((unsigned long) dsc - dscA24Offset));
 	  errFlag = 1;
 	  continue;
 	} 
@@ -186,7 +204,7 @@ vmeDSCInit(unsigned int addr, unsigned int addr_inc, int ndsc, int iFlag)
       if(boardID != DSC_BOARD_ID) 
 	{
 	  printf("%s: ERROR: Board ID at addr=0x%x does not match: 0x%08x \n",
-		 __FUNCTION__,(UINT32) dsc - dscA24Offset,boardID);
+		 __FUNCTION__,(UINT32)((unsigned long) dsc - dscA24Offset),boardID);
 	  errFlag = 1;
 	  continue;
 	}
@@ -196,7 +214,7 @@ vmeDSCInit(unsigned int addr, unsigned int addr_inc, int ndsc, int iFlag)
       if(fwrev < DSC_SUPPORTED_FIRMWARE)
 	{
 	  printf("%s: ERROR: vmeDSC firmware (0x%x) at addr=0x%x not supported by this driver. \n",
-		 __FUNCTION__,fwrev,(UINT32) dsc - dscA24Offset);
+		 __FUNCTION__,fwrev,(UINT32)((unsigned long) dsc - dscA24Offset));
 	  printf("  Minimum required = 0x%x\n",DSC_SUPPORTED_FIRMWARE);
 	  errFlag = 1;
 	  if(!allowOlderFirmware)
@@ -208,7 +226,7 @@ vmeDSCInit(unsigned int addr, unsigned int addr_inc, int ndsc, int iFlag)
       if((slotno<1) || (slotno>DSC_MAX_SLOTS))
 	{
 	  printf("%s: Module at addr=0x%x has an invalid slot number (%d)\n",
-		 __FUNCTION__, (UINT32) dsc - dscA24Offset, slotno);
+		 __FUNCTION__, (UINT32)((unsigned long) dsc - dscA24Offset), slotno);
 	  errFlag = 1;
 	  if(!indexByOrder)
 	    continue;
@@ -221,7 +239,7 @@ vmeDSCInit(unsigned int addr, unsigned int addr_inc, int ndsc, int iFlag)
 
       dscp[dscID[Ndsc]] = (struct dsc_struct*)laddr_inc;
       printf("Initialized vmeDSC ID %d at VME (USER) address 0x%x (0x%x).\n",
-	     dscID[Ndsc], (UINT32) dscp[dscID[Ndsc]] - dscA24Offset, (UINT32) dscp[dscID[Ndsc]]);
+	     dscID[Ndsc], (UINT32)((unsigned long) dscp[dscID[Ndsc]] - dscA24Offset), (UINT32)(unsigned long) dscp[dscID[Ndsc]]);
       Ndsc++;
     }
 
@@ -239,7 +257,7 @@ vmeDSCInit(unsigned int addr, unsigned int addr_inc, int ndsc, int iFlag)
       dscA32Offset = laddr - dscA32Base;
     }
 #else
-  res = vmeBusToLocalAdrs(0x09,(char *)dscA32Base,(char **)&laddr);
+  res = vmeBusToLocalAdrs(0x09,(char *)(unsigned long)dscA32Base,(char **)&laddr);
   if (res != 0) 
     {
       printf("%s: ERROR in vmeBusToLocalAdrs(0x09,0x%x,&laddr) \n",
@@ -274,7 +292,7 @@ vmeDSCInit(unsigned int addr, unsigned int addr_inc, int ndsc, int iFlag)
 	  return(ERROR);
 	}
 #else
-      res = vmeBusToLocalAdrs(0x09,(char *)a32addr,(char **)&laddr);
+      res = vmeBusToLocalAdrs(0x09,(char *)(unsigned long)a32addr,(char **)&laddr);
       if (res != 0) 
 	{
 	  printf("%s: ERROR in vmeBusToLocalAdrs(0x09,0x%x,&laddr) \n",
@@ -366,13 +384,13 @@ vmeDSCStatus(UINT32 id, int pflag)
   DSCUNLOCK;
 
   printf("\nSTATUS for DSC in slot %d at VME (USER) base address 0x%x (0x%x)\n",
-	 id,  (UINT32) dscp[id]-dscA24Offset, (UINT32) dscp[id]);
+	 id,  (UINT32)((unsigned long) dscp[id]-dscA24Offset), (UINT32)(unsigned long) dscp[id]);
   printf("-----------------------------------------------------------------------\n");
   printf(" Board Firmware = 0x%04x  Board ID = 0x%08x\n",
 	 firmwareRev&DSC_FIRMWAREREV_MASK, boardID);
   if(Adr32&DSC_ADR32_ENABLE)
     printf(" A32 Enabled at VME (Local) base 0x%08x (0x%08x)\n",
-	   ((Adr32 & DSC_ADR32_BASE_MASK)<<16),(UINT32) dscpd[id]);
+	   ((Adr32 & DSC_ADR32_BASE_MASK)<<16),(UINT32)(unsigned long) dscpd[id]);
   else
     printf(" A32 Disabled\n");
 
@@ -1591,6 +1609,56 @@ vmeDSCLatchScalers(UINT32 id, UINT16 group)
   return OK;
 }
 
+/*******************************************************************
+ *   Function : vmeDSCReadLatchedScalers
+ *                      
+ *   Function : Read the scalers and the reference scaler of a group,
+ *              as latched by vmeDSCLatchScalers, with programmed I/O.
+ *              The reference scaler counts DSC_REFERENCE_RATE.
+ *                                                    
+ *   Parameters :  UINT32 id    - Module slot number
+ *                 UINT16 group - 1 for the Grp1 scalers
+ *                                2 for the Grp2 scalers
+ *                 UINT32 *tdc  - 16 TDC scalers, or NULL
+ *                 UINT32 *trg  - 16 TRG scalers, or NULL
+ *                 UINT32 *ref  - reference scaler, or NULL
+ *                                                    
+ *   Returns -1 if Error, 0 if OK.
+ *                                                    
+ *******************************************************************/
+
+int
+vmeDSCReadLatchedScalers(UINT32 id, UINT16 group, UINT32 *tdc, UINT32 *trg,
+			 UINT32 *ref)
+{
+  int ichan;
+
+  CHECKID(id);
+
+  if((group<=0) || (group>2))
+    {
+      printf("%s: ERROR: invalid group (%d)\n",__FUNCTION__,group);
+      return ERROR;
+    }
+
+  DSCLOCK;
+  for(ichan=0; ichan<16; ichan++)
+    {
+      if(tdc)
+	tdc[ichan] = vmeRead32((group==1) ? &dscp[id]->TdcScalerGrp1[ichan] :
+			       &dscp[id]->TdcScalerGrp2[ichan]);
+      if(trg)
+	trg[ichan] = vmeRead32((group==1) ? &dscp[id]->TrgScalerGrp1[ichan] :
+			       &dscp[id]->TrgScalerGrp2[ichan]);
+    }
+  if(ref)
+    *ref = vmeRead32((group==1) ? &dscp[id]->refScalerGrp1 :
+		     &dscp[id]->refScalerGrp2);
+  DSCUNLOCK;
+
+  return OK;
+}
+
 /*******************************************************************
  *   Function : vmeDSCSetGateSource
  *                      
@@ -1683,7 +1751,8 @@ vmeDSCGetAdr32(int id)
 int
 vmeDSCSetAdr32(UINT32 id, UINT32 a32base, UINT16 enable)
 {
-  UINT32 a32addr=0, a32base_set=0, laddr=0;
+  UINT32 a32addr=0, a32base_set=0;
+  unsigned long laddr=0;
   int res=0;
   
   CHECKID(id);
@@ -1706,7 +1775,7 @@ vmeDSCSetAdr32(UINT32 id, UINT32 a32base, UINT16 enable)
       return(ERROR);
     }
 #else
-  res = vmeBusToLocalAdrs(0x09,(char *)a32addr,(char **)&laddr);
+  res = vmeBusToLocalAdrs(0x09,(char *)(unsigned long)a32addr,(char **)&laddr);
   if (res != 0) 
     {
       printf("%s: ERROR in vmeBusToLocalAdrs(0x09,0x%x,&laddr) \n",
@@ -1889,6 +1958,79 @@ vmeDSCSoftTrigger(UINT32 id)
   return OK;
 }
 
+/*
+ * DSCLOGHOT: rate limited logMsg for vmeDSCReadBlock and vmeDSCReadScalers,
+ * which may fail on every event.  Each call site prints DSC_LOG_RATE
+ * messages per second and counts the rest.  Output goes to the
+ * vmeDSCSetLogFunc function if one is set.
+ */
+typedef struct
+{
+  time_t       sec;
+  unsigned int count;
+  unsigned int suppressed;
+} dscLogSite;
+
+static DSC_LOG_FUNC dscLogFunc = NULL;
+
+static void
+dscLogHot(dscLogSite *site, const char *fmt, long a1, long a2, long a3,
+	  long a4, long a5, long a6)
+{
+  time_t now = time(NULL);
+
+  if(now != site->sec)
+    {
+      if(site->suppressed)
+	{
+	  /* A DSC_LOG_FUNC gets the format text as a long, logMsg as a string */
+	  if(dscLogFunc)
+	    dscLogFunc("%d messages suppressed: %s",site->suppressed,(long)fmt,0,0,0,0);
+	  else
+	    logMsg("%d messages suppressed: %s",site->suppressed,fmt,0,0,0,0);
+	}
+      site->sec = now;
+      site->count = 0;
+      site->suppressed = 0;
+    }
+
+  if(++site->count > DSC_LOG_RATE)
+    {
+      site->suppressed++;
+      return;
+    }
+
+  if(dscLogFunc)
+    dscLogFunc(fmt,a1,a2,a3,a4,a5,a6);
+  else
+    logMsg(fmt,a1,a2,a3,a4,a5,a6);
+}
+
+#define DSCLOGHOT(fmt,a1,a2,a3,a4,a5,a6) do {				\
+    static dscLogSite _dscLogSite;					\
+    dscLogHot(&_dscLogSite,fmt,(long)(a1),(long)(a2),(long)(a3),	\
+	      (long)(a4),(long)(a5),(long)(a6));			\
+  } while(0)
+
+/*******************************************************************
+ *   Function : vmeDSCSetLogFunc
+ *
+ *   Function : Send the messages of the readout routines to func
+ *              instead of logMsg
+ *
+ *   Parameters :  DSC_LOG_FUNC func - called as logMsg, NULL for logMsg
+ *
+ *   Returns OK
+ *
+ *******************************************************************/
+
+int
+vmeDSCSetLogFunc(DSC_LOG_FUNC func)
+{
+  dscLogFunc = func;
+  return OK;
+}
+
 /*******************************************************************
  *   Function : vmeDSCReadBlock
  *                      
@@ -1916,11 +2058,11 @@ vmeDSCReadBlock(UINT32 id, volatile UINT32 *data, int nwrds, int rmode)
   volatile unsigned int *laddr;
   unsigned int vmeAdr;
 
-  CHECKID(id);
+  CHECKID_HOT(id);
 
   if(data==NULL) 
     {
-      logMsg("%s: ERROR: Invalid Destination address\n",__FUNCTION__,0,0,0,0,0);
+      DSCLOGHOT("%s: ERROR: Invalid Destination address\n",__FUNCTION__,0,0,0,0,0);
       return(ERROR);
     }
 
@@ -1928,7 +2070,7 @@ vmeDSCReadBlock(UINT32 id, volatile UINT32 *data, int nwrds, int rmode)
       
   if(rmode==0)
     { /* Programmed I/O */
-      logMsg("%s: ERROR: Mode (%d) not supported\n",__FUNCTION__,rmode,3,4,5,6);
+      DSCLOGHOT("%s: ERROR: Mode (%d) not supported\n",__FUNCTION__,rmode,3,4,5,6);
       DSCUNLOCK;
     }
   else if (rmode==1)
@@ -1952,15 +2094,15 @@ vmeDSCReadBlock(UINT32 id, volatile UINT32 *data, int nwrds, int rmode)
 	  laddr = data;
 	}
       
-      vmeAdr = ((unsigned int)(dscpd[id]) - dscA32Offset);
+      vmeAdr = (unsigned int)((unsigned long)(dscpd[id]) - dscA32Offset);
 #ifdef VXWORKS
       retVal = sysVmeDmaSend((UINT32)laddr, vmeAdr, (nwrds<<2), 0);
 #else
-      retVal = vmeDmaSend((UINT32)laddr, vmeAdr, (nwrds<<2));
+      retVal = vmeDmaSend((unsigned long)laddr, vmeAdr, (nwrds<<2));
 #endif
       if(retVal != 0) 
 	{
-	  logMsg("\n%s: ERROR in DMA transfer Initialization 0x%x\n",__FUNCTION__,retVal,0,0,0,0);
+	  DSCLOGHOT("\n%s: ERROR in DMA transfer Initialization 0x%x\n",__FUNCTION__,retVal,0,0,0,0);
 	  DSCUNLOCK;
 	  return(retVal);
 	}
@@ -1985,11 +2127,11 @@ vmeDSCReadBlock(UINT32 id, volatile UINT32 *data, int nwrds, int rmode)
       else if (retVal == 0) 
 	{
 #ifdef VXWORKS
-	  logMsg("\n%s: WARN: DMA transfer terminated by word count (nwrds = %d)\n",
-		 __FUNCTION__,nwrds,0,0,0,0,0);
+	  DSCLOGHOT("\n%s: WARN: DMA transfer terminated by word count (nwrds = %d)\n",
+		 __FUNCTION__,nwrds,0,0,0,0);
 #else
-	  logMsg("\n%s: WARN: DMA transfer returned zero word count (nwrds = %d)\n",
-		 __FUNCTION__,nwrds,0,0,0,0,0);
+	  DSCLOGHOT("\n%s: WARN: DMA transfer returned zero word count (nwrds = %d)\n",
+		 __FUNCTION__,nwrds,0,0,0,0);
 #endif
 	  DSCUNLOCK;
 	  return(retVal);
@@ -1997,10 +2139,10 @@ vmeDSCReadBlock(UINT32 id, volatile UINT32 *data, int nwrds, int rmode)
       else 
 	{  /* Error in DMA */
 #ifdef VXWORKS
-	  logMsg("\n%s: ERROR: sysVmeDmaDone returned an Error\n",
+	  DSCLOGHOT("\n%s: ERROR: sysVmeDmaDone returned an Error\n",
 		 __FUNCTION__,0,0,0,0,0);
 #else
-	  logMsg("\n%s: ERROR: vmeDmaDone returned an Error\n",
+	  DSCLOGHOT("\n%s: ERROR: vmeDmaDone returned an Error\n",
 		 __FUNCTION__,0,0,0,0,0);
 #endif
 	  DSCUNLOCK;
@@ -2011,7 +2153,7 @@ vmeDSCReadBlock(UINT32 id, volatile UINT32 *data, int nwrds, int rmode)
     }
   else
     {
-      logMsg("%s: ERROR: Unsupported mode (%d)\n",__FUNCTION__,rmode);
+      DSCLOGHOT("%s: ERROR: Unsupported mode (%d)\n",__FUNCTION__,rmode,0,0,0,0);
     }
 
   return OK;
@@ -2059,17 +2201,17 @@ vmeDSCReadScalers(UINT32 id, volatile UINT32 *data, int nwrds, int rflag, int rm
   unsigned int vmeAdr;
 #endif
 
-  CHECKID(id);
+  CHECKID_HOT(id);
 
   if(data==NULL) 
     {
-      logMsg("%s: ERROR: Invalid Destination address\n",__FUNCTION__,0,0,0,0,0);
+      DSCLOGHOT("%s: ERROR: Invalid Destination address\n",__FUNCTION__,0,0,0,0,0);
       return(ERROR);
     }
 
   if(rflag>DSC_READOUTSTART_MASK)
     {
-      logMsg("%s: ERROR: Invalid Readout Flag (0x%x)\n",__FUNCTION__,rflag,3,4,5,6);
+      DSCLOGHOT("%s: ERROR: Invalid Readout Flag (0x%x)\n",__FUNCTION__,rflag,3,4,5,6);
     }
 
   if(rmode==0)
@@ -2102,7 +2244,7 @@ vmeDSCReadScalers(UINT32 id, volatile UINT32 *data, int nwrds, int rflag, int rm
 	    {
 	      if(dCnt==nwrds)
 		{
-		  logMsg("%s: ERROR: More data than what was requested (nwrds = %d)",
+		  DSCLOGHOT("%s: ERROR: More data than what was requested (nwrds = %d)",
 			 __FUNCTION__,nwrds,3,4,5,6);
 		  DSCUNLOCK;
 		  return dCnt;
@@ -2117,7 +2259,7 @@ vmeDSCReadScalers(UINT32 id, volatile UINT32 *data, int nwrds, int rflag, int rm
 	    {
 	      if(dCnt==nwrds)
 		{
-		  logMsg("%s: ERROR: More data than what was requested (nwrds = %d)",
+		  DSCLOGHOT("%s: ERROR: More data than what was requested (nwrds = %d)",
 			 __FUNCTION__,nwrds,3,4,5,6);
 		  DSCUNLOCK;
 		  return dCnt;
@@ -2133,7 +2275,7 @@ vmeDSCReadScalers(UINT32 id, volatile UINT32 *data, int nwrds, int rflag, int rm
 	    {
 	      if(dCnt==nwrds)
 		{
-		  logMsg("%s: ERROR: More data than what was requested (nwrds = %d)",
+		  DSCLOGHOT("%s: ERROR: More data than what was requested (nwrds = %d)",
 			 __FUNCTION__,nwrds,3,4,5,6);
 		  DSCUNLOCK;
 		  return dCnt;
@@ -2149,7 +2291,7 @@ vmeDSCReadScalers(UINT32 id, volatile UINT32 *data, int nwrds, int rflag, int rm
 	    {
 	      if(dCnt==nwrds)
 		{
-		  logMsg("%s: ERROR: More data than what was requested (nwrds = %d)",
+		  DSCLOGHOT("%s: ERROR: More data than what was requested (nwrds = %d)",
 			 __FUNCTION__,nwrds,3,4,5,6);
 		  DSCUNLOCK;
 		  return dCnt;
@@ -2163,7 +2305,7 @@ vmeDSCReadScalers(UINT32 id, volatile UINT32 *data, int nwrds, int rflag, int rm
 	{
 	  if(dCnt==nwrds)
 	    {
-	      logMsg("%s: ERROR: More data than what was requested (nwrds = %d)",
+	      DSCLOGHOT("%s: ERROR: More data than what was requested (nwrds = %d)",
 		     __FUNCTION__,nwrds,3,4,5,6);
 	      DSCUNLOCK;
 	      return dCnt;
@@ -2176,7 +2318,7 @@ vmeDSCReadScalers(UINT32 id, volatile UINT32 *data, int nwrds, int rflag, int rm
 	{
 	  if(dCnt==nwrds)
 	    {
-	      logMsg("%s: ERROR: More data than what was requested (nwrds = %d)",
+	      DSCLOGHOT("%s: ERROR: More data than what was requested (nwrds = %d)",
 		     __FUNCTION__,nwrds,3,4,5,6);
 	      DSCUNLOCK;
 	      return dCnt;
@@ -2194,7 +2336,7 @@ vmeDSCReadScalers(UINT32 id, volatile UINT32 *data, int nwrds, int rflag, int rm
     { /* Single Module Block Transfer */
 #ifdef NODMA
       // FIXME: Not supported until A32 is software configured 
-      logMsg("%s: ERROR: Unsupported mode (%d)\n",__FUNCTION__,rmode);
+      DSCLOGHOT("%s: ERROR: Unsupported mode (%d)\n",__FUNCTION__,rmode,0,0,0,0);
 #else /* NODMA */
       /* Fill the output FIFO with the requested data */
       DSCLOCK;
@@ -2211,12 +2353,12 @@ vmeDSCReadScalers(UINT32 id, volatile UINT32 *data, int nwrds, int rflag, int rm
 	}
       if(ready==0)
 	{
-	  printf("%s(%2d): data not ready... \n",__FUNCTION__,id);
+	  DSCLOGHOT("%s(%2d): data not ready... \n",__FUNCTION__,id,0,0,0,0);
 	  DSCUNLOCK;
 	  return -1;
 	}
-      else
-	printf("%s(%2d): ready... \n",__FUNCTION__,id);
+/*       else */
+/* 	printf("%s(%2d): ready... \n",__FUNCTION__,id); */
 	
 
       /* Assume that the DMA programming is already setup. */
@@ -2238,16 +2380,16 @@ vmeDSCReadScalers(UINT32 id, volatile UINT32 *data, int nwrds, int rflag, int rm
 	  laddr = data;
 	}
       
-      vmeAdr = ((unsigned int)(dscpd[id]) - dscA32Offset);
-      printf("%s: vmeAdr = 0x%08x\n",__FUNCTION__,vmeAdr);
+      vmeAdr = (unsigned int)((unsigned long)(dscpd[id]) - dscA32Offset);
+/*       printf("%s: vmeAdr = 0x%08x\n",__FUNCTION__,vmeAdr); */
 #ifdef VXWORKS
       retVal = sysVmeDmaSend((UINT32)laddr, vmeAdr, (nwrds<<2), 0);
 #else
-      retVal = vmeDmaSend((UINT32)laddr, vmeAdr, (nwrds<<2));
+      retVal = vmeDmaSend((unsigned long)laddr, vmeAdr, (nwrds<<2));
 #endif
       if(retVal != 0) 
 	{
-	  logMsg("\n%s: ERROR in DMA transfer Initialization 0x%x\n",__FUNCTION__,retVal,0,0,0,0);
+	  DSCLOGHOT("\n%s: ERROR in DMA transfer Initialization 0x%x\n",__FUNCTION__,retVal,0,0,0,0);
 	  DSCUNLOCK;
 	  return(retVal);
 	}
@@ -2272,11 +2414,11 @@ vmeDSCReadScalers(UINT32 id, volatile UINT32 *data, int nwrds, int rflag, int rm
       else if (retVal == 0) 
 	{
 #ifdef VXWORKS
-	  logMsg("\n%s: WARN: DMA transfer terminated by word count (nwrds = %d)\n",
-		 __FUNCTION__,nwrds,0,0,0,0,0);
+	  DSCLOGHOT("\n%s: WARN: DMA transfer terminated by word count (nwrds = %d)\n",
+		 __FUNCTION__,nwrds,0,0,0,0);
 #else
-	  logMsg("\n%s: WARN: DMA transfer returned zero word count (nwrds = %d)\n",
-		 __FUNCTION__,nwrds,0,0,0,0,0);
+	  DSCLOGHOT("\n%s: WARN: DMA transfer returned zero word count (nwrds = %d)\n",
+		 __FUNCTION__,nwrds,0,0,0,0);
 #endif
 	  DSCUNLOCK;
 	  return(retVal);
@@ -2284,10 +2426,10 @@ vmeDSCReadScalers(UINT32 id, volatile UINT32 *data, int nwrds, int rflag, int rm
       else 
 	{  /* Error in DMA */
 #ifdef VXWORKS
-	  logMsg("\n%s: ERROR: sysVmeDmaDone returned an Error\n",
+	  DSCLOGHOT("\n%s: ERROR: sysVmeDmaDone returned an Error\n",
 		 __FUNCTION__,0,0,0,0,0);
 #else
-	  logMsg("\n%s: ERROR: vmeDmaDone returned an Error\n",
+	  DSCLOGHOT("\n%s: ERROR: vmeDmaDone returned an Error\n",
 		 __FUNCTION__,0,0,0,0,0);
 #endif
 	  DSCUNLOCK;
@@ -2299,7 +2441,7 @@ vmeDSCReadScalers(UINT32 id, volatile UINT32 *data, int nwrds, int rflag, int rm
     }
   else
     {
-      logMsg("%s: ERROR: Unsupported mode (%d)\n",__FUNCTION__,rmode);
+      DSCLOGHOT("%s: ERROR: Unsupported mode (%d)\n",__FUNCTION__,rmode,0,0,0,0);
     }
 
   return OK;
@@ -2734,7 +2876,7 @@ int
 vmeDSCUpdateFirmware(UINT32 id, const char *filename)
 {
   FILE *f;
-  int i, flashId = 0;
+  int i, flashId = 0, status;
   unsigned int addr = 0, page = 0;
   unsigned char buf[528];
 
@@ -2775,19 +2917,23 @@ vmeDSCUpdateFirmware(UINT32 id, const char *filename)
 	      vmeWrite32(&dscp[id]->calExe,1);
 	      while(vmeRead32(&dscp[id]->calCmd) != 0xFFFFFFFF);
 
+	      /* Other modules may use the bus while this one erases */
+	      DSCUNLOCK;
 	      i = 0;
 	      while(1)
 		{
-		  if(!(vmeDSCFlashPollStatus(id,0x05) & 0x1))	// ~10us per poll
+		  DSCLOCK;
+		  status = vmeDSCFlashPollStatus(id,0x05);
+		  DSCUNLOCK;
+		  if(!(status & 0x1))	// ~10us per poll
 		    break;
-		  if(!(i % 30000))
+		  if(!(i % 30000) && !dscFlashQuiet)
 		    {
 		      printf(".");
 		      fflush(stdout);
 		    }
 		  if(i == 300000)	// max 3s sector erase time
 		    {
-		      DSCUNLOCK;
 		      fclose(f);
 		      printf("%s: ERROR: failed to erase flash\n", 
 			     __FUNCTION__);
@@ -2795,6 +2941,7 @@ vmeDSCUpdateFirmware(UINT32 id, const char *filename)
 		    }
 		  i++;
 		}
+	      DSCLOCK;
 	    }
 
 	  vmeWrite32(&dscp[id]->calBuf[1],0x06);	// write enable
@@ -2816,18 +2963,21 @@ vmeDSCUpdateFirmware(UINT32 id, const char *filename)
 	  while(vmeRead32(&dscp[id]->calCmd) != 0xFFFFFFFF)
 	    {
 	      iwait++;
-	      if(iwait%1000==0)
+	      if((iwait%1000==0) && !dscFlashQuiet)
 		printf("X"); fflush(stdout);
 	    }
 
+	  DSCUNLOCK;
 	  i = 0;
 	  while(1)
 	    {
-	      if(!(vmeDSCFlashPollStatus(id,0x05) & 0x1))	// ~10us per poll
+	      DSCLOCK;
+	      status = vmeDSCFlashPollStatus(id,0x05);
+	      DSCUNLOCK;
+	      if(!(status & 0x1))	// ~10us per poll
 		break;
 	      if(i == 500)	// max 5ms page program time
 		{
-		  DSCUNLOCK;
 		  fclose(f);
 		  printf("%s: ERROR: failed to program flash\n", 
 			 __FUNCTION__);
@@ -2835,8 +2985,10 @@ vmeDSCUpdateFirmware(UINT32 id, const char *filename)
 		}
 	      i++;
 	    }
+	  DSCLOCK;
 
 	  addr+= 256;
+	  dscFlashBytes[id] = addr;
 	}
     }
   else if(flashId == 0x1F)	// Atmel flash
@@ -2878,14 +3030,17 @@ vmeDSCUpdateFirmware(UINT32 id, const char *filename)
 	  vmeWrite32(&dscp[id]->calExe,1);
 	  while(vmeRead32(&dscp[id]->calCmd) != 0xFFFFFFFF);
 
+	  DSCUNLOCK;
 	  i = 0;
 	  while(1)
 	    {
-	      if(vmeDSCFlashPollStatus(id,0xD7) & 0x80)	// ~10us per poll
+	      DSCLOCK;
+	      status = vmeDSCFlashPollStatus(id,0xD7);
+	      DSCUNLOCK;
+	      if(status & 0x80)	// ~10us per poll
 		break;
 	      if(i == 4000)	// max 40ms page erase+prog time
 		{
-		  DSCUNLOCK;
 		  fclose(f);
 		  printf("%s: ERROR: failed to erase flash\n", 
 			 __FUNCTION__);
@@ -2893,8 +3048,10 @@ vmeDSCUpdateFirmware(UINT32 id, const char *filename)
 		}
 	      i++;
 	    }
+	  DSCLOCK;
 	  page++;
-	  if(!(page % 10))
+	  dscFlashBytes[id] = page*528;
+	  if(!(page % 10) && !dscFlashQuiet)
 	    {
 	      printf(".");
 	      fflush(stdout);
@@ -2970,6 +3127,12 @@ vmeDSCVerifyFirmware(UINT32 id, const char *filename)
 		}
 	    }
 	  addr+=256;
+	  dscFlashBytes[id] = addr;
+
+	  /* Let the other modules use the bus between pages */
+	  DSCUNLOCK;
+	  sched_yield();
+	  DSCLOCK;
 	}
       vmeDSCFlashChipSelect(id, 0);
     }
@@ -3006,6 +3169,12 @@ vmeDSCVerifyFirmware(UINT32 id, const char *filename)
 		}
 	    }
 	  addr+=264;
+	  dscFlashBytes[id] = addr;
+
+	  /* Let the other modules use the bus between pages */
+	  DSCUNLOCK;
+	  sched_yield();
+	  DSCLOCK;
 	}
       vmeDSCFlashChipSelect(id, 0);
     }
@@ -3022,39 +3191,152 @@ vmeDSCVerifyFirmware(UINT32 id, const char *filename)
   return OK;
 }
 
+typedef struct
+{
+  int          id;
+  const char  *filename;
+  volatile int step;      /* 0 write, 1 verify, 2 reload, 3 done */
+  volatile int running;
+  int          result;
+} dscFlashJob;
+
+static const char *dscFlashStepName[4] = { "write", "verify", "reload", "done" };
+
+static void *
+vmeDSCFlashWorker(void *arg)
+{
+  dscFlashJob *job = (dscFlashJob *)arg;
+
+  dscFlashBytes[job->id] = 0;
+  job->result = vmeDSCUpdateFirmware(job->id, job->filename);
+
+  if(job->result == OK)
+    {
+      job->step = 1;
+      dscFlashBytes[job->id] = 0;
+      job->result = vmeDSCVerifyFirmware(job->id, job->filename);
+    }
+
+  if(job->result == OK)
+    {
+      job->step = 2;
+      DSCLOCK;
+      vmeDSCReloadFPGA(job->id);
+      DSCUNLOCK;
+      sleep(2);
+      job->step = 3;
+    }
+
+  job->running = 0;
+  return NULL;
+}
+
+/*
+  Update, verify and reload the firmware of all initialized modules, each
+  module on its own thread.  The flash code holds the library lock for one
+  SPI transfer at a time, so the sector erase and page program waits of one
+  module overlap the page writes of the others.  The progress of every
+  module is printed every 5 seconds.  A module that fails does not stop
+  the others.
+
+  RETURNS: OK if all modules were updated, otherwise ERROR.
+*/
 int
 vmeDSCUpdateFirmwareAll(const char *filename)
 {
-  int idsc, result;
-	
+  dscFlashJob job[DSC_MAX_BOARDS+1];
+  pthread_t worker[DSC_MAX_BOARDS+1];
+  int started[DSC_MAX_BOARDS+1];
+  int idsc, id, pct, nrun, nfail = 0, elapsed = 0;
+  long size;
+  FILE *f;
+
+  f = fopen(filename, "rb");
+  if(!f)
+    {
+      printf("%s: ERROR: invalid file %s\n", 
+	     __FUNCTION__, filename);
+      return ERROR;
+    }
+  fseek(f, 0, SEEK_END);
+  size = ftell(f);
+  fclose(f);
+  if(size <= 0)
+    size = 1;
+
+  printf("%s: Updating firmware on %d unit(s) with %s\n",
+	 __FUNCTION__, Ndsc, filename);
+
+  dscFlashQuiet = 1;
   for(idsc = 0; idsc < Ndsc; idsc++)
     {
-      printf("Updating firmware on unit %d...", idsc);
-      fflush(stdout);
-      result = vmeDSCUpdateFirmware(idsc, filename);
-      if(result != OK)
+      job[idsc].id       = vmeDSCSlot(idsc);
+      job[idsc].filename = filename;
+      job[idsc].step     = 0;
+      job[idsc].running  = 1;
+      job[idsc].result   = ERROR;
+      started[idsc] = 0;
+
+      if(pthread_create(&worker[idsc], NULL, vmeDSCFlashWorker, &job[idsc]) != 0)
 	{
-	  printf("failed.\n");
-	  return result;
+	  printf("%s: ERROR: Unable to start the thread for unit %d\n",
+		 __FUNCTION__, idsc);
+	  job[idsc].running = 0;
 	}
       else
-	printf("succeeded.");
-		
-      printf(" Verifying.");
-      fflush(stdout);
-      result = vmeDSCVerifyFirmware(idsc, filename);
-      if(result != OK)
+	started[idsc] = 1;
+    }
+
+  do
+    {
+      sleep(1);
+      elapsed++;
+
+      nrun = 0;
+      for(idsc = 0; idsc < Ndsc; idsc++)
+	if(job[idsc].running)
+	  nrun++;
+
+      if(((elapsed % 5) == 0) || (nrun == 0))
 	{
-	  printf("failed.\n");
-	  return result;
+	  printf("%4ds:", elapsed);
+	  for(idsc = 0; idsc < Ndsc; idsc++)
+	    {
+	      id = job[idsc].id;
+	      if(!job[idsc].running && (job[idsc].result != OK))
+		printf("  %2d FAILED", idsc);
+	      else if(job[idsc].step < 2)
+		{
+		  pct = (int)((100. * dscFlashBytes[id]) / size);
+		  printf("  %2d %s %d%%", idsc, dscFlashStepName[job[idsc].step],
+			 (pct > 100) ? 100 : pct);
+		}
+	      else
+		printf("  %2d %s", idsc, dscFlashStepName[job[idsc].step]);
+	    }
+	  printf("\n");
+	  fflush(stdout);
 	}
-      else
-	printf("ok.\n");
+    }
+  while(nrun > 0);
+  dscFlashQuiet = 0;
 
-      vmeDSCReloadFPGA(idsc);
-      sleep(2);
+  for(idsc = 0; idsc < Ndsc; idsc++)
+    {
+      if(started[idsc])
+	pthread_join(worker[idsc], NULL);
+
+      if(job[idsc].result == OK)
+	printf("Unit %d: updated, verified and reloaded\n", idsc);
+      else
+	{
+	  printf("Unit %d: FAILED at %s\n",
+		 idsc, dscFlashStepName[job[idsc].step]);
+	  nfail++;
+	}
     }
-  return OK;
+
+  return (nfail > 0) ? ERROR : OK;
 }
 
 int
@@ -213,6 +213,10 @@ struct dsc_struct
 #define DSC_DATA_TYPE_FILLER          15
 #define DSC_DATA_FILLER               (DSC_DATA_TYPE_FILLER<<27)
 
+/* Readout routine messages (vmeDSCSetLogFunc) */
+#define DSC_LOG_RATE                  10  /* per second and call site */
+typedef int (*DSC_LOG_FUNC)(const char *fmt, long a1, long a2, long a3,
+			    long a4, long a5, long a6);
 
 /* Function Prototypes */
 int  vmeDSCInit(unsigned int addr, unsigned int addr_incr, int ndsc, int iFlag);
@@ -242,6 +246,8 @@ int  vmeDSCGetDelay(UINT32 id, UINT16 type);
 int  vmeDSCSetTestInput(UINT32 id, UINT32 flag);
 int  vmeDSCTestPulse(UINT32 id, UINT32 npulses);
 int  vmeDSCLatchScalers(UINT32 id, UINT16 type);
+int  vmeDSCReadLatchedScalers(UINT32 id, UINT16 group, UINT32 *tdc, UINT32 *trg,
+			      UINT32 *ref);
 int  vmeDSCSetGateSource(UINT32 id, UINT16 group, UINT32 srcMask);
 UINT32 vmeDSCGetAdr32(int id);
 int  vmeDSCSetAdr32(UINT32 id, UINT32 a32base, UINT16 enable);
@@ -253,9 +259,13 @@ int  vmeDSCReadoutConfig(UINT32 id, UINT32 rconf, UINT32 rsrc);
 int  vmeDSCSoftTrigger(UINT32 id);
 int  vmeDSCReadBlock(UINT32 id, volatile UINT32 *data, int nwrds, int rmode);
 int  vmeDSCReadScalers(UINT32 id, volatile UINT32 *data, int nwrds, int rflag, int rmode);
+int  vmeDSCSetLogFunc(DSC_LOG_FUNC func);
 int  vmeDSCPrintScalers(UINT32 id, int rflag);
 int  vmeDSCPrintScalerRates(UINT32 id, int rflag);
 int  vmeDSCSetPulseWidthAll(UINT16 tdcVal, UINT16 trgVal, UINT16 trgoutVal);
 int  vmeDSCSetThresholdAll(UINT16 tdcVal, UINT16 trgVal);
 int  vmeDSCSetBipolarThresholdAll(INT16 tdcVal, INT16 trgVal);
+int  vmeDSCUpdateFirmware(UINT32 id, const char *filename);
+int  vmeDSCVerifyFirmware(UINT32 id, const char *filename);
+int  vmeDSCUpdateFirmwareAll(const char *filename);
 #endif /* __VMEDSC__ */